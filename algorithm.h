@@ -11,11 +11,16 @@
 #pragma once
 
 #include <stdlib.h>
+#include <string.h>
 
 #ifndef THOR_SORT_H
 #include "sort.h"
 #endif
 
+#ifndef THOR_RADIX_SORT_H
+#include "radix_sort.h"
+#endif
+
 #ifndef THOR_SWAP_H
 #include "swap.h"
 #endif
@@ -24,15 +29,63 @@
 #include "heap.h"
 #endif
 
+#ifndef THOR_SELECT_H
+#include "select.h"
+#endif
+
 #ifndef THOR_PAIR_H
 #include "pair.h"
 #endif
 
+#ifndef THOR_SIMD_H
+#include "simd.h"
+#endif
+
+#ifndef THOR_MEMORY_H
+#include "memory.h"
+#endif
+
 namespace thor
 {
 
+// Fast paths for plain-old-data types.
+//
+// Iterators over contiguous memory are reduced to pointers with __unwrap_iter() (vector iterators
+// provide their own overloads), and __rewrap_iter() turns the resulting pointer back into the
+// original iterator type. Algorithms such as copy() and fill() then dispatch on a tag: when both
+// ranges are pointers to the same plain-old-data type they use memmove(), memset() or memcmp().
+template <class Iterator> inline Iterator __unwrap_iter(const Iterator& i)
+{
+    return i;
+}
+
+template <class Iterator> inline Iterator __rewrap_iter(const Iterator&, const Iterator& result)
+{
+    return result;
+}
+
+struct __not_a_pointer {};
+
+// value_type is the pointed-to type if Iterator1 and Iterator2 are both pointers to it (either may be const)
+template <class Iterator1, class Iterator2> struct __pointer_pair        { typedef __not_a_pointer value_type; };
+template <class T> struct __pointer_pair<T*, T*>                         { typedef T value_type; };
+template <class T> struct __pointer_pair<const T*, T*>                   { typedef T value_type; };
+template <class T> struct __pointer_pair<T*, const T*>                   { typedef T value_type; };
+template <class T> struct __pointer_pair<const T*, const T*>             { typedef T value_type; };
+
+// Whether operator == on T is equivalent to comparing the bytes (not so for floating point: 0.0 == -0.0)
+template <class T> struct __bitwise_equality        { typedef typename is_pod_type<T>::Type Type; };
+template <> struct __bitwise_equality<float>        { typedef false_type Type; };
+template <> struct __bitwise_equality<double>       { typedef false_type Type; };
+template <> struct __bitwise_equality<long double>  { typedef false_type Type; };
+
+// Whether operator < on T is equivalent to memcmp() (only unsigned bytes)
+template <class T> struct __bytewise_order          { typedef false_type Type; };
+template <> struct __bytewise_order<unsigned char>  { typedef true_type Type; };
+template <> struct __bytewise_order<bool>           { typedef true_type Type; };
+
 template <class InputIterator1, class InputIterator2>
-bool equal(InputIterator1 f1, InputIterator1 l1, InputIterator2 f2)
+inline bool __equal(InputIterator1 f1, InputIterator1 l1, InputIterator2 f2, const false_type&)
 {
     for (; f1 != l1; ++f1, ++f2)
     {
@@ -44,6 +97,41 @@ bool equal(InputIterator1 f1, InputIterator1 l1, InputIterator2 f2)
     return true;
 }
 
+template <class T1, class T2>
+inline bool __equal(T1* f1, T1* l1, T2* f2, const true_type&)
+{
+    const difference_type n = l1 - f1;
+    return n <= 0 || memcmp(f1, f2, n * sizeof(T1)) == 0;
+}
+
+// Floating point ranges can not be compared with memcmp(), but can be compared with SIMD
+struct __simd_equal_tag {};
+template <class T> struct __equal_method            { typedef typename __bitwise_equality<T>::Type Type; };
+#ifdef THOR_SIMD_SSE2
+template <> struct __equal_method<float>            { typedef __simd_equal_tag Type; };
+template <> struct __equal_method<double>           { typedef __simd_equal_tag Type; };
+
+template <class T1, class T2>
+inline bool __equal(T1* f1, T1* l1, T2* f2, const __simd_equal_tag&)
+{
+    const difference_type n = l1 - f1;
+    return n <= 0 || __simd_equal(f1, size_type(n), f2);
+}
+#endif
+
+template <class InputIterator1, class InputIterator2>
+inline bool __equal_unwrapped(InputIterator1 f1, InputIterator1 l1, InputIterator2 f2)
+{
+    typedef typename __pointer_pair<InputIterator1, InputIterator2>::value_type value_type;
+    return __equal(f1, l1, f2, typename __equal_method<value_type>::Type());
+}
+
+template <class InputIterator1, class InputIterator2>
+bool equal(InputIterator1 f1, InputIterator1 l1, InputIterator2 f2)
+{
+    return __equal_unwrapped(__unwrap_iter(f1), __unwrap_iter(l1), __unwrap_iter(f2));
+}
+
 template <class InputIterator1, class InputIterator2, class BinaryPredicate>
 bool equal(InputIterator1 f1, InputIterator1 l1, InputIterator2 f2, BinaryPredicate pred)
 {
@@ -58,9 +146,180 @@ bool equal(InputIterator1 f1, InputIterator1 l1, InputIterator2 f2, BinaryPredic
 }
 
 
+template <class InputIterator, class T> InputIterator __find(InputIterator first, InputIterator last, const T& val, const random_access_iterator_tag&)
+{
+    difference_type check_count = (last - first) / 4;
+    for (; check_count > 0; --check_count)
+    {
+        if (*first == val) return first;
+        ++first;
+
+        if (*first == val) return first;
+        ++first;
+
+        if (*first == val) return first;
+        ++first;
+
+        if (*first == val) return first;
+        ++first;
+    }
+
+    switch (last - first)
+    {
+    case 3:
+        if (*first == val) return first;
+        ++first;
+    case 2:
+        if (*first == val) return first;
+        ++first;
+    case 1:
+        if (*first == val) return first;
+        ++first;
+    case 0:
+    default:
+        return first;
+    }
+}
+
+template <class InputIterator, class T> InputIterator __find(InputIterator first, InputIterator last, const T& val, const input_iterator_tag&)
+{
+    while (first != last && !(*first == val))
+    {
+        ++first;
+    }
+    return first;
+}
+
+template <class InputIterator, class T> InputIterator __find_simd(InputIterator first, InputIterator last, const T& val, const false_type&)
+{
+    return __find(first, last, val, THOR_GET_CATEGORY(first,InputIterator));
+}
+
+#ifdef THOR_SIMD_SSE2
+template <class U, class T> U* __find_simd(U* first, U* last, const T& val, const true_type&)
+{
+    // If val doesn't survive the conversion, no element can compare equal to it (this includes NaN)
+    const U v = static_cast<U>(val);
+    if (!(v == val))
+    {
+        return last;
+    }
+    return first + __simd_find(first, size_type(last - first), v);
+}
+#endif
+
+template <class InputIterator, class T> inline InputIterator __find_unwrapped(InputIterator first, InputIterator last, const T& val)
+{
+    typedef typename __pointer_pair<InputIterator, InputIterator>::value_type value_type;
+    return __find_simd(first, last, val, typename __simd_value_tag<value_type, T>::Type());
+}
+
+template <class InputIterator, class T> InputIterator find(InputIterator first, InputIterator last, const T& val)
+{
+    return __rewrap_iter(first, __find_unwrapped(__unwrap_iter(first), __unwrap_iter(last), val));
+}
+
+template <class InputIterator, class Predicate> InputIterator __find_if(InputIterator first, InputIterator last, Predicate pred, const random_access_iterator_tag&)
+{
+    difference_type check_count = (last - first) / 4;
+    for (; check_count > 0; --check_count)
+    {
+        if (pred(*first)) return first;
+        ++first;
+
+        if (pred(*first)) return first;
+        ++first;
+
+        if (pred(*first)) return first;
+        ++first;
+
+        if (pred(*first)) return first;
+        ++first;
+    }
+
+    switch (last - first)
+    {
+    case 3:
+        if (pred(*first)) return first;
+        ++first;
+    case 2:
+        if (pred(*first)) return first;
+        ++first;
+    case 1:
+        if (pred(*first)) return first;
+        ++first;
+    case 0:
+    default:
+        return first;
+    }
+}
+
+template <class InputIterator, class Predicate> InputIterator __find_if(InputIterator first, InputIterator last, Predicate pred, const input_iterator_tag&)
+{
+    while (first != last && !pred(*first))
+    {
+        ++first;
+    }
+    return first;
+}
+
+template <class InputIterator, class Predicate> InputIterator find_if(InputIterator first, InputIterator last, Predicate pred)
+{
+    return __find_if(first, last, pred, THOR_GET_CATEGORY(first, InputIterator));
+}
+
+template <class InputIterator, class T> difference_type __count_simd(InputIterator first, InputIterator last, const T& val, const false_type&)
+{
+    difference_type n = 0;
+    for (; first != last; ++first)
+    {
+        if (*first == val)
+        {
+            ++n;
+        }
+    }
+    return n;
+}
+
+#ifdef THOR_SIMD_SSE2
+template <class U, class T> difference_type __count_simd(U* first, U* last, const T& val, const true_type&)
+{
+    const U v = static_cast<U>(val);
+    if (!(v == val))
+    {
+        return 0;
+    }
+    return difference_type(__simd_count(first, size_type(last - first), v));
+}
+#endif
+
+template <class InputIterator, class T> inline difference_type __count_unwrapped(InputIterator first, InputIterator last, const T& val)
+{
+    typedef typename __pointer_pair<InputIterator, InputIterator>::value_type value_type;
+    return __count_simd(first, last, val, typename __simd_value_tag<value_type, T>::Type());
+}
+
+template <class InputIterator, class T> difference_type count(InputIterator first, InputIterator last, const T& val)
+{
+    return __count_unwrapped(__unwrap_iter(first), __unwrap_iter(last), val);
+}
+
+template <class InputIterator, class Predicate> difference_type count_if(InputIterator first, InputIterator last, Predicate pred)
+{
+    difference_type n = 0;
+    for (; first != last; ++first)
+    {
+        if (pred(*first))
+        {
+            ++n;
+        }
+    }
+    return n;
+}
+
 template <class InputIterator1, class InputIterator2>
-bool lexicographical_compare(InputIterator1 f1, InputIterator1 l1,
-                             InputIterator2 f2, InputIterator2 l2)
+inline bool __lexicographical_compare(InputIterator1 f1, InputIterator1 l1,
+                                      InputIterator2 f2, InputIterator2 l2, const false_type&)
 {
     for (; f1 != l1 && f2 != l2; ++f1, ++f2)
     {
@@ -76,6 +335,31 @@ bool lexicographical_compare(InputIterator1 f1, InputIterator1 l1,
     return f1 == l1 && f2 != l2;
 }
 
+template <class T1, class T2>
+inline bool __lexicographical_compare(T1* f1, T1* l1, T2* f2, T2* l2, const true_type&)
+{
+    const size_t n1 = size_t(l1 - f1);
+    const size_t n2 = size_t(l2 - f2);
+    const size_t n = n1 < n2 ? n1 : n2;
+    const int result = n == 0 ? 0 : memcmp(f1, f2, n);
+    return result < 0 || (result == 0 && n1 < n2);
+}
+
+template <class InputIterator1, class InputIterator2>
+inline bool __lexicographical_compare_unwrapped(InputIterator1 f1, InputIterator1 l1,
+                                                InputIterator2 f2, InputIterator2 l2)
+{
+    typedef typename __pointer_pair<InputIterator1, InputIterator2>::value_type value_type;
+    return __lexicographical_compare(f1, l1, f2, l2, typename __bytewise_order<value_type>::Type());
+}
+
+template <class InputIterator1, class InputIterator2>
+bool lexicographical_compare(InputIterator1 f1, InputIterator1 l1,
+                             InputIterator2 f2, InputIterator2 l2)
+{
+    return __lexicographical_compare_unwrapped(__unwrap_iter(f1), __unwrap_iter(l1), __unwrap_iter(f2), __unwrap_iter(l2));
+}
+
 template <class InputIterator1, class InputIterator2, class Compare>
 bool lexicographical_compare(InputIterator1 f1, InputIterator1 l1,
                              InputIterator2 f2, InputIterator2 l2,
@@ -137,9 +421,9 @@ template <class ForwardIterator, class BinaryPredicate> ForwardIterator unique(F
     return ++new_end;
 }
 
-template <class InputIterator, class OutputIterator> OutputIterator copy(InputIterator first, InputIterator last, OutputIterator output)
+template <class InputIterator, class OutputIterator>
+inline OutputIterator __copy(InputIterator first, InputIterator last, OutputIterator output, const false_type&)
 {
-    // TODO: Specialize for POD types
     while (first != last)
     {
         *output++ = *first++;
@@ -147,9 +431,33 @@ template <class InputIterator, class OutputIterator> OutputIterator copy(InputIt
     return output;
 }
 
-template <class RandomAccessIterator, class OutputIterator> OutputIterator copy_backward(RandomAccessIterator first, RandomAccessIterator last, OutputIterator output)
+// memmove() rather than memcpy() since the ranges may overlap (with output before first)
+template <class T1, class T2>
+inline T2* __copy(T1* first, T1* last, T2* output, const true_type&)
+{
+    const difference_type n = last - first;
+    if (n > 0)
+    {
+        memmove(output, first, n * sizeof(T2));
+    }
+    return output + n;
+}
+
+template <class InputIterator, class OutputIterator>
+inline OutputIterator __copy_unwrapped(InputIterator first, InputIterator last, OutputIterator output)
+{
+    typedef typename __pointer_pair<InputIterator, OutputIterator>::value_type value_type;
+    return __copy(first, last, output, typename is_pod_type<value_type>::Type());
+}
+
+template <class InputIterator, class OutputIterator> OutputIterator copy(InputIterator first, InputIterator last, OutputIterator output)
+{
+    return __rewrap_iter(output, __copy_unwrapped(__unwrap_iter(first), __unwrap_iter(last), __unwrap_iter(output)));
+}
+
+template <class RandomAccessIterator, class OutputIterator>
+inline OutputIterator __copy_backward(RandomAccessIterator first, RandomAccessIterator last, OutputIterator output, const false_type&)
 {
-    // TODO: Specialize for POD types
     for (difference_type d = last - first; d > 0; --d)
     {
         *--output = *--last;
@@ -157,6 +465,108 @@ template <class RandomAccessIterator, class OutputIterator> OutputIterator copy_
     return output;
 }
 
+template <class T1, class T2>
+inline T2* __copy_backward(T1* first, T1* last, T2* output, const true_type&)
+{
+    const difference_type n = last - first;
+    if (n > 0)
+    {
+        memmove(output - n, first, n * sizeof(T2));
+    }
+    return output - n;
+}
+
+template <class RandomAccessIterator, class OutputIterator>
+inline OutputIterator __copy_backward_unwrapped(RandomAccessIterator first, RandomAccessIterator last, OutputIterator output)
+{
+    typedef typename __pointer_pair<RandomAccessIterator, OutputIterator>::value_type value_type;
+    return __copy_backward(first, last, output, typename is_pod_type<value_type>::Type());
+}
+
+template <class RandomAccessIterator, class OutputIterator> OutputIterator copy_backward(RandomAccessIterator first, RandomAccessIterator last, OutputIterator output)
+{
+    return __rewrap_iter(output, __copy_backward_unwrapped(__unwrap_iter(first), __unwrap_iter(last), __unwrap_iter(output)));
+}
+
+template <class ForwardIterator, class T>
+inline void __fill(ForwardIterator first, ForwardIterator last, const T& value, const false_type&)
+{
+    for (; first != last; ++first)
+    {
+        *first = value;
+    }
+}
+
+// memset() can be used whenever every byte of the value is the same (always for single-byte types,
+// and commonly for zero)
+template <class U, class T>
+inline void __fill(U* first, U* last, const T& value, const true_type&)
+{
+    const U v(value);
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&v);
+    size_t i = 1;
+    while (i != sizeof(U) && bytes[i] == bytes[0])
+    {
+        ++i;
+    }
+    if (i == sizeof(U))
+    {
+        if (last - first > 0)
+        {
+            memset(first, bytes[0], (last - first) * sizeof(U));
+        }
+    }
+    else
+    {
+        __fill(first, last, v, false_type());
+    }
+}
+
+template <class ForwardIterator, class T>
+inline void __fill_unwrapped(ForwardIterator first, ForwardIterator last, const T& value)
+{
+    typedef typename __pointer_pair<ForwardIterator, ForwardIterator>::value_type value_type;
+    __fill(first, last, value, typename is_pod_type<value_type>::Type());
+}
+
+template <class ForwardIterator, class T> void fill(ForwardIterator first, ForwardIterator last, const T& value)
+{
+    __fill_unwrapped(__unwrap_iter(first), __unwrap_iter(last), value);
+}
+
+template <class OutputIterator, class Size, class T>
+inline OutputIterator __fill_n(OutputIterator first, Size n, const T& value, const false_type&)
+{
+    for (; n > 0; --n, ++first)
+    {
+        *first = value;
+    }
+    return first;
+}
+
+template <class U, class Size, class T>
+inline U* __fill_n(U* first, Size n, const T& value, const true_type&)
+{
+    if (n <= 0)
+    {
+        return first;
+    }
+    __fill(first, first + n, value, true_type());
+    return first + n;
+}
+
+template <class OutputIterator, class Size, class T>
+inline OutputIterator __fill_n_unwrapped(OutputIterator first, Size n, const T& value)
+{
+    typedef typename __pointer_pair<OutputIterator, OutputIterator>::value_type value_type;
+    return __fill_n(first, n, value, typename is_pod_type<value_type>::Type());
+}
+
+template <class OutputIterator, class Size, class T> OutputIterator fill_n(OutputIterator first, Size n, const T& value)
+{
+    return __rewrap_iter(first, __fill_n_unwrapped(__unwrap_iter(first), n, value));
+}
+
 template <class InputIterator, class UnaryPredicate> UnaryPredicate for_each(InputIterator first, InputIterator last, UnaryPredicate pred)
 {
     while (first != last)
@@ -178,70 +588,437 @@ inline ForwardIterator2 swap_ranges(ForwardIterator1 first1, ForwardIterator1 la
     {
         iter_swap(first1, first2);
     }
-    return first2;
+    return first2;
+}
+
+template <class Distance> inline Distance __random(Distance n)
+{
+    return rand() % n;
+}
+
+template <class RandomAccessIterator> void random_shuffle(RandomAccessIterator first, RandomAccessIterator last)
+{
+    if (first == last)
+    {
+        return;
+    }
+
+    for (RandomAccessIterator iter = first + 1; iter != last; ++iter)
+    {
+        thor::iter_swap(iter, first + __random((iter - first) + 1));
+    }
+}
+
+template <class RandomAccessIterator, class RandomNumberGenerator> void random_shuffle(RandomAccessIterator first, RandomAccessIterator last, RandomNumberGenerator prng)
+{
+    if (first == last)
+    {
+        return;
+    }
+
+    for (RandomAccessIterator iter = first + 1; iter != last; ++iter)
+    {
+        thor::iter_swap(iter, first + prng((iter - first) + 1));
+    }
+}
+
+template <class InputIterator1, class InputIterator2, class OutputIterator>
+OutputIterator merge(InputIterator1 first1, InputIterator1 last1,
+                     InputIterator2 first2, InputIterator2 last2,
+                     OutputIterator result)
+{
+    while (first1 != last1 && first2 != last2)
+    {
+      if (*first2 < *first1)
+      {
+          *result = *first2;
+          ++first2;
+      }
+      else
+      {
+          *result = *first1;
+          ++first1;
+      }
+      ++result;
+    }
+    return copy(first2, last2, copy(first1, last1, result));
+}
+
+template <class InputIterator1, class InputIterator2, class OutputIterator, class Compare>
+OutputIterator merge(InputIterator1 first1, InputIterator1 last1,
+                     InputIterator2 first2, InputIterator2 last2,
+                     OutputIterator result, Compare comp)
+{
+    while (first1 != last1 && first2 != last2)
+    {
+        if (comp(*first2, *first1))
+        {
+            *result = *first2;
+            ++first2;
+        }
+        else
+        {
+            *result = *first1;
+            ++first1;
+        }
+        ++result;
+    }
+    return thor::copy(first2, last2, thor::copy(first1, last1, result));
+}
+
+// operator < between an element and a value of another type, for the searches without a comparison
+struct __less_op
+{
+    template <class T1, class T2> bool operator () (const T1& lhs, const T2& rhs) const { return lhs < rhs; }
+};
+
+template <class Iterator> inline void __prefetch_element(const Iterator&) {}
+template <class T> inline void __prefetch_element(T* p)   { memory::prefetch(p); }
+
+template <class ForwardIterator, class T, class LessThanComparable>
+ForwardIterator __lower_bound(ForwardIterator first, ForwardIterator last, const T& t, LessThanComparable comp, const forward_iterator_tag&)
+{
+    difference_type size = thor::distance(first, last);
+    THOR_ASSERT(size >= 0);
+    difference_type half;
+    ForwardIterator middle;
+
+    while (size > 0)
+    {
+        half = size >> 1;
+        middle = first;
+        thor::advance(middle, half);
+        if (comp(*middle, t))
+        {
+            first = middle;
+            ++first;
+            size = size - half - 1;
+        }
+        else
+        {
+            size = half;
+        }
+    }
+    return first;
+}
+
+// Random access searches are branchless: each step moves first by half or not at all, which compiles to a
+// conditional move, so there are no mispredictions. Since the next element compared can't be known until the
+// current comparison completes, both candidates are prefetched when the range is contiguous memory.
+template <class RandomAccessIterator, class T, class LessThanComparable>
+RandomAccessIterator __lower_bound(RandomAccessIterator first, RandomAccessIterator last, const T& t, LessThanComparable comp, const random_access_iterator_tag&)
+{
+    difference_type size = last - first;
+    THOR_ASSERT(size >= 0);
+    if (size <= 0)
+    {
+        return first;
+    }
+
+    while (size > 1)
+    {
+        const difference_type half = size >> 1;
+        __prefetch_element(first + (half >> 1));
+        __prefetch_element(first + (half + (half >> 1)));
+        first += comp(*(first + half), t) ? half : 0;
+        size -= half;
+    }
+    return first + (comp(*first, t) ? 1 : 0);
+}
+
+template <class ForwardIterator, class T, class LessThanComparable>
+ForwardIterator __upper_bound(ForwardIterator first, ForwardIterator last, const T& t, LessThanComparable comp, const forward_iterator_tag&)
+{
+    difference_type size = thor::distance(first, last);
+    THOR_ASSERT(size >= 0);
+    difference_type half;
+
+    while (size > 0)
+    {
+        half = size >> 1;
+        ForwardIterator middle = first;
+        thor::advance(middle, half);
+        if (comp(t, *middle))
+        {
+            size = half;
+        }
+        else
+        {
+            first = middle;
+            ++first;
+            size = size - half - 1;
+        }
+    }
+    return first;
+}
+
+template <class RandomAccessIterator, class T, class LessThanComparable>
+RandomAccessIterator __upper_bound(RandomAccessIterator first, RandomAccessIterator last, const T& t, LessThanComparable comp, const random_access_iterator_tag&)
+{
+    difference_type size = last - first;
+    THOR_ASSERT(size >= 0);
+    if (size <= 0)
+    {
+        return first;
+    }
+
+    while (size > 1)
+    {
+        const difference_type half = size >> 1;
+        __prefetch_element(first + (half >> 1));
+        __prefetch_element(first + (half + (half >> 1)));
+        first += comp(t, *(first + half)) ? 0 : half;
+        size -= half;
+    }
+    return first + (comp(t, *first) ? 0 : 1);
+}
+
+template <class ForwardIterator, class T> ForwardIterator lower_bound(ForwardIterator first, ForwardIterator last, const T& t)
+{
+    return __rewrap_iter(first, __lower_bound(__unwrap_iter(first), __unwrap_iter(last), t, __less_op(), THOR_GET_CATEGORY(first, ForwardIterator)));
+}
+
+template <class ForwardIterator, class T, class LessThanComparable> ForwardIterator lower_bound(ForwardIterator first, ForwardIterator last, const T& t, LessThanComparable comp)
+{
+    return __rewrap_iter(first, __lower_bound(__unwrap_iter(first), __unwrap_iter(last), t, comp, THOR_GET_CATEGORY(first, ForwardIterator)));
+}
+
+template <class ForwardIterator, class T> ForwardIterator upper_bound(ForwardIterator first, ForwardIterator last, const T& t)
+{
+    return __rewrap_iter(first, __upper_bound(__unwrap_iter(first), __unwrap_iter(last), t, __less_op(), THOR_GET_CATEGORY(first, ForwardIterator)));
+}
+
+template <class ForwardIterator, class T, class LessThanComparable> ForwardIterator upper_bound(ForwardIterator first, ForwardIterator last, const T& t, LessThanComparable comp)
+{
+    return __rewrap_iter(first, __upper_bound(__unwrap_iter(first), __unwrap_iter(last), t, comp, THOR_GET_CATEGORY(first, ForwardIterator)));
+}
+
+template <class ForwardIterator, class T, class LessThanComparable>
+thor::pair<ForwardIterator, ForwardIterator> __equal_range(ForwardIterator first, ForwardIterator last, const T& t, LessThanComparable comp, const forward_iterator_tag&)
+{
+    difference_type size = thor::distance(first, last);
+    THOR_ASSERT(size >= 0);
+    difference_type half;
+
+    while (size > 0)
+    {
+        half = size >> 1;
+        ForwardIterator middle = first;
+        thor::advance(middle, half);
+        if (comp(*middle, t))
+        {
+            first = middle;
+            ++first;
+            size = size - half - 1;
+        }
+        else if (comp(t, *middle))
+        {
+            size = half;
+        }
+        else
+        {
+            // Found a match: the range starts before it and ends after it
+            ForwardIterator end = first;
+            thor::advance(end, size);
+            thor::pair<ForwardIterator, ForwardIterator> result;
+            result.first = __lower_bound(first, middle, t, comp, forward_iterator_tag());
+            result.second = __upper_bound(++middle, end, t, comp, forward_iterator_tag());
+            return result;
+        }
+    }
+    return thor::pair<ForwardIterator, ForwardIterator>(first, first);
+}
+
+template <class RandomAccessIterator, class T, class LessThanComparable>
+thor::pair<RandomAccessIterator, RandomAccessIterator> __equal_range(RandomAccessIterator first, RandomAccessIterator last, const T& t, LessThanComparable comp, const random_access_iterator_tag&)
+{
+    // Two branchless searches are faster than one branching search that stops early
+    first = thor::lower_bound(first, last, t, comp);
+    return thor::pair<RandomAccessIterator, RandomAccessIterator>(first, thor::upper_bound(first, last, t, comp));
+}
+
+template <class ForwardIterator, class T> thor::pair<ForwardIterator, ForwardIterator> equal_range(ForwardIterator first, ForwardIterator last, const T& t)
+{
+    return __equal_range(first, last, t, __less_op(), THOR_GET_CATEGORY(first, ForwardIterator));
+}
+
+template <class ForwardIterator, class T, class LessThanComparable> thor::pair<ForwardIterator, ForwardIterator> equal_range(ForwardIterator first, ForwardIterator last, const T& t, LessThanComparable comp)
+{
+    return __equal_range(first, last, t, comp, THOR_GET_CATEGORY(first, ForwardIterator));
+}
+
+// Set operations on sorted ranges. As with the standard algorithms, ranges may contain equivalent
+// elements: set_intersection() keeps min(m, n) of a value that appears m times in the first range and
+// n times in the second, set_union() keeps max(m, n), set_difference() keeps max(m - n, 0) and
+// set_symmetric_difference() keeps |m - n|. Equivalent elements are copied from the first range.
+//
+// When both ranges are random access and one is much longer than the other, the long range is
+// searched with exponential ("galloping") searches instead of being stepped through one element at a
+// time, and runs of elements that are copied to the result are copied at once. Intersecting a range
+// of m elements with a range of n >> m elements takes O(m*log(n/m)) comparisons instead of O(n + m).
+// Otherwise, intersections of contiguous ranges of integers skip non-matching blocks with SIMD
+// compares (see simd.h).
+enum
+{
+    __set_gallop_ratio = 16,    // Galloping is used when one range is at least this many times longer than the other
+};
+
+// The first element of [first, last) not less than t, in O(log(d)) comparisons where d is its distance from first
+template <class RandomAccessIterator, class T, class Compare>
+RandomAccessIterator __gallop_lower_bound(RandomAccessIterator first, RandomAccessIterator last, const T& t, Compare comp)
+{
+    const difference_type size = last - first;
+    if (size == 0 || !comp(*first, t))
+    {
+        return first;
+    }
+
+    // Invariant: *(first + lo) < t, and t <= *(first + hi) if hi < size
+    difference_type lo = 0, hi = 1;
+    while (hi < size && comp(*(first + hi), t))
+    {
+        lo = hi;
+        hi = (hi << 1) + 1;
+    }
+    return __lower_bound(first + (lo + 1), first + (hi < size ? hi : size), t, comp, random_access_iterator_tag());
+}
+
+template <class Iterator1, class Iterator2>
+inline bool __set_skewed(Iterator1 first1, Iterator1 last1, Iterator2 first2, Iterator2 last2)
+{
+    const difference_type size1 = last1 - first1, size2 = last2 - first2;
+    return (size1 / __set_gallop_ratio) > size2 || (size2 / __set_gallop_ratio) > size1;
+}
+
+// Intersections of contiguous integer ranges without a comparison are vectorized
+template <class Iterator1, class Iterator2, class Compare> struct __set_simd_tag { typedef false_type Type; };
+template <class Iterator1, class Iterator2> struct __set_simd_tag<Iterator1, Iterator2, __less_op>
+{
+    typedef typename __simd_ops<typename __pointer_pair<Iterator1, Iterator2>::value_type>::Exact Type;
+};
+
+template <class InputIterator1, class InputIterator2, class OutputIterator, class Compare>
+OutputIterator __set_intersection_merge(InputIterator1 first1, InputIterator1 last1,
+                                        InputIterator2 first2, InputIterator2 last2,
+                                        OutputIterator result, Compare comp, const false_type&)
+{
+    while (first1 != last1 && first2 != last2)
+    {
+        if (comp(*first1, *first2))
+        {
+            ++first1;
+        }
+        else if (comp(*first2, *first1))
+        {
+            ++first2;
+        }
+        else
+        {
+            *result = *first1;
+            ++result;
+            ++first1;
+            ++first2;
+        }
+    }
+    return result;
+}
+
+#ifdef THOR_SIMD_SSE2
+template <class T1, class T2, class OutputIterator>
+inline OutputIterator __set_intersection_merge(T1* first1, T1* last1, T2* first2, T2* last2, OutputIterator result, __less_op, const true_type&)
+{
+    return __simd_set_intersection<typename __pointer_pair<T1*, T2*>::value_type>(first1, last1 - first1, first2, last2 - first2, result);
+}
+#endif
+
+template <class RandomAccessIterator1, class RandomAccessIterator2, class OutputIterator, class Compare>
+OutputIterator __set_intersection_gallop(RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                                         RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                                         OutputIterator result, Compare comp)
+{
+    while (first1 != last1 && first2 != last2)
+    {
+        first1 = __gallop_lower_bound(first1, last1, *first2, comp);
+        if (first1 == last1)
+        {
+            break;
+        }
+        first2 = __gallop_lower_bound(first2, last2, *first1, comp);
+        if (first2 == last2)
+        {
+            break;
+        }
+        if (!comp(*first1, *first2))
+        {
+            *result = *first1;
+            ++result;
+            ++first1;
+            ++first2;
+        }
+    }
+    return result;
 }
 
-template <class Distance> inline Distance __random(Distance n)
+template <class InputIterator1, class InputIterator2, class OutputIterator, class Compare>
+inline OutputIterator __set_intersection(InputIterator1 first1, InputIterator1 last1,
+                                         InputIterator2 first2, InputIterator2 last2,
+                                         OutputIterator result, Compare comp,
+                                         const input_iterator_tag&, const input_iterator_tag&)
 {
-    return rand() % n;
+    return __set_intersection_merge(first1, last1, first2, last2, result, comp, typename __set_simd_tag<InputIterator1, InputIterator2, Compare>::Type());
 }
 
-template <class RandomAccessIterator> void random_shuffle(RandomAccessIterator first, RandomAccessIterator last)
+template <class RandomAccessIterator1, class RandomAccessIterator2, class OutputIterator, class Compare>
+inline OutputIterator __set_intersection(RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                                         RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                                         OutputIterator result, Compare comp,
+                                         const random_access_iterator_tag&, const random_access_iterator_tag&)
 {
-    if (first == last)
+    if (__set_skewed(first1, last1, first2, last2))
     {
-        return;
-    }
-
-    for (RandomAccessIterator iter = first + 1; iter != last; ++iter)
-    {
-        thor::iter_swap(iter, first + __random((iter - first) + 1));
+        return __set_intersection_gallop(first1, last1, first2, last2, result, comp);
     }
+    return __set_intersection_merge(first1, last1, first2, last2, result, comp, typename __set_simd_tag<RandomAccessIterator1, RandomAccessIterator2, Compare>::Type());
 }
 
-template <class RandomAccessIterator, class RandomNumberGenerator> void random_shuffle(RandomAccessIterator first, RandomAccessIterator last, RandomNumberGenerator prng)
+template <class InputIterator1, class InputIterator2, class OutputIterator, class Compare>
+inline OutputIterator __set_intersection_unwrapped(InputIterator1 first1, InputIterator1 last1,
+                                                   InputIterator2 first2, InputIterator2 last2,
+                                                   OutputIterator result, Compare comp)
 {
-    if (first == last)
-    {
-        return;
-    }
-
-    for (RandomAccessIterator iter = first + 1; iter != last; ++iter)
-    {
-        thor::iter_swap(iter, first + prng((iter - first) + 1));
-    }
+    return __set_intersection(first1, last1, first2, last2, result, comp, THOR_GET_CATEGORY(first1, InputIterator1), THOR_GET_CATEGORY(first2, InputIterator2));
 }
 
 template <class InputIterator1, class InputIterator2, class OutputIterator>
-OutputIterator merge(InputIterator1 first1, InputIterator1 last1,
-                     InputIterator2 first2, InputIterator2 last2,
-                     OutputIterator result)
+OutputIterator set_intersection(InputIterator1 first1, InputIterator1 last1,
+                                InputIterator2 first2, InputIterator2 last2,
+                                OutputIterator result)
 {
-    while (first1 != last1 && first2 != last2)
-    {
-      if (*first2 < *first1)
-      {
-          *result = *first2;
-          ++first2;
-      }
-      else
-      {
-          *result = *first1;
-          ++first1;
-      }
-      ++result;
-    }
-    return copy(first2, last2, copy(first1, last1, result));
+    return __set_intersection_unwrapped(__unwrap_iter(first1), __unwrap_iter(last1), __unwrap_iter(first2), __unwrap_iter(last2), result, __less_op());
 }
 
 template <class InputIterator1, class InputIterator2, class OutputIterator, class Compare>
-OutputIterator merge(InputIterator1 first1, InputIterator1 last1,
-                     InputIterator2 first2, InputIterator2 last2,
-                     OutputIterator result, Compare comp)
+OutputIterator set_intersection(InputIterator1 first1, InputIterator1 last1,
+                                InputIterator2 first2, InputIterator2 last2,
+                                OutputIterator result, Compare comp)
+{
+    return __set_intersection_unwrapped(__unwrap_iter(first1), __unwrap_iter(last1), __unwrap_iter(first2), __unwrap_iter(last2), result, comp);
+}
+
+template <class InputIterator1, class InputIterator2, class OutputIterator, class Compare>
+OutputIterator __set_union(InputIterator1 first1, InputIterator1 last1,
+                           InputIterator2 first2, InputIterator2 last2,
+                           OutputIterator result, Compare comp,
+                           const input_iterator_tag&, const input_iterator_tag&)
 {
     while (first1 != last1 && first2 != last2)
     {
-        if (comp(*first2, *first1))
+        if (comp(*first1, *first2))
+        {
+            *result = *first1;
+            ++first1;
+        }
+        else if (comp(*first2, *first1))
         {
             *result = *first2;
             ++first2;
@@ -250,178 +1027,230 @@ OutputIterator merge(InputIterator1 first1, InputIterator1 last1,
         {
             *result = *first1;
             ++first1;
+            ++first2;
         }
         ++result;
     }
     return thor::copy(first2, last2, thor::copy(first1, last1, result));
 }
 
-template <class ForwardIterator, class T> ForwardIterator lower_bound(ForwardIterator first, ForwardIterator last, const T& t)
+template <class RandomAccessIterator1, class RandomAccessIterator2, class OutputIterator, class Compare>
+OutputIterator __set_union(RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                           RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                           OutputIterator result, Compare comp,
+                           const random_access_iterator_tag&, const random_access_iterator_tag&)
 {
-    difference_type size = distance(first, last);
-    THOR_ASSERT(size >= 0);
-    difference_type half;
-    ForwardIterator middle;
+    if (!__set_skewed(first1, last1, first2, last2))
+    {
+        return __set_union(first1, last1, first2, last2, result, comp, input_iterator_tag(), input_iterator_tag());
+    }
 
-    while (size > 0)
+    while (first1 != last1 && first2 != last2)
     {
-        half = size >> 1;
-        middle = first;
-        advance(middle, half);
-        if (*middle < t)
+        // Copy the run of each range that is less than the next element of the other
+        RandomAccessIterator1 run1 = __gallop_lower_bound(first1, last1, *first2, comp);
+        result = thor::copy(first1, run1, result);
+        first1 = run1;
+        if (first1 == last1)
         {
-            first = middle;
-            ++first;
-            size = size - half - 1;
+            break;
         }
-        else
+        RandomAccessIterator2 run2 = __gallop_lower_bound(first2, last2, *first1, comp);
+        result = thor::copy(first2, run2, result);
+        first2 = run2;
+        if (first2 == last2)
         {
-            size = half;
+            break;
+        }
+        if (!comp(*first1, *first2))
+        {
+            *result = *first1;
+            ++result;
+            ++first1;
+            ++first2;
         }
     }
-    return first;
+    return thor::copy(first2, last2, thor::copy(first1, last1, result));
 }
 
-template <class ForwardIterator, class T, class LessThanComparable> ForwardIterator lower_bound(ForwardIterator first, ForwardIterator last, const T& t, LessThanComparable comp)
+template <class InputIterator1, class InputIterator2, class OutputIterator>
+OutputIterator set_union(InputIterator1 first1, InputIterator1 last1,
+                         InputIterator2 first2, InputIterator2 last2,
+                         OutputIterator result)
 {
-    difference_type size = thor::distance(first, last);
-    THOR_ASSERT(size >= 0);
-    difference_type half;
-    ForwardIterator middle;
-
-    while (size > 0)
-    {
-        half = size >> 1;
-        middle = first;
-        thor::advance(middle, half);
-        if (comp(*middle, t))
-        {
-            first = middle;
-            ++first;
-            size = size - half - 1;
-        }
-        else
-        {
-            size = half;
-        }
-    }
-    return first;
+    return __set_union(__unwrap_iter(first1), __unwrap_iter(last1), __unwrap_iter(first2), __unwrap_iter(last2), result, __less_op(),
+                       THOR_GET_CATEGORY(first1, InputIterator1), THOR_GET_CATEGORY(first2, InputIterator2));
 }
 
-template <class ForwardIterator, class T> ForwardIterator upper_bound(ForwardIterator first, ForwardIterator last, const T& t)
+template <class InputIterator1, class InputIterator2, class OutputIterator, class Compare>
+OutputIterator set_union(InputIterator1 first1, InputIterator1 last1,
+                         InputIterator2 first2, InputIterator2 last2,
+                         OutputIterator result, Compare comp)
 {
-    difference_type size = thor::distance(first, last);
-    THOR_ASSERT(size >= 0);
-    difference_type half;
+    return __set_union(__unwrap_iter(first1), __unwrap_iter(last1), __unwrap_iter(first2), __unwrap_iter(last2), result, comp,
+                       THOR_GET_CATEGORY(first1, InputIterator1), THOR_GET_CATEGORY(first2, InputIterator2));
+}
 
-    while (size > 0)
+template <class InputIterator1, class InputIterator2, class OutputIterator, class Compare>
+OutputIterator __set_difference(InputIterator1 first1, InputIterator1 last1,
+                                InputIterator2 first2, InputIterator2 last2,
+                                OutputIterator result, Compare comp,
+                                const input_iterator_tag&, const input_iterator_tag&)
+{
+    while (first1 != last1 && first2 != last2)
     {
-        half = size >> 1;
-        ForwardIterator middle = first;
-        thor::advance(middle, half);
-        if (t < *middle)
+        if (comp(*first1, *first2))
         {
-            size = half;
+            *result = *first1;
+            ++result;
+            ++first1;
+        }
+        else if (comp(*first2, *first1))
+        {
+            ++first2;
         }
         else
         {
-            first = middle;
-            ++first;
-            size = size - half - 1;
+            ++first1;
+            ++first2;
         }
     }
-    return first;
+    return thor::copy(first1, last1, result);
 }
 
-template <class ForwardIterator, class T, class LessThanComparable> ForwardIterator upper_bound(ForwardIterator first, ForwardIterator last, const T& t, LessThanComparable comp)
+template <class RandomAccessIterator1, class RandomAccessIterator2, class OutputIterator, class Compare>
+OutputIterator __set_difference(RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                                RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                                OutputIterator result, Compare comp,
+                                const random_access_iterator_tag&, const random_access_iterator_tag&)
 {
-    difference_type size = thor::distance(first, last);
-    THOR_ASSERT(size >= 0);
-    difference_type half;
+    if (!__set_skewed(first1, last1, first2, last2))
+    {
+        return __set_difference(first1, last1, first2, last2, result, comp, input_iterator_tag(), input_iterator_tag());
+    }
 
-    while (size > 0)
+    while (first1 != last1 && first2 != last2)
     {
-        half = size >> 1;
-        ForwardIterator middle = first;
-        thor::advance(middle, half);
-        if (comp(t, *middle))
+        RandomAccessIterator1 run1 = __gallop_lower_bound(first1, last1, *first2, comp);
+        result = thor::copy(first1, run1, result);
+        first1 = run1;
+        if (first1 == last1)
         {
-            size = half;
+            break;
         }
-        else
+        first2 = __gallop_lower_bound(first2, last2, *first1, comp);
+        if (first2 == last2)
         {
-            first = middle;
-            ++first;
-            size = size - half - 1;
+            break;
+        }
+        if (!comp(*first1, *first2))
+        {
+            ++first1;
+            ++first2;
         }
     }
-    return first;
+    return thor::copy(first1, last1, result);
 }
 
-template <class ForwardIterator, class T> thor::pair<ForwardIterator, ForwardIterator> equal_range(ForwardIterator first, ForwardIterator last, const T& t)
+template <class InputIterator1, class InputIterator2, class OutputIterator>
+OutputIterator set_difference(InputIterator1 first1, InputIterator1 last1,
+                              InputIterator2 first2, InputIterator2 last2,
+                              OutputIterator result)
 {
-    difference_type size = thor::distance(first, last);
-    THOR_ASSERT(size >= 0);
-    difference_type half;
+    return __set_difference(__unwrap_iter(first1), __unwrap_iter(last1), __unwrap_iter(first2), __unwrap_iter(last2), result, __less_op(),
+                            THOR_GET_CATEGORY(first1, InputIterator1), THOR_GET_CATEGORY(first2, InputIterator2));
+}
 
-    while (size > 0)
+template <class InputIterator1, class InputIterator2, class OutputIterator, class Compare>
+OutputIterator set_difference(InputIterator1 first1, InputIterator1 last1,
+                              InputIterator2 first2, InputIterator2 last2,
+                              OutputIterator result, Compare comp)
+{
+    return __set_difference(__unwrap_iter(first1), __unwrap_iter(last1), __unwrap_iter(first2), __unwrap_iter(last2), result, comp,
+                            THOR_GET_CATEGORY(first1, InputIterator1), THOR_GET_CATEGORY(first2, InputIterator2));
+}
+
+template <class InputIterator1, class InputIterator2, class OutputIterator, class Compare>
+OutputIterator __set_symmetric_difference(InputIterator1 first1, InputIterator1 last1,
+                                          InputIterator2 first2, InputIterator2 last2,
+                                          OutputIterator result, Compare comp,
+                                          const input_iterator_tag&, const input_iterator_tag&)
+{
+    while (first1 != last1 && first2 != last2)
     {
-        half = size >> 1;
-        ForwardIterator middle = first;
-        thor::advance(middle, half);
-        if (*middle < t)
+        if (comp(*first1, *first2))
         {
-            first = middle;
-            ++first;
-            size -= (half - 1);
+            *result = *first1;
+            ++result;
+            ++first1;
         }
-        else if (t < *middle)
+        else if (comp(*first2, *first1))
         {
-            size = half;
+            *result = *first2;
+            ++result;
+            ++first2;
         }
         else
         {
-            thor::pair<ForwardIterator, ForwardIterator> result;
-            result.first = thor::lower_bound(first, middle, t);
-            thor::advance(result.first, size);
-            result.second = thor::upper_bound(++middle, first, t);
-            return result;
+            ++first1;
+            ++first2;
         }
     }
-    return thor::pair<ForwardIterator, ForwardIterator>(first, first);
+    return thor::copy(first2, last2, thor::copy(first1, last1, result));
 }
 
-template <class ForwardIterator, class T, class LessThanComparable> thor::pair<ForwardIterator, ForwardIterator> equal_range(ForwardIterator first, ForwardIterator last, const T& t, LessThanComparable comp)
+template <class RandomAccessIterator1, class RandomAccessIterator2, class OutputIterator, class Compare>
+OutputIterator __set_symmetric_difference(RandomAccessIterator1 first1, RandomAccessIterator1 last1,
+                                          RandomAccessIterator2 first2, RandomAccessIterator2 last2,
+                                          OutputIterator result, Compare comp,
+                                          const random_access_iterator_tag&, const random_access_iterator_tag&)
 {
-    difference_type size = thor::distance(first, last);
-    THOR_ASSERT(size >= 0);
-    difference_type half;
+    if (!__set_skewed(first1, last1, first2, last2))
+    {
+        return __set_symmetric_difference(first1, last1, first2, last2, result, comp, input_iterator_tag(), input_iterator_tag());
+    }
 
-    while (size > 0)
+    while (first1 != last1 && first2 != last2)
     {
-        half = size >> 1;
-        ForwardIterator middle = first;
-        thor::advance(middle, half);
-        if (comp(*middle, t))
+        RandomAccessIterator1 run1 = __gallop_lower_bound(first1, last1, *first2, comp);
+        result = thor::copy(first1, run1, result);
+        first1 = run1;
+        if (first1 == last1)
         {
-            first = middle;
-            ++first;
-            size -= (half - 1);
+            break;
         }
-        else if (comp(t, *middle))
+        RandomAccessIterator2 run2 = __gallop_lower_bound(first2, last2, *first1, comp);
+        result = thor::copy(first2, run2, result);
+        first2 = run2;
+        if (first2 == last2)
         {
-            size = half;
+            break;
         }
-        else
+        if (!comp(*first1, *first2))
         {
-            thor::pair<ForwardIterator, ForwardIterator> result;
-            result.first = thor::lower_bound(first, middle, t, comp);
-            thor::advance(result.first, size);
-            result.second = thor::upper_bound(++middle, first, t, comp);
-            return result;
+            ++first1;
+            ++first2;
         }
     }
-    return thor::pair<ForwardIterator, ForwardIterator>(first, first);
+    return thor::copy(first2, last2, thor::copy(first1, last1, result));
+}
+
+template <class InputIterator1, class InputIterator2, class OutputIterator>
+OutputIterator set_symmetric_difference(InputIterator1 first1, InputIterator1 last1,
+                                        InputIterator2 first2, InputIterator2 last2,
+                                        OutputIterator result)
+{
+    return __set_symmetric_difference(__unwrap_iter(first1), __unwrap_iter(last1), __unwrap_iter(first2), __unwrap_iter(last2), result, __less_op(),
+                                      THOR_GET_CATEGORY(first1, InputIterator1), THOR_GET_CATEGORY(first2, InputIterator2));
+}
+
+template <class InputIterator1, class InputIterator2, class OutputIterator, class Compare>
+OutputIterator set_symmetric_difference(InputIterator1 first1, InputIterator1 last1,
+                                        InputIterator2 first2, InputIterator2 last2,
+                                        OutputIterator result, Compare comp)
+{
+    return __set_symmetric_difference(__unwrap_iter(first1), __unwrap_iter(last1), __unwrap_iter(first2), __unwrap_iter(last2), result, comp,
+                                      THOR_GET_CATEGORY(first1, InputIterator1), THOR_GET_CATEGORY(first2, InputIterator2));
 }
 
 template <class BidirectionalIterator> void reverse(BidirectionalIterator first, BidirectionalIterator last)
@@ -710,10 +1539,27 @@ template <class ForwardIterator> inline ForwardIterator __internal_max_element(F
     return found;
 }
 
+template <class ForwardIterator> inline ForwardIterator __max_element_simd(ForwardIterator first, ForwardIterator last, const false_type&)
+{
+    return __internal_max_element(first, last);
+}
+
+#ifdef THOR_SIMD_SSE2
+template <class T> inline T* __max_element_simd(T* first, T* last, const true_type&)
+{
+    return first == last ? last : first + __simd_max_element(first, size_type(last - first));
+}
+#endif
+
+template <class ForwardIterator> inline ForwardIterator __max_element_unwrapped(ForwardIterator first, ForwardIterator last)
+{
+    typedef typename __pointer_pair<ForwardIterator, ForwardIterator>::value_type value_type;
+    return __max_element_simd(first, last, typename __simd_ops<value_type>::Type());
+}
+
 template <class ForwardIterator> inline ForwardIterator max_element(ForwardIterator first, ForwardIterator last)
 {
-    first = __internal_max_element(first, last);
-    return first;
+    return __rewrap_iter(first, __max_element_unwrapped(__unwrap_iter(first), __unwrap_iter(last)));
 }
 
 template <class ForwardIterator> inline ForwardIterator __internal_min_element(ForwardIterator first, ForwardIterator last)
@@ -723,7 +1569,7 @@ template <class ForwardIterator> inline ForwardIterator __internal_min_element(F
     {
         for (; first != last; ++first)
         {
-            if (first < *found)
+            if (*first < *found)
             {
                 found = first;
             }
@@ -732,10 +1578,27 @@ template <class ForwardIterator> inline ForwardIterator __internal_min_element(F
     return found;
 }
 
+template <class ForwardIterator> inline ForwardIterator __min_element_simd(ForwardIterator first, ForwardIterator last, const false_type&)
+{
+    return __internal_min_element(first, last);
+}
+
+#ifdef THOR_SIMD_SSE2
+template <class T> inline T* __min_element_simd(T* first, T* last, const true_type&)
+{
+    return first == last ? last : first + __simd_min_element(first, size_type(last - first));
+}
+#endif
+
+template <class ForwardIterator> inline ForwardIterator __min_element_unwrapped(ForwardIterator first, ForwardIterator last)
+{
+    typedef typename __pointer_pair<ForwardIterator, ForwardIterator>::value_type value_type;
+    return __min_element_simd(first, last, typename __simd_ops<value_type>::Type());
+}
+
 template <class ForwardIterator> inline ForwardIterator min_element( ForwardIterator first, ForwardIterator last )
 {
-    first = __internal_min_element( first, last );
-    return first;
+    return __rewrap_iter(first, __min_element_unwrapped(__unwrap_iter(first), __unwrap_iter(last)));
 }
 
 template <class InputIterator, class T> inline T __internal_accumulate( InputIterator first, InputIterator last, T val)
@@ -747,9 +1610,41 @@ template <class InputIterator, class T> inline T __internal_accumulate( InputIte
     return val;
 }
 
+// Whether the sum of an array may be computed with SIMD: the array must be of T itself. With
+// Unordered, floating point sums are allowed even though the rounding differs.
+template <class InputIterator, class T, class Unordered> struct __simd_accumulate_tag      { typedef false_type Type; };
+template <class T> struct __simd_accumulate_tag<T*, T, false_type>                          { typedef typename __simd_ops<T>::Exact Type; };
+template <class T> struct __simd_accumulate_tag<const T*, T, false_type>                    { typedef typename __simd_ops<T>::Exact Type; };
+template <class T> struct __simd_accumulate_tag<T*, T, true_type>                           { typedef typename __simd_ops<T>::Type Type; };
+template <class T> struct __simd_accumulate_tag<const T*, T, true_type>                     { typedef typename __simd_ops<T>::Type Type; };
+
+template <class InputIterator, class T> inline T __accumulate_simd(InputIterator first, InputIterator last, T val, const false_type&)
+{
+    return __internal_accumulate(first, last, val);
+}
+
+#ifdef THOR_SIMD_SSE2
+template <class U, class T> inline T __accumulate_simd(U* first, U* last, T val, const true_type&)
+{
+    return __simd_sum(first, size_type(last - first), val);
+}
+#endif
+
+template <class InputIterator, class T, class Unordered> inline T __accumulate_unwrapped(InputIterator first, InputIterator last, T val, const Unordered&)
+{
+    return __accumulate_simd(first, last, val, typename __simd_accumulate_tag<InputIterator, T, Unordered>::Type());
+}
+
 template <class InputIterator, class T> inline T accumulate( InputIterator first, InputIterator last, T val)
 {
-    return __internal_accumulate( first, last, val);
+    return __accumulate_unwrapped(__unwrap_iter(first), __unwrap_iter(last), val, false_type());
+}
+
+// Like accumulate(), but the elements may be added in any order. For floating point values this
+// allows SIMD, but the result may be rounded differently than the sequential sum.
+template <class InputIterator, class T> inline T accumulate_unordered( InputIterator first, InputIterator last, T val)
+{
+    return __accumulate_unwrapped(__unwrap_iter(first), __unwrap_iter(last), val, true_type());
 }
 
 } // namespace thor
@@ -23,12 +23,14 @@
 #define THOR_ALIGN_OF(type) __alignof(type)
 #define THOR_ALIGN(align_, declaration_) __declspec(align(align_)) declaration_
 #define THOR_NOTHROW throw()
+#define THOR_THREAD_LOCAL __declspec(thread)
 #pragma warning(disable:4324) // warning: structure was padded due to __declspec(align())
 #else
 #define THOR_TYPENAME
 #define THOR_ALIGN_OF(type) __alignof__(type)
 #define THOR_ALIGN(align_, declaration_) declaration_ __attribute__ ((aligned (align_)))
 #define THOR_NOTHROW /*nothrow for linux does nothing currently*/
+#define THOR_THREAD_LOCAL __thread
 #endif
 
 #include <stddef.h>
@@ -55,6 +57,7 @@ typedef thor_size_type size_type;
 typedef thor_diff_type difference_type;
 
 enum { THOR_GUARANTEED_ALIGNMENT = (2 * sizeof(thor_size_type)) };
+enum { THOR_CACHE_LINE_SIZE = 64 };
 
 }; // namespace thor
 
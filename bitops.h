@@ -0,0 +1,132 @@
+/* THOR - THOR Template Library
+ * Joshua M. Kriegshauser
+ *
+ * bitops.h
+ *
+ * ** THOR INTERNAL FILE - NOT FOR APPLICATION USE **
+ *
+ * This file defines bit counting and scanning of 32- and 64-bit unsigned words, using the
+ * processor's instructions where they are available. They are used by bitset and dynamic_bitset.
+ *
+ * - __popcount(w) returns the number of set bits. The POPCNT instruction is used when the compiler
+ *   targets it: GCC with -mpopcnt (or an -march that includes it), MSVC with /arch:AVX or higher
+ *   (every processor with AVX has POPCNT). Otherwise MSVC counts the bits of the word in parallel
+ *   and GCC calls its library routine.
+ * - __lowest_bit(w) and __highest_bit(w) return the index of the lowest or highest set bit, where
+ *   bit 0 is the least significant. w must not be zero.
+ */
+
+#ifndef THOR_BITOPS_H
+#define THOR_BITOPS_H
+#pragma once
+
+#ifndef THOR_BASETYPES_H
+#include "basetypes.h"
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace thor
+{
+
+template <size_type T_SIZE> struct __bitops;
+
+template <> struct __bitops<4>
+{
+    static size_type popcount(uint32 w)
+    {
+#if defined(_MSC_VER) && defined(__AVX__)
+        return size_type(__popcnt(w));
+#elif defined(_MSC_VER)
+        // From: http://graphics.stanford.edu/~seander/bithacks.html#CountBitsSetParallel
+        w = w - ((w >> 1) & 0x55555555);
+        w = (w & 0x33333333) + ((w >> 2) & 0x33333333);
+        return size_type((((w + (w >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24);
+#else
+        return size_type(__builtin_popcount(w));
+#endif
+    }
+
+    static size_type lowest_bit(uint32 w)
+    {
+        THOR_DEBUG_ASSERT(w != 0);
+#ifdef _MSC_VER
+        unsigned long i;
+        _BitScanForward(&i, w);
+        return size_type(i);
+#else
+        return size_type(__builtin_ctz(w));
+#endif
+    }
+
+    static size_type highest_bit(uint32 w)
+    {
+        THOR_DEBUG_ASSERT(w != 0);
+#ifdef _MSC_VER
+        unsigned long i;
+        _BitScanReverse(&i, w);
+        return size_type(i);
+#else
+        return size_type(31 - __builtin_clz(w));
+#endif
+    }
+};
+
+template <> struct __bitops<8>
+{
+    static size_type popcount(uint64 w)
+    {
+#if defined(_MSC_VER) && defined(__AVX__) && defined(_M_X64)
+        return size_type(__popcnt64(w));
+#elif defined(_MSC_VER) && defined(__AVX__)
+        return size_type(__popcnt(uint32(w)) + __popcnt(uint32(w >> 32)));
+#elif defined(_MSC_VER)
+        w = w - ((w >> 1) & 0x5555555555555555ULL);
+        w = (w & 0x3333333333333333ULL) + ((w >> 2) & 0x3333333333333333ULL);
+        return size_type((((w + (w >> 4)) & 0x0F0F0F0F0F0F0F0FULL) * 0x0101010101010101ULL) >> 56);
+#else
+        return size_type(__builtin_popcountll(w));
+#endif
+    }
+
+    static size_type lowest_bit(uint64 w)
+    {
+        THOR_DEBUG_ASSERT(w != 0);
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long i;
+        _BitScanForward64(&i, w);
+        return size_type(i);
+#elif defined(_MSC_VER)
+        const uint32 low = uint32(w);
+        return low != 0 ? __bitops<4>::lowest_bit(low) : 32 + __bitops<4>::lowest_bit(uint32(w >> 32));
+#else
+        return size_type(__builtin_ctzll(w));
+#endif
+    }
+
+    static size_type highest_bit(uint64 w)
+    {
+        THOR_DEBUG_ASSERT(w != 0);
+#if defined(_MSC_VER) && defined(_M_X64)
+        unsigned long i;
+        _BitScanReverse64(&i, w);
+        return size_type(i);
+#elif defined(_MSC_VER)
+        const uint32 high = uint32(w >> 32);
+        return high != 0 ? 32 + __bitops<4>::highest_bit(high) : __bitops<4>::highest_bit(uint32(w));
+#else
+        return size_type(63 - __builtin_clzll(w));
+#endif
+    }
+};
+
+// Selected by the size of the word, so that any unsigned integer type of 4 or 8 bytes can be used
+template <class T> inline size_type __popcount(T w)         { return __bitops<sizeof(T)>::popcount(w); }
+template <class T> inline size_type __lowest_bit(T w)       { return __bitops<sizeof(T)>::lowest_bit(w); }
+template <class T> inline size_type __highest_bit(T w)      { return __bitops<sizeof(T)>::highest_bit(w); }
+
+} // namespace thor
+
+#endif
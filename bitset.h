@@ -14,6 +14,10 @@
 #include "basetypes.h"
 #endif
 
+#ifndef THOR_BITOPS_H
+#include "bitops.h"
+#endif
+
 #ifndef THOR_BASIC_STRING_H
 #include "basic_string.h"
 #endif
@@ -123,6 +127,8 @@ public:
     bitset& rotate_right(size_type n);
 	size_type size() const;
 	size_type count() const;
+    size_type find_first() const;
+    size_type find_next(size_type n) const;
 	bool any() const;
     bool all() const;
 	bool none() const;
@@ -142,6 +148,7 @@ private:
     size_type remainder_mask() const;
     void check_remainder() const;
     void clear_remainder();
+    size_type find_from(size_type n) const;
 
 	typedef vector<size_type, (unsigned)storage_size> vector_type;
 	vector_type data_;
@@ -510,21 +517,27 @@ template<unsigned N> typename bitset<N>::size_type bitset<N>::size() const
 
 template<unsigned N> typename bitset<N>::size_type bitset<N>::count() const
 {
-    // Algorithm below only works as written for types up to 128 bits according to URL given below
-    THOR_COMPILETIME_ASSERT(sizeof(size_type) < 16, InvalidAssumption);
     size_type bits = 0;
     const vector_type::const_iterator end(data_.end());
     for (vector_type::const_iterator iter(data_.begin()); iter != end; ++iter)
     {
-        // From: http://graphics.stanford.edu/~seander/bithacks.html#CountBitsSetParallel
-        size_type v = *iter - ((*iter >> 1) & (size_type(-1)/3));
-        v = (v & (size_type(-1)/15*3)) + ((v >> 2) & (size_type(-1)/15*3));
-        v = (v + (v >> 4)) & (size_type(-1)/255*15);
-        bits += (v * ((size_type(-1)/255))) >> (sizeof(size_type) - 1) * 8;
+        bits += __popcount(*iter);
     }
     return bits;
 }
 
+// Returns the index of the first set bit, or size() if no bits are set
+template<unsigned N> typename bitset<N>::size_type bitset<N>::find_first() const
+{
+    return find_from(0);
+}
+
+// Returns the index of the first set bit after n, or size() if there is none
+template<unsigned N> typename bitset<N>::size_type bitset<N>::find_next(size_type n) const
+{
+    return n < size() ? find_from(n + 1) : size();
+}
+
 template<unsigned N> bool bitset<N>::any() const
 {
     for (vector_type::const_iterator iter = data_.begin(); iter != data_.end(); ++iter)
@@ -716,6 +729,27 @@ template<unsigned N> void bitset<N>::clear_remainder()
     *data_.rbegin() &= ~remainder_mask();
 }
 
+template<unsigned N> typename bitset<N>::size_type bitset<N>::find_from(size_type n) const
+{
+    if (n >= size()) return size();
+
+    // Bits are stored from the most significant end of each word, so the first set bit is the highest
+    size_type index = n / bits_per_size_type;
+    size_type word = data_[index] & (size_type(-1) >> (n % bits_per_size_type));
+    for (;;)
+    {
+        if (word != 0)
+        {
+            return (index * bits_per_size_type) + (bits_per_size_type - 1 - __highest_bit(word));
+        }
+        if (++index == data_.size())
+        {
+            return size();
+        }
+        word = data_[index];
+    }
+}
+
 }
 
 #endif
\ No newline at end of file
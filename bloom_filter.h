@@ -0,0 +1,238 @@
+/* THOR - THOR Template Library
+ * Joshua M. Kriegshauser
+ *
+ * bloom_filter.h
+ *
+ * This file defines a blocked Bloom filter: a probabilistic set that can report false
+ * positives but never false negatives. Each element maps to a single cache-line-sized block
+ * and all of its bits are set within that block, so a lookup touches exactly one cache line.
+ *
+ * Use to screen out lookups for elements that are certainly not present before performing an
+ * expensive lookup (disk, network, etc). Elements cannot be removed; see cuckoo_filter.h for a
+ * filter that supports removal.
+ *
+ * blocked_bloom_filter
+ *   Time:
+ *     insert   - constant
+ *     contains - constant
+ *   Space:
+ *     bits_per_element bits per expected element, rounded up to whole blocks. 10 bits per element
+ *     with 7 hashes gives a false positive rate of roughly 1%.
+ */
+
+#ifndef THOR_BLOOM_FILTER_H
+#define THOR_BLOOM_FILTER_H
+#pragma once
+
+#ifndef THOR_BASETYPES_H
+#include "basetypes.h"
+#endif
+
+#ifndef THOR_HASH_FUNCS_H
+#include "hash_funcs.h"
+#endif
+
+#ifndef THOR_VECTOR_H
+#include "vector.h"
+#endif
+
+#ifndef THOR_ALGORITHM_H
+#include "algorithm.h"
+#endif
+
+#ifndef THOR_SWAP_H
+#include "swap.h"
+#endif
+
+namespace thor
+{
+
+template
+<
+    class T,
+    class HashFunc = hash<T>
+> class blocked_bloom_filter
+{
+public:
+    typedef T value_type;
+    typedef HashFunc hasher;
+    typedef thor_size_type size_type;
+
+    enum
+    {
+        block_bits = THOR_CACHE_LINE_SIZE * 8,
+        words_per_block = THOR_CACHE_LINE_SIZE / sizeof(size_type),
+        bits_per_word = sizeof(size_type) * 8,
+        max_hash_count = 16,
+        default_bits_per_element = 10,
+    };
+
+    // expected_elements - the number of elements that are expected to be inserted
+    // bits_per_element  - determines the false positive rate; 8 gives ~2.5%, 10 ~1%, 16 ~0.1%
+    blocked_bloom_filter(size_type expected_elements = 0, size_type bits_per_element = default_bits_per_element, const hasher& h = hasher()) :
+        m_hash(h),
+        m_hash_count(0),
+        m_count(0)
+    {
+        THOR_COMPILETIME_ASSERT(sizeof(block) == THOR_CACHE_LINE_SIZE, InvalidBlockSize);
+        reset(expected_elements, bits_per_element);
+    }
+
+    // Resizes and clears the filter
+    void reset(size_type expected_elements, size_type bits_per_element = default_bits_per_element)
+    {
+        THOR_DEBUG_ASSERT(bits_per_element != 0);
+        const size_type bits = _max(expected_elements, size_type(1)) * bits_per_element;
+        m_blocks.clear();
+        m_blocks.resize((bits + block_bits - 1) / block_bits);
+
+        // The optimal number of hashes is bits_per_element * ln(2)
+        m_hash_count = _min(_max((bits_per_element * 693 + 500) / 1000, size_type(1)), size_type(max_hash_count));
+        clear();
+    }
+
+    // Removes all elements without changing the size
+    void clear()
+    {
+        for (typename block_vector::iterator iter(m_blocks.begin()); iter != m_blocks.end(); ++iter)
+        {
+            for (size_type i = 0; i != words_per_block; ++i)
+            {
+                iter->words[i] = 0;
+            }
+        }
+        m_count = 0;
+    }
+
+    void insert(const value_type& v)
+    {
+        insert_hash(m_hash(v));
+    }
+
+    bool contains(const value_type& v) const
+    {
+        return contains_hash(m_hash(v));
+    }
+
+    // Versions that take a precomputed hasher value
+    void insert_hash(size_type hashval)
+    {
+        block& b = m_blocks[block_index(hashval)];
+        size_type pos, step;
+        first_bit(hashval, pos, step);
+        for (size_type i = 0; i != m_hash_count; ++i, pos += step)
+        {
+            pos &= (block_bits - 1);
+            b.words[pos / bits_per_word] |= size_type(1) << (pos % bits_per_word);
+        }
+        ++m_count;
+    }
+
+    bool contains_hash(size_type hashval) const
+    {
+        const block& b = m_blocks[block_index(hashval)];
+        size_type pos, step;
+        first_bit(hashval, pos, step);
+        size_type missing = 0;
+        for (size_type i = 0; i != m_hash_count; ++i, pos += step)
+        {
+            pos &= (block_bits - 1);
+            missing |= ~b.words[pos / bits_per_word] & (size_type(1) << (pos % bits_per_word));
+        }
+        return missing == 0;
+    }
+
+    // Adds all elements from a filter with identical size and hash count. Returns false if the
+    // filters are not compatible.
+    bool merge(const blocked_bloom_filter& rhs)
+    {
+        if (rhs.m_blocks.size() != m_blocks.size() || rhs.m_hash_count != m_hash_count)
+        {
+            return false;
+        }
+        for (size_type b = 0; b != m_blocks.size(); ++b)
+        {
+            for (size_type i = 0; i != words_per_block; ++i)
+            {
+                m_blocks[b].words[i] |= rhs.m_blocks[b].words[i];
+            }
+        }
+        m_count += rhs.m_count;
+        return true;
+    }
+
+    void swap(blocked_bloom_filter& rhs)
+    {
+        m_blocks.swap(rhs.m_blocks);
+        thor::swap(m_hash, rhs.m_hash);
+        thor::swap(m_hash_count, rhs.m_hash_count);
+        thor::swap(m_count, rhs.m_count);
+    }
+
+    // Number of insert() calls since the last clear
+    size_type count() const
+    {
+        return m_count;
+    }
+
+    bool empty() const
+    {
+        return m_count == 0;
+    }
+
+    size_type block_count() const
+    {
+        return m_blocks.size();
+    }
+
+    size_type bit_count() const
+    {
+        return m_blocks.size() * block_bits;
+    }
+
+    size_type hash_count() const
+    {
+        return m_hash_count;
+    }
+
+    const hasher& hash_funct() const
+    {
+        return m_hash;
+    }
+
+private:
+    struct block
+    {
+        THOR_ALIGN(64, size_type words[words_per_block]);
+    };
+    typedef vector<block> block_vector;
+
+    size_type block_index(size_type hashval) const
+    {
+        return __hashmix(hashval, 0) % m_blocks.size();
+    }
+
+    // Bit positions within the block use double hashing: pos(i) = first + i * step. The step
+    // is odd so the positions are distinct.
+    static void first_bit(size_type hashval, size_type& pos, size_type& step)
+    {
+        const size_type h = __hashmix(hashval, 1);
+        pos = h & (block_bits - 1);
+        step = ((h >> 16) & (block_bits - 1)) | 1;
+    }
+
+    block_vector m_blocks;
+    hasher m_hash;
+    size_type m_hash_count;
+    size_type m_count;
+};
+
+template <class T, class HashFunc> void swap(blocked_bloom_filter<T, HashFunc>& lhs, blocked_bloom_filter<T, HashFunc>& rhs)
+{
+    lhs.swap(rhs);
+}
+
+} // namespace thor
+
+#endif
+
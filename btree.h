@@ -0,0 +1,1244 @@
+/* THOR - THOR Template Library
+ * Joshua M. Kriegshauser
+ *
+ * btree.h
+ *
+ * ** THOR INTERNAL FILE - NOT FOR APPLICATION USE **
+ *
+ * This file defines a B-tree to be used as a base for B-tree containers (btree_map, btree_multimap,
+ * btree_set, btree_multiset). This class is not intended to be used outside of internal THOR
+ * implementation.
+ *
+ * Each node holds many values in contiguous arrays and is sized to a small number of cache lines.
+ * Keys are stored in their own array within the node so that searching a node only touches keys;
+ * for common arithmetic keys ordered by less<> the search is a branch-free (SSE2 where available)
+ * count of the keys less than the search key.
+ */
+
+#ifndef THOR_BTREE_H
+#define THOR_BTREE_H
+#pragma once
+
+#ifndef THOR_PAIR_H
+#include "pair.h"
+#endif
+
+#ifndef THOR_ITERATOR_H
+#include "iterator.h"
+#endif
+
+#ifndef THOR_ALGORITHM_H
+#include "algorithm.h"
+#endif
+
+#ifndef THOR_FUNCTION_H
+#include "function.h"
+#endif
+
+#ifndef THOR_TYPETRAITS_H
+#include "typetraits.h"
+#endif
+
+#ifndef THOR_MEMORY_H
+#include "memory.h"
+#endif
+
+#ifndef THOR_SWAP_H
+#include "swap.h"
+#endif
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define THOR_BTREE_SSE2
+#endif
+
+namespace thor
+{
+
+namespace internal
+{
+
+// In-node search. lower_bound() returns the number of keys in [keys, keys + n) that are less
+// than k; upper_bound() returns the number of keys that are not greater than k.
+template <class Key, class Compare> struct btree_search
+{
+    static size_type lower_bound(const Key* keys, size_type n, const Key& k, const Compare& comp)
+    {
+        size_type first = 0;
+        while (n != 0)
+        {
+            const size_type half = n >> 1;
+            if (comp(keys[first + half], k))
+            {
+                first += half + 1;
+                n -= half + 1;
+            }
+            else
+            {
+                n = half;
+            }
+        }
+        return first;
+    }
+
+    static size_type upper_bound(const Key* keys, size_type n, const Key& k, const Compare& comp)
+    {
+        size_type first = 0;
+        while (n != 0)
+        {
+            const size_type half = n >> 1;
+            if (!comp(k, keys[first + half]))
+            {
+                first += half + 1;
+                n -= half + 1;
+            }
+            else
+            {
+                n = half;
+            }
+        }
+        return first;
+    }
+};
+
+// Arithmetic keys with the default ordering are searched by counting, which has no
+// data-dependent branches and is easily vectorized by the compiler.
+template <class Key> struct btree_linear_search
+{
+    static size_type lower_bound(const Key* keys, size_type n, const Key& k, const less<Key>&)
+    {
+        size_type count = 0;
+        for (size_type i = 0; i != n; ++i)
+        {
+            count += (keys[i] < k);
+        }
+        return count;
+    }
+
+    static size_type upper_bound(const Key* keys, size_type n, const Key& k, const less<Key>&)
+    {
+        size_type count = 0;
+        for (size_type i = 0; i != n; ++i)
+        {
+            count += !(k < keys[i]);
+        }
+        return count;
+    }
+};
+
+#define THOR_BTREE_LINEAR_SEARCH(T) template <> struct btree_search<T, less<T> > : public btree_linear_search<T> {}
+THOR_BTREE_LINEAR_SEARCH(char);
+THOR_BTREE_LINEAR_SEARCH(unsigned char);
+THOR_BTREE_LINEAR_SEARCH(short);
+THOR_BTREE_LINEAR_SEARCH(unsigned short);
+THOR_BTREE_LINEAR_SEARCH(long);
+THOR_BTREE_LINEAR_SEARCH(unsigned long);
+THOR_BTREE_LINEAR_SEARCH(long long);
+THOR_BTREE_LINEAR_SEARCH(unsigned long long);
+THOR_BTREE_LINEAR_SEARCH(float);
+THOR_BTREE_LINEAR_SEARCH(double);
+#undef THOR_BTREE_LINEAR_SEARCH
+
+#ifdef THOR_BTREE_SSE2
+// Counts the 32-bit keys that compare greater than (greater == true) or less than k, four at a
+// time. The bias flips the sign bit so that unsigned keys can use the signed compare.
+template <bool greater> inline size_type btree_sse2_count(const __int32* keys, size_type n, __int32 k, __int32 bias)
+{
+    const __m128i vbias = _mm_set1_epi32(bias);
+    const __m128i vk = _mm_set1_epi32(k ^ bias);
+    __m128i acc = _mm_setzero_si128();
+    size_type i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        const __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(keys + i)), vbias);
+        // Each matching lane is -1, so subtracting counts the matches per lane
+        acc = _mm_sub_epi32(acc, greater ? _mm_cmpgt_epi32(v, vk) : _mm_cmplt_epi32(v, vk));
+    }
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    size_type count = (size_type)_mm_cvtsi128_si32(acc);
+    for (; i != n; ++i)
+    {
+        const __int32 key = keys[i] ^ bias;
+        count += greater ? (key > (k ^ bias)) : (key < (k ^ bias));
+    }
+    return count;
+}
+
+template <class Key, __int32 bias> struct btree_sse2_search
+{
+    static size_type lower_bound(const Key* keys, size_type n, const Key& k, const less<Key>&)
+    {
+        return btree_sse2_count<false>((const __int32*)keys, n, (__int32)k, bias);
+    }
+
+    static size_type upper_bound(const Key* keys, size_type n, const Key& k, const less<Key>&)
+    {
+        return n - btree_sse2_count<true>((const __int32*)keys, n, (__int32)k, bias);
+    }
+};
+
+template <> struct btree_search<int, less<int> > : public btree_sse2_search<int, 0> {};
+template <> struct btree_search<unsigned int, less<unsigned int> > : public btree_sse2_search<unsigned int, (__int32)0x80000000> {};
+#else
+template <> struct btree_search<int, less<int> > : public btree_linear_search<int> {};
+template <> struct btree_search<unsigned int, less<unsigned int> > : public btree_linear_search<unsigned int> {};
+#endif
+
+// Value storage for a node. Keys are kept in their own contiguous array for searching. The
+// memory is never constructed as a whole; individual slots are constructed and destroyed.
+template <class Key, class Value, class KeyFromValue, size_type N> struct btree_slots
+{
+    enum { slot_size = sizeof(Key) + sizeof(Value) };
+
+    Key   m_keys[N];
+    Value m_values[N];
+
+    const Key* keys() const                         { return m_keys; }
+    const Key& key(size_type i) const               { return m_keys[i]; }
+    Value& value(size_type i)                       { return m_values[i]; }
+    const Value& value(size_type i) const           { return m_values[i]; }
+
+    void construct_key(size_type i, const Key& k)   { typetraits<Key>::construct(&m_keys[i], k); }
+    void construct_value(size_type i, const Value& v) { typetraits<Value>::construct(&m_values[i], v); }
+    void destruct_value(size_type i)                { typetraits<Value>::destruct(&m_values[i]); }
+    void destroy(size_type i)
+    {
+        typetraits<Key>::destruct(&m_keys[i]);
+        typetraits<Value>::destruct(&m_values[i]);
+    }
+    void copy(size_type i, const btree_slots& src, size_type j)
+    {
+        typetraits<Key>::construct(&m_keys[i], src.m_keys[j]);
+        typetraits<Value>::construct(&m_values[i], src.m_values[j]);
+    }
+    // Constructs dest slot j from slot i and destroys slot i
+    void move(size_type i, btree_slots& dest, size_type j)
+    {
+        dest.copy(j, *this, i);
+        destroy(i);
+    }
+};
+
+// Sets store the value as the key
+template <class Key, size_type N> struct btree_slots<Key, Key, identity<Key>, N>
+{
+    enum { slot_size = sizeof(Key) };
+
+    Key   m_keys[N];
+
+    const Key* keys() const                         { return m_keys; }
+    const Key& key(size_type i) const               { return m_keys[i]; }
+    Key& value(size_type i)                         { return m_keys[i]; }
+    const Key& value(size_type i) const             { return m_keys[i]; }
+
+    void construct_key(size_type, const Key&)       {}
+    void construct_value(size_type i, const Key& v) { typetraits<Key>::construct(&m_keys[i], v); }
+    void destruct_value(size_type i)                { typetraits<Key>::destruct(&m_keys[i]); }
+    void destroy(size_type i)                       { typetraits<Key>::destruct(&m_keys[i]); }
+    void copy(size_type i, const btree_slots& src, size_type j) { typetraits<Key>::construct(&m_keys[i], src.m_keys[j]); }
+    void move(size_type i, btree_slots& dest, size_type j)
+    {
+        dest.copy(j, *this, i);
+        destroy(i);
+    }
+};
+
+} // namespace internal
+
+template <class Key, class Value, class KeyFromValue, class Compare>
+class btree
+{
+    struct node;
+    struct internal_node;
+    typedef internal::btree_search<Key, Compare> search_type;
+
+public:
+    typedef Key key_type;
+    typedef Value value_type;
+    typedef Compare key_compare;
+    typedef value_type* pointer;
+    typedef const value_type* const_pointer;
+    typedef value_type& reference;
+    typedef const value_type& const_reference;
+    typedef thor_size_type size_type;
+    typedef thor_diff_type difference_type;
+
+    enum
+    {
+        // Target size of a leaf node
+        node_bytes = 4 * THOR_CACHE_LINE_SIZE,
+        node_header_bytes = 2 * sizeof(void*),
+        fit_values = (node_bytes - node_header_bytes) / internal::btree_slots<Key, Value, KeyFromValue, 1>::slot_size,
+        max_values = fit_values < 3 ? 3 : (fit_values > 255 ? 255 : fit_values),
+        // Every node except the root holds at least min_values
+        min_values = (max_values - 1) / 2,
+    };
+
+    // iterator definitions
+    struct iterator_base : public iterator_type<bidirectional_iterator_tag, value_type>
+    {
+        node* m_node;
+        size_type m_pos;
+#ifdef THOR_DEBUG
+        const btree* m_owner;
+        iterator_base(node* n, size_type pos, const btree* o) : m_node(n), m_pos(pos), m_owner(o) {}
+#else
+        iterator_base(node* n, size_type pos, const btree*) : m_node(n), m_pos(pos) {}
+#endif
+        void verify_not_end() const { THOR_DEBUG_ASSERT(m_node != 0 && m_pos < m_node->count); }
+
+        void incr()
+        {
+            verify_not_end();
+            if (!m_node->leaf)
+            {
+                // First value of the right subtree
+                m_node = static_cast<internal_node*>(m_node)->children[m_pos + 1];
+                while (!m_node->leaf)
+                {
+                    m_node = static_cast<internal_node*>(m_node)->children[0];
+                }
+                m_pos = 0;
+            }
+            else if (++m_pos == m_node->count)
+            {
+                // Climb to the next value. If there isn't one, stay at the end of the last leaf.
+                node* n = m_node;
+                size_type pos = m_pos;
+                while (pos == n->count && n->parent != 0)
+                {
+                    pos = n->position;
+                    n = n->parent;
+                }
+                if (pos != n->count)
+                {
+                    m_node = n;
+                    m_pos = pos;
+                }
+            }
+        }
+
+        void decr()
+        {
+            THOR_DEBUG_ASSERT(m_node != 0);
+            if (!m_node->leaf)
+            {
+                // Last value of the left subtree
+                m_node = static_cast<internal_node*>(m_node)->children[m_pos];
+                while (!m_node->leaf)
+                {
+                    m_node = static_cast<internal_node*>(m_node)->children[m_node->count];
+                }
+                m_pos = m_node->count - 1;
+            }
+            else if (m_pos != 0)
+            {
+                --m_pos;
+            }
+            else
+            {
+                node* n = m_node;
+                size_type pos = 0;
+                while (pos == 0 && n->parent != 0)
+                {
+                    pos = n->position;
+                    n = n->parent;
+                }
+                // Stepping before the first value gives rend()
+                m_node = pos == 0 ? 0 : n;
+                m_pos = pos == 0 ? 0 : pos - 1;
+            }
+        }
+
+        bool operator == (const iterator_base& i) const { THOR_DEBUG_ASSERT(m_owner == i.m_owner); return m_node == i.m_node && m_pos == i.m_pos; }
+        bool operator != (const iterator_base& i) const { THOR_DEBUG_ASSERT(m_owner == i.m_owner); return !(*this == i); }
+    };
+
+    template<class Traits> class fwd_iterator : public iterator_base
+    {
+    public:
+        typedef typename Traits::pointer pointer;
+        typedef typename Traits::reference reference;
+        typedef fwd_iterator<nonconst_traits<value_type> > nonconst_iterator;
+        typedef fwd_iterator<Traits> selftype;
+
+        fwd_iterator(node* n = 0, size_type pos = 0, const btree* o = 0) : iterator_base(n, pos, o) {}
+        fwd_iterator(const nonconst_iterator& i) : iterator_base(i) {}
+        selftype&  operator = (const nonconst_iterator& i)  { iterator_base::operator = (i); return *this; }
+        reference  operator * () const                      { verify_not_end(); return m_node->slots.value(this->m_pos); }
+        pointer    operator -> () const                     { return &(operator*()); }
+        selftype&  operator -- ()     /* --iterator */      {                    decr(); return *this; }
+        selftype   operator -- (int)  /* iterator-- */      { selftype n(*this); decr(); return n; }
+        selftype&  operator ++ ()     /* ++iterator */      {                    incr(); return *this; }
+        selftype   operator ++ (int)  /* iterator++ */      { selftype n(*this); incr(); return n; }
+    };
+
+    template<class Traits> class rev_iterator : public iterator_base
+    {
+    public:
+        typedef typename Traits::pointer pointer;
+        typedef typename Traits::reference reference;
+        typedef rev_iterator<nonconst_traits<value_type> > nonconst_iterator;
+        typedef rev_iterator<Traits> selftype;
+
+        rev_iterator(node* n = 0, size_type pos = 0, const btree* o = 0) : iterator_base(n, pos, o) {}
+        rev_iterator(const nonconst_iterator& i) : iterator_base(i) {}
+        selftype&  operator = (const nonconst_iterator& i)  { iterator_base::operator = (i); return *this; }
+        reference  operator * () const                      { verify_not_end(); return m_node->slots.value(this->m_pos); }
+        pointer    operator -> () const                     { return &(operator*()); }
+        selftype&  operator -- ()     /* --iterator */      {                    incr(); return *this; }
+        selftype   operator -- (int)  /* iterator-- */      { selftype n(*this); incr(); return n; }
+        selftype&  operator ++ ()     /* ++iterator */      {                    decr(); return *this; }
+        selftype   operator ++ (int)  /* iterator++ */      { selftype n(*this); decr(); return n; }
+    };
+
+    typedef fwd_iterator<nonconst_traits<value_type> > iterator;
+    typedef fwd_iterator<const_traits<value_type>    > const_iterator;
+
+    typedef rev_iterator<nonconst_traits<value_type> > reverse_iterator;
+    typedef rev_iterator<const_traits<value_type>    > const_reverse_iterator;
+
+    // constructors
+    btree() :
+        m_header()
+    {}
+
+    btree(const key_compare& k) :
+        m_header(k)
+    {}
+
+    btree(const btree& rhs) :
+        m_header(rhs.key_comp())
+    {
+        copy_from(rhs);
+    }
+
+    ~btree()
+    {
+        clear();
+    }
+
+    btree& operator = (const btree& rhs)
+    {
+        if (this != &rhs)
+        {
+            clear();
+            static_cast<key_compare&>(m_header) = rhs.key_comp();
+            copy_from(rhs);
+        }
+        return *this;
+    }
+
+    // Size
+    bool empty() const
+    {
+        return m_header.m_size == 0;
+    }
+
+    size_type size() const
+    {
+        return m_header.m_size;
+    }
+
+    size_type max_size() const
+    {
+        return size_type(-1);
+    }
+
+    const key_compare& key_comp() const
+    {
+        return m_header;
+    }
+
+    // Iteration
+    iterator begin()
+    {
+        return iterator(m_header.m_leftmost, 0, this);
+    }
+
+    const_iterator begin() const
+    {
+        return const_iterator(m_header.m_leftmost, 0, this);
+    }
+
+    iterator end()
+    {
+        return iterator(m_header.m_rightmost, end_pos(), this);
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator(m_header.m_rightmost, end_pos(), this);
+    }
+
+    reverse_iterator rbegin()
+    {
+        return reverse_iterator(m_header.m_rightmost, end_pos() - (m_header.m_rightmost != 0), this);
+    }
+
+    const_reverse_iterator rbegin() const
+    {
+        return const_reverse_iterator(m_header.m_rightmost, end_pos() - (m_header.m_rightmost != 0), this);
+    }
+
+    reverse_iterator rend()
+    {
+        return reverse_iterator(0, 0, this);
+    }
+
+    const_reverse_iterator rend() const
+    {
+        return const_reverse_iterator(0, 0, this);
+    }
+
+    // O(1) swap; nodes never refer back to the container
+    void swap(btree& rhs)
+    {
+        thor::swap(m_header, rhs.m_header);
+    }
+
+    void clear()
+    {
+        if (m_header.m_root != 0)
+        {
+            destroy_subtree(m_header.m_root);
+        }
+        m_header.m_root = m_header.m_leftmost = m_header.m_rightmost = 0;
+        m_header.m_size = 0;
+    }
+
+    // Insertion
+    pair<iterator, bool> insert_unique(const value_type& v)
+    {
+        const key_type& key = KeyFromValue()(v);
+        node* n;
+        size_type pos;
+        if (!find_insert_unique(key, n, pos))
+        {
+            return pair<iterator, bool>(iterator(n, pos, this), false);
+        }
+        internal_insert(n, pos);
+        n->slots.construct_key(pos, key);
+        n->slots.construct_value(pos, v);
+        return pair<iterator, bool>(iterator(n, pos, this), true);
+    }
+
+    // The value_type of the returned iterator always needs to be constructed
+    iterator key_insert_unique(const key_type& key)
+    {
+        node* n;
+        size_type pos;
+        if (!find_insert_unique(key, n, pos))
+        {
+            // Need to destruct the current value so that the caller can always construct it.
+            n->slots.destruct_value(pos);
+            return iterator(n, pos, this);
+        }
+        internal_insert(n, pos);
+        n->slots.construct_key(pos, key);
+        return iterator(n, pos, this);
+    }
+
+    template <class InputIterator> void insert_unique(InputIterator first, InputIterator last)
+    {
+        for (; first != last; ++first)
+        {
+            insert_unique(*first);
+        }
+    }
+
+    iterator insert_equal(const value_type& v)
+    {
+        const key_type& key = KeyFromValue()(v);
+        node* n;
+        size_type pos;
+        find_insert_equal(key, n, pos);
+        internal_insert(n, pos);
+        n->slots.construct_key(pos, key);
+        n->slots.construct_value(pos, v);
+        return iterator(n, pos, this);
+    }
+
+    // The value_type of the returned iterator always needs to be constructed
+    iterator key_insert_equal(const key_type& key)
+    {
+        node* n;
+        size_type pos;
+        find_insert_equal(key, n, pos);
+        internal_insert(n, pos);
+        n->slots.construct_key(pos, key);
+        return iterator(n, pos, this);
+    }
+
+    template <class InputIterator> void insert_equal(InputIterator first, InputIterator last)
+    {
+        for (; first != last; ++first)
+        {
+            insert_equal(*first);
+        }
+    }
+
+    // Erasing. Returns the iterator following the erased value.
+    iterator erase(iterator pos)
+    {
+        verify_iterator(pos);
+        pos.verify_not_end();
+
+        node* n = pos.m_node;
+        size_type i = pos.m_pos;
+        const bool from_internal = !n->leaf;
+        if (from_internal)
+        {
+            // Replace the value with its predecessor, the last value in the rightmost leaf of the
+            // left subtree, then remove the predecessor from that leaf.
+            node* leaf = as_internal(n)->children[i];
+            while (!leaf->leaf)
+            {
+                leaf = as_internal(leaf)->children[leaf->count];
+            }
+            n->slots.destroy(i);
+            leaf->slots.move(leaf->count - 1, n->slots, i);
+            n = leaf;
+            i = leaf->count - 1;
+        }
+        else
+        {
+            n->slots.destroy(i);
+            for (size_type j = i + 1; j < n->count; ++j)
+            {
+                n->slots.move(j, n->slots, j - 1);
+            }
+        }
+        --n->count;
+        THOR_DEBUG_ASSERT(m_header.m_size != 0);
+        --m_header.m_size;
+
+        // (n, i) is the leaf position of the value that followed the removed value. It is kept
+        // up to date as values move between nodes.
+        rebalance(n, n, i);
+        iterator result(make_iterator(n, i));
+        if (from_internal)
+        {
+            // result is the predecessor that replaced the erased value
+            ++result;
+        }
+        return result;
+    }
+
+    size_type erase(const key_type& k)
+    {
+        iterator first(lower_bound(k));
+        size_type n = 0;
+        while (first != end() && !key_comp()(k, KeyFromValue()(*first)))
+        {
+            first = erase(first);
+            ++n;
+        }
+        return n;
+    }
+
+    size_type erase(iterator first, iterator last)
+    {
+        verify_iterator(first);
+        verify_iterator(last);
+        if (first == begin() && last == end())
+        {
+            size_type n = size();
+            clear();
+            return n;
+        }
+
+        // Iterators are invalidated by erase, so count first
+        size_type n = 0;
+        for (iterator iter(first); iter != last; ++iter)
+        {
+            ++n;
+        }
+        for (size_type i = 0; i != n; ++i)
+        {
+            first = erase(first);
+        }
+        return n;
+    }
+
+    // Searching
+    iterator find(const key_type& k)
+    {
+        iterator iter(lower_bound(k));
+        return (iter == end() || key_comp()(k, KeyFromValue()(*iter))) ? end() : iter;
+    }
+
+    const_iterator find(const key_type& k) const
+    {
+        const_iterator iter(lower_bound(k));
+        return (iter == end() || key_comp()(k, KeyFromValue()(*iter))) ? end() : iter;
+    }
+
+    size_type count(const key_type& k) const
+    {
+        size_type n = 0;
+        for (const_iterator iter(lower_bound(k)); iter != end() && !key_comp()(k, KeyFromValue()(*iter)); ++iter)
+        {
+            ++n;
+        }
+        return n;
+    }
+
+    iterator lower_bound(const key_type& k)
+    {
+        node* n;
+        size_type pos;
+        internal_lower_bound(k, n, pos);
+        return iterator(n, pos, this);
+    }
+
+    const_iterator lower_bound(const key_type& k) const
+    {
+        node* n;
+        size_type pos;
+        internal_lower_bound(k, n, pos);
+        return const_iterator(n, pos, this);
+    }
+
+    iterator upper_bound(const key_type& k)
+    {
+        node* n;
+        size_type pos;
+        internal_upper_bound(k, n, pos);
+        return iterator(n, pos, this);
+    }
+
+    const_iterator upper_bound(const key_type& k) const
+    {
+        node* n;
+        size_type pos;
+        internal_upper_bound(k, n, pos);
+        return const_iterator(n, pos, this);
+    }
+
+    pair<iterator,iterator> equal_range(const key_type& k)
+    {
+        return pair<iterator,iterator>(lower_bound(k), upper_bound(k));
+    }
+
+    pair<const_iterator,const_iterator> equal_range(const key_type& k) const
+    {
+        return pair<const_iterator,const_iterator>(lower_bound(k), upper_bound(k));
+    }
+
+private:
+    typedef internal::btree_slots<Key, Value, KeyFromValue, max_values> slots_type;
+
+    struct node
+    {
+        internal_node*  parent;
+        unsigned short  position;   // Index of this node in parent->children
+        unsigned short  count;      // Number of values
+        bool            leaf;
+        slots_type      slots;
+    };
+
+    struct internal_node : public node
+    {
+        node*           children[max_values + 1];
+    };
+
+    enum
+    {
+        node_alignment = memory::align_selector<internal_node>::alignment > THOR_CACHE_LINE_SIZE ? memory::align_selector<internal_node>::alignment : THOR_CACHE_LINE_SIZE
+    };
+
+    // Use empty member optimization since key_compare is likely going to be an empty class.
+    struct empty_member_opt : public key_compare
+    {
+        node*       m_root;
+        node*       m_leftmost;     // First leaf
+        node*       m_rightmost;    // Last leaf; end() is one past its last value
+        size_type   m_size;
+
+        empty_member_opt() :
+            key_compare(),
+            m_root(0),
+            m_leftmost(0),
+            m_rightmost(0),
+            m_size(0)
+        {}
+
+        empty_member_opt(const key_compare& k) :
+            key_compare(k),
+            m_root(0),
+            m_leftmost(0),
+            m_rightmost(0),
+            m_size(0)
+        {}
+    };
+
+    empty_member_opt m_header;
+
+    void verify_iterator(const iterator_base& i) const { THOR_UNUSED(i); THOR_ASSERT(i.m_owner == this); }
+
+    key_compare& key_comp()
+    {
+        return static_cast<key_compare&>(m_header);
+    }
+
+    size_type end_pos() const
+    {
+        return m_header.m_rightmost != 0 ? m_header.m_rightmost->count : 0;
+    }
+
+    static internal_node* as_internal(node* n)
+    {
+        THOR_DEBUG_ASSERT(!n->leaf);
+        return static_cast<internal_node*>(n);
+    }
+
+    static const internal_node* as_internal(const node* n)
+    {
+        THOR_DEBUG_ASSERT(!n->leaf);
+        return static_cast<const internal_node*>(n);
+    }
+
+    static void set_child(internal_node* parent, size_type i, node* child)
+    {
+        parent->children[i] = child;
+        child->parent = parent;
+        child->position = (unsigned short)i;
+    }
+
+    // Only allocates memory for the node and sets up the header; no values are constructed
+    static node* alloc_node(bool leaf)
+    {
+        node* n = leaf ? memory::align_alloc<node, node_alignment>::alloc() : memory::align_alloc<internal_node, node_alignment>::alloc();
+        n->parent = 0;
+        n->position = 0;
+        n->count = 0;
+        n->leaf = leaf;
+        return n;
+    }
+
+    static void free_node(node* n)
+    {
+        if (n->leaf)
+        {
+            memory::align_alloc<node, node_alignment>::free(n);
+        }
+        else
+        {
+            memory::align_alloc<internal_node, node_alignment>::free(as_internal(n));
+        }
+    }
+
+    void destroy_subtree(node* n)
+    {
+        for (size_type i = 0; i != n->count; ++i)
+        {
+            n->slots.destroy(i);
+        }
+        if (!n->leaf)
+        {
+            for (size_type i = 0; i <= n->count; ++i)
+            {
+                destroy_subtree(as_internal(n)->children[i]);
+            }
+        }
+        free_node(n);
+    }
+
+    // Copies the shape and values of another tree; this tree must be empty
+    void copy_from(const btree& rhs)
+    {
+        if (rhs.m_header.m_root != 0)
+        {
+            m_header.m_root = clone(rhs.m_header.m_root);
+            m_header.m_size = rhs.m_header.m_size;
+            node* n = m_header.m_root;
+            while (!n->leaf)
+            {
+                n = as_internal(n)->children[0];
+            }
+            m_header.m_leftmost = n;
+            n = m_header.m_root;
+            while (!n->leaf)
+            {
+                n = as_internal(n)->children[n->count];
+            }
+            m_header.m_rightmost = n;
+        }
+    }
+
+    node* clone(const node* src)
+    {
+        node* n = alloc_node(src->leaf);
+        for (size_type i = 0; i != src->count; ++i)
+        {
+            n->slots.copy(i, src->slots, i);
+        }
+        n->count = src->count;
+        if (!src->leaf)
+        {
+            for (size_type i = 0; i <= src->count; ++i)
+            {
+                set_child(as_internal(n), i, clone(as_internal(src)->children[i]));
+            }
+        }
+        return n;
+    }
+
+    size_type node_lower_bound(const node* n, const key_type& k) const
+    {
+        return search_type::lower_bound(n->slots.keys(), n->count, k, key_comp());
+    }
+
+    size_type node_upper_bound(const node* n, const key_type& k) const
+    {
+        return search_type::upper_bound(n->slots.keys(), n->count, k, key_comp());
+    }
+
+    // Sets rn/rpos to the first value not less than k, or end()
+    void internal_lower_bound(const key_type& k, node*& rn, size_type& rpos) const
+    {
+        rn = m_header.m_rightmost;
+        rpos = end_pos();
+        node* n = m_header.m_root;
+        while (n != 0)
+        {
+            const size_type i = node_lower_bound(n, k);
+            if (i != n->count)
+            {
+                rn = n;
+                rpos = i;
+            }
+            if (n->leaf)
+            {
+                break;
+            }
+            n = as_internal(n)->children[i];
+        }
+    }
+
+    // Sets rn/rpos to the first value greater than k, or end()
+    void internal_upper_bound(const key_type& k, node*& rn, size_type& rpos) const
+    {
+        rn = m_header.m_rightmost;
+        rpos = end_pos();
+        node* n = m_header.m_root;
+        while (n != 0)
+        {
+            const size_type i = node_upper_bound(n, k);
+            if (i != n->count)
+            {
+                rn = n;
+                rpos = i;
+            }
+            if (n->leaf)
+            {
+                break;
+            }
+            n = as_internal(n)->children[i];
+        }
+    }
+
+    // Returns false with n/pos at the existing value if k is present; otherwise n/pos is the
+    // position in a leaf where k belongs.
+    bool find_insert_unique(const key_type& k, node*& n, size_type& pos)
+    {
+        n = m_header.m_root;
+        if (n == 0)
+        {
+            pos = 0;
+            return true;
+        }
+        for (;;)
+        {
+            pos = node_lower_bound(n, k);
+            if (pos != n->count && !key_comp()(k, n->slots.key(pos)))
+            {
+                return false;
+            }
+            if (n->leaf)
+            {
+                return true;
+            }
+            n = as_internal(n)->children[pos];
+        }
+    }
+
+    // Equal keys are inserted after any existing matches
+    void find_insert_equal(const key_type& k, node*& n, size_type& pos)
+    {
+        n = m_header.m_root;
+        pos = 0;
+        while (n != 0)
+        {
+            pos = node_upper_bound(n, k);
+            if (n->leaf)
+            {
+                break;
+            }
+            n = as_internal(n)->children[pos];
+        }
+    }
+
+    // Makes room for a value at leaf position n/pos, splitting as required. n/pos are updated to
+    // the final location of the new slot, which is not constructed.
+    void internal_insert(node*& n, size_type& pos)
+    {
+        if (n == 0)
+        {
+            // First value
+            n = alloc_node(true);
+            m_header.m_root = m_header.m_leftmost = m_header.m_rightmost = n;
+        }
+        else if (n->count == max_values)
+        {
+            node* right = split(n);
+            if (pos > n->count)
+            {
+                pos -= n->count + 1;
+                n = right;
+            }
+        }
+
+        THOR_DEBUG_ASSERT(n->leaf && n->count < max_values);
+        for (size_type i = n->count; i > pos; --i)
+        {
+            n->slots.move(i - 1, n->slots, i);
+        }
+        ++n->count;
+        ++m_header.m_size;
+    }
+
+    // Splits a full node into itself and a new right sibling, which is returned. The middle value
+    // moves up to the parent, which is split first if necessary.
+    node* split(node* n)
+    {
+        THOR_DEBUG_ASSERT(n->count == max_values);
+        if (n->parent == 0)
+        {
+            // Grow the tree by one level
+            internal_node* root = as_internal(alloc_node(false));
+            set_child(root, 0, n);
+            m_header.m_root = root;
+        }
+        else if (n->parent->count == max_values)
+        {
+            split(n->parent);
+        }
+
+        internal_node* parent = n->parent;
+        const size_type ppos = n->position;
+        const size_type mid = max_values / 2;
+
+        node* right = alloc_node(n->leaf);
+        right->count = (unsigned short)(max_values - mid - 1);
+        for (size_type i = mid + 1; i != max_values; ++i)
+        {
+            n->slots.move(i, right->slots, i - (mid + 1));
+        }
+        if (!n->leaf)
+        {
+            for (size_type i = mid + 1; i <= max_values; ++i)
+            {
+                set_child(as_internal(right), i - (mid + 1), as_internal(n)->children[i]);
+            }
+        }
+
+        // Make room in the parent and move the middle value up
+        for (size_type i = parent->count; i > ppos; --i)
+        {
+            parent->slots.move(i - 1, parent->slots, i);
+            set_child(parent, i + 1, parent->children[i]);
+        }
+        n->slots.move(mid, parent->slots, ppos);
+        set_child(parent, ppos + 1, right);
+        ++parent->count;
+        n->count = (unsigned short)mid;
+
+        if (m_header.m_rightmost == n)
+        {
+            m_header.m_rightmost = right;
+        }
+        return right;
+    }
+
+    // Restores the minimum fill after a value was removed from n. tn/tpos is a position that is
+    // updated as values move between nodes.
+    void rebalance(node* n, node*& tn, size_type& tpos)
+    {
+        for (;;)
+        {
+            if (n == m_header.m_root)
+            {
+                if (n->count == 0)
+                {
+                    if (n->leaf)
+                    {
+                        // Tree is now empty
+                        free_node(n);
+                        m_header.m_root = m_header.m_leftmost = m_header.m_rightmost = 0;
+                        tn = 0;
+                        tpos = 0;
+                    }
+                    else
+                    {
+                        // Shrink the tree by one level
+                        node* child = as_internal(n)->children[0];
+                        child->parent = 0;
+                        child->position = 0;
+                        m_header.m_root = child;
+                        free_node(n);
+                    }
+                }
+                return;
+            }
+
+            if (n->count >= min_values)
+            {
+                return;
+            }
+
+            internal_node* parent = n->parent;
+            const size_type p = n->position;
+            node* left = p > 0 ? parent->children[p - 1] : 0;
+            node* right = p < parent->count ? parent->children[p + 1] : 0;
+            if (left != 0 && left->count > min_values)
+            {
+                rotate_right(left, n);
+                if (tn == n)
+                {
+                    ++tpos;
+                }
+                return;
+            }
+            if (right != 0 && right->count > min_values)
+            {
+                rotate_left(n, right);
+                return;
+            }
+
+            if (left != 0)
+            {
+                if (tn == n)
+                {
+                    tn = left;
+                    tpos += left->count + 1;
+                }
+                merge(left, n);
+            }
+            else
+            {
+                merge(n, right);
+            }
+            n = parent;
+        }
+    }
+
+    // Moves the last value of left up to the parent and the parent separator down to the front of n
+    void rotate_right(node* left, node* n)
+    {
+        internal_node* parent = n->parent;
+        const size_type sep = n->position - 1;
+        for (size_type i = n->count; i > 0; --i)
+        {
+            n->slots.move(i - 1, n->slots, i);
+        }
+        parent->slots.move(sep, n->slots, 0);
+        left->slots.move(left->count - 1, parent->slots, sep);
+        if (!n->leaf)
+        {
+            for (size_type i = n->count + 1; i > 0; --i)
+            {
+                set_child(as_internal(n), i, as_internal(n)->children[i - 1]);
+            }
+            set_child(as_internal(n), 0, as_internal(left)->children[left->count]);
+        }
+        ++n->count;
+        --left->count;
+    }
+
+    // Moves the first value of right up to the parent and the parent separator down to the end of n
+    void rotate_left(node* n, node* right)
+    {
+        internal_node* parent = n->parent;
+        const size_type sep = n->position;
+        parent->slots.move(sep, n->slots, n->count);
+        right->slots.move(0, parent->slots, sep);
+        for (size_type i = 1; i < right->count; ++i)
+        {
+            right->slots.move(i, right->slots, i - 1);
+        }
+        if (!n->leaf)
+        {
+            set_child(as_internal(n), n->count + 1, as_internal(right)->children[0]);
+            for (size_type i = 0; i != right->count; ++i)
+            {
+                set_child(as_internal(right), i, as_internal(right)->children[i + 1]);
+            }
+        }
+        ++n->count;
+        --right->count;
+    }
+
+    // Moves the parent separator and all of right into left, then frees right
+    void merge(node* left, node* right)
+    {
+        internal_node* parent = left->parent;
+        const size_type sep = left->position;
+        THOR_DEBUG_ASSERT(left->count + right->count + 1 <= max_values);
+
+        parent->slots.move(sep, left->slots, left->count);
+        for (size_type i = 0; i != right->count; ++i)
+        {
+            right->slots.move(i, left->slots, left->count + 1 + i);
+        }
+        if (!left->leaf)
+        {
+            for (size_type i = 0; i <= right->count; ++i)
+            {
+                set_child(as_internal(left), left->count + 1 + i, as_internal(right)->children[i]);
+            }
+        }
+        left->count = (unsigned short)(left->count + 1 + right->count);
+
+        // Close the gap in the parent
+        for (size_type i = sep + 1; i < parent->count; ++i)
+        {
+            parent->slots.move(i, parent->slots, i - 1);
+            set_child(parent, i, parent->children[i + 1]);
+        }
+        --parent->count;
+
+        if (m_header.m_rightmost == right)
+        {
+            m_header.m_rightmost = left;
+        }
+        free_node(right);
+    }
+
+    // Builds an iterator from a position that may be one past the last value of a node
+    iterator make_iterator(node* n, size_type pos)
+    {
+        if (n != 0 && pos == n->count)
+        {
+            node* c = n;
+            size_type p = pos;
+            while (p == c->count && c->parent != 0)
+            {
+                p = c->position;
+                c = c->parent;
+            }
+            if (p != c->count)
+            {
+                n = c;
+                pos = p;
+            }
+        }
+        return iterator(n, pos, this);
+    }
+};
+
+} // namespace thor
+
+#endif
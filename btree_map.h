@@ -0,0 +1,391 @@
+/* THOR - THOR Template Library
+ * Joshua M. Kriegshauser
+ *
+ * btree_map.h
+ *
+ * This file defines B-tree based btree_map and btree_multimap ordered associative containers
+ *
+ * Changes/Extensions:
+ * - The interface matches map and multimap (see map.h), but values are stored in wide B-tree
+ *   nodes (a few cache lines each) rather than one heap node per value. Lookups and ordered
+ *   iteration touch far fewer cache lines and per-value memory overhead is much lower.
+ * - Keys are also stored in a contiguous array within each node, so the key type must be
+ *   copy-constructible. Arithmetic keys ordered by less<> are searched without branches (SSE2
+ *   where available).
+ * - Unlike map, values move between nodes as the tree changes:
+ *   * ALL iterators and pointers to values are invalidated by insert and erase.
+ *   * erase(iterator) returns the iterator following the erased value.
+ * - The insert(pos, value_type) functions that support an insert hint are not implemented.
+ * - The value_comp() functions are not implemented.
+ *
+ * btree_map/btree_multimap - Ordered associative containers
+ *   Time:
+ *     insert - logarithmic
+ *     find   - logarithmic
+ *     erase  - logarithmic
+ *     iteration - linear; begin() and end() are constant
+ *   Usage suggestions:
+ *     Prefer over map/multimap for large containers of small values where lookup and iteration
+ *     speed matter, and iterator stability across insert/erase does not.
+ */
+
+#ifndef THOR_BTREE_MAP_H
+#define THOR_BTREE_MAP_H
+#pragma once
+
+#ifndef THOR_BTREE_H
+#include "btree.h"
+#endif
+
+#ifndef THOR_FUNCTION_H
+#include "function.h"
+#endif
+
+namespace thor
+{
+
+// thor::btree_map
+template <class Key, class Value, class Compare = less<Key> > class btree_map
+{
+public:
+    typedef Key key_type;
+    typedef Value data_type;
+    typedef pair<const Key, Value> value_type;
+    typedef Compare key_compare;
+
+private:
+    typedef btree<key_type, value_type, select1st<value_type>, Compare> tree_type;
+    tree_type m_tree;
+
+public:
+    typedef typename tree_type::pointer pointer;
+    typedef typename tree_type::reference reference;
+    typedef typename tree_type::const_pointer const_pointer;
+    typedef typename tree_type::const_reference const_reference;
+    typedef typename tree_type::size_type size_type;
+    typedef typename tree_type::difference_type difference_type;
+    typedef typename tree_type::iterator iterator;
+    typedef typename tree_type::const_iterator const_iterator;
+    typedef typename tree_type::reverse_iterator reverse_iterator;
+    typedef typename tree_type::const_reverse_iterator const_reverse_iterator;
+
+    // constructors
+    btree_map()
+    {}
+
+    btree_map(const key_compare& comp) :
+        m_tree(comp)
+    {}
+
+    template <class InputIterator> btree_map(InputIterator first, InputIterator last)
+    {
+        m_tree.insert_unique(first, last);
+    }
+
+    template <class InputIterator> btree_map(InputIterator first, InputIterator last, const key_compare& comp) :
+        m_tree(comp)
+    {
+        m_tree.insert_unique(first, last);
+    }
+
+    btree_map(const btree_map& m) :
+        m_tree(m.m_tree)
+    {}
+
+    ~btree_map()
+    {}
+
+    btree_map& operator = (const btree_map& m)
+    {
+        m_tree = m.m_tree;
+        return *this;
+    }
+
+    // members
+    iterator begin()                                { return m_tree.begin(); }
+    const_iterator begin() const                    { return m_tree.begin(); }
+    iterator end()                                  { return m_tree.end(); }
+    const_iterator end() const                      { return m_tree.end(); }
+
+    reverse_iterator rbegin()                       { return m_tree.rbegin(); }
+    const_reverse_iterator rbegin() const           { return m_tree.rbegin(); }
+    reverse_iterator rend()                         { return m_tree.rend(); }
+    const_reverse_iterator rend() const             { return m_tree.rend(); }
+
+    bool empty() const                              { return m_tree.empty(); }
+    size_type size() const                          { return m_tree.size(); }
+    size_type max_size() const                      { return m_tree.max_size(); }
+
+    const key_compare& key_comp() const             { return m_tree.key_comp(); }
+
+    void swap(btree_map& m)                         { m_tree.swap(m.m_tree); }
+
+    pair<iterator, bool> insert(const value_type& v) { return m_tree.insert_unique(v); }
+    template <class InputIterator> void insert_range(InputIterator first, InputIterator last) { m_tree.insert_unique(first, last); }
+
+    // Extended insert():
+    // These insert extension functions work more like operator[] than insert(value_type) in that
+    // they always reconstruct the value object if it already exists.
+    iterator insert(const Key& key)
+    {
+        iterator iter(m_tree.key_insert_unique(key));
+        typetraits<value_type>::construct(&*iter, key);
+        return iter;
+    }
+    template <class T1> iterator insert(const Key& key, const T1& t1)
+    {
+        iterator iter(m_tree.key_insert_unique(key));
+        new (&*iter) value_type(key, t1);
+        return iter;
+    }
+    template <class T1, class T2> iterator insert(const Key& key, const T1& t1, const T2& t2)
+    {
+        iterator iter(m_tree.key_insert_unique(key));
+        new (&*iter) value_type(key, t1, t2);
+        return iter;
+    }
+    template <class T1, class T2, class T3> iterator insert(const Key& key, const T1& t1, const T2& t2, const T3& t3)
+    {
+        iterator iter(m_tree.key_insert_unique(key));
+        new (&*iter) value_type(key, t1, t2, t3);
+        return iter;
+    }
+    template <class T1, class T2, class T3, class T4> iterator insert(const Key& key, const T1& t1, const T2& t2, const T3& t3, const T4& t4)
+    {
+        iterator iter(m_tree.key_insert_unique(key));
+        new (&*iter) value_type(key, t1, t2, t3, t4);
+        return iter;
+    }
+    // Requires the use of placement new to construct the Value.
+    // Example: new (l.insert_placement(key)) Value(arg1, arg2);
+    void* insert_placement(const Key& key)
+    {
+        value_type* v = &*m_tree.key_insert_unique(key);
+        typetraits<Key>::construct(const_cast<Key*>(&v->first), key);
+        return &v->second;
+    }
+
+    iterator erase(iterator pos)                    { return m_tree.erase(pos); }
+
+    size_type erase(const key_type& k)
+    {
+        iterator i(find(k));
+        if (i != end()) { m_tree.erase(i); return 1; }
+        return 0;
+    }
+
+    void erase(iterator first, iterator last)       { m_tree.erase(first, last); }
+
+    void clear()                                    { m_tree.clear(); }
+
+    iterator find(const key_type& k)                { return m_tree.find(k); }
+    const_iterator find(const key_type& k) const    { return m_tree.find(k); }
+
+    size_type count(const key_type& k) const        { return find(k) == end() ? 0 : 1; }
+
+    iterator lower_bound(const key_type& k)         { return m_tree.lower_bound(k); }
+    const_iterator lower_bound(const key_type& k) const { return m_tree.lower_bound(k); }
+
+    iterator upper_bound(const key_type& k)         { return m_tree.upper_bound(k); }
+    const_iterator upper_bound(const key_type& k) const { return m_tree.upper_bound(k); }
+
+    pair<iterator,iterator> equal_range(const key_type& k) { return m_tree.equal_range(k); }
+    pair<const_iterator,const_iterator> equal_range(const key_type& k) const { return m_tree.equal_range(k); }
+
+    // Using this involves default-constructing the value and copying the key.
+    data_type& operator [] (const key_type& k)
+    {
+        return (*insert(value_type(k, data_type())).first).second;
+    }
+};
+
+// thor::btree_multimap
+template <class Key, class Value, class Compare = less<Key> > class btree_multimap
+{
+public:
+    typedef Key key_type;
+    typedef Value data_type;
+    typedef pair<const Key, Value> value_type;
+    typedef Compare key_compare;
+
+private:
+    typedef btree<key_type, value_type, select1st<value_type>, Compare> tree_type;
+    tree_type m_tree;
+
+public:
+    typedef typename tree_type::pointer pointer;
+    typedef typename tree_type::reference reference;
+    typedef typename tree_type::const_pointer const_pointer;
+    typedef typename tree_type::const_reference const_reference;
+    typedef typename tree_type::size_type size_type;
+    typedef typename tree_type::difference_type difference_type;
+    typedef typename tree_type::iterator iterator;
+    typedef typename tree_type::const_iterator const_iterator;
+    typedef typename tree_type::reverse_iterator reverse_iterator;
+    typedef typename tree_type::const_reverse_iterator const_reverse_iterator;
+
+    // constructors
+    btree_multimap()
+    {}
+
+    btree_multimap(const key_compare& comp) :
+        m_tree(comp)
+    {}
+
+    template <class InputIterator> btree_multimap(InputIterator first, InputIterator last)
+    {
+        m_tree.insert_equal(first, last);
+    }
+
+    template <class InputIterator> btree_multimap(InputIterator first, InputIterator last, const key_compare& comp) :
+        m_tree(comp)
+    {
+        m_tree.insert_equal(first, last);
+    }
+
+    btree_multimap(const btree_multimap& m) :
+        m_tree(m.m_tree)
+    {}
+
+    ~btree_multimap()
+    {}
+
+    btree_multimap& operator = (const btree_multimap& m)
+    {
+        m_tree = m.m_tree;
+        return *this;
+    }
+
+    // members
+    iterator begin()                            { return m_tree.begin(); }
+    const_iterator begin() const                { return m_tree.begin(); }
+    iterator end()                              { return m_tree.end(); }
+    const_iterator end() const                  { return m_tree.end(); }
+
+    reverse_iterator rbegin()                   { return m_tree.rbegin(); }
+    const_reverse_iterator rbegin() const       { return m_tree.rbegin(); }
+    reverse_iterator rend()                     { return m_tree.rend(); }
+    const_reverse_iterator rend() const         { return m_tree.rend(); }
+
+    bool empty() const                          { return m_tree.empty(); }
+    size_type size() const                      { return m_tree.size(); }
+    size_type max_size() const                  { return m_tree.max_size(); }
+
+    const key_compare& key_comp() const         { return m_tree.key_comp(); }
+
+    void swap(btree_multimap& m)                { m_tree.swap(m.m_tree); }
+
+    iterator insert(const value_type& v)        { return m_tree.insert_equal(v); }
+    template <class InputIterator> void insert_range(InputIterator first, InputIterator last) { m_tree.insert_equal(first, last); }
+
+    iterator insert(const Key& key)
+    {
+        iterator iter(m_tree.key_insert_equal(key));
+        typetraits<value_type>::construct(&*iter, key);
+        return iter;
+    }
+    template <class T1> iterator insert(const Key& key, const T1& t1)
+    {
+        iterator iter(m_tree.key_insert_equal(key));
+        new (&*iter) value_type(key, t1);
+        return iter;
+    }
+    template <class T1, class T2> iterator insert(const Key& key, const T1& t1, const T2& t2)
+    {
+        iterator iter(m_tree.key_insert_equal(key));
+        new (&*iter) value_type(key, t1, t2);
+        return iter;
+    }
+    template <class T1, class T2, class T3> iterator insert(const Key& key, const T1& t1, const T2& t2, const T3& t3)
+    {
+        iterator iter(m_tree.key_insert_equal(key));
+        new (&*iter) value_type(key, t1, t2, t3);
+        return iter;
+    }
+    template <class T1, class T2, class T3, class T4> iterator insert(const Key& key, const T1& t1, const T2& t2, const T3& t3, const T4& t4)
+    {
+        iterator iter(m_tree.key_insert_equal(key));
+        new (&*iter) value_type(key, t1, t2, t3, t4);
+        return iter;
+    }
+    // Requires the use of placement new to construct the Value.
+    // Example: new (l.insert_placement(key)) Value(arg1, arg2);
+    void* insert_placement(const Key& key)
+    {
+        value_type* v = &*m_tree.key_insert_equal(key);
+        typetraits<Key>::construct(const_cast<Key*>(&v->first), key);
+        return &v->second;
+    }
+
+    iterator erase(iterator pos)                { return m_tree.erase(pos); }
+    size_type erase(const key_type& k)          { return m_tree.erase(k); }
+    void erase(iterator first, iterator last)   { m_tree.erase(first, last); }
+
+    void clear()                                { m_tree.clear(); }
+
+    iterator find(const key_type& k)            { return m_tree.find(k); }
+    const_iterator find(const key_type& k) const { return m_tree.find(k); }
+
+    size_type count(const key_type& k) const    { return m_tree.count(k); }
+
+    iterator lower_bound(const key_type& k)     { return m_tree.lower_bound(k); }
+    const_iterator lower_bound(const key_type& k) const { return m_tree.lower_bound(k); }
+
+    iterator upper_bound(const key_type& k)     { return m_tree.upper_bound(k); }
+    const_iterator upper_bound(const key_type& k) const { return m_tree.upper_bound(k); }
+
+    pair<iterator,iterator> equal_range(const key_type& k) { return m_tree.equal_range(k); }
+    pair<const_iterator,const_iterator> equal_range(const key_type& k) const { return m_tree.equal_range(k); }
+};
+
+// Swap specializations
+template <class Key, class Value, class Compare> void swap(btree_map<Key, Value, Compare>& lhs, btree_map<Key, Value, Compare>& rhs)
+{
+    lhs.swap(rhs);
+}
+
+template <class Key, class Value, class Compare> void swap(btree_multimap<Key, Value, Compare>& lhs, btree_multimap<Key, Value, Compare>& rhs)
+{
+    lhs.swap(rhs);
+}
+
+} // namespace thor
+
+// Global operators
+template <class Key, class Value, class Compare>
+bool operator == (const thor::btree_map<Key,Value,Compare>& lhs, const thor::btree_map<Key,Value,Compare>& rhs)
+{
+    return lhs.size() == rhs.size() && thor::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+template <class Key, class Value, class Compare>
+bool operator != (const thor::btree_map<Key,Value,Compare>& lhs, const thor::btree_map<Key,Value,Compare>& rhs)
+{
+    return !(lhs == rhs);
+}
+
+template <class Key, class Value, class Compare>
+bool operator < (const thor::btree_map<Key,Value,Compare>& lhs, const thor::btree_map<Key,Value,Compare>& rhs)
+{
+    return thor::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+}
+
+template <class Key, class Value, class Compare>
+bool operator == (const thor::btree_multimap<Key,Value,Compare>& lhs, const thor::btree_multimap<Key,Value,Compare>& rhs)
+{
+    return lhs.size() == rhs.size() && thor::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+template <class Key, class Value, class Compare>
+bool operator != (const thor::btree_multimap<Key,Value,Compare>& lhs, const thor::btree_multimap<Key,Value,Compare>& rhs)
+{
+    return !(lhs == rhs);
+}
+
+template <class Key, class Value, class Compare>
+bool operator < (const thor::btree_multimap<Key,Value,Compare>& lhs, const thor::btree_multimap<Key,Value,Compare>& rhs)
+{
+    return thor::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+}
+
+#endif
@@ -0,0 +1,289 @@
+/* THOR - THOR Template Library
+ * Joshua M. Kriegshauser
+ *
+ * btree_set.h
+ *
+ * This file defines B-tree based btree_set and btree_multiset ordered containers
+ *
+ * Changes/Extensions:
+ * - The interface matches set and multiset (see set.h), but keys are stored contiguously in wide
+ *   B-tree nodes (a few cache lines each) rather than one heap node per key. Arithmetic keys
+ *   ordered by less<> are searched without branches (SSE2 where available).
+ * - Unlike set, keys move between nodes as the tree changes:
+ *   * ALL iterators and pointers to keys are invalidated by insert and erase.
+ *   * erase(iterator) returns the iterator following the erased key.
+ * - The insert(pos, value_type) functions that support an insert hint are not implemented.
+ * - The value_comp() functions are not implemented.
+ *
+ * btree_set/btree_multiset - Ordered containers
+ *   Time:
+ *     insert - logarithmic
+ *     find   - logarithmic
+ *     erase  - logarithmic
+ *     iteration - linear; begin() and end() are constant
+ *   Usage suggestions:
+ *     Prefer over set/multiset for large containers of small keys where lookup and iteration
+ *     speed matter, and iterator stability across insert/erase does not.
+ */
+
+#ifndef THOR_BTREE_SET_H
+#define THOR_BTREE_SET_H
+#pragma once
+
+#ifndef THOR_BTREE_H
+#include "btree.h"
+#endif
+
+#ifndef THOR_FUNCTION_H
+#include "function.h"
+#endif
+
+namespace thor
+{
+
+// thor::btree_set
+template <class Key, class Compare = less<Key> > class btree_set
+{
+    typedef btree<Key, Key, identity<Key>, Compare> tree_type;
+    typedef typename tree_type::iterator mutable_iterator;
+    mutable_iterator make_mutable(typename tree_type::const_iterator pos) const { return *(mutable_iterator*)&pos; }
+    tree_type m_tree;
+
+public:
+    typedef Key key_type;
+    typedef Key value_type;
+    typedef Compare key_compare;
+    typedef typename tree_type::pointer pointer;
+    typedef typename tree_type::reference reference;
+    typedef typename tree_type::const_pointer const_pointer;
+    typedef typename tree_type::const_reference const_reference;
+    typedef typename tree_type::size_type size_type;
+    typedef typename tree_type::difference_type difference_type;
+
+    // iterator and const_iterator are the same since the value can never be modified.
+    typedef typename tree_type::const_iterator          iterator;
+    typedef typename tree_type::const_iterator          const_iterator;
+    typedef typename tree_type::const_reverse_iterator  reverse_iterator;
+    typedef typename tree_type::const_reverse_iterator  const_reverse_iterator;
+
+    // constructors
+    btree_set()
+    {}
+
+    btree_set(const key_compare& comp) :
+        m_tree(comp)
+    {}
+
+    template <class InputIterator> btree_set(InputIterator first, InputIterator last)
+    {
+        m_tree.insert_unique(first, last);
+    }
+
+    template <class InputIterator> btree_set(InputIterator first, InputIterator last, const key_compare& comp) :
+        m_tree(comp)
+    {
+        m_tree.insert_unique(first, last);
+    }
+
+    btree_set(const btree_set& S) :
+        m_tree(S.m_tree)
+    {}
+
+    ~btree_set()
+    {}
+
+    btree_set& operator = (const btree_set& S)
+    {
+        m_tree = S.m_tree;
+        return *this;
+    }
+
+    // iteration
+    iterator begin() const                              { return m_tree.begin(); }
+    iterator end() const                                { return m_tree.end(); }
+
+    reverse_iterator rbegin() const                     { return m_tree.rbegin(); }
+    reverse_iterator rend() const                       { return m_tree.rend(); }
+
+    // size
+    bool empty() const                                  { return m_tree.empty(); }
+    size_type size() const                              { return m_tree.size(); }
+    size_type max_size() const                          { return m_tree.max_size(); }
+
+    const key_compare& key_comp() const                 { return m_tree.key_comp(); }
+
+    void swap(btree_set& m)                             { m_tree.swap(m.m_tree); }
+
+    // insertion
+    pair<iterator, bool> insert(const value_type& v)    { return m_tree.insert_unique(v); }
+    template <class InputIterator> void insert(InputIterator first, InputIterator last) { m_tree.insert_unique(first, last); }
+
+    // erasing
+    iterator erase(iterator pos)                        { return m_tree.erase(make_mutable(pos)); }
+    size_type erase(const key_type& k)
+    {
+        iterator i(find(k));
+        if (i != end())
+        {
+            m_tree.erase(make_mutable(i));
+            return 1;
+        }
+        return 0;
+    }
+    void erase(iterator first, iterator last)           { m_tree.erase(make_mutable(first), make_mutable(last)); }
+
+    void clear() { m_tree.clear(); }
+
+    // searching
+    iterator find(const key_type& k) const              { return m_tree.find(k); }
+
+    size_type count(const key_type& k) const            { return find(k) == end() ? 0 : 1; }
+
+    iterator lower_bound(const key_type& k) const       { return m_tree.lower_bound(k); }
+    iterator upper_bound(const key_type& k) const       { return m_tree.upper_bound(k); }
+    pair<iterator,iterator> equal_range(const key_type& k) const { return m_tree.equal_range(k); }
+};
+
+// thor::btree_multiset
+template <class Key, class Compare = less<Key> > class btree_multiset
+{
+    typedef btree<Key, Key, identity<Key>, Compare> tree_type;
+    typedef typename tree_type::iterator mutable_iterator;
+    mutable_iterator make_mutable(typename tree_type::const_iterator pos) const { return *(mutable_iterator*)&pos; }
+    tree_type m_tree;
+
+public:
+    typedef Key key_type;
+    typedef Key value_type;
+    typedef Compare key_compare;
+    typedef typename tree_type::pointer pointer;
+    typedef typename tree_type::reference reference;
+    typedef typename tree_type::const_pointer const_pointer;
+    typedef typename tree_type::const_reference const_reference;
+    typedef typename tree_type::size_type size_type;
+    typedef typename tree_type::difference_type difference_type;
+
+    // iterator and const_iterator are the same since the value can never be modified.
+    typedef typename tree_type::const_iterator          iterator;
+    typedef typename tree_type::const_iterator          const_iterator;
+    typedef typename tree_type::const_reverse_iterator  reverse_iterator;
+    typedef typename tree_type::const_reverse_iterator  const_reverse_iterator;
+
+    // constructors
+    btree_multiset()
+    {}
+
+    btree_multiset(const key_compare& comp) :
+        m_tree(comp)
+    {}
+
+    template <class InputIterator> btree_multiset(InputIterator first, InputIterator last)
+    {
+        m_tree.insert_equal(first, last);
+    }
+
+    template <class InputIterator> btree_multiset(InputIterator first, InputIterator last, const key_compare& comp) :
+        m_tree(comp)
+    {
+        m_tree.insert_equal(first, last);
+    }
+
+    btree_multiset(const btree_multiset& S) :
+        m_tree(S.m_tree)
+    {}
+
+    ~btree_multiset()
+    {}
+
+    btree_multiset& operator = (const btree_multiset& S)
+    {
+        m_tree = S.m_tree;
+        return *this;
+    }
+
+    // iteration
+    iterator begin() const                              { return m_tree.begin(); }
+    iterator end() const                                { return m_tree.end(); }
+
+    reverse_iterator rbegin() const                     { return m_tree.rbegin(); }
+    reverse_iterator rend() const                       { return m_tree.rend(); }
+
+    // size
+    bool empty() const                                  { return m_tree.empty(); }
+    size_type size() const                              { return m_tree.size(); }
+    size_type max_size() const                          { return m_tree.max_size(); }
+
+    const key_compare& key_comp() const                 { return m_tree.key_comp(); }
+
+    void swap(btree_multiset& m)                        { m_tree.swap(m.m_tree); }
+
+    // insertion
+    iterator insert(const value_type& v)                { return m_tree.insert_equal(v); }
+    template <class InputIterator> void insert(InputIterator f, InputIterator l) { m_tree.insert_equal(f, l); }
+
+    // erasing
+    iterator erase(iterator pos)                        { return m_tree.erase(make_mutable(pos)); }
+    size_type erase(const key_type& k)                  { return m_tree.erase(k); }
+    void erase(iterator first, iterator last)           { m_tree.erase(make_mutable(first), make_mutable(last)); }
+
+    void clear()                                        { m_tree.clear(); }
+
+    // searching
+    iterator find(const key_type& k) const              { return m_tree.find(k); }
+    size_type count(const key_type& k) const            { return m_tree.count(k); }
+    iterator lower_bound(const key_type& k) const       { return m_tree.lower_bound(k); }
+    iterator upper_bound(const key_type& k) const       { return m_tree.upper_bound(k); }
+    pair<iterator,iterator> equal_range(const key_type& k) const { return m_tree.equal_range(k); }
+};
+
+// Swap specializations
+template <class Key, class Compare> void swap(btree_set<Key, Compare>& lhs, btree_set<Key, Compare>& rhs)
+{
+    lhs.swap(rhs);
+}
+
+template <class Key, class Compare> void swap(btree_multiset<Key, Compare>& lhs, btree_multiset<Key, Compare>& rhs)
+{
+    lhs.swap(rhs);
+}
+
+} // namespace thor
+
+// Global operators
+template <class Key, class Compare>
+bool operator == (const thor::btree_set<Key,Compare>& lhs, const thor::btree_set<Key,Compare>& rhs)
+{
+    return lhs.size() == rhs.size() && thor::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+template <class Key, class Compare>
+bool operator != (const thor::btree_set<Key,Compare>& lhs, const thor::btree_set<Key,Compare>& rhs)
+{
+    return !(lhs == rhs);
+}
+
+template <class Key, class Compare>
+bool operator < (const thor::btree_set<Key,Compare>& lhs, const thor::btree_set<Key,Compare>& rhs)
+{
+    return thor::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+}
+
+template <class Key, class Compare>
+bool operator == (const thor::btree_multiset<Key,Compare>& lhs, const thor::btree_multiset<Key,Compare>& rhs)
+{
+    return lhs.size() == rhs.size() && thor::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+template <class Key, class Compare>
+bool operator != (const thor::btree_multiset<Key,Compare>& lhs, const thor::btree_multiset<Key,Compare>& rhs)
+{
+    return !(lhs == rhs);
+}
+
+template <class Key, class Compare>
+bool operator < (const thor::btree_multiset<Key,Compare>& lhs, const thor::btree_multiset<Key,Compare>& rhs)
+{
+    return thor::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+}
+
+#endif
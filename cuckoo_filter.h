@@ -0,0 +1,334 @@
+/* THOR - THOR Template Library
+ * Joshua M. Kriegshauser
+ *
+ * cuckoo_filter.h
+ *
+ * This file defines a cuckoo filter: a probabilistic set that can report false positives but
+ * never false negatives and, unlike a Bloom filter, supports removal.
+ *
+ * Each element is reduced to a small fingerprint stored in one of two candidate buckets of four
+ * slots (partial-key cuckoo hashing). The alternate bucket is computed from the current bucket and
+ * the fingerprint alone, so fingerprints can be relocated without the original element.
+ *
+ * Changes/Extensions:
+ * - insert() returns false when the filter is full. The filter can typically be filled to ~95% of
+ *   capacity() before this happens.
+ * - Inserting the same element more than once stores multiple copies of its fingerprint (at most
+ *   2 * bucket_size). remove() removes one copy.
+ * - remove() must only be called for elements that were inserted; otherwise it may remove the
+ *   fingerprint of a different element that happens to match, causing a false negative.
+ *
+ * cuckoo_filter
+ *   Time:
+ *     insert   - amortized constant
+ *     contains - constant (two buckets)
+ *     remove   - constant
+ *   Space:
+ *     sizeof(Fingerprint) per slot. The false positive rate is roughly 8 / 2^(bits in Fingerprint)
+ *     (~0.012% for 16 bits).
+ */
+
+#ifndef THOR_CUCKOO_FILTER_H
+#define THOR_CUCKOO_FILTER_H
+#pragma once
+
+#ifndef THOR_BASETYPES_H
+#include "basetypes.h"
+#endif
+
+#ifndef THOR_HASH_FUNCS_H
+#include "hash_funcs.h"
+#endif
+
+#ifndef THOR_VECTOR_H
+#include "vector.h"
+#endif
+
+#ifndef THOR_SWAP_H
+#include "swap.h"
+#endif
+
+namespace thor
+{
+
+template
+<
+    class T,
+    class HashFunc = hash<T>,
+    class Fingerprint = uint16
+> class cuckoo_filter
+{
+public:
+    typedef T value_type;
+    typedef HashFunc hasher;
+    typedef Fingerprint fingerprint_type;
+    typedef thor_size_type size_type;
+
+    enum
+    {
+        bucket_size = 4,
+        max_kicks = 500,
+    };
+
+    // capacity - the number of elements that are expected to be inserted
+    cuckoo_filter(size_type capacity = 0, const hasher& h = hasher()) :
+        m_hash(h),
+        m_mask(0),
+        m_size(0),
+        m_has_victim(false),
+        m_victim_index(0),
+        m_victim(0),
+        m_kick_state(0)
+    {
+        reset(capacity);
+    }
+
+    // Resizes and clears the filter
+    void reset(size_type capacity)
+    {
+        // Leave some headroom since the filter cannot be completely filled
+        const size_type needed = ((capacity + capacity / 16) + bucket_size - 1) / bucket_size;
+        size_type bc = 1;
+        while (bc < needed)
+        {
+            bc <<= 1;
+        }
+        m_buckets.clear();
+        m_buckets.resize(bc);
+        m_mask = bc - 1;
+        clear();
+    }
+
+    // Removes all elements without changing the size
+    void clear()
+    {
+        for (typename bucket_vector::iterator iter(m_buckets.begin()); iter != m_buckets.end(); ++iter)
+        {
+            for (size_type i = 0; i != bucket_size; ++i)
+            {
+                iter->slots[i] = 0;
+            }
+        }
+        m_size = 0;
+        m_has_victim = false;
+        m_victim_index = 0;
+        m_victim = 0;
+    }
+
+    bool insert(const value_type& v)
+    {
+        return insert_hash(m_hash(v));
+    }
+
+    bool contains(const value_type& v) const
+    {
+        return contains_hash(m_hash(v));
+    }
+
+    bool remove(const value_type& v)
+    {
+        return remove_hash(m_hash(v));
+    }
+
+    // Versions that take a precomputed hasher value
+    bool insert_hash(size_type hashval)
+    {
+        if (m_has_victim)
+        {
+            // Full: the last insert could not be placed
+            return false;
+        }
+
+        size_type index;
+        fingerprint_type fp;
+        split(hashval, index, fp);
+        internal_insert(index, fp);
+        ++m_size;
+        return true;
+    }
+
+    bool contains_hash(size_type hashval) const
+    {
+        size_type index;
+        fingerprint_type fp;
+        split(hashval, index, fp);
+        const size_type alt = alt_index(index, fp);
+        return m_buckets[index].contains(fp) || m_buckets[alt].contains(fp) ||
+               (m_has_victim && m_victim == fp && (m_victim_index == index || m_victim_index == alt));
+    }
+
+    bool remove_hash(size_type hashval)
+    {
+        size_type index;
+        fingerprint_type fp;
+        split(hashval, index, fp);
+        const size_type alt = alt_index(index, fp);
+        if (m_buckets[index].remove(fp) || m_buckets[alt].remove(fp))
+        {
+            --m_size;
+            if (m_has_victim)
+            {
+                // There is room again, so try to place the victim
+                m_has_victim = false;
+                internal_insert(m_victim_index, m_victim);
+            }
+            return true;
+        }
+        if (m_has_victim && m_victim == fp && (m_victim_index == index || m_victim_index == alt))
+        {
+            m_has_victim = false;
+            --m_size;
+            return true;
+        }
+        return false;
+    }
+
+    void swap(cuckoo_filter& rhs)
+    {
+        m_buckets.swap(rhs.m_buckets);
+        thor::swap(m_hash, rhs.m_hash);
+        thor::swap(m_mask, rhs.m_mask);
+        thor::swap(m_size, rhs.m_size);
+        thor::swap(m_has_victim, rhs.m_has_victim);
+        thor::swap(m_victim_index, rhs.m_victim_index);
+        thor::swap(m_victim, rhs.m_victim);
+        thor::swap(m_kick_state, rhs.m_kick_state);
+    }
+
+    size_type size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    bool full() const
+    {
+        return m_has_victim;
+    }
+
+    size_type capacity() const
+    {
+        return m_buckets.size() * bucket_size;
+    }
+
+    size_type bucket_count() const
+    {
+        return m_buckets.size();
+    }
+
+    const hasher& hash_funct() const
+    {
+        return m_hash;
+    }
+
+private:
+    struct bucket
+    {
+        fingerprint_type slots[bucket_size];
+
+        bool contains(fingerprint_type fp) const
+        {
+            return (slots[0] == fp) | (slots[1] == fp) | (slots[2] == fp) | (slots[3] == fp);
+        }
+
+        bool add(fingerprint_type fp)
+        {
+            for (size_type i = 0; i != bucket_size; ++i)
+            {
+                if (slots[i] == 0)
+                {
+                    slots[i] = fp;
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool remove(fingerprint_type fp)
+        {
+            for (size_type i = 0; i != bucket_size; ++i)
+            {
+                if (slots[i] == fp)
+                {
+                    slots[i] = 0;
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+    typedef vector<bucket> bucket_vector;
+
+    // A fingerprint of zero marks an empty slot
+    void split(size_type hashval, size_type& index, fingerprint_type& fp) const
+    {
+        index = __hashmix(hashval, 0) & m_mask;
+        fp = fingerprint_type(__hashmix(hashval, 1));
+        if (fp == 0)
+        {
+            fp = 1;
+        }
+    }
+
+    // Symmetric: alt_index(alt_index(i, fp), fp) == i
+    size_type alt_index(size_type index, fingerprint_type fp) const
+    {
+        return (index ^ __hashmix(size_type(fp), 2)) & m_mask;
+    }
+
+    // Returns false if a fingerprint had to be left in the victim slot (the filter is full)
+    bool internal_insert(size_type index, fingerprint_type fp)
+    {
+        if (m_buckets[index].add(fp))
+        {
+            return true;
+        }
+        index = alt_index(index, fp);
+        if (m_buckets[index].add(fp))
+        {
+            return true;
+        }
+
+        // Both buckets are full; evict fingerprints to their alternate buckets
+        for (size_type kick = 0; kick != max_kicks; ++kick)
+        {
+            m_kick_state = (m_kick_state * 1103515245) + 12345;
+            fingerprint_type& slot = m_buckets[index].slots[(m_kick_state >> 16) % bucket_size];
+            thor::swap(fp, slot);
+            index = alt_index(index, fp);
+            if (m_buckets[index].add(fp))
+            {
+                return true;
+            }
+        }
+
+        // Keep the last evicted fingerprint so that no element is lost; the filter is now full
+        m_has_victim = true;
+        m_victim_index = index;
+        m_victim = fp;
+        return false;
+    }
+
+    bucket_vector m_buckets;
+    hasher m_hash;
+    size_type m_mask;
+    size_type m_size;
+    bool m_has_victim;
+    size_type m_victim_index;
+    fingerprint_type m_victim;
+    size_type m_kick_state;
+};
+
+template <class T, class HashFunc, class Fingerprint> void swap(cuckoo_filter<T, HashFunc, Fingerprint>& lhs, cuckoo_filter<T, HashFunc, Fingerprint>& rhs)
+{
+    lhs.swap(rhs);
+}
+
+} // namespace thor
+
+#endif
+
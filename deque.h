@@ -6,7 +6,11 @@
  * This file defines an STL-compatible deque (double-ended queue) container.
  *
  * Extensions/Changes:
- * - Blocks of 256 items are allocated as necessary.
+ * - Elements are allocated in blocks as necessary. The size of a block is given in bytes by the
+ *   T_BLOCK_BYTES template parameter (4096 by default): each block holds the largest power of two
+ *   number of elements that fits, but at least 4. The block_count enum is the resulting number.
+ * - Up to two freed blocks are kept for reuse, so a deque used as a queue doesn't allocate as it
+ *   cycles through blocks. They are freed by the destructor (or by swapping with an empty deque).
  * - Debug builds check that all iterators are valid (i.e. no trying to erase using an iterator from a different container).
  * - push_back() has changed but remains compatible with STL usage:
  *   * push_back() returns a reference to the added item
@@ -52,7 +56,18 @@
 namespace thor
 {
 
-template <class T>
+// The largest power of two no greater than T_COUNT, but at least 4
+template <size_type T_COUNT, size_type T_POW2 = 1, bool T_DONE = (T_POW2 * 2 > T_COUNT)> struct __deque_block_count
+{
+    enum { value = __deque_block_count<T_COUNT, T_POW2 * 2>::value };
+};
+
+template <size_type T_COUNT, size_type T_POW2> struct __deque_block_count<T_COUNT, T_POW2, true>
+{
+    enum { value = T_POW2 < 4 ? 4 : T_POW2 };
+};
+
+template <class T, size_type T_BLOCK_BYTES = 4096>
 class deque
 {
     struct deque_node;
@@ -66,8 +81,8 @@ public:
     typedef thor_size_type size_type;
     typedef thor_diff_type difference_type;
 
-    // extension: the number of elements allocated at once
-    enum { block_count = 256 };
+    // extension: the number of elements allocated at once. A power of two, so that indexing is a shift.
+    enum { block_count = __deque_block_count<T_BLOCK_BYTES / sizeof(T)>::value };
 
     // iterator definitions
     struct iterator_base : public iterator_type<random_access_iterator_tag, T>
@@ -338,12 +353,16 @@ public:
     // constructors
     deque() :
         m_head(terminator(), terminator(), 0, 0),
-        m_size(0)
+        m_size(0),
+        m_spare(0),
+        m_spare_count(0)
     {}
 
     deque(size_type n) :
         m_head(terminator(), terminator(), 0, 0),
-        m_size(n)
+        m_size(n),
+        m_spare(0),
+        m_spare_count(0)
     {
         if (n != 0)
         {
@@ -365,7 +384,9 @@ public:
 
     deque(size_type n, const T& t) :
         m_head(terminator(), terminator(), 0, 0),
-        m_size(n)
+        m_size(n),
+        m_spare(0),
+        m_spare_count(0)
     {
         if (n != 0)
         {
@@ -387,7 +408,9 @@ public:
 
     deque(const deque& D) :
         m_head(terminator(), terminator(), 0, 0),
-        m_size(0)
+        m_size(0),
+        m_spare(0),
+        m_spare_count(0)
     {
         operator = (D);
     }
@@ -395,7 +418,9 @@ public:
     
     template <class InputIterator> deque(InputIterator first, InputIterator last) :
         m_head(terminator(), terminator(), 0, 0),
-        m_size(0)
+        m_size(0),
+        m_spare(0),
+        m_spare_count(0)
     {
         insert(end(), first, last);
     }
@@ -403,6 +428,12 @@ public:
     ~deque()
     {
         clear();
+        while (m_spare != 0)
+        {
+            deque_node* node = m_spare;
+            m_spare = node->next;
+            memory::align_alloc<deque_node>::free(node);
+        }
     }
 
     template <class InputIterator> void assign(InputIterator first, InputIterator last)
@@ -570,6 +601,8 @@ public:
         m_nodes.swap(D.m_nodes);
         thor::swap(m_head, D.m_head);
         thor::swap(m_size, D.m_size);
+        thor::swap(m_spare, D.m_spare);
+        thor::swap(m_spare_count, D.m_spare_count);
     }
 
     // element insertion
@@ -1432,13 +1465,31 @@ private:
     }
 
     // These functions merely alloc/free memory for the node. No construction takes place.
+    // Freed nodes are kept in a short list of spares (linked through next) for reuse.
+    enum { max_spare_count = 2 };
     deque_node* alloc_node()
     {
+        if (m_spare != 0)
+        {
+            deque_node* node = m_spare;
+            m_spare = node->next;
+            --m_spare_count;
+            return node;
+        }
         return memory::align_alloc<deque_node>::alloc();
     }
     void free_node(deque_node* node)
     {
-        memory::align_alloc<deque_node>::free(node);
+        if (m_spare_count < max_spare_count)
+        {
+            new (node) deque_node_base(m_spare);
+            m_spare = node;
+            ++m_spare_count;
+        }
+        else
+        {
+            memory::align_alloc<deque_node>::free(node);
+        }
     }
 
     // Value elements are not constructed
@@ -1524,10 +1575,12 @@ private:
     vector<deque_node*> m_nodes;
     deque_node_base     m_head;
     size_type           m_size;
+    deque_node*         m_spare;
+    size_type           m_spare_count;
 };
 
 // Swap specialization
-template <class T> void swap(deque<T>& lhs, deque<T>& rhs)
+template <class T, size_type T_BLOCK_BYTES> void swap(deque<T, T_BLOCK_BYTES>& lhs, deque<T, T_BLOCK_BYTES>& rhs)
 {
     lhs.swap(rhs);
 }
@@ -1535,15 +1588,15 @@ template <class T> void swap(deque<T>& lhs, deque<T>& rhs)
 } // namespace thor
 
 // Global operators
-template <class T> bool operator == (const thor::deque<T>& lhs, const thor::deque<T>& rhs)
+template <class T, thor::size_type T_BLOCK_BYTES> bool operator == (const thor::deque<T, T_BLOCK_BYTES>& lhs, const thor::deque<T, T_BLOCK_BYTES>& rhs)
 {
     if (lhs.size() != rhs.size())
     {
         return false;
     }
 
-    thor::deque<T>::const_iterator liter(lhs.begin()), riter(rhs.begin());
-    thor::deque<T>::const_iterator eiter(lhs.end());
+    typename thor::deque<T, T_BLOCK_BYTES>::const_iterator liter(lhs.begin()), riter(rhs.begin());
+    typename thor::deque<T, T_BLOCK_BYTES>::const_iterator eiter(lhs.end());
     while (liter != eiter)
     {
         if (!(*liter++ == *riter++))
@@ -1554,27 +1607,27 @@ template <class T> bool operator == (const thor::deque<T>& lhs, const thor::dequ
     return true;
 }
 
-template <class T> bool operator != (const thor::deque<T>& lhs, const thor::deque<T>& rhs)
+template <class T, thor::size_type T_BLOCK_BYTES> bool operator != (const thor::deque<T, T_BLOCK_BYTES>& lhs, const thor::deque<T, T_BLOCK_BYTES>& rhs)
 {
     return !(lhs == rhs);
 }
 
-template <class T> bool operator < (const thor::deque<T>& lhs, const thor::deque<T>& rhs)
+template <class T, thor::size_type T_BLOCK_BYTES> bool operator < (const thor::deque<T, T_BLOCK_BYTES>& lhs, const thor::deque<T, T_BLOCK_BYTES>& rhs)
 {
     return thor::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
 }
 
-template <class T> bool operator > (const thor::deque<T>& lhs, const thor::deque<T>& rhs)
+template <class T, thor::size_type T_BLOCK_BYTES> bool operator > (const thor::deque<T, T_BLOCK_BYTES>& lhs, const thor::deque<T, T_BLOCK_BYTES>& rhs)
 {
     return thor::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), thor::greater<T>());
 }
 
-template <class T> bool operator >= (const thor::deque<T>& lhs, const thor::deque<T>& rhs)
+template <class T, thor::size_type T_BLOCK_BYTES> bool operator >= (const thor::deque<T, T_BLOCK_BYTES>& lhs, const thor::deque<T, T_BLOCK_BYTES>& rhs)
 {
     return !(lhs < rhs);
 }
 
-template <class T> bool operator <= (const thor::deque<T>& lhs, const thor::deque<T>& rhs)
+template <class T, thor::size_type T_BLOCK_BYTES> bool operator <= (const thor::deque<T, T_BLOCK_BYTES>& lhs, const thor::deque<T, T_BLOCK_BYTES>& rhs)
 {
     return !(lhs > rhs);
 }
@@ -0,0 +1,500 @@
+/* THOR - THOR Template Library
+ * Joshua M. Kriegshauser
+ *
+ * dynamic_bitset.h
+ *
+ * This file defines a bitset whose size is chosen at runtime and may change. The bits are stored
+ * in 64-bit words, lowest index in the least significant bit, so that whole words are counted with
+ * the processor's population count and scanned for set bits with its bit scan instructions (see
+ * bitops.h). The bitwise operators between two bitsets are vectorized (see simd.h).
+ *
+ * Shifts follow the C++ Standard Library: operator << moves bit i to bit i + n.
+ *
+ * dynamic_bitset
+ *   Time:
+ *     test/set/reset/flip of one bit       - constant
+ *     count/any/all/find_next/find_prev    - linear in the number of words scanned
+ *     &=, |=, ^=, <<=, >>=                 - linear in the number of words
+ *   Space:
+ *     One bit per element, rounded up to whole 64-bit words.
+ */
+
+#ifndef THOR_DYNAMIC_BITSET_H
+#define THOR_DYNAMIC_BITSET_H
+#pragma once
+
+#ifndef THOR_BASETYPES_H
+#include "basetypes.h"
+#endif
+
+#ifndef THOR_BITOPS_H
+#include "bitops.h"
+#endif
+
+#ifndef THOR_VECTOR_H
+#include "vector.h"
+#endif
+
+#ifndef THOR_ALGORITHM_H
+#include "algorithm.h"
+#endif
+
+#ifndef THOR_SWAP_H
+#include "swap.h"
+#endif
+
+namespace thor
+{
+
+class dynamic_bitset
+{
+public:
+    typedef bool value_type;
+    typedef uint64 word_type;
+    typedef thor_size_type size_type;
+    typedef thor_diff_type difference_type;
+
+    static const size_type npos = size_type(-1);
+    static const size_type bits_per_word = sizeof(word_type) * 8;
+
+    // A proxy class that acts as a reference to a single bit
+    class reference
+    {
+        friend class dynamic_bitset;
+        word_type* m_word;
+        word_type  m_mask;
+
+        reference(word_type* w, word_type mask) : m_word(w), m_mask(mask) {}
+    public:
+        operator bool () const                      { return (*m_word & m_mask) != 0; }
+        bool operator ~ () const                    { return (*m_word & m_mask) == 0; }
+        reference& operator = (bool b)
+        {
+            if (b)
+            {
+                *m_word |= m_mask;
+            }
+            else
+            {
+                *m_word &= ~m_mask;
+            }
+            return *this;
+        }
+        reference& operator = (const reference& rhs) { return operator = (bool(rhs)); }
+        reference& flip()                           { *m_word ^= m_mask; return *this; }
+    };
+
+    explicit dynamic_bitset(size_type n = 0, bool value = false)
+        : m_words(words_for(n), value ? ~word_type(0) : word_type(0))
+        , m_size(n)
+    {
+        clear_unused();
+    }
+
+    dynamic_bitset(const dynamic_bitset& rhs)
+        : m_words(rhs.m_words)
+        , m_size(rhs.m_size)
+    {}
+
+    dynamic_bitset& operator = (const dynamic_bitset& rhs)
+    {
+        m_words = rhs.m_words;
+        m_size = rhs.m_size;
+        return *this;
+    }
+
+    size_type size() const                          { return m_size; }
+    bool empty() const                              { return m_size == 0; }
+    size_type num_words() const                     { return m_words.size(); }
+
+    // Direct access to the words. Bits beyond size() in the last word are always zero.
+    word_type* words()                              { return m_words.empty() ? 0 : &m_words[0]; }
+    const word_type* words() const                  { return m_words.empty() ? 0 : &m_words[0]; }
+
+    // New bits are set to value
+    void resize(size_type n, bool value = false)
+    {
+        if (value && n > m_size && (m_size % bits_per_word) != 0)
+        {
+            m_words.back() |= ~word_type(0) << (m_size % bits_per_word);
+        }
+        m_words.resize(words_for(n), value ? ~word_type(0) : word_type(0));
+        m_size = n;
+        clear_unused();
+    }
+
+    void clear()
+    {
+        m_words.clear();
+        m_size = 0;
+    }
+
+    void push_back(bool value)
+    {
+        if ((m_size % bits_per_word) == 0)
+        {
+            m_words.push_back(word_type(0));
+        }
+        if (value)
+        {
+            m_words.back() |= bit_mask(m_size);
+        }
+        ++m_size;
+    }
+
+    bool test(size_type n) const
+    {
+        THOR_ASSERT(n < m_size);
+        return (m_words[n / bits_per_word] & bit_mask(n)) != 0;
+    }
+
+    bool operator [] (size_type n) const            { return test(n); }
+
+    reference operator [] (size_type n)
+    {
+        THOR_ASSERT(n < m_size);
+        return reference(&m_words[n / bits_per_word], bit_mask(n));
+    }
+
+    dynamic_bitset& set()
+    {
+        fill(~word_type(0));
+        clear_unused();
+        return *this;
+    }
+
+    dynamic_bitset& set(size_type n, bool value = true)
+    {
+        THOR_ASSERT(n < m_size);
+        if (value)
+        {
+            m_words[n / bits_per_word] |= bit_mask(n);
+        }
+        else
+        {
+            m_words[n / bits_per_word] &= ~bit_mask(n);
+        }
+        return *this;
+    }
+
+    dynamic_bitset& reset()
+    {
+        fill(word_type(0));
+        return *this;
+    }
+
+    dynamic_bitset& reset(size_type n)
+    {
+        THOR_ASSERT(n < m_size);
+        m_words[n / bits_per_word] &= ~bit_mask(n);
+        return *this;
+    }
+
+    dynamic_bitset& flip()
+    {
+        for (size_type i = 0; i != m_words.size(); ++i)
+        {
+            m_words[i] = ~m_words[i];
+        }
+        clear_unused();
+        return *this;
+    }
+
+    dynamic_bitset& flip(size_type n)
+    {
+        THOR_ASSERT(n < m_size);
+        m_words[n / bits_per_word] ^= bit_mask(n);
+        return *this;
+    }
+
+    // The number of set bits
+    size_type count() const
+    {
+        size_type bits = 0;
+        const word_type* const end = words() + m_words.size();
+        for (const word_type* w = words(); w != end; ++w)
+        {
+            bits += __popcount(*w);
+        }
+        return bits;
+    }
+
+    bool any() const
+    {
+        for (size_type i = 0; i != m_words.size(); ++i)
+        {
+            if (m_words[i] != 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool none() const                               { return !any(); }
+
+    bool all() const
+    {
+        const size_type full = m_size / bits_per_word;
+        for (size_type i = 0; i != full; ++i)
+        {
+            if (m_words[i] != ~word_type(0))
+            {
+                return false;
+            }
+        }
+        return full == m_words.size() || m_words.back() == used_mask();
+    }
+
+    // The index of the lowest set bit, or npos if none is set
+    size_type find_first() const                    { return find_from(0); }
+
+    // The index of the lowest set bit after pos, or npos if there is none
+    size_type find_next(size_type pos) const
+    {
+        return (pos < m_size && ++pos < m_size) ? find_from(pos) : npos;
+    }
+
+    // The index of the highest set bit before pos, or npos if there is none. pos may be size().
+    size_type find_prev(size_type pos) const
+    {
+        THOR_ASSERT(pos <= m_size);
+        if (pos == 0)
+        {
+            return npos;
+        }
+        --pos;
+        size_type i = pos / bits_per_word;
+        const size_type bit = pos % bits_per_word;
+        word_type w = m_words[i] & (bit == bits_per_word - 1 ? ~word_type(0) : (word_type(1) << (bit + 1)) - 1);
+        for (;;)
+        {
+            if (w != 0)
+            {
+                return (i * bits_per_word) + __highest_bit(w);
+            }
+            if (i == 0)
+            {
+                return npos;
+            }
+            w = m_words[--i];
+        }
+    }
+
+    // The index of the highest set bit, or npos if none is set
+    size_type find_last() const                     { return find_prev(m_size); }
+
+    // The bitwise operators require both bitsets to be the same size
+    dynamic_bitset& operator &= (const dynamic_bitset& rhs)
+    {
+        THOR_ASSERT(m_size == rhs.m_size);
+#ifdef THOR_SIMD_SSE2
+        __simd_bitwise(words(), rhs.words(), m_words.size(), __simd_bitwise_and());
+#else
+        for (size_type i = 0; i != m_words.size(); ++i)
+        {
+            m_words[i] &= rhs.m_words[i];
+        }
+#endif
+        return *this;
+    }
+
+    dynamic_bitset& operator |= (const dynamic_bitset& rhs)
+    {
+        THOR_ASSERT(m_size == rhs.m_size);
+#ifdef THOR_SIMD_SSE2
+        __simd_bitwise(words(), rhs.words(), m_words.size(), __simd_bitwise_or());
+#else
+        for (size_type i = 0; i != m_words.size(); ++i)
+        {
+            m_words[i] |= rhs.m_words[i];
+        }
+#endif
+        return *this;
+    }
+
+    dynamic_bitset& operator ^= (const dynamic_bitset& rhs)
+    {
+        THOR_ASSERT(m_size == rhs.m_size);
+#ifdef THOR_SIMD_SSE2
+        __simd_bitwise(words(), rhs.words(), m_words.size(), __simd_bitwise_xor());
+#else
+        for (size_type i = 0; i != m_words.size(); ++i)
+        {
+            m_words[i] ^= rhs.m_words[i];
+        }
+#endif
+        return *this;
+    }
+
+    // Moves every bit n positions higher; bits moved past the end are lost
+    dynamic_bitset& operator <<= (size_type n)
+    {
+        if (n >= m_size)
+        {
+            return reset();
+        }
+        const size_type skip = n / bits_per_word;
+        const size_type shift = n % bits_per_word;
+        const size_type count = m_words.size();
+        if (shift == 0)
+        {
+            for (size_type i = count; i-- != skip; )
+            {
+                m_words[i] = m_words[i - skip];
+            }
+        }
+        else
+        {
+            for (size_type i = count - 1; i > skip; --i)
+            {
+                m_words[i] = (m_words[i - skip] << shift) | (m_words[i - skip - 1] >> (bits_per_word - shift));
+            }
+            m_words[skip] = m_words[0] << shift;
+        }
+        for (size_type i = 0; i != skip; ++i)
+        {
+            m_words[i] = word_type(0);
+        }
+        clear_unused();
+        return *this;
+    }
+
+    // Moves every bit n positions lower; bits moved below zero are lost
+    dynamic_bitset& operator >>= (size_type n)
+    {
+        if (n >= m_size)
+        {
+            return reset();
+        }
+        const size_type skip = n / bits_per_word;
+        const size_type shift = n % bits_per_word;
+        const size_type last = m_words.size() - skip - 1;
+        if (shift == 0)
+        {
+            for (size_type i = 0; i <= last; ++i)
+            {
+                m_words[i] = m_words[i + skip];
+            }
+        }
+        else
+        {
+            for (size_type i = 0; i != last; ++i)
+            {
+                m_words[i] = (m_words[i + skip] >> shift) | (m_words[i + skip + 1] << (bits_per_word - shift));
+            }
+            m_words[last] = m_words[last + skip] >> shift;
+        }
+        for (size_type i = last + 1; i != m_words.size(); ++i)
+        {
+            m_words[i] = word_type(0);
+        }
+        return *this;
+    }
+
+    dynamic_bitset operator << (size_type n) const  { dynamic_bitset b(*this); b <<= n; return b; }
+    dynamic_bitset operator >> (size_type n) const  { dynamic_bitset b(*this); b >>= n; return b; }
+    dynamic_bitset operator ~ () const              { dynamic_bitset b(*this); b.flip(); return b; }
+
+    bool operator == (const dynamic_bitset& rhs) const
+    {
+        return m_size == rhs.m_size && thor::equal(m_words.begin(), m_words.end(), rhs.m_words.begin());
+    }
+
+    void swap(dynamic_bitset& rhs)
+    {
+        m_words.swap(rhs.m_words);
+        thor::swap(m_size, rhs.m_size);
+    }
+
+private:
+    typedef vector<word_type> word_vector;
+
+    static size_type words_for(size_type n)         { return (n + (bits_per_word - 1)) / bits_per_word; }
+    static word_type bit_mask(size_type n)          { return word_type(1) << (n % bits_per_word); }
+
+    // The bits of the last word that are in use
+    word_type used_mask() const
+    {
+        const size_type used = m_size % bits_per_word;
+        return used == 0 ? ~word_type(0) : (word_type(1) << used) - 1;
+    }
+
+    void clear_unused()
+    {
+        if (!m_words.empty())
+        {
+            m_words.back() &= used_mask();
+        }
+    }
+
+    void fill(word_type w)
+    {
+        for (size_type i = 0; i != m_words.size(); ++i)
+        {
+            m_words[i] = w;
+        }
+    }
+
+    size_type find_from(size_type pos) const
+    {
+        if (pos >= m_size)
+        {
+            return npos;
+        }
+        size_type i = pos / bits_per_word;
+        word_type w = m_words[i] & (~word_type(0) << (pos % bits_per_word));
+        for (;;)
+        {
+            if (w != 0)
+            {
+                return (i * bits_per_word) + __lowest_bit(w);
+            }
+            if (++i == m_words.size())
+            {
+                return npos;
+            }
+            w = m_words[i];
+        }
+    }
+
+    word_vector m_words;
+    size_type   m_size;
+};
+
+// Swap specialization
+inline void swap(dynamic_bitset& lhs, dynamic_bitset& rhs)
+{
+    lhs.swap(rhs);
+}
+
+} // namespace thor
+
+// Global operators
+inline bool operator != (const thor::dynamic_bitset& lhs, const thor::dynamic_bitset& rhs)
+{
+    return !(lhs == rhs);
+}
+
+inline thor::dynamic_bitset operator & (const thor::dynamic_bitset& lhs, const thor::dynamic_bitset& rhs)
+{
+    thor::dynamic_bitset ret(lhs);
+    ret &= rhs;
+    return ret;
+}
+
+inline thor::dynamic_bitset operator | (const thor::dynamic_bitset& lhs, const thor::dynamic_bitset& rhs)
+{
+    thor::dynamic_bitset ret(lhs);
+    ret |= rhs;
+    return ret;
+}
+
+inline thor::dynamic_bitset operator ^ (const thor::dynamic_bitset& lhs, const thor::dynamic_bitset& rhs)
+{
+    thor::dynamic_bitset ret(lhs);
+    ret ^= rhs;
+    return ret;
+}
+
+#endif
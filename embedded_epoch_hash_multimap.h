@@ -0,0 +1,682 @@
+/* THOR - THOR Template Library
+ * Joshua M. Kriegshauser
+ *
+ * embedded_epoch_hash_multimap.h
+ *
+ * This file defines a read-mostly embedded_hash_multimap variant. Lookups are lock-free
+ * and never block writers; writers are serialized by an internal mutex and never block
+ * readers. Memory that readers may still be touching (unlinked elements, replaced bucket
+ * arrays) is reclaimed through an epoch_domain.
+ *
+ * Differences from embedded_hash_multimap:
+ *  - The link node is singly-linked per bucket. Each link carries one chain pointer for
+ *    each of two bucket array generations so that a resize can build the new chains
+ *    while readers are still walking the old ones. A resize that would reuse a chain
+ *    slot first waits for readers of the generation that last used it.
+ *  - There are no iterators. Readers use find(), count(), find_all() or for_each() and
+ *    must be inside a read-side critical section (epoch_domain::guard) of the domain that
+ *    the map was constructed with. Pointers returned by find() are only valid until the
+ *    critical section ends, unless the caller otherwise knows the element is not removed.
+ *  - remove() unlinks an element but leaves its key constructed since concurrent readers
+ *    may still compare against it. A removed element must not be freed or re-inserted until
+ *    no reader can reference it: use remove_retire(), or call epoch_domain::synchronize().
+ *  - insert() and the remove functions never wait for readers, so they may be called from
+ *    within a read-side critical section. If growing the bucket array would have to wait for
+ *    readers of an earlier generation, insert() defers it to a later insert. resize() and
+ *    delete_all() do wait for readers (without holding the writer mutex), so they must not
+ *    be called from within a read-side critical section of the calling thread.
+ *  - The epoch_domain must outlive the map.
+ */
+
+#ifndef THOR_EMBEDDED_EPOCH_HASH_MULTIMAP_H
+#define THOR_EMBEDDED_EPOCH_HASH_MULTIMAP_H
+#pragma once
+
+#ifndef THOR_EPOCH_H
+#include "epoch.h"
+#endif
+
+#ifndef THOR_MEMORY_H
+#include "memory.h"
+#endif
+
+#ifndef THOR_HASH_FUNCS_H
+#include "hash_funcs.h"
+#endif
+
+#ifndef THOR_POLICY_H
+#include "policy.h"
+#endif
+
+namespace thor
+{
+
+//
+// Prototypes
+//
+template <class Key, class T> class embedded_epoch_hash_multimap_link;
+template <class Key, class T, embedded_epoch_hash_multimap_link<Key, T> T::*LINK, class HashFunc, class PartitionPolicy> class embedded_epoch_hash_multimap;
+
+
+//
+// embedded_epoch_hash_multimap_link
+//
+template <typename Key, typename T> class embedded_epoch_hash_multimap_link
+{
+    THOR_DECLARE_NOCOPY(embedded_epoch_hash_multimap_link);
+
+    enum { alignment = memory::align_selector<Key>::alignment };
+
+public:
+    typedef Key         key_type;
+    typedef T           value_type;
+    typedef value_type* pointer;
+
+    embedded_epoch_hash_multimap_link()
+        : hashval(0)
+        , contained(false)
+        , keyvalid(false)
+    {
+        hashnext[0] = hashnext[1] = 0;
+        set_owner(0);
+        THOR_DEBUG_INIT_MEM(keybuf, sizeof(keybuf), 0);
+    }
+    ~embedded_epoch_hash_multimap_link()
+    {
+        verify_free();
+        destroy_key();
+    }
+
+    bool is_contained() const { return contained; }
+
+    // Functions to retrieve the key
+    const key_type& key() const { THOR_DEBUG_ASSERT(keyvalid); return *(const key_type*)memory::align_forward<alignment>(keybuf); }
+
+    // One chain pointer per bucket array generation
+    pointer volatile hashnext[2];
+
+    void verify_free() const
+    {
+        verify_owner(0);
+    }
+
+    void set_key(const key_type& k)
+    {
+        // The key of a previously removed element is kept until now in case a reader was still comparing it
+        destroy_key();
+        new (memory::align_forward<alignment>(keybuf)) key_type(k);
+        keyvalid = true;
+    }
+
+    void destroy_key()
+    {
+        if (keyvalid)
+        {
+            const_cast<key_type&>(key()).~key_type();
+            keyvalid = false;
+        }
+    }
+
+    thor_size_type hashval;
+    bool contained;
+    bool keyvalid;
+
+    // The key is implemented as a buffer so that it is not constructed until necessary
+    thor_byte keybuf[sizeof(key_type) + alignment];
+
+#ifdef THOR_DEBUG
+    void* owner;
+    void set_owner(void* o) { owner = o; }
+    void verify_owner(void* o) const
+    {
+        THOR_DEBUG_ASSERT(owner == o);
+        THOR_DEBUG_ASSERT(is_contained() == (owner != 0));
+    }
+#else
+    void set_owner(void*) {}
+    void verify_owner(void*) const {}
+#endif
+};
+
+template
+<
+    typename Key,
+    typename T,
+    embedded_epoch_hash_multimap_link<Key, T> T::*LINK,
+    typename HashFunc = hash<Key>,
+    class PartitionPolicy = policy::base2_partition
+> class embedded_epoch_hash_multimap
+{
+    THOR_DECLARE_NOCOPY(embedded_epoch_hash_multimap);
+    typedef PartitionPolicy partition_type;
+public:
+    typedef Key                 key_type;
+    typedef T                   value_type;
+    typedef HashFunc            hasher;
+    typedef value_type*         pointer;
+    typedef const value_type*   const_pointer;
+    typedef value_type&         reference;
+    typedef const value_type&   const_reference;
+    typedef thor_size_type      size_type;
+    typedef thor_diff_type      difference_type;
+
+    typedef embedded_epoch_hash_multimap_link<Key, T> link_type;
+
+    // constructors
+    embedded_epoch_hash_multimap(epoch_domain& domain) :
+        m_root(),
+        m_domain(domain)
+    {}
+
+    embedded_epoch_hash_multimap(epoch_domain& domain, size_type n) :
+        m_root(),
+        m_domain(domain)
+    {
+        resize(n);
+    }
+
+    embedded_epoch_hash_multimap(epoch_domain& domain, size_type n, const hasher& h) :
+        m_root(h),
+        m_domain(domain)
+    {
+        resize(n);
+    }
+
+    ~embedded_epoch_hash_multimap()
+    {
+        // Should be empty at destruction time since we don't own the elements
+        THOR_DEBUG_ASSERT(empty());
+        remove_all();
+    }
+
+    epoch_domain& domain() const
+    {
+        return m_domain;
+    }
+
+    size_type size() const
+    {
+        return m_root.m_size;
+    }
+
+    size_type max_size() const
+    {
+        return size_type(-1);
+    }
+
+    bool empty() const
+    {
+        return m_root.m_size == 0;
+    }
+
+    size_type bucket_count() const
+    {
+        const table* t = m_root.m_table;
+        return t != 0 ? t->bucket_count : 0;
+    }
+
+    const hasher& hash_funct() const
+    {
+        return static_cast<const hasher&>(m_root);
+    }
+
+    // Waits for readers of an earlier generation if necessary, so this must not be called from
+    // within a read-side critical section.
+    void resize(size_type n)
+    {
+        scope_locker<mutex> lock(m_lock);
+        while (n > bucket_count() && !internal_resize(n))
+        {
+            // Wait without blocking other writers; the map may change meanwhile, so try again
+            m_lock.unlock();
+            m_domain.synchronize();
+            m_lock.lock();
+        }
+    }
+
+    // Writer functions. These may be called concurrently with each other and with readers.
+    void insert(const key_type& k, pointer p)
+    {
+        THOR_DEBUG_ASSERT(p != 0);
+        scope_locker<mutex> lock(m_lock);
+        internal_insert(k, p);
+    }
+
+    pointer remove(pointer pos)
+    {
+        THOR_DEBUG_ASSERT(pos != 0);
+        scope_locker<mutex> lock(m_lock);
+        link(pos).verify_owner(this);
+        return internal_remove(pos);
+    }
+
+    size_type remove(const key_type& k)
+    {
+        scope_locker<mutex> lock(m_lock);
+        size_type erasecount = 0;
+        pointer node;
+        while ((node = internal_find(k)) != 0)
+        {
+            internal_remove(node);
+            ++erasecount;
+        }
+        return erasecount;
+    }
+
+    // Removes the element and deletes it once no reader can reference it
+    void remove_retire(pointer pos)
+    {
+        m_domain.retire_delete(remove(pos));
+    }
+
+    size_type remove_retire(const key_type& k)
+    {
+        scope_locker<mutex> lock(m_lock);
+        size_type erasecount = 0;
+        pointer node;
+        while ((node = internal_find(k)) != 0)
+        {
+            m_domain.retire_delete(internal_remove(node));
+            ++erasecount;
+        }
+        return erasecount;
+    }
+
+    // Unlinks all elements. As with remove(), the elements cannot be freed or re-inserted until
+    // no reader can reference them.
+    void remove_all()
+    {
+        scope_locker<mutex> lock(m_lock);
+        table* t = internal_detach();
+        if (t != 0)
+        {
+            for (size_type i = 0; i != t->bucket_count; ++i)
+            {
+                for (pointer node = t->buckets[i]; node != 0; node = link(node).hashnext[t->slot])
+                {
+                    release_link(link(node));
+                }
+            }
+            retire_table(t);
+        }
+    }
+
+    // Unlinks and deletes all elements. Blocks until no reader can reference them, so this must
+    // not be called from within a read-side critical section. Other writers are not blocked while
+    // waiting.
+    void delete_all()
+    {
+        table* t;
+        {
+            scope_locker<mutex> lock(m_lock);
+            t = internal_detach();
+
+            // The detached elements are deleted, so no later generation can share chains with them
+            m_root.m_slot_pending = false;
+        }
+        if (t != 0)
+        {
+            m_domain.synchronize();
+            for (size_type i = 0; i != t->bucket_count; ++i)
+            {
+                pointer node = t->buckets[i];
+                while (node != 0)
+                {
+                    pointer next = link(node).hashnext[t->slot];
+                    release_link(link(node));
+                    delete node;
+                    node = next;
+                }
+            }
+            free_table(t);
+        }
+    }
+
+    // Reader functions. These must be called from within a read-side critical section.
+    pointer find(const key_type& k) const
+    {
+        const table* t = m_root.m_table;
+        internal::acquire_barrier();
+        if (t != 0)
+        {
+            const size_type hashval = hash_funct()(k);
+            pointer node = t->buckets[partition_type::bucket_index(hashval, t->bucket_count)];
+            while (node != 0)
+            {
+                internal::acquire_barrier();
+                const link_type& l = link(node);
+                if (l.hashval == hashval && k == l.key())
+                {
+                    return node;
+                }
+                node = l.hashnext[t->slot];
+            }
+        }
+        return 0;
+    }
+
+    size_type count(const key_type& k) const
+    {
+        return find_all(k, count_func());
+    }
+
+    // Calls pred(pointer) for every element matching k. Returns the number of matches.
+    template <class Pred> size_type find_all(const key_type& k, Pred pred) const
+    {
+        const table* t = m_root.m_table;
+        internal::acquire_barrier();
+        size_type found = 0;
+        if (t != 0)
+        {
+            const size_type hashval = hash_funct()(k);
+            pointer node = t->buckets[partition_type::bucket_index(hashval, t->bucket_count)];
+            while (node != 0)
+            {
+                internal::acquire_barrier();
+                const link_type& l = link(node);
+                if (l.hashval == hashval && k == l.key())
+                {
+                    pred(node);
+                    ++found;
+                }
+                else if (found != 0)
+                {
+                    // Equal keys are always adjacent
+                    break;
+                }
+                node = l.hashnext[t->slot];
+            }
+        }
+        return found;
+    }
+
+    // Calls pred(pointer) for every element in the map. Elements inserted or removed during
+    // the call may or may not be visited.
+    template <class Pred> void for_each(Pred pred) const
+    {
+        const table* t = m_root.m_table;
+        internal::acquire_barrier();
+        if (t != 0)
+        {
+            for (size_type i = 0; i != t->bucket_count; ++i)
+            {
+                pointer node = t->buckets[i];
+                while (node != 0)
+                {
+                    internal::acquire_barrier();
+                    pointer next = link(node).hashnext[t->slot];
+                    pred(node);
+                    node = next;
+                }
+            }
+        }
+    }
+
+private:
+    typedef pointer volatile bucket_type;
+
+    // A bucket array generation. The chains for this generation use link_type::hashnext[slot].
+    struct table
+    {
+        bucket_type* buckets;
+        size_type bucket_count;
+        size_type slot;
+    };
+
+    struct count_func
+    {
+        void operator () (pointer) const {}
+    };
+
+    static table* alloc_table(size_type bc, size_type slot)
+    {
+        table* t = memory::align_alloc<table>::alloc(1);
+        t->buckets = memory::align_alloc<bucket_type>::alloc(bc);
+        t->bucket_count = bc;
+        t->slot = slot;
+        for (size_type i = 0; i != bc; ++i)
+        {
+            t->buckets[i] = 0;
+        }
+        return t;
+    }
+
+    static void free_table(void* p)
+    {
+        table* t = static_cast<table*>(p);
+        memory::align_alloc<bucket_type>::free(t->buckets);
+        memory::align_alloc<table>::free(t);
+    }
+
+    void retire_table(table* t)
+    {
+        m_domain.retire(t, &free_table);
+        m_root.m_retire_epoch = m_domain.current_epoch();
+        m_root.m_slot_pending = true;
+    }
+
+    // Unpublishes the current table; the caller owns it afterwards
+    table* internal_detach()
+    {
+        table* t = m_root.m_table;
+        if (t != 0)
+        {
+            m_root.m_next_slot = t->slot ^ 1;
+            internal::release_barrier();
+            m_root.m_table = 0;
+            m_root.m_size = 0;
+        }
+        return t;
+    }
+
+    void release_link(link_type& l)
+    {
+        l.contained = false;
+        l.set_owner(0);
+    }
+
+    void internal_insert(const key_type& k, pointer p)
+    {
+        link_type& l = link(p);
+        l.verify_free();
+        THOR_DEBUG_ASSERT(!l.is_contained());
+
+        if (size() + 1 > bucket_count())
+        {
+            // May be deferred if readers of an earlier generation are still active, but a first
+            // table is always created
+            internal_resize(size() + 1);
+        }
+        THOR_DEBUG_ASSERT(m_root.m_table != 0);
+
+        table* t = m_root.m_table;
+        const size_type slot = t->slot;
+        const size_type hashval = hash_funct()(k);
+
+        l.set_key(k);
+        l.hashval = hashval;
+
+        // New keys go to the front of the bucket; duplicate keys go after the last matching key
+        bucket_type* where = &t->buckets[partition_type::bucket_index(hashval, t->bucket_count)];
+        for (pointer node = *where; node != 0; node = link(node).hashnext[slot])
+        {
+            if (link(node).hashval == hashval && k == link(node).key())
+            {
+                where = &link(node).hashnext[slot];
+                while (*where != 0 && link(*where).hashval == hashval && k == link(*where).key())
+                {
+                    where = &link(*where).hashnext[slot];
+                }
+                break;
+            }
+        }
+
+        l.hashnext[slot] = *where;
+        l.contained = true;
+        l.set_owner(this);
+
+        // The node must be completely built before readers can see it
+        internal::release_barrier();
+        *where = p;
+        ++m_root.m_size;
+    }
+
+    pointer internal_remove(pointer n)
+    {
+        link_type& l = link(n);
+        table* t = m_root.m_table;
+        const size_type slot = t->slot;
+
+        bucket_type* where = &t->buckets[partition_type::bucket_index(l.hashval, t->bucket_count)];
+        while (*where != n)
+        {
+            THOR_DEBUG_ASSERT(*where != 0);
+            where = &link(*where).hashnext[slot];
+        }
+
+        // Unlinking is a single store. The removed node keeps its own chain pointer so that a
+        // reader currently positioned on it can continue.
+        *where = l.hashnext[slot];
+        release_link(l);
+        --m_root.m_size;
+        return n;
+    }
+
+    // Returns false without resizing if the chain slot for the new generation may still be in use
+    // by readers of an earlier one. Never waits for readers.
+    bool internal_resize(size_type n)
+    {
+        table* old = m_root.m_table;
+        size_type bc = old != 0 ? old->bucket_count : 0;
+        if (0 == bc)
+        {
+            // Initial size
+            bc = partition_type::initial_size;
+        }
+        bc = partition_type::resize(bc, n);
+        if (old != 0 && bc == old->bucket_count)
+        {
+            return true;
+        }
+
+        // Without a current table, the new one only holds elements inserted from now on, which no
+        // reader of an earlier generation can reach; its chains can be built right away.
+        const size_type slot = old != 0 ? (old->slot ^ 1) : m_root.m_next_slot;
+        if (old != 0 && m_root.m_slot_pending)
+        {
+            // Readers of the generation that last used this slot may still be walking its chains.
+            // Advance the epoch as far as the readers allow, but don't wait for them.
+            while (!m_domain.is_safe(m_root.m_retire_epoch) && m_domain.try_advance())
+            {
+            }
+            if (!m_domain.is_safe(m_root.m_retire_epoch))
+            {
+                return false;
+            }
+            m_root.m_slot_pending = false;
+        }
+
+        table* t = alloc_table(bc, slot);
+        if (old != 0)
+        {
+            // Prepend each node to its new bucket, then reverse each bucket. This keeps the relative
+            // order of nodes (and therefore the adjacency of equal keys) from the old chains.
+            for (size_type i = 0; i != old->bucket_count; ++i)
+            {
+                for (pointer node = old->buckets[i]; node != 0; node = link(node).hashnext[old->slot])
+                {
+                    bucket_type& b = t->buckets[partition_type::bucket_index(link(node).hashval, bc)];
+                    link(node).hashnext[slot] = b;
+                    b = node;
+                }
+            }
+            for (size_type i = 0; i != bc; ++i)
+            {
+                pointer prev = 0;
+                pointer node = t->buckets[i];
+                while (node != 0)
+                {
+                    pointer next = link(node).hashnext[slot];
+                    link(node).hashnext[slot] = prev;
+                    prev = node;
+                    node = next;
+                }
+                t->buckets[i] = prev;
+            }
+        }
+
+        // Publish the new generation
+        internal::release_barrier();
+        m_root.m_table = t;
+
+        if (old != 0)
+        {
+            retire_table(old);
+        }
+        return true;
+    }
+
+    pointer internal_find(const key_type& k) const
+    {
+        const table* t = m_root.m_table;
+        if (t != 0)
+        {
+            const size_type hashval = hash_funct()(k);
+            for (pointer node = t->buckets[partition_type::bucket_index(hashval, t->bucket_count)]; node != 0; node = link(node).hashnext[t->slot])
+            {
+                if (link(node).hashval == hashval && k == link(node).key())
+                {
+                    return node;
+                }
+            }
+        }
+        return 0;
+    }
+
+    static link_type& link(pointer p)
+    {
+        return p->*LINK;
+    }
+
+    static const link_type& link(const_pointer p)
+    {
+        return p->*LINK;
+    }
+
+    // Inherit from hasher since hasher generally has no members
+    struct empty_member_opt : public hasher
+    {
+        table* volatile m_table;
+        volatile size_type m_size;
+        size_type m_next_slot;
+        size_type m_retire_epoch;
+        bool m_slot_pending;
+
+        empty_member_opt() :
+            hasher(),
+            m_table(0),
+            m_size(0),
+            m_next_slot(0),
+            m_retire_epoch(0),
+            m_slot_pending(false)
+        {}
+
+        empty_member_opt(const hasher& h) :
+            hasher(h),
+            m_table(0),
+            m_size(0),
+            m_next_slot(0),
+            m_retire_epoch(0),
+            m_slot_pending(false)
+        {}
+    };
+
+    empty_member_opt m_root;
+    epoch_domain& m_domain;
+    mutex m_lock;
+};
+
+} // namespace thor
+
+#endif
+
@@ -359,6 +359,44 @@ public:
         return iterator(p, this);
     }
 
+    // Inserts p as close as possible before hint. If the key belongs immediately before hint, the
+    // tree descent is skipped and the insert is amortized constant time; otherwise this is the same
+    // as insert(k, p). Inserting a key not less than the largest key with a hint of end() is always
+    // constant time (amortized), which suits items that arrive mostly in increasing key order.
+    iterator insert(const_iterator hint, const key_type& k, pointer p)
+    {
+        THOR_DEBUG_ASSERT(p != 0);
+        THOR_DEBUG_ASSERT(!link(p).is_contained());
+        verify_iterator(hint);
+        internal_insert_hint(hint.node_, k, p);
+        return iterator(p, this);
+    }
+
+    // Inserts a run of values sorted by non-decreasing key. The iterators must dereference to a pair
+    // of (key, pointer). Each value is inserted with the previously inserted value as the hint, so
+    // a run that falls between existing keys (or after the largest key) is inserted in amortized
+    // constant time per value. Values with equal keys keep their order from the run.
+    template <class InputIterator> void insert_sorted(InputIterator first, InputIterator last)
+    {
+        pointer hint = terminator();
+        pointer prev = 0;
+        for (; first != last; ++first)
+        {
+            THOR_DEBUG_ASSERT(prev == 0 || !key_comp()((*first).first, link(prev).key())); // Must be sorted
+            pointer p = (*first).second;
+            THOR_DEBUG_ASSERT(p != 0);
+            THOR_DEBUG_ASSERT(!link(p).is_contained());
+            if (prev != 0)
+            {
+                iterator_base next(prev, this);
+                next.incr();
+                hint = next.node_;
+            }
+            internal_insert_hint(hint, (*first).first, p);
+            prev = p;
+        }
+    }
+
     pointer remove(iterator pos)
     {
         verify_iterator(pos);
@@ -569,14 +607,6 @@ private:
     // Does not construct the value_type
     void internal_insert(const key_type& key, pointer which)
     {
-        // Construct a copy of the key
-        link_type& l = link(which);
-        l.verify_free();
-        
-        l.color_ = link_type::red;
-        l.left_ = l.right_ = 0;
-        new (&const_cast<key_type&>(l.key())) key_type(key);
-
         pointer y = terminator();
         pointer x = m_root.parent_;
         while (x != 0)
@@ -585,9 +615,67 @@ private:
             x = key_comp()(key, link(x).key()) ? link(x).left_ : link(x).right_;
         }
 
-        if (y == terminator() ||
-            x != 0 ||     // If x != 0, the remainder succeeds to true
-            key_comp()(key, link(y).key()))
+        internal_link(key, which, y, y == terminator() || key_comp()(key, link(y).key()));
+    }
+
+    // Links which directly before pos if that is where key belongs, otherwise falls back to a
+    // full descent.
+    void internal_insert_hint(pointer pos, const key_type& key, pointer which)
+    {
+        if (pos == terminator())
+        {
+            // Appending after the largest key
+            if (m_root.size_ == 0)
+            {
+                internal_link(key, which, terminator(), true);
+                return;
+            }
+            if (!key_comp()(key, link(m_root.right_).key()))
+            {
+                internal_link(key, which, m_root.right_, false);
+                return;
+            }
+        }
+        else if (!key_comp()(link(pos).key(), key))
+        {
+            if (pos == m_root.left_)
+            {
+                internal_link(key, which, pos, true);
+                return;
+            }
+
+            iterator_base before(pos, this);
+            before.decr();
+            if (!key_comp()(key, link(before.node_).key()))
+            {
+                // Either pos has no left child or its predecessor has no right child
+                if (link(before.node_).right_ == 0)
+                {
+                    internal_link(key, which, before.node_, false);
+                }
+                else
+                {
+                    THOR_DEBUG_ASSERT(link(pos).left_ == 0);
+                    internal_link(key, which, pos, true);
+                }
+                return;
+            }
+        }
+        internal_insert(key, which);
+    }
+
+    // Links which as the left or right child of parent y and rebalances
+    void internal_link(const key_type& key, pointer which, pointer y, bool insert_left)
+    {
+        // Construct a copy of the key
+        link_type& l = link(which);
+        l.verify_free();
+        
+        l.color_ = link_type::red;
+        l.left_ = l.right_ = 0;
+        new (&const_cast<key_type&>(l.key())) key_type(key);
+
+        if (insert_left)
         {
             link(y).left_ = which;
             if (y == terminator())
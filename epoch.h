@@ -0,0 +1,341 @@
+/* THOR - THOR Template Library
+ * Joshua M. Kriegshauser
+ *
+ * epoch.h
+ *
+ * This file defines an epoch-based memory reclamation domain. Readers announce the
+ * global epoch when they enter a read-side critical section and clear it when they
+ * leave. Writers unlink objects and then retire them; a retired object is destroyed
+ * once the global epoch has advanced twice past the epoch in which it was retired,
+ * at which point no reader can still hold a reference to it.
+ *
+ * Read-side critical sections are wait-free (a store and a fence). Retiring takes a
+ * mutex and is intended for writers.
+ */
+
+#ifndef THOR_EPOCH_H
+#define THOR_EPOCH_H
+#pragma once
+
+#ifndef THOR_BASETYPES_H
+#include "basetypes.h"
+#endif
+
+#ifndef THOR_ATOMIC_INTEGER_H
+#include "atomic_integer.h"
+#endif
+
+#ifndef THOR_ATOMIC_POINTER_H
+#include "atomic_pointer.h"
+#endif
+
+#ifndef THOR_MUTEX_H
+#include "mutex.h"
+#endif
+
+#ifndef THOR_SYSTEM_H
+#include "system.h"
+#endif
+
+#ifndef THOR_VECTOR_H
+#include "vector.h"
+#endif
+
+#ifndef THOR_MEMORY_H
+#include "memory.h"
+#endif
+
+namespace thor
+{
+
+class epoch_domain
+{
+    THOR_DECLARE_NOCOPY(epoch_domain);
+
+    // One record per registered reader. Records are never freed while the domain
+    // exists; a record released by a reader is reused by the next one to register.
+    // Each record occupies its own cache line so readers don't contend.
+    struct record
+    {
+        record* next;                           // immutable once the record is published
+        volatile size_type state;               // 0 when quiescent, (epoch << 1) | 1 when active
+        atomic_integer<size_type> in_use;
+        thor_byte pad[THOR_CACHE_LINE_SIZE - sizeof(record*) - (2 * sizeof(size_type))];
+    };
+    typedef memory::align_alloc<record, THOR_CACHE_LINE_SIZE> record_alloc;
+
+    struct retired
+    {
+        void* object;
+        void (*reclaim)(void*);
+        size_type epoch;
+    };
+    typedef vector<retired> retired_list;
+
+    template <class T> static void delete_object(void* p) { delete static_cast<T*>(p); }
+
+public:
+    typedef void (*reclaim_func)(void*);
+
+    // Number of retired objects that triggers an opportunistic reclaim() from retire()
+    enum { reclaim_threshold = 64 };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // reader
+    //  Registers the calling thread with the domain. A reader is owned by a single
+    //  thread; enter() and leave() may be nested.
+    ///////////////////////////////////////////////////////////////////////////
+    class reader
+    {
+        THOR_DECLARE_NOCOPY(reader);
+    public:
+        reader(epoch_domain& domain)
+            : m_domain(domain)
+            , m_record(domain.acquire_record())
+            , m_depth(0)
+        {}
+
+        ~reader()
+        {
+            THOR_DEBUG_ASSERT(m_depth == 0);
+            m_domain.release_record(m_record);
+        }
+
+        void enter()
+        {
+            if (m_depth++ == 0)
+            {
+                m_record->state = (m_domain.current_epoch() << 1) | 1;
+
+                // The announcement must be visible before any shared pointer is loaded
+                internal::memory_barrier();
+            }
+        }
+
+        void leave()
+        {
+            THOR_DEBUG_ASSERT(m_depth != 0);
+            if (--m_depth == 0)
+            {
+                // All loads from the critical section must complete before the record is cleared
+                internal::release_barrier();
+                m_record->state = 0;
+            }
+        }
+
+        bool is_active() const
+        {
+            return m_depth != 0;
+        }
+
+        epoch_domain& domain() const
+        {
+            return m_domain;
+        }
+
+    private:
+        epoch_domain& m_domain;
+        record* m_record;
+        size_type m_depth;
+    };
+
+    ///////////////////////////////////////////////////////////////////////////
+    // guard
+    //  Scoped read-side critical section.
+    ///////////////////////////////////////////////////////////////////////////
+    class guard
+    {
+        THOR_DECLARE_NOCOPY(guard);
+        reader& m_reader;
+    public:
+        guard(reader& r) : m_reader(r) { m_reader.enter(); }
+        ~guard()                       { m_reader.leave(); }
+    };
+
+    epoch_domain()
+        : m_epoch(0)
+        , m_records(0)
+    {}
+
+    ~epoch_domain()
+    {
+        // All readers must have been destroyed by now, so everything is safe to free
+        for (retired_list::iterator iter(m_retired.begin()); iter != m_retired.end(); ++iter)
+        {
+            iter->reclaim(iter->object);
+        }
+
+        record* r = m_records.get();
+        while (r != 0)
+        {
+            THOR_DEBUG_ASSERT(r->in_use.get() == 0);
+            record* next = r->next;
+            r->~record();
+            record_alloc::free(r);
+            r = next;
+        }
+    }
+
+    size_type current_epoch() const
+    {
+        return m_epoch.get();
+    }
+
+    // Returns true if an object retired at epoch e can no longer be referenced by any reader
+    bool is_safe(size_type e) const
+    {
+        return (current_epoch() - e) >= 2;
+    }
+
+    // Advances the global epoch if every active reader has observed the current one.
+    bool try_advance()
+    {
+        const size_type e = current_epoch();
+
+        // Any record states written before this point must be visible to the scan below
+        internal::memory_barrier();
+
+        for (const record* r = m_records.get(); r != 0; r = r->next)
+        {
+            const size_type state = r->state;
+            if ((state & 1) != 0 && (state >> 1) != (e & (size_type(-1) >> 1)))
+            {
+                return false;
+            }
+        }
+
+        m_epoch.compare_exchange(e + 1, e);
+        return true;
+    }
+
+    // Queues an object to be reclaimed with fn(p) once no reader can reference it.
+    // The object must already be unreachable for readers that enter after this call.
+    void retire(void* p, reclaim_func fn)
+    {
+        THOR_DEBUG_ASSERT(fn != 0);
+        if (p == 0)
+        {
+            return;
+        }
+
+        // The store that unlinked the object must be visible before the epoch is read. Otherwise a
+        // reader could enter in a later epoch, still find the object, and have it reclaimed under it.
+        internal::memory_barrier();
+
+        retired r;
+        r.object = p;
+        r.reclaim = fn;
+        r.epoch = current_epoch();
+
+        size_type count;
+        {
+            scope_locker<mutex> lock(m_lock);
+            m_retired.push_back(r);
+            count = m_retired.size();
+        }
+
+        if (count >= reclaim_threshold)
+        {
+            reclaim();
+        }
+    }
+
+    template <class T> void retire_delete(T* p)
+    {
+        retire(p, &delete_object<T>);
+    }
+
+    // Attempts to advance the epoch and reclaims every retired object that is safe to reclaim.
+    // Returns the number of objects reclaimed.
+    size_type reclaim()
+    {
+        try_advance();
+
+        retired_list ready;
+        {
+            scope_locker<mutex> lock(m_lock);
+            retired_list::iterator out(m_retired.begin());
+            for (retired_list::iterator iter(m_retired.begin()); iter != m_retired.end(); ++iter)
+            {
+                if (is_safe(iter->epoch))
+                {
+                    ready.push_back(*iter);
+                }
+                else
+                {
+                    *out++ = *iter;
+                }
+            }
+            m_retired.erase(out, m_retired.end());
+        }
+
+        // Reclaim outside of the lock as the reclaim functions may retire more objects
+        for (retired_list::iterator iter(ready.begin()); iter != ready.end(); ++iter)
+        {
+            iter->reclaim(iter->object);
+        }
+        return ready.size();
+    }
+
+    // Blocks until every object retired before the call can no longer be referenced by a reader,
+    // then reclaims. Must not be called from within a read-side critical section of the calling
+    // thread or it will never return.
+    void synchronize()
+    {
+        const size_type e = current_epoch();
+        while (!is_safe(e))
+        {
+            if (!try_advance())
+            {
+                system::yield();
+            }
+        }
+        reclaim();
+    }
+
+    // Number of objects waiting to be reclaimed
+    size_type pending() const
+    {
+        scope_locker<mutex> lock(m_lock);
+        return m_retired.size();
+    }
+
+private:
+    record* acquire_record()
+    {
+        // Reuse a released record if possible
+        for (record* r = m_records.get(); r != 0; r = r->next)
+        {
+            if (r->in_use.get() == 0 && r->in_use.compare_exchange(1, 0) == 0)
+            {
+                return r;
+            }
+        }
+
+        record* r = new (record_alloc::alloc(1)) record;
+        r->state = 0;
+        r->in_use = 1;
+        record* head;
+        do
+        {
+            head = m_records.get();
+            r->next = head;
+        } while (m_records.compare_exchange(r, head) != head);
+        return r;
+    }
+
+    void release_record(record* r)
+    {
+        THOR_DEBUG_ASSERT(r->state == 0);
+        r->in_use = 0;
+    }
+
+    atomic_integer<size_type> m_epoch;
+    atomic_pointer<record> m_records;
+    mutable mutex m_lock;
+    retired_list m_retired;
+};
+
+} // namespace thor
+
+#endif
@@ -0,0 +1,207 @@
+/* THOR - THOR Template Library
+ * Joshua M. Kriegshauser
+ *
+ * eytzinger_array.h
+ *
+ * This file defines an immutable sorted array for fast searching, built once from a set of values.
+ *
+ * The values are stored in Eytzinger (breadth-first) order: the root of an implicit binary search
+ * tree is first, followed by its two children, then its four grandchildren, and so on. The children
+ * of the element at (1-based) position k are at 2k and 2k+1, so a search is a branchless walk down
+ * the tree. Unlike a binary search of a sorted array, the elements compared by successive steps are
+ * close together: the top levels of the tree share a few cache lines, and all 16 descendants four
+ * levels below an element are adjacent, so they are prefetched while the search is still above them.
+ *
+ * Changes/Extensions:
+ * - The array cannot be modified after it is built. There are only const iterators, which visit
+ *   elements in storage (breadth-first) order, not sorted order.
+ * - Values that compare equivalent are allowed; lower_bound() and find() return the first of them
+ *   in the order they were given to build().
+ * - lower_bound(), upper_bound() and find() return end() if there is no such element.
+ *
+ * eytzinger_array
+ *   Time:
+ *     build - O(n log n)
+ *     find, lower_bound, upper_bound - O(log n)
+ *     iteration - linear
+ *   Memory: one value per element.
+ *   Usage suggestions:
+ *     Use instead of a sorted vector and lower_bound() for large, read-only lookup tables that are
+ *     searched often. For tables that fit in the L2 cache, lower_bound() on a sorted vector is as fast.
+ */
+
+#ifndef THOR_EYTZINGER_ARRAY_H
+#define THOR_EYTZINGER_ARRAY_H
+#pragma once
+
+#ifndef THOR_BASETYPES_H
+#include "basetypes.h"
+#endif
+
+#ifndef THOR_VECTOR_H
+#include "vector.h"
+#endif
+
+#ifndef THOR_ALGORITHM_H
+#include "algorithm.h"
+#endif
+
+#ifndef THOR_FUNCTION_H
+#include "function.h"
+#endif
+
+#ifndef THOR_MEMORY_H
+#include "memory.h"
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace thor
+{
+
+template <class T, class Compare = less<T> > class eytzinger_array
+{
+    THOR_DECLARE_NOCOPY(eytzinger_array);
+public:
+    typedef T                   value_type;
+    typedef Compare             compare_type;
+    typedef const value_type*   const_pointer;
+    typedef const value_type&   const_reference;
+    typedef thor_size_type      size_type;
+    typedef thor_diff_type      difference_type;
+
+    // Elements are stored contiguously, so iterators are pointers
+    typedef const value_type*   const_iterator;
+    typedef const_iterator      iterator;
+
+    explicit eytzinger_array(const compare_type& comp = compare_type()) :
+        m_comp(comp)
+    {}
+
+    template <class InputIterator> eytzinger_array(InputIterator first, InputIterator last, const compare_type& comp = compare_type()) :
+        m_comp(comp)
+    {
+        build(first, last);
+    }
+
+    // Replaces the contents with the values in [first, last), which need not be sorted
+    template <class InputIterator> void build(InputIterator first, InputIterator last)
+    {
+        vector<value_type> sorted(first, last);
+        thor::stable_sort(sorted.begin(), sorted.end(), m_comp);
+
+        // Every element is overwritten in breadth-first order by an in-order walk of the tree
+        m_values = sorted;
+        if (!sorted.empty())
+        {
+            fill(&sorted[0], 0, 1);
+        }
+    }
+
+    void clear()                            { m_values.clear(); }
+    void swap(eytzinger_array& rhs)
+    {
+        thor::swap(m_comp, rhs.m_comp);
+        m_values.swap(rhs.m_values);
+    }
+
+    size_type size() const                  { return m_values.size(); }
+    bool empty() const                      { return m_values.empty(); }
+    compare_type comp() const               { return m_comp; }
+
+    const_iterator begin() const            { return empty() ? 0 : &m_values[0]; }
+    const_iterator end() const              { return begin() + size(); }
+
+    // The first element that is not less than t
+    const_iterator lower_bound(const value_type& t) const
+    {
+        const size_type n = size();
+        const_pointer values = begin();
+        size_type k = 1;
+        while (k <= n)
+        {
+            prefetch(values, k);
+            k = (k << 1) + (m_comp(values[k - 1], t) ? 1 : 0);
+        }
+        return result(k);
+    }
+
+    // The first element that t is less than
+    const_iterator upper_bound(const value_type& t) const
+    {
+        const size_type n = size();
+        const_pointer values = begin();
+        size_type k = 1;
+        while (k <= n)
+        {
+            prefetch(values, k);
+            k = (k << 1) + (m_comp(t, values[k - 1]) ? 0 : 1);
+        }
+        return result(k);
+    }
+
+    const_iterator find(const value_type& t) const
+    {
+        const_iterator i = lower_bound(t);
+        return (i == end() || m_comp(t, *i)) ? end() : i;
+    }
+
+private:
+    // Prefetching this far down the tree fetches a cache line of descendants four levels below
+    // (for 4-byte values) while the four comparisons above them are made.
+    enum { prefetch_stride = sizeof(value_type) < 32 ? 64 / sizeof(value_type) : 2 };
+
+    // The address is computed as an integer since it may be past the end of the array near the
+    // bottom of the tree; prefetching never faults. Compilers drop a prefetch behind a condition when
+    // they convert the search to branchless code, so there is none.
+    static void prefetch(const_pointer values, size_type k)
+    {
+        memory::prefetch((const void*)(size_type(values) + (k * prefetch_stride - 1) * sizeof(value_type)));
+    }
+
+    // Each step of a search shifts a 1 bit into k when it went right and a 0 bit when it went left.
+    // The result is the last element where the search went left: shift out the trailing 1 bits and
+    // the 0 bit below them. This is done with a bit scan, since a loop would mispredict.
+    const_iterator result(size_type k) const
+    {
+        const size_type turns = ~k;
+#ifdef _MSC_VER
+        unsigned long bit;
+#ifdef _M_X64
+        _BitScanForward64(&bit, turns);
+#else
+        _BitScanForward(&bit, turns);
+#endif
+#else
+        const unsigned long bit = (unsigned long)__builtin_ctzl(turns);
+#endif
+        k >>= bit + 1;
+        return k == 0 ? end() : begin() + (k - 1);
+    }
+
+    // Assigns sorted values to the subtree rooted at k by an in-order walk; returns the next sorted index
+    size_type fill(const_pointer sorted, size_type i, size_type k)
+    {
+        if (k <= m_values.size())
+        {
+            i = fill(sorted, i, k << 1);
+            m_values[k - 1] = sorted[i++];
+            i = fill(sorted, i, (k << 1) + 1);
+        }
+        return i;
+    }
+
+    compare_type m_comp;
+    vector<value_type> m_values;
+};
+
+template <class T, class Compare> void swap(eytzinger_array<T, Compare>& lhs, eytzinger_array<T, Compare>& rhs)
+{
+    lhs.swap(rhs);
+}
+
+} // namespace thor
+
+#endif
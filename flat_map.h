@@ -0,0 +1,331 @@
+/* THOR - THOR Template Library
+ * Joshua M. Kriegshauser
+ *
+ * flat_map.h
+ *
+ * This file defines flat_map and flat_multimap: associative containers that keep their entries
+ * sorted by key in a single contiguous vector.
+ *
+ * Changes/Extensions:
+ * - The interface matches map and multimap (see map.h) where possible.
+ * - The value_type is pair<Key, Value> rather than pair<const Key, Value> since entries are moved
+ *   by assignment. Changing the key through an iterator is not allowed.
+ * - Iteration is over contiguous memory. The iterators are vector iterators, so they are random
+ *   access.
+ * - ALL iterators and references are invalidated by any insert or erase.
+ * - insert_range() appends the entries and merges them in as a single batch. insert_deferred()
+ *   appends a single entry to an unsorted buffer; buffered entries are sorted and merged as a
+ *   batch the next time the container is read or when enough accumulate. Because a read may merge
+ *   the buffer, even const functions are not safe to call concurrently with deferred entries
+ *   pending; call flush() first.
+ *   * In the case of flat_map, a buffered entry with a key that already exists (or that was
+ *     buffered earlier) is discarded when merged.
+ *   * In the case of flat_multimap, entries with equal keys keep their insertion order.
+ * - reserve(), capacity() and reduce() manage the underlying vector.
+ * - find_batch() looks up many independent keys at once, overlapping their cache misses
+ * - The insert(pos, value_type) functions that support an insert hint are not implemented.
+ * - The value_comp() functions are not implemented.
+ *
+ * flat_map/flat_multimap - Sorted associative containers
+ *   Time:
+ *     insert          - linear (entries after the insert position are moved)
+ *     insert_range    - O(size() + n log n) for n new entries
+ *     insert_deferred - amortized O(log n) when many entries are inserted before a read
+ *     find            - logarithmic
+ *     erase           - linear
+ *     iteration       - linear, contiguous
+ *   Usage suggestions:
+ *     Prefer over map for read-heavy small to medium containers, or containers that are built
+ *     once and then searched. Memory overhead is only the unused vector capacity and lookups and
+ *     iteration are much more cache friendly than a tree.
+ */
+
+#ifndef THOR_FLAT_MAP_H
+#define THOR_FLAT_MAP_H
+#pragma once
+
+#ifndef THOR_FLAT_TREE_H
+#include "flat_tree.h"
+#endif
+
+#ifndef THOR_FUNCTION_H
+#include "function.h"
+#endif
+
+namespace thor
+{
+
+// thor::flat_map
+template <class Key, class Value, class Compare = less<Key> > class flat_map
+{
+public:
+    typedef Key key_type;
+    typedef Value data_type;
+    typedef pair<Key, Value> value_type;
+    typedef Compare key_compare;
+
+private:
+    typedef flat_tree<key_type, value_type, select1st<value_type>, Compare, true> tree_type;
+    tree_type m_tree;
+
+public:
+    typedef typename tree_type::pointer pointer;
+    typedef typename tree_type::reference reference;
+    typedef typename tree_type::const_pointer const_pointer;
+    typedef typename tree_type::const_reference const_reference;
+    typedef typename tree_type::size_type size_type;
+    typedef typename tree_type::difference_type difference_type;
+    typedef typename tree_type::iterator iterator;
+    typedef typename tree_type::const_iterator const_iterator;
+    typedef typename tree_type::reverse_iterator reverse_iterator;
+    typedef typename tree_type::const_reverse_iterator const_reverse_iterator;
+
+    // constructors
+    flat_map()
+    {}
+
+    flat_map(const key_compare& comp) :
+        m_tree(comp)
+    {}
+
+    template <class InputIterator> flat_map(InputIterator first, InputIterator last)
+    {
+        m_tree.insert(first, last);
+    }
+
+    template <class InputIterator> flat_map(InputIterator first, InputIterator last, const key_compare& comp) :
+        m_tree(comp)
+    {
+        m_tree.insert(first, last);
+    }
+
+    flat_map(const flat_map& m) :
+        m_tree(m.m_tree)
+    {}
+
+    ~flat_map()
+    {}
+
+    flat_map& operator = (const flat_map& m)
+    {
+        m_tree = m.m_tree;
+        return *this;
+    }
+
+    // members
+    iterator begin()                                { return m_tree.begin(); }
+    const_iterator begin() const                    { return m_tree.begin(); }
+    iterator end()                                  { return m_tree.end(); }
+    const_iterator end() const                      { return m_tree.end(); }
+
+    reverse_iterator rbegin()                       { return m_tree.rbegin(); }
+    const_reverse_iterator rbegin() const           { return m_tree.rbegin(); }
+    reverse_iterator rend()                         { return m_tree.rend(); }
+    const_reverse_iterator rend() const             { return m_tree.rend(); }
+
+    bool empty() const                              { return m_tree.empty(); }
+    size_type size() const                          { return m_tree.size(); }
+    size_type max_size() const                      { return m_tree.max_size(); }
+    size_type capacity() const                      { return m_tree.capacity(); }
+    void reserve(size_type n)                       { m_tree.reserve(n); }
+    void reduce()                                   { m_tree.reduce(); }
+
+    const key_compare& key_comp() const             { return m_tree.key_comp(); }
+
+    void swap(flat_map& m)                          { m_tree.swap(m.m_tree); }
+
+    pair<iterator, bool> insert(const value_type& v) { return m_tree.insert(v); }
+    template <class InputIterator> void insert_range(InputIterator first, InputIterator last) { m_tree.insert(first, last); }
+    void insert_deferred(const value_type& v)       { m_tree.insert_deferred(v); }
+    void flush() const                              { m_tree.flush(); }
+
+    iterator erase(const_iterator pos)              { return m_tree.erase(pos); }
+    size_type erase(const key_type& k)              { return m_tree.erase(k); }
+    iterator erase(const_iterator first, const_iterator last) { return m_tree.erase(first, last); }
+
+    void clear()                                    { m_tree.clear(); }
+
+    iterator find(const key_type& k)                { return m_tree.find(k); }
+    const_iterator find(const key_type& k) const    { return m_tree.find(k); }
+
+    void find_batch(const key_type* keys, size_type n, const_iterator* out) const { m_tree.find_batch(keys, n, out); }
+    void find_batch(const key_type* keys, size_type n, iterator* out)             { m_tree.find_batch(keys, n, out); }
+
+    size_type count(const key_type& k) const        { return find(k) == end() ? 0 : 1; }
+
+    iterator lower_bound(const key_type& k)         { return m_tree.lower_bound(k); }
+    const_iterator lower_bound(const key_type& k) const { return m_tree.lower_bound(k); }
+
+    iterator upper_bound(const key_type& k)         { return m_tree.upper_bound(k); }
+    const_iterator upper_bound(const key_type& k) const { return m_tree.upper_bound(k); }
+
+    pair<iterator,iterator> equal_range(const key_type& k) { return m_tree.equal_range(k); }
+    pair<const_iterator,const_iterator> equal_range(const key_type& k) const { return m_tree.equal_range(k); }
+
+    // Using this involves default-constructing the value and copying the key.
+    data_type& operator [] (const key_type& k)
+    {
+        return (*insert(value_type(k, data_type())).first).second;
+    }
+};
+
+// thor::flat_multimap
+template <class Key, class Value, class Compare = less<Key> > class flat_multimap
+{
+public:
+    typedef Key key_type;
+    typedef Value data_type;
+    typedef pair<Key, Value> value_type;
+    typedef Compare key_compare;
+
+private:
+    typedef flat_tree<key_type, value_type, select1st<value_type>, Compare, false> tree_type;
+    tree_type m_tree;
+
+public:
+    typedef typename tree_type::pointer pointer;
+    typedef typename tree_type::reference reference;
+    typedef typename tree_type::const_pointer const_pointer;
+    typedef typename tree_type::const_reference const_reference;
+    typedef typename tree_type::size_type size_type;
+    typedef typename tree_type::difference_type difference_type;
+    typedef typename tree_type::iterator iterator;
+    typedef typename tree_type::const_iterator const_iterator;
+    typedef typename tree_type::reverse_iterator reverse_iterator;
+    typedef typename tree_type::const_reverse_iterator const_reverse_iterator;
+
+    // constructors
+    flat_multimap()
+    {}
+
+    flat_multimap(const key_compare& comp) :
+        m_tree(comp)
+    {}
+
+    template <class InputIterator> flat_multimap(InputIterator first, InputIterator last)
+    {
+        m_tree.insert(first, last);
+    }
+
+    template <class InputIterator> flat_multimap(InputIterator first, InputIterator last, const key_compare& comp) :
+        m_tree(comp)
+    {
+        m_tree.insert(first, last);
+    }
+
+    flat_multimap(const flat_multimap& m) :
+        m_tree(m.m_tree)
+    {}
+
+    ~flat_multimap()
+    {}
+
+    flat_multimap& operator = (const flat_multimap& m)
+    {
+        m_tree = m.m_tree;
+        return *this;
+    }
+
+    // members
+    iterator begin()                                { return m_tree.begin(); }
+    const_iterator begin() const                    { return m_tree.begin(); }
+    iterator end()                                  { return m_tree.end(); }
+    const_iterator end() const                      { return m_tree.end(); }
+
+    reverse_iterator rbegin()                       { return m_tree.rbegin(); }
+    const_reverse_iterator rbegin() const           { return m_tree.rbegin(); }
+    reverse_iterator rend()                         { return m_tree.rend(); }
+    const_reverse_iterator rend() const             { return m_tree.rend(); }
+
+    bool empty() const                              { return m_tree.empty(); }
+    size_type size() const                          { return m_tree.size(); }
+    size_type max_size() const                      { return m_tree.max_size(); }
+    size_type capacity() const                      { return m_tree.capacity(); }
+    void reserve(size_type n)                       { m_tree.reserve(n); }
+    void reduce()                                   { m_tree.reduce(); }
+
+    const key_compare& key_comp() const             { return m_tree.key_comp(); }
+
+    void swap(flat_multimap& m)                     { m_tree.swap(m.m_tree); }
+
+    iterator insert(const value_type& v)            { return m_tree.insert(v).first; }
+    template <class InputIterator> void insert_range(InputIterator first, InputIterator last) { m_tree.insert(first, last); }
+    void insert_deferred(const value_type& v)       { m_tree.insert_deferred(v); }
+    void flush() const                              { m_tree.flush(); }
+
+    iterator erase(const_iterator pos)              { return m_tree.erase(pos); }
+    size_type erase(const key_type& k)              { return m_tree.erase(k); }
+    iterator erase(const_iterator first, const_iterator last) { return m_tree.erase(first, last); }
+
+    void clear()                                    { m_tree.clear(); }
+
+    iterator find(const key_type& k)                { return m_tree.find(k); }
+    const_iterator find(const key_type& k) const    { return m_tree.find(k); }
+
+    void find_batch(const key_type* keys, size_type n, const_iterator* out) const { m_tree.find_batch(keys, n, out); }
+    void find_batch(const key_type* keys, size_type n, iterator* out)             { m_tree.find_batch(keys, n, out); }
+
+    size_type count(const key_type& k) const        { return m_tree.count(k); }
+
+    iterator lower_bound(const key_type& k)         { return m_tree.lower_bound(k); }
+    const_iterator lower_bound(const key_type& k) const { return m_tree.lower_bound(k); }
+
+    iterator upper_bound(const key_type& k)         { return m_tree.upper_bound(k); }
+    const_iterator upper_bound(const key_type& k) const { return m_tree.upper_bound(k); }
+
+    pair<iterator,iterator> equal_range(const key_type& k) { return m_tree.equal_range(k); }
+    pair<const_iterator,const_iterator> equal_range(const key_type& k) const { return m_tree.equal_range(k); }
+};
+
+// Swap specializations
+template <class Key, class Value, class Compare> void swap(flat_map<Key, Value, Compare>& lhs, flat_map<Key, Value, Compare>& rhs)
+{
+    lhs.swap(rhs);
+}
+
+template <class Key, class Value, class Compare> void swap(flat_multimap<Key, Value, Compare>& lhs, flat_multimap<Key, Value, Compare>& rhs)
+{
+    lhs.swap(rhs);
+}
+
+} // namespace thor
+
+// Global operators
+template <class Key, class Value, class Compare>
+bool operator == (const thor::flat_map<Key,Value,Compare>& lhs, const thor::flat_map<Key,Value,Compare>& rhs)
+{
+    return lhs.size() == rhs.size() && thor::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+template <class Key, class Value, class Compare>
+bool operator != (const thor::flat_map<Key,Value,Compare>& lhs, const thor::flat_map<Key,Value,Compare>& rhs)
+{
+    return !(lhs == rhs);
+}
+
+template <class Key, class Value, class Compare>
+bool operator < (const thor::flat_map<Key,Value,Compare>& lhs, const thor::flat_map<Key,Value,Compare>& rhs)
+{
+    return thor::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+}
+
+template <class Key, class Value, class Compare>
+bool operator == (const thor::flat_multimap<Key,Value,Compare>& lhs, const thor::flat_multimap<Key,Value,Compare>& rhs)
+{
+    return lhs.size() == rhs.size() && thor::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+template <class Key, class Value, class Compare>
+bool operator != (const thor::flat_multimap<Key,Value,Compare>& lhs, const thor::flat_multimap<Key,Value,Compare>& rhs)
+{
+    return !(lhs == rhs);
+}
+
+template <class Key, class Value, class Compare>
+bool operator < (const thor::flat_multimap<Key,Value,Compare>& lhs, const thor::flat_multimap<Key,Value,Compare>& rhs)
+{
+    return thor::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+}
+
+#endif
+
@@ -0,0 +1,303 @@
+/* THOR - THOR Template Library
+ * Joshua M. Kriegshauser
+ *
+ * flat_set.h
+ *
+ * This file defines flat_set and flat_multiset: containers that keep their entries sorted in a
+ * single contiguous vector.
+ *
+ * Changes/Extensions:
+ * - The interface matches set and multiset (see set.h) where possible.
+ * - Iteration is over contiguous memory. The iterators are vector iterators, so they are random
+ *   access.
+ * - ALL iterators and references are invalidated by any insert or erase.
+ * - insert(InputIterator, InputIterator) appends the entries and merges them in as a single
+ *   batch. insert_deferred() appends a single entry to an unsorted buffer; buffered entries are
+ *   sorted and merged as a batch the next time the container is read or when enough accumulate.
+ *   Because a read may merge the buffer, even const functions are not safe to call concurrently
+ *   with deferred entries pending; call flush() first.
+ *   * In the case of flat_set, a buffered entry that already exists (or that was buffered
+ *     earlier) is discarded when merged.
+ * - reserve(), capacity() and reduce() manage the underlying vector.
+ * - find_batch() looks up many independent keys at once, overlapping their cache misses
+ * - The insert(pos, value_type) functions that support an insert hint are not implemented.
+ * - The value_comp() functions are not implemented.
+ *
+ * flat_set/flat_multiset - Sorted containers
+ *   Time:
+ *     insert          - linear (entries after the insert position are moved)
+ *     insert (range)  - O(size() + n log n) for n new entries
+ *     insert_deferred - amortized O(log n) when many entries are inserted before a read
+ *     find            - logarithmic
+ *     erase           - linear
+ *     iteration       - linear, contiguous
+ *   Usage suggestions:
+ *     Prefer over set for read-heavy small to medium containers, or containers that are built
+ *     once and then searched.
+ */
+
+#ifndef THOR_FLAT_SET_H
+#define THOR_FLAT_SET_H
+#pragma once
+
+#ifndef THOR_FLAT_TREE_H
+#include "flat_tree.h"
+#endif
+
+#ifndef THOR_FUNCTION_H
+#include "function.h"
+#endif
+
+namespace thor
+{
+
+// thor::flat_set
+template <class Key, class Compare = less<Key> > class flat_set
+{
+    typedef flat_tree<Key, Key, identity<Key>, Compare, true> tree_type;
+    tree_type m_tree;
+
+public:
+    typedef Key key_type;
+    typedef Key value_type;
+    typedef Compare key_compare;
+    typedef typename tree_type::pointer pointer;
+    typedef typename tree_type::reference reference;
+    typedef typename tree_type::const_pointer const_pointer;
+    typedef typename tree_type::const_reference const_reference;
+    typedef typename tree_type::size_type size_type;
+    typedef typename tree_type::difference_type difference_type;
+
+    // iterator and const_iterator are the same since the value can never be modified.
+    typedef typename tree_type::const_iterator          iterator;
+    typedef typename tree_type::const_iterator          const_iterator;
+    typedef typename tree_type::const_reverse_iterator  reverse_iterator;
+    typedef typename tree_type::const_reverse_iterator  const_reverse_iterator;
+
+    // constructors
+    flat_set()
+    {}
+
+    flat_set(const key_compare& comp) :
+        m_tree(comp)
+    {}
+
+    template <class InputIterator> flat_set(InputIterator first, InputIterator last)
+    {
+        m_tree.insert(first, last);
+    }
+
+    template <class InputIterator> flat_set(InputIterator first, InputIterator last, const key_compare& comp) :
+        m_tree(comp)
+    {
+        m_tree.insert(first, last);
+    }
+
+    flat_set(const flat_set& S) :
+        m_tree(S.m_tree)
+    {}
+
+    ~flat_set()
+    {}
+
+    flat_set& operator = (const flat_set& S)
+    {
+        m_tree = S.m_tree;
+        return *this;
+    }
+
+    // iteration
+    iterator begin() const                              { return static_cast<const tree_type&>(m_tree).begin(); }
+    iterator end() const                                { return static_cast<const tree_type&>(m_tree).end(); }
+
+    reverse_iterator rbegin() const                     { return static_cast<const tree_type&>(m_tree).rbegin(); }
+    reverse_iterator rend() const                       { return static_cast<const tree_type&>(m_tree).rend(); }
+
+    // size
+    bool empty() const                                  { return m_tree.empty(); }
+    size_type size() const                              { return m_tree.size(); }
+    size_type max_size() const                          { return m_tree.max_size(); }
+    size_type capacity() const                          { return m_tree.capacity(); }
+    void reserve(size_type n)                           { m_tree.reserve(n); }
+    void reduce()                                       { m_tree.reduce(); }
+
+    const key_compare& key_comp() const                 { return m_tree.key_comp(); }
+
+    void swap(flat_set& m)                              { m_tree.swap(m.m_tree); }
+
+    // insertion
+    pair<iterator, bool> insert(const value_type& v)
+    {
+        pair<typename tree_type::iterator, bool> p(m_tree.insert(v));
+        return pair<iterator, bool>(p.first, p.second);
+    }
+    template <class InputIterator> void insert(InputIterator first, InputIterator last) { m_tree.insert(first, last); }
+    void insert_deferred(const value_type& v)           { m_tree.insert_deferred(v); }
+    void flush() const                                  { m_tree.flush(); }
+
+    // erasing
+    iterator erase(iterator pos)                        { return m_tree.erase(pos); }
+    size_type erase(const key_type& k)                  { return m_tree.erase(k); }
+    iterator erase(iterator first, iterator last)       { return m_tree.erase(first, last); }
+
+    void clear()                                        { m_tree.clear(); }
+
+    // searching
+    iterator find(const key_type& k) const              { return m_tree.find(k); }
+    void find_batch(const key_type* keys, size_type n, iterator* out) const { m_tree.find_batch(keys, n, out); }
+
+    size_type count(const key_type& k) const            { return find(k) == end() ? 0 : 1; }
+
+    iterator lower_bound(const key_type& k) const       { return m_tree.lower_bound(k); }
+    iterator upper_bound(const key_type& k) const       { return m_tree.upper_bound(k); }
+    pair<iterator,iterator> equal_range(const key_type& k) const { return m_tree.equal_range(k); }
+};
+
+// thor::flat_multiset
+template <class Key, class Compare = less<Key> > class flat_multiset
+{
+    typedef flat_tree<Key, Key, identity<Key>, Compare, false> tree_type;
+    tree_type m_tree;
+
+public:
+    typedef Key key_type;
+    typedef Key value_type;
+    typedef Compare key_compare;
+    typedef typename tree_type::pointer pointer;
+    typedef typename tree_type::reference reference;
+    typedef typename tree_type::const_pointer const_pointer;
+    typedef typename tree_type::const_reference const_reference;
+    typedef typename tree_type::size_type size_type;
+    typedef typename tree_type::difference_type difference_type;
+
+    // iterator and const_iterator are the same since the value can never be modified.
+    typedef typename tree_type::const_iterator          iterator;
+    typedef typename tree_type::const_iterator          const_iterator;
+    typedef typename tree_type::const_reverse_iterator  reverse_iterator;
+    typedef typename tree_type::const_reverse_iterator  const_reverse_iterator;
+
+    // constructors
+    flat_multiset()
+    {}
+
+    flat_multiset(const key_compare& comp) :
+        m_tree(comp)
+    {}
+
+    template <class InputIterator> flat_multiset(InputIterator first, InputIterator last)
+    {
+        m_tree.insert(first, last);
+    }
+
+    template <class InputIterator> flat_multiset(InputIterator first, InputIterator last, const key_compare& comp) :
+        m_tree(comp)
+    {
+        m_tree.insert(first, last);
+    }
+
+    flat_multiset(const flat_multiset& S) :
+        m_tree(S.m_tree)
+    {}
+
+    ~flat_multiset()
+    {}
+
+    flat_multiset& operator = (const flat_multiset& S)
+    {
+        m_tree = S.m_tree;
+        return *this;
+    }
+
+    // iteration
+    iterator begin() const                              { return static_cast<const tree_type&>(m_tree).begin(); }
+    iterator end() const                                { return static_cast<const tree_type&>(m_tree).end(); }
+
+    reverse_iterator rbegin() const                     { return static_cast<const tree_type&>(m_tree).rbegin(); }
+    reverse_iterator rend() const                       { return static_cast<const tree_type&>(m_tree).rend(); }
+
+    // size
+    bool empty() const                                  { return m_tree.empty(); }
+    size_type size() const                              { return m_tree.size(); }
+    size_type max_size() const                          { return m_tree.max_size(); }
+    size_type capacity() const                          { return m_tree.capacity(); }
+    void reserve(size_type n)                           { m_tree.reserve(n); }
+    void reduce()                                       { m_tree.reduce(); }
+
+    const key_compare& key_comp() const                 { return m_tree.key_comp(); }
+
+    void swap(flat_multiset& m)                         { m_tree.swap(m.m_tree); }
+
+    // insertion
+    iterator insert(const value_type& v)                { return m_tree.insert(v).first; }
+    template <class InputIterator> void insert(InputIterator f, InputIterator l) { m_tree.insert(f, l); }
+    void insert_deferred(const value_type& v)           { m_tree.insert_deferred(v); }
+    void flush() const                                  { m_tree.flush(); }
+
+    // erasing
+    iterator erase(iterator pos)                        { return m_tree.erase(pos); }
+    size_type erase(const key_type& k)                  { return m_tree.erase(k); }
+    iterator erase(iterator first, iterator last)       { return m_tree.erase(first, last); }
+
+    void clear()                                        { m_tree.clear(); }
+
+    // searching
+    iterator find(const key_type& k) const              { return m_tree.find(k); }
+    void find_batch(const key_type* keys, size_type n, iterator* out) const { m_tree.find_batch(keys, n, out); }
+    size_type count(const key_type& k) const            { return m_tree.count(k); }
+    iterator lower_bound(const key_type& k) const       { return m_tree.lower_bound(k); }
+    iterator upper_bound(const key_type& k) const       { return m_tree.upper_bound(k); }
+    pair<iterator,iterator> equal_range(const key_type& k) const { return m_tree.equal_range(k); }
+};
+
+// Swap specializations
+template <class Key, class Compare> void swap(flat_set<Key, Compare>& lhs, flat_set<Key, Compare>& rhs)
+{
+    lhs.swap(rhs);
+}
+
+template <class Key, class Compare> void swap(flat_multiset<Key, Compare>& lhs, flat_multiset<Key, Compare>& rhs)
+{
+    lhs.swap(rhs);
+}
+
+} // namespace thor
+
+// Global operators
+template <class Key, class Compare>
+bool operator == (const thor::flat_set<Key,Compare>& lhs, const thor::flat_set<Key,Compare>& rhs)
+{
+    return lhs.size() == rhs.size() && thor::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+template <class Key, class Compare>
+bool operator != (const thor::flat_set<Key,Compare>& lhs, const thor::flat_set<Key,Compare>& rhs)
+{
+    return !(lhs == rhs);
+}
+
+template <class Key, class Compare>
+bool operator < (const thor::flat_set<Key,Compare>& lhs, const thor::flat_set<Key,Compare>& rhs)
+{
+    return thor::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+}
+
+template <class Key, class Compare>
+bool operator == (const thor::flat_multiset<Key,Compare>& lhs, const thor::flat_multiset<Key,Compare>& rhs)
+{
+    return lhs.size() == rhs.size() && thor::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+template <class Key, class Compare>
+bool operator != (const thor::flat_multiset<Key,Compare>& lhs, const thor::flat_multiset<Key,Compare>& rhs)
+{
+    return !(lhs == rhs);
+}
+
+template <class Key, class Compare>
+bool operator < (const thor::flat_multiset<Key,Compare>& lhs, const thor::flat_multiset<Key,Compare>& rhs)
+{
+    return thor::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+}
+
+#endif
+
@@ -0,0 +1,499 @@
+/* THOR - THOR Template Library
+ * Joshua M. Kriegshauser
+ *
+ * flat_tree.h
+ *
+ * ** THOR INTERNAL FILE - NOT FOR APPLICATION USE **
+ *
+ * This file defines a sorted vector to be used as a base for flat associative containers
+ * (flat_map, flat_multimap, flat_set, flat_multiset). This class is not intended to be used outside
+ * of internal THOR implementation.
+ *
+ * Values are kept sorted in a single contiguous vector. Values may also be appended unsorted to
+ * the end of the vector with insert_deferred(); these pending values are sorted and merged into
+ * the rest as a batch the next time the container is read, or when enough of them accumulate.
+ */
+
+#ifndef THOR_FLAT_TREE_H
+#define THOR_FLAT_TREE_H
+#pragma once
+
+#ifndef THOR_VECTOR_H
+#include "vector.h"
+#endif
+
+#ifndef THOR_PAIR_H
+#include "pair.h"
+#endif
+
+#ifndef THOR_ALGORITHM_H
+#include "algorithm.h"
+#endif
+
+#ifndef THOR_SORT_H
+#include "sort.h"
+#endif
+
+#ifndef THOR_SWAP_H
+#include "swap.h"
+#endif
+
+#ifndef THOR_MEMORY_H
+#include "memory.h"
+#endif
+
+namespace thor
+{
+
+template <class Key, class Value, class KeyFromValue, class Compare, bool T_UNIQUE>
+class flat_tree
+{
+    typedef vector<Value> vector_type;
+
+    // Number of keys that find_batch() has in flight at once
+    enum { find_batch_size = 16 };
+public:
+    typedef Key key_type;
+    typedef Value value_type;
+    typedef Compare key_compare;
+    typedef typename vector_type::pointer pointer;
+    typedef typename vector_type::const_pointer const_pointer;
+    typedef typename vector_type::reference reference;
+    typedef typename vector_type::const_reference const_reference;
+    typedef typename vector_type::size_type size_type;
+    typedef typename vector_type::difference_type difference_type;
+    typedef typename vector_type::iterator iterator;
+    typedef typename vector_type::const_iterator const_iterator;
+    typedef typename vector_type::reverse_iterator reverse_iterator;
+    typedef typename vector_type::const_reverse_iterator const_reverse_iterator;
+
+    enum
+    {
+        // Pending values are merged once there are more than this many, or one eighth of the
+        // sorted values, whichever is greater.
+        min_pending_merge = 64,
+    };
+
+    // constructors
+    flat_tree()
+    {}
+
+    flat_tree(const key_compare& k) :
+        m_data(k)
+    {}
+
+    flat_tree(const flat_tree& rhs) :
+        m_data(rhs.key_comp())
+    {
+        rhs.flush();
+        m_data.m_values = rhs.m_data.m_values;
+        m_data.m_sorted = rhs.m_data.m_sorted;
+    }
+
+    flat_tree& operator = (const flat_tree& rhs)
+    {
+        if (this != &rhs)
+        {
+            rhs.flush();
+            static_cast<key_compare&>(m_data) = rhs.key_comp();
+            m_data.m_values = rhs.m_data.m_values;
+            m_data.m_sorted = rhs.m_data.m_sorted;
+        }
+        return *this;
+    }
+
+    // Size
+    bool empty() const
+    {
+        return m_data.m_values.empty();
+    }
+
+    size_type size() const
+    {
+        flush();
+        return m_data.m_values.size();
+    }
+
+    size_type max_size() const
+    {
+        return m_data.m_values.max_size();
+    }
+
+    size_type capacity() const
+    {
+        return m_data.m_values.capacity();
+    }
+
+    void reserve(size_type n)
+    {
+        m_data.m_values.reserve(n);
+    }
+
+    // Frees memory that is not in use
+    void reduce()
+    {
+        flush();
+        m_data.m_values.reduce();
+    }
+
+    const key_compare& key_comp() const
+    {
+        return m_data;
+    }
+
+    // Iteration; all values are contiguous
+    iterator begin()                        { flush(); return m_data.m_values.begin(); }
+    const_iterator begin() const            { flush(); return m_data.m_values.begin(); }
+    iterator end()                          { flush(); return m_data.m_values.end(); }
+    const_iterator end() const              { flush(); return m_data.m_values.end(); }
+    reverse_iterator rbegin()               { flush(); return m_data.m_values.rbegin(); }
+    const_reverse_iterator rbegin() const   { flush(); return m_data.m_values.rbegin(); }
+    reverse_iterator rend()                 { flush(); return m_data.m_values.rend(); }
+    const_reverse_iterator rend() const     { flush(); return m_data.m_values.rend(); }
+
+    void swap(flat_tree& rhs)
+    {
+        m_data.m_values.swap(rhs.m_data.m_values);
+        thor::swap(m_data.m_sorted, rhs.m_data.m_sorted);
+        thor::swap(static_cast<key_compare&>(m_data), static_cast<key_compare&>(rhs.m_data));
+    }
+
+    void clear()
+    {
+        m_data.m_values.clear();
+        m_data.m_sorted = 0;
+    }
+
+    // Insertion. If T_UNIQUE and the key already exists, the existing iterator is returned with
+    // false.
+    pair<iterator, bool> insert(const value_type& v)
+    {
+        flush();
+        const Key& key = KeyFromValue()(v);
+        size_type pos = is_unique() ? lower_bound_index(key) : upper_bound_index(key);
+        if (is_unique() && pos != m_data.m_values.size() && !key_comp()(key, key_at(pos)))
+        {
+            return pair<iterator, bool>(m_data.m_values.begin() + pos, false);
+        }
+        iterator iter(m_data.m_values.insert(m_data.m_values.begin() + pos, v));
+        ++m_data.m_sorted;
+        return pair<iterator, bool>(iter, true);
+    }
+
+    // Appends the range and merges it in as a single batch: O(size() + n log n)
+    template <class InputIterator> void insert(InputIterator first, InputIterator last)
+    {
+        for (; first != last; ++first)
+        {
+            m_data.m_values.push_back(*first);
+        }
+        flush();
+    }
+
+    // Appends a value without sorting it. Pending values are sorted and merged as a batch before
+    // the container is next read (which may be from a const function) or when enough accumulate.
+    void insert_deferred(const value_type& v)
+    {
+        m_data.m_values.push_back(v);
+        const size_type pending = m_data.m_values.size() - m_data.m_sorted;
+        if (pending > size_type(min_pending_merge) && pending > (m_data.m_sorted >> 3))
+        {
+            flush();
+        }
+    }
+
+    // Sorts and merges any values added by insert_deferred()
+    void flush() const
+    {
+        if (m_data.m_sorted != m_data.m_values.size())
+        {
+            merge_pending();
+        }
+    }
+
+    // Erasing
+    iterator erase(const_iterator pos)
+    {
+        flush();
+        --m_data.m_sorted;
+        return m_data.m_values.erase(make_mutable(pos));
+    }
+
+    size_type erase(const key_type& k)
+    {
+        flush();
+        const size_type first = lower_bound_index(k);
+        const size_type last = upper_bound_index(k);
+        m_data.m_values.erase(m_data.m_values.begin() + first, m_data.m_values.begin() + last);
+        m_data.m_sorted -= (last - first);
+        return last - first;
+    }
+
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        flush();
+        m_data.m_sorted -= (last - first);
+        return m_data.m_values.erase(make_mutable(first), make_mutable(last));
+    }
+
+    // Searching
+    iterator find(const key_type& k)
+    {
+        flush();
+        return m_data.m_values.begin() + find_index(k);
+    }
+
+    const_iterator find(const key_type& k) const
+    {
+        flush();
+        return m_data.m_values.begin() + find_index(k);
+    }
+
+    // Looks up n keys and stores the result of find(keys[i]) in out[i]. The binary searches of a
+    // group of keys advance one step at a time in turn, and the value that each search compares
+    // against next is prefetched, so the cache misses of the searches overlap instead of being
+    // taken one after another.
+    void find_batch(const key_type* keys, size_type n, const_iterator* out) const
+    {
+        flush();
+        internal_find_batch(keys, n, out, const_iterator(m_data.m_values.begin()));
+    }
+
+    void find_batch(const key_type* keys, size_type n, iterator* out)
+    {
+        flush();
+        internal_find_batch(keys, n, out, m_data.m_values.begin());
+    }
+
+    size_type count(const key_type& k) const
+    {
+        flush();
+        return upper_bound_index(k) - lower_bound_index(k);
+    }
+
+    iterator lower_bound(const key_type& k)
+    {
+        flush();
+        return m_data.m_values.begin() + lower_bound_index(k);
+    }
+
+    const_iterator lower_bound(const key_type& k) const
+    {
+        flush();
+        return m_data.m_values.begin() + lower_bound_index(k);
+    }
+
+    iterator upper_bound(const key_type& k)
+    {
+        flush();
+        return m_data.m_values.begin() + upper_bound_index(k);
+    }
+
+    const_iterator upper_bound(const key_type& k) const
+    {
+        flush();
+        return m_data.m_values.begin() + upper_bound_index(k);
+    }
+
+    pair<iterator,iterator> equal_range(const key_type& k)
+    {
+        return pair<iterator,iterator>(lower_bound(k), upper_bound(k));
+    }
+
+    pair<const_iterator,const_iterator> equal_range(const key_type& k) const
+    {
+        return pair<const_iterator,const_iterator>(lower_bound(k), upper_bound(k));
+    }
+
+private:
+    struct value_compare
+    {
+        const key_compare& m_comp;
+        value_compare(const key_compare& comp) : m_comp(comp) {}
+        bool operator () (const value_type& lhs, const value_type& rhs) const
+        {
+            return m_comp(KeyFromValue()(lhs), KeyFromValue()(rhs));
+        }
+    };
+
+    // Values with equal keys are adjacent after sorting; keeps the first
+    struct equal_keys
+    {
+        const key_compare& m_comp;
+        equal_keys(const key_compare& comp) : m_comp(comp) {}
+        bool operator () (const value_type& lhs, const value_type& rhs) const
+        {
+            return !m_comp(KeyFromValue()(lhs), KeyFromValue()(rhs));
+        }
+    };
+
+    // Use empty member optimization since key_compare is likely going to be an empty class.
+    // The values are mutable since pending values are merged on first read.
+    struct empty_member_opt : public key_compare
+    {
+        mutable vector_type m_values;
+        mutable size_type   m_sorted;   // Values at or beyond this index are pending and unsorted
+
+        empty_member_opt() : key_compare(), m_sorted(0) {}
+        empty_member_opt(const key_compare& k) : key_compare(k), m_sorted(0) {}
+    };
+
+    empty_member_opt m_data;
+
+    static bool is_unique()
+    {
+        return T_UNIQUE;
+    }
+
+    iterator make_mutable(const_iterator pos)
+    {
+        const vector_type& values = m_data.m_values;
+        return m_data.m_values.begin() + (pos - values.begin());
+    }
+
+    const Key& key_at(size_type i) const
+    {
+        return KeyFromValue()(m_data.m_values[i]);
+    }
+
+    size_type lower_bound_index(const key_type& k) const
+    {
+        size_type first = 0;
+        size_type n = m_data.m_values.size();
+        while (n != 0)
+        {
+            const size_type half = n >> 1;
+            if (key_comp()(key_at(first + half), k))
+            {
+                first += half + 1;
+                n -= half + 1;
+            }
+            else
+            {
+                n = half;
+            }
+        }
+        return first;
+    }
+
+    size_type upper_bound_index(const key_type& k) const
+    {
+        size_type first = 0;
+        size_type n = m_data.m_values.size();
+        while (n != 0)
+        {
+            const size_type half = n >> 1;
+            if (!key_comp()(k, key_at(first + half)))
+            {
+                first += half + 1;
+                n -= half + 1;
+            }
+            else
+            {
+                n = half;
+            }
+        }
+        return first;
+    }
+
+    size_type find_index(const key_type& k) const
+    {
+        const size_type i = lower_bound_index(k);
+        return (i == m_data.m_values.size() || key_comp()(k, key_at(i))) ? m_data.m_values.size() : i;
+    }
+
+    template <class Iterator> void internal_find_batch(const key_type* keys, size_type n, Iterator* out, Iterator first) const
+    {
+        const size_type size = m_data.m_values.size();
+        size_type lower[find_batch_size];
+        size_type remain[find_batch_size];
+        while (n != 0)
+        {
+            const size_type count = n < size_type(find_batch_size) ? n : size_type(find_batch_size);
+            for (size_type i = 0; i != count; ++i)
+            {
+                lower[i] = 0;
+                remain[i] = size;
+            }
+
+            // Each pass takes one lower_bound_index() step for every search that is not done yet
+            bool searching = size != 0;
+            while (searching)
+            {
+                searching = false;
+                for (size_type i = 0; i != count; ++i)
+                {
+                    if (remain[i] == 0)
+                    {
+                        continue;
+                    }
+                    const size_type half = remain[i] >> 1;
+                    if (key_comp()(key_at(lower[i] + half), keys[i]))
+                    {
+                        lower[i] += half + 1;
+                        remain[i] -= half + 1;
+                    }
+                    else
+                    {
+                        remain[i] = half;
+                    }
+                    if (remain[i] != 0)
+                    {
+                        memory::prefetch(&m_data.m_values[lower[i] + (remain[i] >> 1)]);
+                        searching = true;
+                    }
+                }
+            }
+
+            for (size_type i = 0; i != count; ++i)
+            {
+                const bool found = lower[i] != size && !key_comp()(keys[i], key_at(lower[i]));
+                out[i] = first + (found ? lower[i] : size);
+            }
+            keys += count;
+            out += count;
+            n -= count;
+        }
+    }
+
+    // Sorts the pending values and merges them with the sorted values from the back, so that
+    // each value is moved at most once. The sort is stable and pending values follow sorted values
+    // with equal keys, so values with equal keys keep their insertion order.
+    void merge_pending() const
+    {
+        vector_type& values = m_data.m_values;
+        const size_type total = values.size();
+        vector_type pending(values.begin() + m_data.m_sorted, values.end());
+        thor::stable_sort(pending.begin(), pending.end(), value_compare(key_comp()));
+
+        size_type i = m_data.m_sorted;
+        size_type j = pending.size();
+        size_type out = total;
+        while (j != 0 && i != 0)
+        {
+            if (key_comp()(KeyFromValue()(pending[j - 1]), key_at(i - 1)))
+            {
+                values[--out] = values[--i];
+            }
+            else
+            {
+                values[--out] = pending[--j];
+            }
+        }
+        while (j != 0)
+        {
+            values[--out] = pending[--j];
+        }
+
+        if (is_unique())
+        {
+            values.erase(thor::unique(values.begin(), values.end(), equal_keys(key_comp())), values.end());
+        }
+        m_data.m_sorted = values.size();
+    }
+};
+
+} // namespace thor
+
+#endif
+
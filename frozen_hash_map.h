@@ -0,0 +1,576 @@
+/* THOR - THOR Template Library
+ * Joshua M. Kriegshauser
+ *
+ * frozen_hash_map.h
+ *
+ * This file defines an immutable hash map that is built once from a set of unique keys.
+ *
+ * The map uses minimal perfect hashing (hash and displace): keys are distributed into small
+ * buckets and each bucket stores a displacement that maps its keys onto distinct slots of a
+ * table exactly size() entries large. A lookup is therefore one probe with no chains and no
+ * empty slots: hash the key, read the bucket displacement, compute the slot and compare one key.
+ *
+ * All data lives in a single contiguous block:
+ *   header | uint32 displacement[bucket_count()] | value_type values[size()]
+ *
+ * Changes/Extensions:
+ * - The map cannot be modified after it is built. There are only const iterators, which visit
+ *   elements in slot order (not insertion order).
+ * - There is no template parameter for EqualsFunc. Therefore, an operator == MUST be defined
+ *   for types used as keys.
+ * - build() returns false if the keys are not unique (or if distinct keys have identical hash<>
+ *   values, which can never be separated).
+ * - data()/data_size() expose the block so it can be written to a file, and attach() uses such a
+ *   block in-place without copying (e.g. from a memory-mapped file). This is only valid if Key
+ *   and Data are POD types that contain no pointers and the hasher gives the same results in the
+ *   reading process.
+ * - find_batch() looks up many independent keys at once, overlapping their cache misses.
+ *
+ * frozen_hash_map
+ *   Time:
+ *     build - linear (expected)
+ *     find  - constant
+ *     iteration - linear
+ *   Usage suggestions:
+ *     Use for large, static dictionaries that are built or loaded once and then only read.
+ */
+
+#ifndef THOR_FROZEN_HASH_MAP_H
+#define THOR_FROZEN_HASH_MAP_H
+#pragma once
+
+#ifndef THOR_BASETYPES_H
+#include "basetypes.h"
+#endif
+
+#ifndef THOR_HASH_FUNCS_H
+#include "hash_funcs.h"
+#endif
+
+#ifndef THOR_PAIR_H
+#include "pair.h"
+#endif
+
+#ifndef THOR_VECTOR_H
+#include "vector.h"
+#endif
+
+#ifndef THOR_MEMORY_H
+#include "memory.h"
+#endif
+
+#ifndef THOR_TYPETRAITS_H
+#include "typetraits.h"
+#endif
+
+#ifndef THOR_ALGORITHM_H
+#include "algorithm.h"
+#endif
+
+#ifndef THOR_SWAP_H
+#include "swap.h"
+#endif
+
+namespace thor
+{
+
+template
+<
+    class Key,
+    class Data,
+    class HashFunc = hash<Key>
+> class frozen_hash_map
+{
+    THOR_DECLARE_NOCOPY(frozen_hash_map);
+public:
+    typedef Key key_type;
+    typedef Data data_type;
+    typedef pair<const key_type, data_type> value_type;
+    typedef HashFunc hasher;
+    typedef value_type* pointer;
+    typedef const value_type* const_pointer;
+    typedef value_type& reference;
+    typedef const value_type& const_reference;
+    typedef thor_size_type size_type;
+    typedef thor_diff_type difference_type;
+
+    // Elements are stored contiguously, so iterators are pointers
+    typedef const value_type* const_iterator;
+    typedef const_iterator iterator;
+
+    // Average keys per bucket. Larger values use less memory but take longer to build.
+    enum { keys_per_bucket = 4 };
+
+    frozen_hash_map() :
+        m_block(0),
+        m_owned(false),
+        m_size(0),
+        m_bucket_count(0),
+        m_seed(0),
+        m_displace(0),
+        m_values(0)
+    {}
+
+    template <class InputIterator> frozen_hash_map(InputIterator first, InputIterator last) :
+        m_block(0),
+        m_owned(false),
+        m_size(0),
+        m_bucket_count(0),
+        m_seed(0),
+        m_displace(0),
+        m_values(0)
+    {
+        build(first, last);
+    }
+
+    frozen_hash_map(const hasher& h) :
+        m_hash(h),
+        m_block(0),
+        m_owned(false),
+        m_size(0),
+        m_bucket_count(0),
+        m_seed(0),
+        m_displace(0),
+        m_values(0)
+    {}
+
+    ~frozen_hash_map()
+    {
+        clear();
+    }
+
+    // Builds the map from a range of value_type (or anything value_type can be constructed from).
+    // Any previous contents are released. Returns false and leaves the map empty if the keys are
+    // not unique.
+    template <class InputIterator> bool build(InputIterator first, InputIterator last)
+    {
+        clear();
+
+        vector<value_type> items;
+        for (; first != last; ++first)
+        {
+            items.push_back(*first);
+        }
+        return internal_build(items);
+    }
+
+    // Uses an existing block (as returned by data()) without copying it. The memory must remain
+    // valid and unchanged for as long as the map refers to it. Returns false if the block is not
+    // valid for this map type.
+    bool attach(const void* block, size_type bytes)
+    {
+        clear();
+
+        const header* h = (const header*)block;
+        if (block == 0 || bytes < sizeof(header) ||
+            h->magic != header::magic_value || h->version != header::current_version ||
+            h->value_size != sizeof(value_type) || h->value_align != THOR_ALIGN_OF(value_type) ||
+            h->bucket_count == 0 || block_size(h->size, h->bucket_count) != bytes)
+        {
+            return false;
+        }
+        if (((size_type)block + values_offset(h->bucket_count)) & (THOR_ALIGN_OF(value_type) - 1))
+        {
+            // Values would not be correctly aligned
+            return false;
+        }
+
+        m_block = (thor_byte*)block;
+        m_owned = false;
+        set_pointers(*h);
+        return true;
+    }
+
+    // Releases the contents. Attached blocks are not freed.
+    void clear()
+    {
+        if (m_owned)
+        {
+            typetraits<value_type>::range_destruct(const_cast<pointer>(m_values), const_cast<pointer>(m_values) + m_size);
+            memory::align_free_raw<block_alignment>(m_block);
+        }
+        m_block = 0;
+        m_owned = false;
+        m_size = 0;
+        m_bucket_count = 0;
+        m_seed = 0;
+        m_displace = 0;
+        m_values = 0;
+    }
+
+    void swap(frozen_hash_map& rhs)
+    {
+        thor::swap(m_hash, rhs.m_hash);
+        thor::swap(m_block, rhs.m_block);
+        thor::swap(m_owned, rhs.m_owned);
+        thor::swap(m_size, rhs.m_size);
+        thor::swap(m_bucket_count, rhs.m_bucket_count);
+        thor::swap(m_seed, rhs.m_seed);
+        thor::swap(m_displace, rhs.m_displace);
+        thor::swap(m_values, rhs.m_values);
+    }
+
+    // The contiguous block holding the map, suitable for writing to a file and attach()ing later
+    const void* data() const
+    {
+        return m_block;
+    }
+
+    size_type data_size() const
+    {
+        return m_block != 0 ? block_size(m_size, m_bucket_count) : 0;
+    }
+
+    // iteration
+    const_iterator begin() const
+    {
+        return m_values;
+    }
+
+    const_iterator end() const
+    {
+        return m_values + m_size;
+    }
+
+    size_type size() const
+    {
+        return m_size;
+    }
+
+    bool empty() const
+    {
+        return m_size == 0;
+    }
+
+    size_type bucket_count() const
+    {
+        return m_bucket_count;
+    }
+
+    const hasher& hash_funct() const
+    {
+        return m_hash;
+    }
+
+    const_iterator find(const key_type& k) const
+    {
+        if (m_size != 0)
+        {
+            const_pointer p = m_values + slot_index(m_hash(k));
+            if (p->first == k)
+            {
+                return p;
+            }
+        }
+        return end();
+    }
+
+    // Looks up n independent keys, storing the result for keys[i] in out[i] (end() if not found).
+    // Every key in a group is hashed and its displacement and slot are prefetched before any key
+    // is compared, so the cache misses of the lookups overlap.
+    void find_batch(const key_type* keys, size_type n, const_iterator* out) const
+    {
+        size_type hashvals[find_batch_size];
+        size_type slots[find_batch_size];
+        while (n != 0)
+        {
+            const size_type count = n < size_type(find_batch_size) ? n : size_type(find_batch_size);
+            if (m_size == 0)
+            {
+                for (size_type i = 0; i != count; ++i)
+                {
+                    out[i] = end();
+                }
+            }
+            else
+            {
+                for (size_type i = 0; i != count; ++i)
+                {
+                    hashvals[i] = m_hash(keys[i]);
+                    memory::prefetch(m_displace + bucket_index(hashvals[i]));
+                }
+                for (size_type i = 0; i != count; ++i)
+                {
+                    slots[i] = slot_index(hashvals[i]);
+                    memory::prefetch(m_values + slots[i]);
+                }
+                for (size_type i = 0; i != count; ++i)
+                {
+                    const_pointer p = m_values + slots[i];
+                    out[i] = p->first == keys[i] ? p : end();
+                }
+            }
+            keys += count;
+            out += count;
+            n -= count;
+        }
+    }
+
+    size_type count(const key_type& k) const
+    {
+        return find(k) != end() ? 1 : 0;
+    }
+
+    // Returns a pointer to the data for k or 0 if k is not in the map
+    const data_type* lookup(const key_type& k) const
+    {
+        const_iterator i(find(k));
+        return i != end() ? &i->second : 0;
+    }
+
+private:
+    enum
+    {
+        find_batch_size = 16,
+        direct_flag = 0x80000000,   // displacement holds the slot itself (single-key buckets)
+        max_size = 0x7fffffff,
+        max_displace_tries = 0x100000,
+        max_seed_tries = 32,
+    };
+
+    enum { block_alignment = memory::align_selector<value_type>::alignment };
+
+    struct header
+    {
+        enum { magic_value = 0x4e5a5246 /* 'FRZN' */, current_version = 1 };
+        uint32 magic;
+        uint32 version;
+        uint32 size;
+        uint32 bucket_count;
+        uint32 seed;
+        uint32 value_size;
+        uint32 value_align;
+        uint32 reserved;
+    };
+
+    static size_type values_offset(size_type bucket_count)
+    {
+        const size_type align = THOR_ALIGN_OF(value_type);
+        const size_type off = sizeof(header) + (bucket_count * sizeof(uint32));
+        return (off + (align - 1)) & ~(align - 1);
+    }
+
+    static size_type block_size(size_type size, size_type bucket_count)
+    {
+        return values_offset(bucket_count) + (size * sizeof(value_type));
+    }
+
+    size_type bucket_index(size_type hashval) const
+    {
+        return __hashmix(hashval, m_seed) % m_bucket_count;
+    }
+
+    size_type slot_index(size_type hashval) const
+    {
+        const uint32 d = m_displace[bucket_index(hashval)];
+        return (d & direct_flag) ? (d & ~direct_flag) : (__hashmix(hashval, d) % m_size);
+    }
+
+    void set_pointers(const header& h)
+    {
+        m_size = h.size;
+        m_bucket_count = h.bucket_count;
+        m_seed = h.seed;
+        m_displace = (const uint32*)(m_block + sizeof(header));
+        m_values = (const_pointer)(m_block + values_offset(h.bucket_count));
+    }
+
+    bool internal_build(const vector<value_type>& items)
+    {
+        const size_type n = items.size();
+        THOR_DEBUG_ASSERT(n <= max_size);
+        if (n > max_size)
+        {
+            return false;
+        }
+        const size_type bc = n == 0 ? 1 : ((n + keys_per_bucket - 1) / keys_per_bucket);
+
+        vector<size_type> hashes(n);
+        for (size_type i = 0; i != n; ++i)
+        {
+            hashes[i] = m_hash(items[i].first);
+        }
+
+        vector<uint32> displace(bc);
+        vector<uint32> slots(n);            // item index -> slot
+        vector<size_type> order(n);         // item indices grouped by bucket
+        vector<size_type> bucket_start(bc + 1);
+        vector<size_type> by_size;          // bucket indices, largest bucket first
+        vector<bool> taken(n);
+        vector<size_type> attempt;
+
+        bool placed = false;
+        for (uint32 seed = 0; seed != max_seed_tries && !placed; ++seed)
+        {
+            m_seed = seed;
+            m_bucket_count = bc;
+
+            // Group item indices by bucket (counting sort)
+            for (size_type b = 0; b <= bc; ++b)
+            {
+                bucket_start[b] = 0;
+            }
+            size_type largest = 0;
+            for (size_type i = 0; i != n; ++i)
+            {
+                size_type& c = bucket_start[bucket_index(hashes[i]) + 1];
+                largest = _max(largest, ++c);
+            }
+            for (size_type b = 0; b != bc; ++b)
+            {
+                bucket_start[b + 1] += bucket_start[b];
+            }
+            {
+                vector<size_type> fill(bc);
+                for (size_type b = 0; b != bc; ++b)
+                {
+                    fill[b] = bucket_start[b];
+                }
+                for (size_type i = 0; i != n; ++i)
+                {
+                    order[fill[bucket_index(hashes[i])]++] = i;
+                }
+            }
+
+            // Order buckets by decreasing size (counting sort) so the hardest buckets are placed first
+            by_size.clear();
+            for (size_type s = largest; s != 0; --s)
+            {
+                for (size_type b = 0; b != bc; ++b)
+                {
+                    if (bucket_start[b + 1] - bucket_start[b] == s)
+                    {
+                        by_size.push_back(b);
+                    }
+                }
+            }
+
+            for (size_type i = 0; i != n; ++i)
+            {
+                taken[i] = false;
+            }
+            for (size_type b = 0; b != bc; ++b)
+            {
+                displace[b] = 0;
+            }
+
+            placed = true;
+            size_type free_slot = 0;
+            for (size_type j = 0; j != by_size.size() && placed; ++j)
+            {
+                const size_type b = by_size[j];
+                const size_type first = bucket_start[b], last = bucket_start[b + 1];
+                if (last - first == 1)
+                {
+                    // Single keys go directly into the next free slot
+                    while (taken[free_slot])
+                    {
+                        ++free_slot;
+                    }
+                    taken[free_slot] = true;
+                    slots[order[first]] = uint32(free_slot);
+                    displace[b] = uint32(free_slot) | direct_flag;
+                    continue;
+                }
+
+                // Keys that can never be separated
+                for (size_type x = first; x != last; ++x)
+                {
+                    for (size_type y = x + 1; y != last; ++y)
+                    {
+                        if (hashes[order[x]] == hashes[order[y]])
+                        {
+                            // Either a duplicate key or a full hash collision
+                            clear();
+                            return false;
+                        }
+                    }
+                }
+
+                placed = false;
+                for (uint32 d = 1; d != max_displace_tries && !placed; ++d)
+                {
+                    attempt.clear();
+                    placed = true;
+                    for (size_type x = first; x != last && placed; ++x)
+                    {
+                        const size_type slot = __hashmix(hashes[order[x]], d) % n;
+                        placed = !taken[slot] && find_index(attempt, slot) == attempt.size();
+                        attempt.push_back(slot);
+                    }
+                    if (placed)
+                    {
+                        for (size_type x = first; x != last; ++x)
+                        {
+                            taken[attempt[x - first]] = true;
+                            slots[order[x]] = uint32(attempt[x - first]);
+                        }
+                        displace[b] = d;
+                    }
+                }
+            }
+        }
+
+        if (!placed)
+        {
+            clear();
+            return false;
+        }
+
+        // Build the block
+        m_block = memory::align_alloc_raw<block_alignment>(block_size(n, bc));
+        m_owned = true;
+
+        header& h = *(header*)m_block;
+        h.magic = header::magic_value;
+        h.version = header::current_version;
+        h.size = uint32(n);
+        h.bucket_count = uint32(bc);
+        h.seed = uint32(m_seed);
+        h.value_size = sizeof(value_type);
+        h.value_align = THOR_ALIGN_OF(value_type);
+        h.reserved = 0;
+        set_pointers(h);
+
+        uint32* d = const_cast<uint32*>(m_displace);
+        for (size_type b = 0; b != bc; ++b)
+        {
+            d[b] = displace[b];
+        }
+        pointer values = const_cast<pointer>(m_values);
+        for (size_type i = 0; i != n; ++i)
+        {
+            typetraits<value_type>::construct(values + slots[i], items[i]);
+        }
+        return true;
+    }
+
+    static size_type find_index(const vector<size_type>& v, size_type val)
+    {
+        size_type i = 0;
+        while (i != v.size() && v[i] != val)
+        {
+            ++i;
+        }
+        return i;
+    }
+
+    hasher m_hash;
+    thor_byte* m_block;
+    bool m_owned;
+    size_type m_size;
+    size_type m_bucket_count;
+    size_type m_seed;
+    const uint32* m_displace;
+    const_pointer m_values;
+};
+
+template <class Key, class Data, class HashFunc> void swap(frozen_hash_map<Key, Data, HashFunc>& lhs, frozen_hash_map<Key, Data, HashFunc>& rhs)
+{
+    lhs.swap(rhs);
+}
+
+} // namespace thor
+
+#endif
+
@@ -114,6 +114,14 @@ template <class T> struct equal_to
     }
 };
 
+template <class T> struct plus
+{
+    T operator () (const T& lhs, const T& rhs) const
+    {
+        return lhs + rhs;
+    }
+};
+
 }; // namespace thor
 
 #endif
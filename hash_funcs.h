@@ -211,6 +211,33 @@ template <> struct hash<long double>
     }
 };
 
+// Scrambles a hash value with a seed. Used to derive several independent hashes from a single
+// hash<> result, which may be as weak as the identity function for integers.
+// (MurmurHash3 finalizer)
+inline size_type __hashmix(size_type h, size_type seed = 0)
+{
+    if (THOR_SUPPRESS_WARNING(sizeof(size_type) == 4))
+    {
+        uint32 k = uint32(h) ^ (uint32(seed) * 0x9e3779b9);
+        k ^= k >> 16;
+        k *= 0x85ebca6b;
+        k ^= k >> 13;
+        k *= 0xc2b2ae35;
+        k ^= k >> 16;
+        return size_type(k);
+    }
+    else
+    {
+        uint64 k = uint64(h) ^ (uint64(seed) * 0x9e3779b97f4a7c15ULL);
+        k ^= k >> 33;
+        k *= 0xff51afd7ed558ccdULL;
+        k ^= k >> 33;
+        k *= 0xc4ceb9fe1a85ec53ULL;
+        k ^= k >> 33;
+        return size_type(k);
+    }
+}
+
 }; // namespace thor
 
 #endif
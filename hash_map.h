@@ -31,7 +31,14 @@
  * - Raw pointer support:
  *   * delete_all() will delete the Value only (not the Key) for all items in the container, followed by a clear().
  * - equal_range() supports an optional count parameter
+ * - find_batch() looks up many independent keys at once, overlapping their cache misses
  * - A PartitionPolicy can be used to control the bucketizing scheme (base2, prime, etc)
+ * - The template allows a preallocated number of entries. These entries and an initial bucket array
+ *   large enough to hold them are included as part of the class and are not allocated from the heap.
+ *   * Example: hash_map<int, int, hash<int>, policy::base2_partition, 8> reserves space for 8 entries.
+ *   * Growth above the preallocated amount will continue using the preallocated
+ *     amount augmented with heap memory.
+ *   * swap() between preallocated containers is O(n) and converts preallocated storage to heap storage.
  *
  * hash_map/hash_multimap - Non-ordered associative containers
  *   Time:
@@ -93,7 +100,8 @@ template
     class Key,
     class Data,
     class HashFunc = hash<Key>,
-    class PartitionPolicy = policy::base2_partition
+    class PartitionPolicy = policy::base2_partition,
+    thor_size_type T_PREALLOC = 0
 > class hash_map
 {
 public:
@@ -103,7 +111,7 @@ public:
     typedef HashFunc hasher;
 
 private:
-    typedef hashtable<key_type, value_type, hasher, select1st<value_type>, PartitionPolicy> hashtable_type;
+    typedef hashtable<key_type, value_type, hasher, select1st<value_type>, PartitionPolicy, T_PREALLOC> hashtable_type;
     hashtable_type m_hashtable;
 
 public:
@@ -239,6 +247,8 @@ public:
     // search
     const_iterator find(const key_type& k) const        { return m_hashtable.find(k); }
     iterator find(const key_type& k)                    { return m_hashtable.find(k); }
+    void find_batch(const key_type* keys, size_type n, const_iterator* out) const { m_hashtable.find_batch(keys, n, out); }
+    void find_batch(const key_type* keys, size_type n, iterator* out)             { m_hashtable.find_batch(keys, n, out); }
     size_type count(const key_type& k) const            { return find(k) == end() ? 0 : 1; }
 
     pair<const_iterator, const_iterator> equal_range(const key_type& k) const { return m_hashtable.equal_range(k); }
@@ -253,7 +263,8 @@ template
     class Key,
     class Data,
     class HashFunc = hash<Key>,
-    class PartitionPolicy = policy::base2_partition
+    class PartitionPolicy = policy::base2_partition,
+    thor_size_type T_PREALLOC = 0
 > class hash_multimap
 {
 public:
@@ -263,7 +274,7 @@ public:
     typedef HashFunc hasher;
 
 private:
-    typedef hashtable<key_type, value_type, hasher, select1st<value_type>, PartitionPolicy> hashtable_type;
+    typedef hashtable<key_type, value_type, hasher, select1st<value_type>, PartitionPolicy, T_PREALLOC> hashtable_type;
     hashtable_type m_hashtable;
 
 public:
@@ -399,6 +410,8 @@ public:
     // searching
     const_iterator find(const key_type& k) const            { return m_hashtable.find(k); }
     iterator find(const key_type& k)                        { return m_hashtable.find(k); }
+    void find_batch(const key_type* keys, size_type n, const_iterator* out) const { m_hashtable.find_batch(keys, n, out); }
+    void find_batch(const key_type* keys, size_type n, iterator* out)             { m_hashtable.find_batch(keys, n, out); }
     size_type count(const key_type& k) const                { return m_hashtable.count(k); }
 
     pair<const_iterator, const_iterator> equal_range(const key_type& k, size_type* count = 0) const { return m_hashtable.equal_range(k, count); }
@@ -406,12 +419,12 @@ public:
 };
 
 // Swap specializations
-template <class Key, class Data, class HashFunc> void swap(hash_map<Key, Data, HashFunc>& lhs, hash_map<Key, Data, HashFunc>& rhs)
+template <class Key, class Data, class HashFunc, class PartitionPolicy, thor_size_type T_PREALLOC> void swap(hash_map<Key, Data, HashFunc, PartitionPolicy, T_PREALLOC>& lhs, hash_map<Key, Data, HashFunc, PartitionPolicy, T_PREALLOC>& rhs)
 {
     lhs.swap(rhs);
 }
 
-template <class Key, class Data, class HashFunc> void swap(hash_multimap<Key, Data, HashFunc>& lhs, hash_multimap<Key, Data, HashFunc>& rhs)
+template <class Key, class Data, class HashFunc, class PartitionPolicy, thor_size_type T_PREALLOC> void swap(hash_multimap<Key, Data, HashFunc, PartitionPolicy, T_PREALLOC>& lhs, hash_multimap<Key, Data, HashFunc, PartitionPolicy, T_PREALLOC>& rhs)
 {
     lhs.swap(rhs);
 }
@@ -18,7 +18,14 @@
  * - bucket_count() will always return powers-of-two whereas some other implementations use
  *   prime numbers. The power-of-two implementation is faster.
  * - equal_range() supports an optional count parameter
+ * - find_batch() looks up many independent keys at once, overlapping their cache misses
  * - A PartitionPolicy can be used to control the bucketizing scheme (base2, prime, etc)
+ * - The template allows a preallocated number of entries. These entries and an initial bucket array
+ *   large enough to hold them are included as part of the class and are not allocated from the heap.
+ *   * Example: hash_set<int, hash<int>, policy::base2_partition, 8> reserves space for 8 entries.
+ *   * Growth above the preallocated amount will continue using the preallocated
+ *     amount augmented with heap memory.
+ *   * swap() between preallocated containers is O(n) and converts preallocated storage to heap storage.
  *
  * hash_set/hash_multiset - Non-ordered simple associative containers
  *   Time:
@@ -71,10 +78,11 @@ template
 <
     class Key,
     class HashFunc = hash<Key>,
-    class PartitionPolicy = policy::base2_partition
+    class PartitionPolicy = policy::base2_partition,
+    thor_size_type T_PREALLOC = 0
 > class hash_set
 {
-    typedef hashtable<Key, Key, HashFunc, identity<Key>, PartitionPolicy> hashtable_type;
+    typedef hashtable<Key, Key, HashFunc, identity<Key>, PartitionPolicy, T_PREALLOC> hashtable_type;
     typedef typename hashtable_type::iterator mutable_iterator;
     mutable_iterator make_mutable(typename hashtable_type::const_iterator pos) const { return *(mutable_iterator*)&pos; }
     hashtable_type m_hashtable;
@@ -167,6 +175,7 @@ public:
 
     // searching
     iterator find(const key_type& k) const                          { return m_hashtable.find(k); }
+    void find_batch(const key_type* keys, size_type n, iterator* out) const { m_hashtable.find_batch(keys, n, out); }
     size_type count(const key_type& k) const                        { return find(k) == end() ? 0 : 1; }
 
     pair<iterator, iterator> equal_range(const key_type& k) const   { return m_hashtable.equal_range(k); }
@@ -177,10 +186,11 @@ template
 <
     class Key,
     class HashFunc = hash<Key>,
-    class PartitionPolicy = policy::base2_partition
+    class PartitionPolicy = policy::base2_partition,
+    thor_size_type T_PREALLOC = 0
 > class hash_multiset
 {
-    typedef hashtable<Key, Key, HashFunc, identity<Key>, PartitionPolicy> hashtable_type;
+    typedef hashtable<Key, Key, HashFunc, identity<Key>, PartitionPolicy, T_PREALLOC> hashtable_type;
     typedef typename hashtable_type::iterator mutable_iterator;
     mutable_iterator make_mutable(typename hashtable_type::const_iterator pos) const { return *(mutable_iterator*)&pos; }
     hashtable_type m_hashtable;
@@ -273,18 +283,19 @@ public:
 
     // searching
     iterator find(const key_type& k) const                  { return m_hashtable.find(k); }
+    void find_batch(const key_type* keys, size_type n, iterator* out) const { m_hashtable.find_batch(keys, n, out); }
     size_type count(const key_type& k) const                { return m_hashtable.count(k); }
 
     pair<iterator, iterator> equal_range(const key_type& k, size_type* count = 0) const { return m_hashtable.equal_range(k, count); }
 };
 
 // Swap specializations
-template <class Key, class HashFunc> void swap(hash_set<Key, HashFunc>& lhs, hash_set<Key, HashFunc>& rhs)
+template <class Key, class HashFunc, class PartitionPolicy, thor_size_type T_PREALLOC> void swap(hash_set<Key, HashFunc, PartitionPolicy, T_PREALLOC>& lhs, hash_set<Key, HashFunc, PartitionPolicy, T_PREALLOC>& rhs)
 {
     lhs.swap(rhs);
 }
 
-template <class Key, class HashFunc> void swap(hash_multiset<Key, HashFunc>& lhs, hash_multiset<Key, HashFunc>& rhs)
+template <class Key, class HashFunc, class PartitionPolicy, thor_size_type T_PREALLOC> void swap(hash_multiset<Key, HashFunc, PartitionPolicy, T_PREALLOC>& lhs, hash_multiset<Key, HashFunc, PartitionPolicy, T_PREALLOC>& rhs)
 {
     lhs.swap(rhs);
 }
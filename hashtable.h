@@ -26,6 +26,14 @@
 #include "pair.h"
 #endif
 
+#ifndef THOR_MEMORY_H
+#include "memory.h"
+#endif
+
+#ifndef THOR_FREELIST_H
+#include "freelist.h"
+#endif
+
 namespace thor
 {
 
@@ -35,12 +43,16 @@ template
     typename Value,
     typename HashFunc,
     typename KeyFromValue,
-    typename PartitionPolicy
+    typename PartitionPolicy,
+    thor_size_type T_PREALLOC = 0
 > class hashtable
 {
     typedef PartitionPolicy partition_type;
     struct hash_node_base;
     struct hash_node;
+
+    // Number of keys that find_batch() has in flight at once
+    enum { find_batch_size = 16 };
 public:
     typedef Key key_type;
     typedef Value value_type;
@@ -236,7 +248,7 @@ public:
     hashtable& operator=(const hashtable& rhs)
     {
         clear();
-        m_root = static_cast<const hasher&>(rhs.m_root);
+        static_cast<empty_member_opt&>(m_root) = rhs.hash_funct();
 
         resize(rhs.size());
         insert_equal(rhs.begin(false), rhs.end());
@@ -244,8 +256,16 @@ public:
         return *this;
     }
 
+    // O(1) swap with another hashtable, unless preallocated
     void swap(hashtable& rhs)
     {
+        if (!m_root.is_always_shareable())
+        {
+            // Preallocated storage cannot change owners, so move everything to the heap first
+            make_shareable();
+            rhs.make_shareable();
+        }
+
         // must fix up terminators first
         // also note that pointers must be assigned simultaneously (i.e. node.prev->next = node.next->prev = terminator() doesn't work)
         {
@@ -260,7 +280,7 @@ public:
             Rhead = Rtail = rhs.terminator();
             Lhead = Ltail = terminator();
         }
-        thor::swap(m_root, rhs.m_root);
+        thor::swap(static_cast<empty_member_opt&>(m_root), static_cast<empty_member_opt&>(rhs.m_root));
     }
 
     void clear()
@@ -276,7 +296,7 @@ public:
         }
 
         // clean up the buckets
-        memory::align_alloc<hash_node*>::free(m_root.m_buckets);
+        free_buckets(m_root.m_buckets);
         m_root.m_buckets = 0;
         m_root.m_bucket_count = 0;
         m_root.m_size = 0;
@@ -425,6 +445,20 @@ public:
         return end();
     }
     
+    // Looks up n independent keys, storing the result for keys[i] in out[i] (end() if not found).
+    // Keys are processed in groups: every key in a group is hashed and its bucket and first node
+    // are prefetched before any lookup is resolved, so the cache misses of the lookups overlap
+    // instead of being taken one after another.
+    void find_batch(const key_type* keys, size_type n, const_iterator* out) const
+    {
+        internal_find_batch(keys, n, out);
+    }
+
+    void find_batch(const key_type* keys, size_type n, iterator* out)
+    {
+        internal_find_batch(keys, n, out);
+    }
+
     size_type count(const key_type& k) const
     {
         hash_node* node = internal_find(k);
@@ -517,13 +551,71 @@ private:
     };
 
     // Allocates and deallocates memory only. Return value is not constructed.
+    // Preallocated nodes are used first, if any are available.
     hash_node* alloc_node()
     {
-        return memory::align_alloc<hash_node>::alloc();
+        hash_node* node = m_root.alloc_node();
+        return node != 0 ? node : memory::align_alloc<hash_node>::alloc();
     }
     void dealloc_node(hash_node* node)
     {
-        memory::align_alloc<hash_node>::free(node);
+        if (!m_root.free_node(node))
+        {
+            memory::align_alloc<hash_node>::free(node);
+        }
+    }
+
+    // Bucket arrays are not constructed. The preallocated bucket array is used if it is large enough.
+    hash_node** alloc_buckets(size_type n)
+    {
+        hash_node** buckets = m_root.alloc_buckets(n);
+        return buckets != 0 ? buckets : memory::align_alloc<hash_node*>::alloc(n);
+    }
+    void free_buckets(hash_node** buckets)
+    {
+        if (!m_root.is_owned_buckets(buckets))
+        {
+            memory::align_alloc<hash_node*>::free(buckets);
+        }
+    }
+
+    // Moves all nodes and the bucket array out of preallocated storage and onto the heap
+    void make_shareable()
+    {
+        if (m_root.m_buckets != 0 && m_root.is_owned_buckets(m_root.m_buckets))
+        {
+            hash_node** buckets = memory::align_alloc<hash_node*>::alloc(bucket_count());
+            for (size_type i = 0; i != bucket_count(); ++i)
+            {
+                buckets[i] = m_root.m_buckets[i];
+            }
+            m_root.m_buckets = buckets;
+        }
+
+        hash_node* node = m_root.m_listhead;
+        while (node != terminator())
+        {
+            hash_node* next = node->listnext;
+            if (m_root.is_owned_node(node))
+            {
+                hash_node* newnode = memory::align_alloc<hash_node>::alloc();
+                new (newnode) hash_node_base(static_cast<const hash_node_base&>(*node));
+                newnode->hashval = node->hashval;
+                typetraits<value_type>::construct(&newnode->value, node->value);
+                newnode->listnext->listprev = newnode;
+                newnode->listprev->listnext = newnode;
+                newnode->hashnext->hashprev = newnode;
+                newnode->hashprev->hashnext = newnode;
+
+                hash_node*& b = m_root.m_buckets[partition_type::bucket_index(node->hashval, bucket_count())];
+                if (b == node)
+                {
+                    b = newnode;
+                }
+                destroy_node(node);
+            }
+            node = next;
+        }
     }
 
     // Everything but hash_node::value has been constructed/set when this function returns
@@ -649,8 +741,8 @@ private:
         if (bc != bucket_count())
         {
             // Build the larger bucket array
-            memory::align_alloc<hash_node*>::free(m_root.m_buckets);
-            m_root.m_buckets = memory::align_alloc<hash_node*>::alloc(bc);
+            free_buckets(m_root.m_buckets);
+            m_root.m_buckets = alloc_buckets(bc);
             m_root.m_bucket_count = bc;
             typetraits<hash_node*>::range_construct(m_root.m_buckets, m_root.m_buckets + bc);
 
@@ -685,34 +777,84 @@ private:
         {
             const size_type hashval = hash_funct()(k);
             const size_type bucket = partition_type::bucket_index(hashval, bucket_count());
-            hash_node* node = m_root.m_buckets[bucket];
-            if (node)
+            return internal_find(k, hashval, bucket, m_root.m_buckets[bucket]);
+        }
+        return terminator();
+    }
+
+    // Searches a bucket for k. node is the head of the bucket (may be zero).
+    hash_node* internal_find(const Key& k, size_type hashval, size_type bucket, hash_node* node) const
+    {
+        if (node)
+        {
+            do
             {
-                do
+                if (node->hashval == hashval)
                 {
-                    if (node->hashval == hashval)
+                    // Inner loop until we end this run of matching hashes
+                    do 
                     {
-                        // Inner loop until we end this run of matching hashes
-                        do 
+                        if (k == KeyFromValue()(node->value))
                         {
-                            if (k == KeyFromValue()(node->value))
-                            {
-                                // Found it
-                                return node;
-                            }
-                            node = node->hashnext;
-                        } while (node != terminator() && node->hashval == hashval);
-
-                        // This ends a run of matching hashes without finding a key match
-                        return terminator();
-                    }
-                    node = node->hashnext;
-                } while (node != terminator() && partition_type::bucket_index(node->hashval, bucket_count()) == bucket);
-            }
+                            // Found it
+                            return node;
+                        }
+                        node = node->hashnext;
+                    } while (node != terminator() && node->hashval == hashval);
+
+                    // This ends a run of matching hashes without finding a key match
+                    return terminator();
+                }
+                node = node->hashnext;
+            } while (node != terminator() && partition_type::bucket_index(node->hashval, bucket_count()) == bucket);
         }
         return terminator();
     }
 
+    template <class Iterator> void internal_find_batch(const key_type* keys, size_type n, Iterator* out) const
+    {
+        size_type hashvals[find_batch_size];
+        size_type buckets[find_batch_size];
+        hash_node* nodes[find_batch_size];
+        while (n != 0)
+        {
+            const size_type count = n < size_type(find_batch_size) ? n : size_type(find_batch_size);
+            if (bucket_count() == 0)
+            {
+                for (size_type i = 0; i != count; ++i)
+                {
+                    out[i] = Iterator(terminator(), Iterator::mode_list, this);
+                }
+            }
+            else
+            {
+                // Stage 1: hash every key and start loading its bucket
+                for (size_type i = 0; i != count; ++i)
+                {
+                    hashvals[i] = hash_funct()(keys[i]);
+                    buckets[i] = partition_type::bucket_index(hashvals[i], bucket_count());
+                    memory::prefetch(&m_root.m_buckets[buckets[i]]);
+                }
+
+                // Stage 2: read the bucket heads and start loading the first nodes
+                for (size_type i = 0; i != count; ++i)
+                {
+                    nodes[i] = m_root.m_buckets[buckets[i]];
+                    memory::prefetch(nodes[i]);
+                }
+
+                // Stage 3: resolve
+                for (size_type i = 0; i != count; ++i)
+                {
+                    out[i] = Iterator(internal_find(keys[i], hashvals[i], buckets[i], nodes[i]), Iterator::mode_hash, this);
+                }
+            }
+            keys += count;
+            out += count;
+            n -= count;
+        }
+    }
+
     void internal_erase(hash_node* n)
     {
         n->hashprev->hashnext = n->hashnext;
@@ -790,7 +932,54 @@ private:
         }
     };
 
-    empty_member_opt m_root;
+    // Rounds N up to a power of two at compile time
+    template <size_type N> struct static_pow2
+    {
+        enum
+        {
+            v0 = N - 1,
+            v1 = v0 | (v0 >> 1),
+            v2 = v1 | (v1 >> 2),
+            v3 = v2 | (v2 >> 4),
+            v4 = v3 | (v3 >> 8),
+            value = (v4 | (v4 >> 16)) + 1
+        };
+    };
+
+    // Preallocated storage for T_COUNT nodes and the bucket array that holds them. The
+    // specialization for zero adds nothing to the size of the hashtable.
+    template <size_type T_COUNT, class Unused = void> struct root_storage : public empty_member_opt
+    {
+        enum { prealloc_buckets = static_pow2<(T_COUNT < partition_type::initial_size ? partition_type::initial_size : T_COUNT)>::value };
+
+        freelist<hash_node, T_COUNT> m_freelist;
+        hash_node* m_bucket_space[prealloc_buckets];
+
+        root_storage(hash_node* term) : empty_member_opt(term) {}
+        root_storage(hash_node* term, const hasher& h) : empty_member_opt(term, h) {}
+
+        hash_node* alloc_node()                         { return m_freelist.alloc_node(); }
+        bool free_node(hash_node* node)                 { return m_freelist.free_node(node); }
+        bool is_owned_node(hash_node* node) const       { return m_freelist.is_owned_node(node); }
+        hash_node** alloc_buckets(size_type n)          { return n <= size_type(prealloc_buckets) ? m_bucket_space : 0; }
+        bool is_owned_buckets(hash_node** b) const      { return b == m_bucket_space; }
+        static bool is_always_shareable()               { return false; }
+    };
+
+    template <class Unused> struct root_storage<0, Unused> : public empty_member_opt
+    {
+        root_storage(hash_node* term) : empty_member_opt(term) {}
+        root_storage(hash_node* term, const hasher& h) : empty_member_opt(term, h) {}
+
+        static hash_node* alloc_node()                  { return 0; }
+        static bool free_node(hash_node*)               { return false; }
+        static bool is_owned_node(hash_node*)           { return false; }
+        static hash_node** alloc_buckets(size_type)     { return 0; }
+        static bool is_owned_buckets(hash_node**)       { return false; }
+        static bool is_always_shareable()               { return true; }
+    };
+
+    root_storage<T_PREALLOC> m_root;
 };
 
 } // namespace thor
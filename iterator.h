@@ -4,6 +4,10 @@
  * iterator.h
  *
  * This file defines functionality required by iterators
+ *
+ * find() and find_if() are not defined here; they are in algorithm.h, which must be included to use
+ * them. This header is included by algorithm.h and the headers it depends on, so it cannot include
+ * algorithm.h itself.
  */
 
 #ifndef THOR_ITERATOR_H
@@ -244,104 +248,6 @@ template <class InputIterator, class Distance> void advance(InputIterator& iter,
     __advance(iter, n, THOR_GET_CATEGORY(iter,InputIterator));
 }
 
-template <class InputIterator, class T> InputIterator __find(InputIterator first, InputIterator last, const T& val, const random_access_iterator_tag&)
-{
-    difference_type check_count = (last - first) / 4;
-    for (; check_count > 0; --check_count)
-    {
-        if (*first == val) return first;
-        ++first;
-
-        if (*first == val) return first;
-        ++first;
-
-        if (*first == val) return first;
-        ++first;
-
-        if (*first == val) return first;
-        ++first;
-    }
-
-    switch (last - first)
-    {
-    case 3:
-        if (*first == val) return first;
-        ++first;
-    case 2:
-        if (*first == val) return first;
-        ++first;
-    case 1:
-        if (*first == val) return first;
-        ++first;
-    case 0:
-    default:
-        return first;
-    }
-}
-
-template <class InputIterator, class T> InputIterator __find(InputIterator first, InputIterator last, const T& val, const input_iterator_tag&)
-{
-    while (first != last && !(*first == val))
-    {
-        ++first;
-    }
-    return first;
-}
-
-template <class InputIterator, class T> InputIterator find(InputIterator first, InputIterator last, const T& val)
-{
-    return __find(first, last, val, THOR_GET_CATEGORY(first,InputIterator));
-}
-
-template <class InputIterator, class Predicate> InputIterator __find_if(InputIterator first, InputIterator last, Predicate pred, const random_access_iterator_tag&)
-{
-    difference_type check_count = (last - first) / 4;
-    for (; check_count > 0; --check_count)
-    {
-        if (pred(*first)) return first;
-        ++first;
-
-        if (pred(*first)) return first;
-        ++first;
-
-        if (pred(*first)) return first;
-        ++first;
-
-        if (pred(*first)) return first;
-        ++first;
-    }
-
-    switch (last - first)
-    {
-    case 3:
-        if (pred(*first)) return first;
-        ++first;
-    case 2:
-        if (pred(*first)) return first;
-        ++first;
-    case 1:
-        if (pred(*first)) return first;
-        ++first;
-    case 0:
-    default:
-        return first;
-    }
-}
-
-template <class InputIterator, class Predicate> InputIterator __find_if(InputIterator first, InputIterator last, Predicate pred, const input_iterator_tag&)
-{
-    while (first != last && !pred(*first))
-    {
-        ++first;
-    }
-    return first;
-}
-
-template <class InputIterator, class Predicate> InputIterator find_if(InputIterator first, InputIterator last, Predicate pred)
-{
-    return __find_if(first, last, pred, THOR_GET_CATEGORY(first, InputIterator));
-}
-
 }; // namespace thor
 
 #ifndef THOR_TYPETRAITS_H
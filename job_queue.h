@@ -54,6 +54,9 @@ class job_queue : protected T_JOB_ID_POLICY
 {
     typedef job_queue<T_PRIORITY, T_JOB_ID_POLICY> job_queue_type;
 public:
+    typedef typename T_JOB_ID_POLICY::job_id_type job_id_type;
+    typedef T_PRIORITY priority_type;
+
     job_queue();
     ~job_queue();
 
@@ -66,8 +69,6 @@ public:
     bool remove_job(job_id_type job);
 
 private:
-    using T_JOB_ID_POLICY::job_id_type;
-
     ref_pointer<job> wait_for_job();
     void job_finished(ref_pointer<job> job);
 
@@ -139,6 +140,7 @@ void job_queue<T_PRIORITY, T_JOB_ID_POLICY>::start_threads(size_type count, cons
     {
         fullname.format("%s%u", name, (unsigned)threads_.size());
         threads_.push_back(new worker_thread(this, fullname.c_str(), priority));
+        threads_.back()->start();
     }
 }
 
@@ -149,6 +151,8 @@ void job_queue<T_PRIORITY, T_JOB_ID_POLICY>::stop_threads()
     {
         threads_[i]->stop(false);
     }
+    // Wake any threads waiting for a job so that they see the stop request
+    sem_.release(threads_.size());
     for (size_type i = 0; i < threads_.size(); ++i)
     {
         threads_[i]->join();
@@ -163,9 +167,9 @@ size_type job_queue<T_PRIORITY, T_JOB_ID_POLICY>::num_threads() const
 }
 
 template<typename T_PRIORITY, class T_JOB_ID_POLICY> inline 
-job_queue<T_PRIORITY, T_JOB_ID_POLICY>::job_id_type job_queue<T_PRIORITY, T_JOB_ID_POLICY>::add_job(ref_pointer<job> job, T_PRIORITY priority)
+typename job_queue<T_PRIORITY, T_JOB_ID_POLICY>::job_id_type job_queue<T_PRIORITY, T_JOB_ID_POLICY>::add_job(ref_pointer<job> job, T_PRIORITY priority)
 {
-    scope_locker lock(mutex_);   
+    scope_locker<mutex> lock(mutex_);   
     job_id_type job_id = next_job_id();
     entry* e = new entry(priority, job);
     entries_.insert(job_id, e);
@@ -177,14 +181,17 @@ job_queue<T_PRIORITY, T_JOB_ID_POLICY>::job_id_type job_queue<T_PRIORITY, T_JOB_
 template<typename T_PRIORITY, class T_JOB_ID_POLICY> inline 
 bool job_queue<T_PRIORITY, T_JOB_ID_POLICY>::reprioritize(job_id_type job_id, T_PRIORITY new_priority)
 {
-    scope_locker lock(mutex_);
-    entries_map::iterator iter((entries_.find(job_id));
+    scope_locker<mutex> lock(mutex_);
+    typename entries_map::iterator iter(entries_.find(job_id));
     if (iter != entries_.end())
     {
+        // The old entry stays in the priority queue without a job and is discarded when reached
         entry* e = new entry(new_priority, iter->job);
         iter->job = 0;
-        *iter = e;
+        entries_.remove(iter);
+        entries_.insert(job_id, e);
         priorities_.push(e);
+        sem_.release();
         return true;
     }
     return false;
@@ -193,8 +200,8 @@ bool job_queue<T_PRIORITY, T_JOB_ID_POLICY>::reprioritize(job_id_type job_id, T_
 template<typename T_PRIORITY, class T_JOB_ID_POLICY> inline 
 bool job_queue<T_PRIORITY, T_JOB_ID_POLICY>::remove_job(job_id_type job_id)
 {
-    scope_locker lock(mutex_);
-    entries_map::iterator iter(entries_.find(job_id));
+    scope_locker<mutex> lock(mutex_);
+    typename entries_map::iterator iter(entries_.find(job_id));
     if (iter != entries_.end())
     {
         iter->job = 0;
@@ -209,7 +216,7 @@ template<typename T_PRIORITY, class T_JOB_ID_POLICY> inline
 ref_pointer<job> job_queue<T_PRIORITY, T_JOB_ID_POLICY>::wait_for_job()
 {
     sem_.wait();
-    scope_locker lock(mutex_);
+    scope_locker<mutex> lock(mutex_);
     if (!priorities_.empty())
     {
         entry* e = priorities_.top();
@@ -217,12 +224,13 @@ ref_pointer<job> job_queue<T_PRIORITY, T_JOB_ID_POLICY>::wait_for_job()
         {
             entries_.remove(e);
         }
-        ref_counted<job> job = e->job;
+        ref_pointer<job> j = e->job;
         priorities_.pop();
         lock.unlock();
         delete e;
-        return job;
+        return j;
     }
+    return ref_pointer<job>();
 }
 
 template<typename T_PRIORITY, class T_JOB_ID_POLICY> inline 
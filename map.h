@@ -9,6 +9,12 @@
  * - The insert(pos, value_type) functions that support an insert hint are not implemented.
  * - The value_comp() functions are not implemented.
  * - The insert(InputIterator, InputIterator) function has been renamed insert_range.
+ * - insert_sorted(InputIterator, InputIterator) inserts a range that is already sorted by key in
+ *   linear time (size() plus the length of the range) by merging it with the existing entries and
+ *   rebuilding a balanced tree. Use it to build a map from sorted input or to merge in large
+ *   sorted batches; for a few entries insert_range is faster.
+ *   * In the case of map, entries with keys that already exist are not inserted.
+ *   * In the case of multimap, entries are inserted after existing entries with equal keys.
  * - While insert(value_type) is supported, it is not the best way to insert elements.
  *   Consider using the templatized insert() functions. These functions pass up to four
  *   parameters directly to the constructor meaning that there is no copy construction
@@ -18,6 +24,18 @@
  *     and re-constructed.
  *   * In the case of map, the insert() functions return an iterator, so it is impossible
  *     to tell whether the key previously existed from the insert() function call alone.
+ * - The template allows a preallocated number of entries. These entries are included as part
+ *   of the class and are not allocated from the heap.
+ *   * Example: map<int, int, less<int>, 8> reserves space for 8 entries.
+ *   * Growth above the preallocated amount will continue using the preallocated
+ *     amount augmented with heap memory.
+ *   * swap() between preallocated containers is O(n) and converts preallocated storage to heap storage.
+ * - The template optionally supports order statistics. Each entry tracks the size of its subtree
+ *   which costs one size_type per entry.
+ *   * Example: map<int, int, less<int>, 0, true>
+ *   * nth(n) returns the n-th entry in order (or end()), rank(key) returns the number of entries
+ *     with keys less than key, index_of(iterator) returns the index of an entry and distance()
+ *     returns the distance between two iterators. These are all logarithmic.
  */
 
 #ifndef THOR_MAP_H
@@ -40,7 +58,7 @@ namespace thor
 {
 
 // thor::map
-template <class Key, class Value, class Compare = less<Key> > class map
+template <class Key, class Value, class Compare = less<Key>, thor_size_type T_PREALLOC = 0, bool T_ORDER_STATS = false> class map
 {
 public:
     typedef Key key_type;
@@ -49,7 +67,7 @@ public:
     typedef Compare key_compare;
 
 private:
-    typedef red_black_tree<key_type, value_type, select1st<value_type>, Compare> tree_type;
+    typedef red_black_tree<key_type, value_type, select1st<value_type>, Compare, T_PREALLOC, T_ORDER_STATS> tree_type;
     tree_type m_tree;
 
 public:
@@ -117,6 +135,7 @@ public:
 
     pair<iterator, bool> insert(const value_type& v) { return m_tree.insert_unique(v); }
     template <class InputIterator> void insert_range(InputIterator first, InputIterator last) { m_tree.insert_unique(first, last); }
+    template <class InputIterator> void insert_sorted(InputIterator first, InputIterator last) { m_tree.insert_sorted_unique(first, last); }
 
     // Extended insert():
     // These insert extension functions work more like operator[] than insert(value_type) in that
@@ -187,6 +206,13 @@ public:
     pair<iterator,iterator> equal_range(const key_type& k) { return m_tree.equal_range(k); }
     pair<const_iterator,const_iterator> equal_range(const key_type& k) const { return m_tree.equal_range(k); }
 
+    // Order statistics; require T_ORDER_STATS
+    iterator nth(size_type n)                       { return m_tree.nth(n); }
+    const_iterator nth(size_type n) const           { return m_tree.nth(n); }
+    size_type rank(const key_type& k) const         { return m_tree.rank(k); }
+    size_type index_of(const_iterator pos) const    { return m_tree.index_of(pos); }
+    difference_type distance(const_iterator first, const_iterator last) const { return m_tree.distance(first, last); }
+
     // Using this involves default-constructing the value and copying the key.
     data_type& operator [] (const key_type& k)
     {
@@ -195,7 +221,7 @@ public:
 };
 
 // thor::multimap
-template <class Key, class Value, class Compare = less<Key> > class multimap
+template <class Key, class Value, class Compare = less<Key>, thor_size_type T_PREALLOC = 0, bool T_ORDER_STATS = false> class multimap
 {
 public:
     typedef Key key_type;
@@ -204,7 +230,7 @@ public:
     typedef Compare key_compare;
 
 private:
-    typedef red_black_tree<key_type, value_type, select1st<value_type>, Compare> tree_type;
+    typedef red_black_tree<key_type, value_type, select1st<value_type>, Compare, T_PREALLOC, T_ORDER_STATS> tree_type;
     tree_type m_tree;
 
 public:
@@ -272,6 +298,7 @@ public:
 
     iterator insert(const value_type& v)        { return m_tree.insert_equal(v); }
     template <class InputIterator> void insert_range(InputIterator first, InputIterator last) { m_tree.insert_equal(first, last); }
+    template <class InputIterator> void insert_sorted(InputIterator first, InputIterator last) { m_tree.insert_sorted_equal(first, last); }
 
     iterator insert(const Key& key)
     {
@@ -331,15 +358,22 @@ public:
 
     pair<iterator,iterator> equal_range(const key_type& k) { return m_tree.equal_range(k); }
     pair<const_iterator,const_iterator> equal_range(const key_type& k) const { return m_tree.equal_range(k); }
+
+    // Order statistics; require T_ORDER_STATS
+    iterator nth(size_type n)                       { return m_tree.nth(n); }
+    const_iterator nth(size_type n) const           { return m_tree.nth(n); }
+    size_type rank(const key_type& k) const         { return m_tree.rank(k); }
+    size_type index_of(const_iterator pos) const    { return m_tree.index_of(pos); }
+    difference_type distance(const_iterator first, const_iterator last) const { return m_tree.distance(first, last); }
 };
 
 // Swap specializations
-template <class Key, class Value, class Compare> void swap(map<Key, Value, Compare>& lhs, map<Key, Value, Compare>& rhs)
+template <class Key, class Value, class Compare, thor_size_type T_PREALLOC, bool T_ORDER_STATS> void swap(map<Key, Value, Compare, T_PREALLOC, T_ORDER_STATS>& lhs, map<Key, Value, Compare, T_PREALLOC, T_ORDER_STATS>& rhs)
 {
     lhs.swap(rhs);
 }
 
-template <class Key, class Value, class Compare> void swap(multimap<Key, Value, Compare>& lhs, multimap<Key, Value, Compare>& rhs)
+template <class Key, class Value, class Compare, thor_size_type T_PREALLOC, bool T_ORDER_STATS> void swap(multimap<Key, Value, Compare, T_PREALLOC, T_ORDER_STATS>& lhs, multimap<Key, Value, Compare, T_PREALLOC, T_ORDER_STATS>& rhs)
 {
     lhs.swap(rhs);
 }
@@ -17,6 +17,10 @@
 #include "basetypes.h"
 #endif
 
+#ifdef _MSC_VER
+#include <xmmintrin.h>
+#endif
+
 namespace thor
 {
 
@@ -135,6 +139,16 @@ public:
     }
 };
 
+// Hints that the cache line containing p will be read soon. Never faults, even for invalid addresses.
+inline void prefetch(const void* p)
+{
+#ifdef _MSC_VER
+    _mm_prefetch((const char*)p, _MM_HINT_T0);
+#else
+    __builtin_prefetch(p);
+#endif
+}
+
 } // namespace memory
 
 } // namespace thor
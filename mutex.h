@@ -68,7 +68,7 @@ public:
     {
         if (locked_)
         {
-            lockable_->unlock();
+            lockable_.unlock();
             locked_ = false;
         }
     }
@@ -0,0 +1,754 @@
+/* THOR - THOR Template Library
+ * Joshua M. Kriegshauser
+ *
+ * parallel_algorithm.h
+ *
+ * This file defines algorithms that split their work into jobs that run on a job_queue.
+ *
+ * parallel_sort(queue, first, last [, comp])          - Same result as sort()
+ * parallel_stable_sort(queue, first, last [, comp])   - Same result as stable_sort()
+ * parallel_for_each(queue, first, last, func)         - Calls func for every element, in no particular order
+ * parallel_transform(queue, first, last, result, op)  - Same result as the element-wise transform: result[i] = op(first[i])
+ * parallel_transform(queue, first1, last1, first2, result, op) - result[i] = op(first1[i], first2[i])
+ * parallel_reduce(queue, first, last, init [, op])    - init combined with every element by op (default +). op must be
+ *                                                       associative; elements are combined in order, but grouped differently
+ *                                                       than accumulate(), so floating point sums may round differently
+ * parallel_inclusive_scan(queue, first, last, result [, op]) - result[i] = first[0] op ... op first[i]
+ * parallel_exclusive_scan(queue, first, last, result, init [, op]) - result[i] = init op first[0] op ... op first[i - 1]
+ * parallel_copy_if(queue, first, last, result, pred)  - Same result as remove_copy_if() with the opposite predicate: the
+ *                                                       elements that satisfy pred, in order. pred is called twice per element
+ * parallel_count(queue, first, last, value)           - Same result as count()
+ * parallel_count_if(queue, first, last, pred)         - Same result as count_if()
+ *
+ * The calling thread blocks until all of the jobs have finished, so these functions must not be
+ * called from a job running on the same queue. Ranges that are too small to benefit, or a queue
+ * without threads, are handled by the sequential algorithm on the calling thread.
+ *
+ * The other algorithms: the range is divided into chunks of about __parallel_chunk_bytes of input
+ *   (sized to stay in cache), and one job per thread plus the calling thread repeatedly claim the
+ *   next unprocessed chunk from a shared counter, so threads that are slowed down or given more
+ *   expensive elements simply process fewer chunks. Function objects are copied for each chunk and
+ *   called from several threads at once. Scans and copy_if() make two passes: the first computes
+ *   the total (or count) of each chunk, which are combined on the calling thread into the starting
+ *   value (or output position) of each chunk for the second.
+ *
+ * Sorting: the range is split into one chunk per thread (rounded up to a power of two), each
+ *   chunk is sorted by a job, and then pairs of sorted runs are merged in rounds between the range
+ *   and a temporary buffer of the same size. Every merge is split into pieces by co-ranking (a
+ *   binary search for the split point of both inputs) so that even the final merge of two halves
+ *   uses every thread. Time: O((n log n) / threads + n log(threads)) given enough threads.
+ */
+
+#ifndef THOR_PARALLEL_ALGORITHM_H
+#define THOR_PARALLEL_ALGORITHM_H
+#pragma once
+
+#ifndef THOR_ALGORITHM_H
+#include "algorithm.h"
+#endif
+
+#ifndef THOR_JOB_QUEUE_H
+#include "job_queue.h"
+#endif
+
+#ifndef THOR_ATOMIC_INTEGER_H
+#include "atomic_integer.h"
+#endif
+
+#ifndef THOR_SEMAPHORE_H
+#include "semaphore.h"
+#endif
+
+#ifndef THOR_VECTOR_H
+#include "vector.h"
+#endif
+
+namespace thor
+{
+
+enum
+{
+    __parallel_sort_min_chunk = 16384,      // Ranges are not split into chunks smaller than this
+    __parallel_chunk_bytes = 32768,         // Chunk size, in bytes of input elements, for the other algorithms
+};
+
+// Tracks a set of jobs so that the submitting thread can wait for all of them to finish.
+class __parallel_job_group
+{
+    THOR_DECLARE_NOCOPY(__parallel_job_group);
+public:
+    __parallel_job_group() : m_pending(1) {}
+
+    void add()          { ++m_pending; }
+    void finished()     { if (--m_pending == 0) m_done.release(); }
+
+    // Waits for every job added since the last wait
+    void wait()
+    {
+        finished();
+        m_done.wait();
+        m_pending = 1;
+    }
+
+private:
+    atomic_integer<size_type> m_pending;    // One for the submitting thread plus one per job
+    semaphore m_done;
+};
+
+template <class Task> class __parallel_task_job : public job
+{
+public:
+    __parallel_task_job(const Task& task, __parallel_job_group& group) : m_task(task), m_group(group) {}
+
+    void run()
+    {
+        m_task();
+        m_group.finished();
+    }
+
+private:
+    Task m_task;
+    __parallel_job_group& m_group;
+};
+
+template <class JobQueue, class Task>
+void __parallel_submit(JobQueue& queue, __parallel_job_group& group, const Task& task)
+{
+    group.add();
+    queue.add_job(ref_pointer<job>(new __parallel_task_job<Task>(task, group)), typename JobQueue::priority_type());
+}
+
+template <class RandomAccessIterator, class Compare> struct __parallel_sort_task
+{
+    RandomAccessIterator m_first, m_last;
+    Compare m_comp;
+    bool m_stable;
+
+    __parallel_sort_task(RandomAccessIterator first, RandomAccessIterator last, Compare comp, bool stable) :
+        m_first(first), m_last(last), m_comp(comp), m_stable(stable) {}
+
+    void operator () () const
+    {
+        if (m_stable)
+        {
+            thor::stable_sort(m_first, m_last, m_comp);
+        }
+        else
+        {
+            thor::sort(m_first, m_last, m_comp);
+        }
+    }
+};
+
+// Returns how many of the first k elements of a stable merge of a and b come from a
+template <class RandomAccessIterator1, class RandomAccessIterator2, class Compare>
+thor_diff_type __merge_corank(thor_diff_type k,
+                              RandomAccessIterator1 a, thor_diff_type na,
+                              RandomAccessIterator2 b, thor_diff_type nb,
+                              Compare comp)
+{
+    thor_diff_type lo = k > nb ? k - nb : 0;
+    thor_diff_type hi = k < na ? k : na;
+    while (lo < hi)
+    {
+        const thor_diff_type i = lo + (hi - lo) / 2;
+        const thor_diff_type j = k - i;
+        // a[i] precedes b[j - 1] in the merge (a wins ties), so more than i come from a
+        if (j > 0 && !comp(*(b + (j - 1)), *(a + i)))
+        {
+            lo = i + 1;
+        }
+        else
+        {
+            hi = i;
+        }
+    }
+    return lo;
+}
+
+// Writes elements [out_first, out_last) of the merge of a and b to result + out_first
+template <class InputIterator, class OutputIterator, class Compare> struct __parallel_merge_task
+{
+    InputIterator m_a, m_b;
+    thor_diff_type m_na, m_nb;
+    OutputIterator m_result;
+    thor_diff_type m_out_first, m_out_last;
+    Compare m_comp;
+
+    __parallel_merge_task(InputIterator a, thor_diff_type na, InputIterator b, thor_diff_type nb,
+                          OutputIterator result, thor_diff_type out_first, thor_diff_type out_last, Compare comp) :
+        m_a(a), m_b(b), m_na(na), m_nb(nb), m_result(result), m_out_first(out_first), m_out_last(out_last), m_comp(comp) {}
+
+    void operator () () const
+    {
+        const thor_diff_type i0 = __merge_corank(m_out_first, m_a, m_na, m_b, m_nb, m_comp);
+        const thor_diff_type i1 = __merge_corank(m_out_last, m_a, m_na, m_b, m_nb, m_comp);
+        thor::merge(m_a + i0, m_a + i1, m_b + (m_out_first - i0), m_b + (m_out_last - i1), m_result + m_out_first, m_comp);
+    }
+};
+
+template <class InputIterator, class OutputIterator> struct __parallel_copy_task
+{
+    InputIterator m_first, m_last;
+    OutputIterator m_result;
+
+    __parallel_copy_task(InputIterator first, InputIterator last, OutputIterator result) :
+        m_first(first), m_last(last), m_result(result) {}
+
+    void operator () () const
+    {
+        thor::copy(m_first, m_last, m_result);
+    }
+};
+
+// Merges pairs of adjacent runs from src into dst. bounds holds runs + 1 offsets.
+template <class JobQueue, class InputIterator, class OutputIterator, class Compare>
+void __parallel_merge_round(JobQueue& queue, __parallel_job_group& group,
+                            InputIterator src, OutputIterator dst,
+                            const vector<thor_diff_type>& bounds, Compare comp)
+{
+    const size_type runs = bounds.size() - 1;
+    const size_type pairs = runs / 2;
+    const size_type threads = queue.num_threads();
+    const size_type pieces = pairs >= threads ? 1 : (threads + pairs - 1) / pairs;
+
+    for (size_type p = 0; p != pairs; ++p)
+    {
+        const thor_diff_type begin = bounds[p * 2];
+        const thor_diff_type middle = bounds[p * 2 + 1];
+        const thor_diff_type end = bounds[p * 2 + 2];
+        const thor_diff_type len = end - begin;
+        for (size_type k = 0; k != pieces; ++k)
+        {
+            const thor_diff_type out_first = (len * thor_diff_type(k)) / thor_diff_type(pieces);
+            const thor_diff_type out_last = (len * thor_diff_type(k + 1)) / thor_diff_type(pieces);
+            __parallel_submit(queue, group, __parallel_merge_task<InputIterator, OutputIterator, Compare>(
+                src + begin, middle - begin, src + middle, end - middle, dst + begin, out_first, out_last, comp));
+        }
+    }
+    group.wait();
+}
+
+template <class JobQueue, class RandomAccessIterator, class T, class Compare>
+void __parallel_sort_internal(JobQueue& queue, RandomAccessIterator first, RandomAccessIterator last, Compare comp, bool stable, T*)
+{
+    const thor_diff_type n = last - first;
+    const size_type threads = queue.num_threads();
+
+    size_type runs = 1;
+    while (runs < threads && n / thor_diff_type(runs * 2) >= thor_diff_type(__parallel_sort_min_chunk))
+    {
+        runs *= 2;
+    }
+
+    if (runs == 1)
+    {
+        __parallel_sort_task<RandomAccessIterator, Compare>(first, last, comp, stable)();
+        return;
+    }
+
+    __parallel_job_group group;
+
+    // Sort each chunk
+    vector<thor_diff_type> bounds;
+    for (size_type i = 0; i <= runs; ++i)
+    {
+        bounds.push_back((n * thor_diff_type(i)) / thor_diff_type(runs));
+    }
+    for (size_type i = 0; i != runs; ++i)
+    {
+        __parallel_submit(queue, group, __parallel_sort_task<RandomAccessIterator, Compare>(first + bounds[i], first + bounds[i + 1], comp, stable));
+    }
+    group.wait();
+
+    // Merge pairs of runs, alternating between the range and the buffer
+    __TemporaryBuffer<RandomAccessIterator, T> buf(first, last);
+    bool in_buffer = false;
+    while (bounds.size() > 2)
+    {
+        if (in_buffer)
+        {
+            __parallel_merge_round(queue, group, buf.begin(), first, bounds, comp);
+        }
+        else
+        {
+            __parallel_merge_round(queue, group, first, buf.begin(), bounds, comp);
+        }
+        in_buffer = !in_buffer;
+
+        vector<thor_diff_type> merged;
+        for (size_type i = 0; i < bounds.size(); i += 2)
+        {
+            merged.push_back(bounds[i]);
+        }
+        bounds.swap(merged);
+    }
+
+    if (in_buffer)
+    {
+        for (size_type i = 0; i != threads; ++i)
+        {
+            const thor_diff_type copy_first = (n * thor_diff_type(i)) / thor_diff_type(threads);
+            const thor_diff_type copy_last = (n * thor_diff_type(i + 1)) / thor_diff_type(threads);
+            __parallel_submit(queue, group, __parallel_copy_task<T*, RandomAccessIterator>(buf.begin() + copy_first, buf.begin() + copy_last, first + copy_first));
+        }
+        group.wait();
+    }
+}
+
+template <class JobQueue, class RandomAccessIterator>
+void parallel_sort(JobQueue& queue, RandomAccessIterator first, RandomAccessIterator last)
+{
+    if (first != last)
+    {
+        __parallel_sort_internal(queue, first, last, __less_factory(THOR_GET_VALUE_TYPE(first, RandomAccessIterator)), false, THOR_GET_VALUE_TYPE(first, RandomAccessIterator));
+    }
+}
+
+template <class JobQueue, class RandomAccessIterator, class Compare>
+void parallel_sort(JobQueue& queue, RandomAccessIterator first, RandomAccessIterator last, Compare comp)
+{
+    if (first != last)
+    {
+        __parallel_sort_internal(queue, first, last, comp, false, THOR_GET_VALUE_TYPE(first, RandomAccessIterator));
+    }
+}
+
+template <class JobQueue, class RandomAccessIterator>
+void parallel_stable_sort(JobQueue& queue, RandomAccessIterator first, RandomAccessIterator last)
+{
+    if (first != last)
+    {
+        __parallel_sort_internal(queue, first, last, __less_factory(THOR_GET_VALUE_TYPE(first, RandomAccessIterator)), true, THOR_GET_VALUE_TYPE(first, RandomAccessIterator));
+    }
+}
+
+template <class JobQueue, class RandomAccessIterator, class Compare>
+void parallel_stable_sort(JobQueue& queue, RandomAccessIterator first, RandomAccessIterator last, Compare comp)
+{
+    if (first != last)
+    {
+        __parallel_sort_internal(queue, first, last, comp, true, THOR_GET_VALUE_TYPE(first, RandomAccessIterator));
+    }
+}
+
+// Divides [0, n) into chunks of __parallel_chunk_bytes of elements. A queue without threads gets a single chunk.
+class __parallel_chunks
+{
+public:
+    template <class JobQueue> __parallel_chunks(const JobQueue& queue, thor_diff_type n, size_type element_size) :
+        m_n(n)
+    {
+        const thor_diff_type size = element_size >= size_type(__parallel_chunk_bytes) ? 1 : thor_diff_type(__parallel_chunk_bytes / element_size);
+        m_size = (queue.num_threads() == 0 || n <= size) ? (n > 0 ? n : 1) : size;
+        m_count = size_type((n + m_size - 1) / m_size);
+    }
+
+    size_type count() const                         { return m_count; }
+    thor_diff_type begin(size_type chunk) const     { return thor_diff_type(chunk) * m_size; }
+    thor_diff_type end(size_type chunk) const
+    {
+        const thor_diff_type e = begin(chunk) + m_size;
+        return e < m_n ? e : m_n;
+    }
+
+private:
+    thor_diff_type m_n;
+    thor_diff_type m_size;
+    size_type m_count;
+};
+
+// Processes chunks until there are none left: body(chunk, begin, end)
+template <class Body> struct __parallel_chunk_task
+{
+    const Body* m_body;
+    const __parallel_chunks* m_chunks;
+    atomic_integer<size_type>* m_next;
+
+    __parallel_chunk_task(const Body* body, const __parallel_chunks* chunks, atomic_integer<size_type>* next) :
+        m_body(body), m_chunks(chunks), m_next(next) {}
+
+    void operator () () const
+    {
+        for (size_type c = (*m_next)++; c < m_chunks->count(); c = (*m_next)++)
+        {
+            (*m_body)(c, m_chunks->begin(c), m_chunks->end(c));
+        }
+    }
+};
+
+// Calls body for every chunk; the calling thread processes chunks alongside the jobs
+template <class JobQueue, class Body>
+void __parallel_for_chunks(JobQueue& queue, const __parallel_chunks& chunks, const Body& body)
+{
+    atomic_integer<size_type> next(0);
+    const __parallel_chunk_task<Body> task(&body, &chunks, &next);
+    const size_type threads = queue.num_threads();
+    if (chunks.count() <= 1 || threads == 0)
+    {
+        task();
+        return;
+    }
+
+    __parallel_job_group group;
+    const size_type helpers = chunks.count() - 1 < threads ? chunks.count() - 1 : threads;
+    for (size_type i = 0; i != helpers; ++i)
+    {
+        __parallel_submit(queue, group, task);
+    }
+    task();
+    group.wait();
+}
+
+template <class RandomAccessIterator, class Function> struct __parallel_for_each_body
+{
+    RandomAccessIterator m_first;
+    Function m_func;
+
+    __parallel_for_each_body(RandomAccessIterator first, Function func) : m_first(first), m_func(func) {}
+
+    void operator () (size_type, thor_diff_type begin, thor_diff_type end) const
+    {
+        thor::for_each(m_first + begin, m_first + end, Function(m_func));
+    }
+};
+
+template <class JobQueue, class RandomAccessIterator, class Function>
+void parallel_for_each(JobQueue& queue, RandomAccessIterator first, RandomAccessIterator last, Function func)
+{
+    const __parallel_chunks chunks(queue, last - first, sizeof(*THOR_GET_VALUE_TYPE(first, RandomAccessIterator)));
+    __parallel_for_chunks(queue, chunks, __parallel_for_each_body<RandomAccessIterator, Function>(first, func));
+}
+
+template <class RandomAccessIterator, class OutputIterator, class UnaryOperation> struct __parallel_transform_body
+{
+    RandomAccessIterator m_first;
+    OutputIterator m_result;
+    UnaryOperation m_op;
+
+    __parallel_transform_body(RandomAccessIterator first, OutputIterator result, UnaryOperation op) :
+        m_first(first), m_result(result), m_op(op) {}
+
+    void operator () (size_type, thor_diff_type begin, thor_diff_type end) const
+    {
+        UnaryOperation op(m_op);
+        OutputIterator out = m_result + begin;
+        for (RandomAccessIterator i = m_first + begin, e = m_first + end; i != e; ++i, ++out)
+        {
+            *out = op(*i);
+        }
+    }
+};
+
+template <class JobQueue, class RandomAccessIterator, class OutputIterator, class UnaryOperation>
+OutputIterator parallel_transform(JobQueue& queue, RandomAccessIterator first, RandomAccessIterator last, OutputIterator result, UnaryOperation op)
+{
+    const __parallel_chunks chunks(queue, last - first, sizeof(*THOR_GET_VALUE_TYPE(first, RandomAccessIterator)));
+    __parallel_for_chunks(queue, chunks, __parallel_transform_body<RandomAccessIterator, OutputIterator, UnaryOperation>(first, result, op));
+    return result + (last - first);
+}
+
+template <class RandomAccessIterator1, class RandomAccessIterator2, class OutputIterator, class BinaryOperation> struct __parallel_transform2_body
+{
+    RandomAccessIterator1 m_first1;
+    RandomAccessIterator2 m_first2;
+    OutputIterator m_result;
+    BinaryOperation m_op;
+
+    __parallel_transform2_body(RandomAccessIterator1 first1, RandomAccessIterator2 first2, OutputIterator result, BinaryOperation op) :
+        m_first1(first1), m_first2(first2), m_result(result), m_op(op) {}
+
+    void operator () (size_type, thor_diff_type begin, thor_diff_type end) const
+    {
+        BinaryOperation op(m_op);
+        OutputIterator out = m_result + begin;
+        RandomAccessIterator2 i2 = m_first2 + begin;
+        for (RandomAccessIterator1 i = m_first1 + begin, e = m_first1 + end; i != e; ++i, ++i2, ++out)
+        {
+            *out = op(*i, *i2);
+        }
+    }
+};
+
+template <class JobQueue, class RandomAccessIterator1, class RandomAccessIterator2, class OutputIterator, class BinaryOperation>
+OutputIterator parallel_transform(JobQueue& queue, RandomAccessIterator1 first1, RandomAccessIterator1 last1, RandomAccessIterator2 first2, OutputIterator result, BinaryOperation op)
+{
+    const __parallel_chunks chunks(queue, last1 - first1, sizeof(*THOR_GET_VALUE_TYPE(first1, RandomAccessIterator1)));
+    __parallel_for_chunks(queue, chunks, __parallel_transform2_body<RandomAccessIterator1, RandomAccessIterator2, OutputIterator, BinaryOperation>(first1, first2, result, op));
+    return result + (last1 - first1);
+}
+
+// Stores the combination of each chunk's elements in m_totals. The default operation uses
+// accumulate_unordered(), which may vectorize.
+template <class RandomAccessIterator, class T, class BinaryOperation> struct __parallel_reduce_body
+{
+    RandomAccessIterator m_first;
+    BinaryOperation m_op;
+    vector<T>* m_totals;
+
+    __parallel_reduce_body(RandomAccessIterator first, BinaryOperation op, vector<T>* totals) :
+        m_first(first), m_op(op), m_totals(totals) {}
+
+    void operator () (size_type chunk, thor_diff_type begin, thor_diff_type end) const
+    {
+        (*m_totals)[chunk] = reduce(m_first + begin, m_first + end, m_op);
+    }
+
+    template <class Op> static T reduce(RandomAccessIterator first, RandomAccessIterator last, Op op)
+    {
+        T total(*first);
+        for (++first; first != last; ++first)
+        {
+            total = op(total, *first);
+        }
+        return total;
+    }
+
+    static T reduce(RandomAccessIterator first, RandomAccessIterator last, plus<T>)
+    {
+        return thor::accumulate_unordered(first + 1, last, T(*first));
+    }
+};
+
+template <class JobQueue, class RandomAccessIterator, class T, class BinaryOperation>
+void __parallel_chunk_totals(JobQueue& queue, const __parallel_chunks& chunks, RandomAccessIterator first, BinaryOperation op, vector<T>& totals)
+{
+    totals.resize(chunks.count(), T(*first));
+    __parallel_for_chunks(queue, chunks, __parallel_reduce_body<RandomAccessIterator, T, BinaryOperation>(first, op, &totals));
+}
+
+template <class JobQueue, class RandomAccessIterator, class T, class BinaryOperation>
+T parallel_reduce(JobQueue& queue, RandomAccessIterator first, RandomAccessIterator last, T init, BinaryOperation op)
+{
+    if (first == last)
+    {
+        return init;
+    }
+    const __parallel_chunks chunks(queue, last - first, sizeof(*THOR_GET_VALUE_TYPE(first, RandomAccessIterator)));
+    vector<T> totals;
+    __parallel_chunk_totals(queue, chunks, first, op, totals);
+    for (size_type i = 0; i != totals.size(); ++i)
+    {
+        init = op(init, totals[i]);
+    }
+    return init;
+}
+
+template <class JobQueue, class RandomAccessIterator, class T>
+T parallel_reduce(JobQueue& queue, RandomAccessIterator first, RandomAccessIterator last, T init)
+{
+    return parallel_reduce(queue, first, last, init, plus<T>());
+}
+
+// Scans each chunk, starting from the combination of all elements before it (m_carry). An
+// inclusive scan of the first chunk has no starting value.
+template <class RandomAccessIterator, class OutputIterator, class T, class BinaryOperation> struct __parallel_scan_body
+{
+    RandomAccessIterator m_first;
+    OutputIterator m_result;
+    BinaryOperation m_op;
+    const vector<T>* m_carry;
+    bool m_inclusive;
+
+    __parallel_scan_body(RandomAccessIterator first, OutputIterator result, BinaryOperation op, const vector<T>* carry, bool inclusive) :
+        m_first(first), m_result(result), m_op(op), m_carry(carry), m_inclusive(inclusive) {}
+
+    void operator () (size_type chunk, thor_diff_type begin, thor_diff_type end) const
+    {
+        BinaryOperation op(m_op);
+        RandomAccessIterator i = m_first + begin;
+        const RandomAccessIterator e = m_first + end;
+        OutputIterator out = m_result + begin;
+        if (m_inclusive)
+        {
+            T total(chunk == 0 ? T(*i) : op((*m_carry)[chunk], *i));
+            *out = total;
+            for (++i, ++out; i != e; ++i, ++out)
+            {
+                total = op(total, *i);
+                *out = total;
+            }
+        }
+        else
+        {
+            // Each element is read before its output is written, so result may be first
+            T total((*m_carry)[chunk]);
+            for (; i != e; ++i, ++out)
+            {
+                T next(op(total, *i));
+                *out = total;
+                total = next;
+            }
+        }
+    }
+};
+
+template <class JobQueue, class RandomAccessIterator, class OutputIterator, class T, class BinaryOperation>
+OutputIterator __parallel_scan(JobQueue& queue, RandomAccessIterator first, RandomAccessIterator last, OutputIterator result, const T& init, BinaryOperation op, bool inclusive)
+{
+    if (first == last)
+    {
+        return result;
+    }
+    const __parallel_chunks chunks(queue, last - first, sizeof(*THOR_GET_VALUE_TYPE(first, RandomAccessIterator)));
+    vector<T> carry;
+    carry.resize(chunks.count(), init);
+    if (chunks.count() > 1)
+    {
+        vector<T> totals;
+        __parallel_chunk_totals(queue, chunks, first, op, totals);
+        carry[1] = inclusive ? totals[0] : op(init, totals[0]);
+        for (size_type i = 2; i < carry.size(); ++i)
+        {
+            carry[i] = op(carry[i - 1], totals[i - 1]);
+        }
+    }
+    __parallel_for_chunks(queue, chunks, __parallel_scan_body<RandomAccessIterator, OutputIterator, T, BinaryOperation>(first, result, op, &carry, inclusive));
+    return result + (last - first);
+}
+
+template <class JobQueue, class RandomAccessIterator, class OutputIterator, class BinaryOperation>
+OutputIterator parallel_inclusive_scan(JobQueue& queue, RandomAccessIterator first, RandomAccessIterator last, OutputIterator result, BinaryOperation op)
+{
+    typedef typename iterator_traits<RandomAccessIterator>::value_type T;
+    return first == last ? result : __parallel_scan(queue, first, last, result, T(*first), op, true);
+}
+
+template <class JobQueue, class RandomAccessIterator, class OutputIterator>
+OutputIterator parallel_inclusive_scan(JobQueue& queue, RandomAccessIterator first, RandomAccessIterator last, OutputIterator result)
+{
+    typedef typename iterator_traits<RandomAccessIterator>::value_type T;
+    return parallel_inclusive_scan(queue, first, last, result, plus<T>());
+}
+
+template <class JobQueue, class RandomAccessIterator, class OutputIterator, class T, class BinaryOperation>
+OutputIterator parallel_exclusive_scan(JobQueue& queue, RandomAccessIterator first, RandomAccessIterator last, OutputIterator result, T init, BinaryOperation op)
+{
+    return __parallel_scan(queue, first, last, result, init, op, false);
+}
+
+template <class JobQueue, class RandomAccessIterator, class OutputIterator, class T>
+OutputIterator parallel_exclusive_scan(JobQueue& queue, RandomAccessIterator first, RandomAccessIterator last, OutputIterator result, T init)
+{
+    return __parallel_scan(queue, first, last, result, init, plus<T>(), false);
+}
+
+template <class RandomAccessIterator, class Predicate> struct __parallel_count_if_body
+{
+    RandomAccessIterator m_first;
+    Predicate m_pred;
+    vector<thor_diff_type>* m_counts;
+
+    __parallel_count_if_body(RandomAccessIterator first, Predicate pred, vector<thor_diff_type>* counts) :
+        m_first(first), m_pred(pred), m_counts(counts) {}
+
+    void operator () (size_type chunk, thor_diff_type begin, thor_diff_type end) const
+    {
+        (*m_counts)[chunk] = thor::count_if(m_first + begin, m_first + end, Predicate(m_pred));
+    }
+};
+
+template <class RandomAccessIterator, class T> struct __parallel_count_body
+{
+    RandomAccessIterator m_first;
+    const T* m_value;
+    vector<thor_diff_type>* m_counts;
+
+    __parallel_count_body(RandomAccessIterator first, const T* value, vector<thor_diff_type>* counts) :
+        m_first(first), m_value(value), m_counts(counts) {}
+
+    void operator () (size_type chunk, thor_diff_type begin, thor_diff_type end) const
+    {
+        (*m_counts)[chunk] = thor::count(m_first + begin, m_first + end, *m_value);
+    }
+};
+
+template <class JobQueue, class Body>
+thor_diff_type __parallel_count(JobQueue& queue, const __parallel_chunks& chunks, const Body& body, vector<thor_diff_type>& counts)
+{
+    __parallel_for_chunks(queue, chunks, body);
+    thor_diff_type total = 0;
+    for (size_type i = 0; i != counts.size(); ++i)
+    {
+        total += counts[i];
+    }
+    return total;
+}
+
+template <class JobQueue, class RandomAccessIterator, class Predicate>
+thor_diff_type parallel_count_if(JobQueue& queue, RandomAccessIterator first, RandomAccessIterator last, Predicate pred)
+{
+    const __parallel_chunks chunks(queue, last - first, sizeof(*THOR_GET_VALUE_TYPE(first, RandomAccessIterator)));
+    vector<thor_diff_type> counts(chunks.count(), 0);
+    return __parallel_count(queue, chunks, __parallel_count_if_body<RandomAccessIterator, Predicate>(first, pred, &counts), counts);
+}
+
+template <class JobQueue, class RandomAccessIterator, class T>
+thor_diff_type parallel_count(JobQueue& queue, RandomAccessIterator first, RandomAccessIterator last, const T& value)
+{
+    const __parallel_chunks chunks(queue, last - first, sizeof(*THOR_GET_VALUE_TYPE(first, RandomAccessIterator)));
+    vector<thor_diff_type> counts(chunks.count(), 0);
+    return __parallel_count(queue, chunks, __parallel_count_body<RandomAccessIterator, T>(first, &value, &counts), counts);
+}
+
+// Copies the selected elements of each chunk to the output position given by the counts of the chunks before it
+template <class RandomAccessIterator, class OutputIterator, class Predicate> struct __parallel_copy_if_body
+{
+    RandomAccessIterator m_first;
+    OutputIterator m_result;
+    Predicate m_pred;
+    const vector<thor_diff_type>* m_offsets;
+
+    __parallel_copy_if_body(RandomAccessIterator first, OutputIterator result, Predicate pred, const vector<thor_diff_type>* offsets) :
+        m_first(first), m_result(result), m_pred(pred), m_offsets(offsets) {}
+
+    void operator () (size_type chunk, thor_diff_type begin, thor_diff_type end) const
+    {
+        Predicate pred(m_pred);
+        OutputIterator out = m_result + (*m_offsets)[chunk];
+        for (RandomAccessIterator i = m_first + begin, e = m_first + end; i != e; ++i)
+        {
+            if (pred(*i))
+            {
+                *out = *i;
+                ++out;
+            }
+        }
+    }
+};
+
+template <class JobQueue, class RandomAccessIterator, class OutputIterator, class Predicate>
+OutputIterator parallel_copy_if(JobQueue& queue, RandomAccessIterator first, RandomAccessIterator last, OutputIterator result, Predicate pred)
+{
+    const __parallel_chunks chunks(queue, last - first, sizeof(*THOR_GET_VALUE_TYPE(first, RandomAccessIterator)));
+    if (chunks.count() <= 1)
+    {
+        for (; first != last; ++first)
+        {
+            if (pred(*first))
+            {
+                *result = *first;
+                ++result;
+            }
+        }
+        return result;
+    }
+
+    vector<thor_diff_type> offsets(chunks.count() + 1, 0);
+    __parallel_for_chunks(queue, chunks, __parallel_count_if_body<RandomAccessIterator, Predicate>(first, pred, &offsets));
+
+    // Exclusive scan of the counts, with the total at the end
+    thor_diff_type total = 0;
+    for (size_type i = 0; i != offsets.size(); ++i)
+    {
+        const thor_diff_type count = offsets[i];
+        offsets[i] = total;
+        total += count;
+    }
+    __parallel_for_chunks(queue, chunks, __parallel_copy_if_body<RandomAccessIterator, OutputIterator, Predicate>(first, result, pred, &offsets));
+    return result + total;
+}
+
+}; // namespace thor
+
+#endif
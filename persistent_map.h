@@ -0,0 +1,472 @@
+/* THOR - THOR Template Library
+ * Joshua M. Kriegshauser
+ *
+ * persistent_map.h
+ *
+ * This file defines persistent_map, an immutable ordered associative container. Updating a
+ * persistent_map does not change it; instead a new map is returned that shares all unchanged nodes
+ * with the original (path copying). Each persistent_map is therefore a consistent snapshot that can
+ * be read without locks while newer versions are being created.
+ *
+ * Changes/Extensions (compared with map):
+ * - All update functions are const and return the updated map:
+ *   * set(key, value) returns a map with key mapped to value, replacing any existing value.
+ *   * insert(value_type) returns a map with the value inserted if the key did not already exist.
+ *   * erase(key) returns a map without key.
+ *   Example: current = current.set(k, v);
+ * - Copying and assigning are constant time; only a reference count is adjusted.
+ * - Only const forward iteration is supported. Iterators remain valid as long as the
+ *   persistent_map (or any copy of it) that they were obtained from exists.
+ * - lookup() returns a pointer to the value for a key, or null if the key is not found.
+ * - Nodes are reference counted with T_REFCOUNT_POLICY (see ref_counted.h). With the default
+ *   thread-safe policy, maps and their copies may be read, copied and destroyed concurrently from
+ *   multiple threads. A single persistent_map variable that is being assigned by one thread must
+ *   still be protected while another thread copies it, but only for the constant time copy:
+ *     Writer:  new_version = snapshot().set(k, v); lock; shared = new_version; unlock;
+ *     Readers: lock; persistent_map local(shared); unlock; ...read local without a lock...
+ *
+ * persistent_map - Persistent ordered associative container (a path-copying AVL tree)
+ *   Time:
+ *     set/insert/erase - logarithmic; allocates a logarithmic number of nodes
+ *     find/lookup      - logarithmic
+ *     copy             - constant
+ *     iteration        - amortized constant per element
+ *   Usage suggestions:
+ *     Use for read-mostly data that must be published as consistent snapshots, instead of copying
+ *     an entire map under a lock.
+ */
+
+#ifndef THOR_PERSISTENT_MAP_H
+#define THOR_PERSISTENT_MAP_H
+#pragma once
+
+#ifndef THOR_REF_COUNTED_H
+#include "ref_counted.h"
+#endif
+
+#ifndef THOR_PAIR_H
+#include "pair.h"
+#endif
+
+#ifndef THOR_ITERATOR_H
+#include "iterator.h"
+#endif
+
+#ifndef THOR_ALGORITHM_H
+#include "algorithm.h"
+#endif
+
+#ifndef THOR_FUNCTION_H
+#include "function.h"
+#endif
+
+#ifndef THOR_SWAP_H
+#include "swap.h"
+#endif
+
+namespace thor
+{
+
+template
+<
+    class Key,
+    class Value,
+    class Compare = less<Key>,
+    class T_REFCOUNT_POLICY = policy::thread_safe_ref_count
+> class persistent_map
+{
+public:
+    typedef Key key_type;
+    typedef Value data_type;
+    typedef pair<const Key, Value> value_type;
+    typedef Compare key_compare;
+    typedef const value_type* const_pointer;
+    typedef const value_type& const_reference;
+    typedef thor_size_type size_type;
+    typedef thor_diff_type difference_type;
+
+    enum
+    {
+        // An AVL tree of height 64 has at least 2^44 nodes, so the path to any node fits.
+        max_height = 64,
+    };
+
+private:
+    struct node;
+    typedef ref_pointer<node> node_ptr;
+
+    // Nodes are never changed once they are shared
+    struct node : public ref_counted<T_REFCOUNT_POLICY>
+    {
+        node_ptr    left;
+        node_ptr    right;
+        size_type   height;
+        value_type  value;
+
+        node(const value_type& v, const node_ptr& l, const node_ptr& r) :
+            left(l),
+            right(r),
+            height(_max(height_of(l), height_of(r)) + 1),
+            value(v)
+        {}
+    };
+
+public:
+    // Visits the nodes in order, keeping the nodes whose right subtrees remain on a stack.
+    class const_iterator : public iterator_type<forward_iterator_tag, value_type>
+    {
+        friend class persistent_map;
+    public:
+        typedef const value_type* pointer;
+        typedef const value_type& reference;
+
+        const_iterator() : m_depth(0) {}
+
+        reference operator * () const           { THOR_DEBUG_ASSERT(m_depth != 0); return m_stack[m_depth - 1]->value; }
+        pointer   operator -> () const          { return &(operator*()); }
+        const_iterator& operator ++ ()          { incr(); return *this; }
+        const_iterator  operator ++ (int)       { const_iterator n(*this); incr(); return n; }
+
+        bool operator == (const const_iterator& i) const { return top() == i.top(); }
+        bool operator != (const const_iterator& i) const { return top() != i.top(); }
+
+    private:
+        const node* m_stack[max_height];
+        size_type   m_depth;
+
+        const node* top() const { return m_depth != 0 ? m_stack[m_depth - 1] : 0; }
+
+        void push(const node* n)
+        {
+            THOR_DEBUG_ASSERT(m_depth < size_type(max_height));
+            m_stack[m_depth++] = n;
+        }
+
+        void push_left(const node* n)
+        {
+            for (; n != 0; n = n->left.get())
+            {
+                push(n);
+            }
+        }
+
+        void incr()
+        {
+            THOR_DEBUG_ASSERT(m_depth != 0);
+            const node* n = m_stack[--m_depth];
+            push_left(n->right.get());
+        }
+    };
+    typedef const_iterator iterator;
+
+    // constructors
+    persistent_map()
+    {}
+
+    persistent_map(const key_compare& comp) :
+        m_root(comp)
+    {}
+
+    template <class InputIterator> persistent_map(InputIterator first, InputIterator last)
+    {
+        for (; first != last; ++first)
+        {
+            internal_insert(*first, false);
+        }
+    }
+
+    persistent_map(const persistent_map& m) :
+        m_root(m.m_root)
+    {}
+
+    ~persistent_map()
+    {}
+
+    persistent_map& operator = (const persistent_map& m)
+    {
+        m_root = m.m_root;
+        return *this;
+    }
+
+    // Iteration
+    const_iterator begin() const
+    {
+        const_iterator iter;
+        iter.push_left(m_root.m_node.get());
+        return iter;
+    }
+
+    const_iterator end() const
+    {
+        return const_iterator();
+    }
+
+    // Size
+    bool empty() const                              { return m_root.m_size == 0; }
+    size_type size() const                          { return m_root.m_size; }
+    size_type max_size() const                      { return size_type(-1); }
+
+    const key_compare& key_comp() const             { return m_root; }
+
+    void swap(persistent_map& m)                    { thor::swap(m_root, m.m_root); }
+
+    // Releases this version's references; other versions are unaffected.
+    void clear()
+    {
+        m_root.m_node = node_ptr();
+        m_root.m_size = 0;
+    }
+
+    // Updates; these return a new map and do not change this one.
+    persistent_map set(const key_type& k, const data_type& d) const
+    {
+        persistent_map m(*this);
+        m.internal_insert(value_type(k, d), true);
+        return m;
+    }
+
+    persistent_map insert(const value_type& v) const
+    {
+        persistent_map m(*this);
+        m.internal_insert(v, false);
+        return m;
+    }
+
+    persistent_map erase(const key_type& k) const
+    {
+        persistent_map m(*this);
+        bool removed = false;
+        node_ptr newroot(m.erase_from(m.m_root.m_node.get(), k, removed));
+        if (removed)
+        {
+            m.m_root.m_node = newroot;
+            --m.m_root.m_size;
+        }
+        return m;
+    }
+
+    // Searching
+    const data_type* lookup(const key_type& k) const
+    {
+        const node* n = find_node(k);
+        return n != 0 ? &n->value.second : 0;
+    }
+
+    const_iterator find(const key_type& k) const
+    {
+        const_iterator iter(lower_bound(k));
+        if (iter != end() && key_comp()(k, iter->first))
+        {
+            return end();
+        }
+        return iter;
+    }
+
+    size_type count(const key_type& k) const        { return find_node(k) != 0 ? 1 : 0; }
+
+    const_iterator lower_bound(const key_type& k) const
+    {
+        const_iterator iter;
+        for (const node* n = m_root.m_node.get(); n != 0; )
+        {
+            if (!key_comp()(n->value.first, k))
+            {
+                iter.push(n);
+                n = n->left.get();
+            }
+            else
+            {
+                n = n->right.get();
+            }
+        }
+        return iter;
+    }
+
+    const_iterator upper_bound(const key_type& k) const
+    {
+        const_iterator iter;
+        for (const node* n = m_root.m_node.get(); n != 0; )
+        {
+            if (key_comp()(k, n->value.first))
+            {
+                iter.push(n);
+                n = n->left.get();
+            }
+            else
+            {
+                n = n->right.get();
+            }
+        }
+        return iter;
+    }
+
+    pair<const_iterator,const_iterator> equal_range(const key_type& k) const
+    {
+        return pair<const_iterator,const_iterator>(lower_bound(k), upper_bound(k));
+    }
+
+    // Returns true if both maps are the same version (or copies of it). Versions that are not
+    // shared may still have equal contents.
+    bool shares_root(const persistent_map& m) const
+    {
+        return m_root.m_node.get() == m.m_root.m_node.get();
+    }
+
+private:
+    // Use empty member optimization since key_compare is likely going to be an empty class.
+    struct empty_member_opt : public key_compare
+    {
+        node_ptr    m_node;
+        size_type   m_size;
+
+        empty_member_opt() : key_compare(), m_size(0) {}
+        empty_member_opt(const key_compare& k) : key_compare(k), m_size(0) {}
+    };
+
+    empty_member_opt m_root;
+
+    static size_type height_of(const node_ptr& n)
+    {
+        return n.get() != 0 ? n->height : 0;
+    }
+
+    static node_ptr make_node(const value_type& v, const node_ptr& l, const node_ptr& r)
+    {
+        return node_ptr(new node(v, l, r));
+    }
+
+    // Creates a node for v with the given subtrees, rotating if their heights differ by more
+    // than one. At most two new nodes are created in addition to the node for v.
+    static node_ptr balance(const value_type& v, const node_ptr& l, const node_ptr& r)
+    {
+        const size_type hl = height_of(l);
+        const size_type hr = height_of(r);
+        if (hl > hr + 1)
+        {
+            if (height_of(l->left) >= height_of(l->right))
+            {
+                return make_node(l->value, l->left, make_node(v, l->right, r));
+            }
+            const node* lr = l->right.get();
+            return make_node(lr->value, make_node(l->value, l->left, lr->left), make_node(v, lr->right, r));
+        }
+        if (hr > hl + 1)
+        {
+            if (height_of(r->right) >= height_of(r->left))
+            {
+                return make_node(r->value, make_node(v, l, r->left), r->right);
+            }
+            const node* rl = r->left.get();
+            return make_node(rl->value, make_node(v, l, rl->left), make_node(r->value, rl->right, r->right));
+        }
+        return make_node(v, l, r);
+    }
+
+    const node* find_node(const key_type& k) const
+    {
+        const node* n = m_root.m_node.get();
+        while (n != 0)
+        {
+            if (key_comp()(k, n->value.first))
+            {
+                n = n->left.get();
+            }
+            else if (key_comp()(n->value.first, k))
+            {
+                n = n->right.get();
+            }
+            else
+            {
+                break;
+            }
+        }
+        return n;
+    }
+
+    void internal_insert(const value_type& v, bool replace)
+    {
+        bool added = false;
+        node_ptr newroot(insert_into(m_root.m_node.get(), v, replace, added));
+        m_root.m_node = newroot;
+        if (added)
+        {
+            ++m_root.m_size;
+        }
+    }
+
+    // Returns the new subtree, which is n itself if nothing changed
+    node_ptr insert_into(node* n, const value_type& v, bool replace, bool& added) const
+    {
+        if (n == 0)
+        {
+            added = true;
+            return make_node(v, node_ptr(), node_ptr());
+        }
+        if (key_comp()(v.first, n->value.first))
+        {
+            node_ptr l(insert_into(n->left.get(), v, replace, added));
+            return l.get() == n->left.get() ? node_ptr(n) : balance(n->value, l, n->right);
+        }
+        if (key_comp()(n->value.first, v.first))
+        {
+            node_ptr r(insert_into(n->right.get(), v, replace, added));
+            return r.get() == n->right.get() ? node_ptr(n) : balance(n->value, n->left, r);
+        }
+        return replace ? make_node(v, n->left, n->right) : node_ptr(n);
+    }
+
+    node_ptr erase_from(node* n, const key_type& k, bool& removed) const
+    {
+        if (n == 0)
+        {
+            return node_ptr();
+        }
+        if (key_comp()(k, n->value.first))
+        {
+            node_ptr l(erase_from(n->left.get(), k, removed));
+            return !removed ? node_ptr(n) : balance(n->value, l, n->right);
+        }
+        if (key_comp()(n->value.first, k))
+        {
+            node_ptr r(erase_from(n->right.get(), k, removed));
+            return !removed ? node_ptr(n) : balance(n->value, n->left, r);
+        }
+        removed = true;
+        if (n->left.get() == 0)
+        {
+            return n->right;
+        }
+        if (n->right.get() == 0)
+        {
+            return n->left;
+        }
+        // Replace with the smallest value in the right subtree
+        const node* successor = n->right.get();
+        while (successor->left.get() != 0)
+        {
+            successor = successor->left.get();
+        }
+        return balance(successor->value, n->left, erase_min(n->right.get()));
+    }
+
+    static node_ptr erase_min(node* n)
+    {
+        if (n->left.get() == 0)
+        {
+            return n->right;
+        }
+        return balance(n->value, erase_min(n->left.get()), n->right);
+    }
+};
+
+// Swap specialization
+template <class Key, class Value, class Compare, class T_REFCOUNT_POLICY>
+void swap(persistent_map<Key, Value, Compare, T_REFCOUNT_POLICY>& lhs, persistent_map<Key, Value, Compare, T_REFCOUNT_POLICY>& rhs)
+{
+    lhs.swap(rhs);
+}
+
+} // namespace thor
+
+#endif
+
@@ -0,0 +1,345 @@
+/* THOR - THOR Template Library
+ * Joshua M. Kriegshauser
+ *
+ * radix_sort.h
+ *
+ * ** THOR INTERNAL FILE - NOT FOR APPLICATION USE **
+ *
+ * This file contains radix sort algorithms for integral, floating-point and other fixed-width keys.
+ * It is included by algorithm.h.
+ *
+ * radix_sort(first, last)               - LSD radix sort of arithmetic values. Stable; uses a
+ *                                         temporary buffer the size of the range.
+ * radix_sort(first, last, key)          - As above, sorting by key(value). KeyExtractor must define
+ *                                         result_type (see unary_function), which must be an
+ *                                         arithmetic type (or have a radix_key specialization).
+ * radix_sort_msd(first, last [, key])   - MSD (American flag) radix sort. In-place and not stable.
+ *
+ * Keys are sorted one byte at a time, so sorting n values with k-byte keys is O(n * k). Bytes that
+ * are the same for every key (such as the high bytes of ids and timestamps) are skipped. The LSD sort
+ * is fastest for 32-bit keys and for wider keys with few varying bytes. The MSD sort also stops
+ * descending once a bucket is small, so it suits 64-bit keys where every byte varies.
+ *
+ * Signed integers and floating-point values are mapped to unsigned integers with the same order
+ * by radix_key<T>. Floating-point NaN values sort before or after all other values depending on
+ * their sign bit.
+ */
+
+#ifndef THOR_RADIX_SORT_H
+#define THOR_RADIX_SORT_H
+#pragma once
+
+#ifndef THOR_SORT_H
+#include "sort.h"
+#endif
+
+#ifndef THOR_TEMPORARY_BUFFER_H
+#include "temporary_buffer.h"
+#endif
+
+namespace thor
+{
+
+template <int size> struct __radix_unsigned;
+template <> struct __radix_unsigned<1> { typedef uint8  type; };
+template <> struct __radix_unsigned<2> { typedef uint16 type; };
+template <> struct __radix_unsigned<4> { typedef uint32 type; };
+template <> struct __radix_unsigned<8> { typedef uint64 type; };
+
+// Identifies the types that the default radix_key accepts
+template <class T> struct __radix_integral { enum { value = 0 }; };
+#define THOR_RADIX_INTEGRAL(T) template <> struct __radix_integral<T> { enum { value = 1 }; }
+THOR_RADIX_INTEGRAL(bool);
+THOR_RADIX_INTEGRAL(char);
+THOR_RADIX_INTEGRAL(signed char);
+THOR_RADIX_INTEGRAL(unsigned char);
+THOR_RADIX_INTEGRAL(short);
+THOR_RADIX_INTEGRAL(unsigned short);
+THOR_RADIX_INTEGRAL(int);
+THOR_RADIX_INTEGRAL(unsigned int);
+THOR_RADIX_INTEGRAL(long);
+THOR_RADIX_INTEGRAL(unsigned long);
+THOR_RADIX_INTEGRAL(long long);
+THOR_RADIX_INTEGRAL(unsigned long long);
+#ifdef _NATIVE_WCHAR_T_DEFINED
+THOR_RADIX_INTEGRAL(wchar_t);
+#endif
+#undef THOR_RADIX_INTEGRAL
+
+// Maps a key to an unsigned integer (key_type) that has the same ordering. This default is for
+// integral types: the sign bit of signed types is flipped so that negative values sort first.
+// Other key types (such as long double, which would be truncated) must specialize radix_key.
+template <class T> struct radix_key
+{
+    THOR_COMPILETIME_ASSERT(__radix_integral<T>::value, radix_key_requires_an_integral_type_or_a_specialization);
+
+    typedef typename __radix_unsigned<sizeof(T)>::type key_type;
+
+    static key_type get(T t)
+    {
+        return key_type(key_type(t) ^ sign_mask());
+    }
+
+private:
+    static key_type sign_mask()
+    {
+        return (T(-1) < T(0)) ? key_type(key_type(1) << (sizeof(T) * 8 - 1)) : key_type(0);
+    }
+};
+
+// Floating-point: negative values have all bits flipped; positive values have the sign bit set.
+template <> struct radix_key<float>
+{
+    typedef uint32 key_type;
+
+    static key_type get(float f)
+    {
+        key_type k;
+        memcpy(&k, &f, sizeof(k));
+        return (k & 0x80000000) ? ~k : (k | 0x80000000);
+    }
+};
+
+template <> struct radix_key<double>
+{
+    typedef uint64 key_type;
+
+    static key_type get(double d)
+    {
+        key_type k;
+        memcpy(&k, &d, sizeof(k));
+        const key_type sign = key_type(1) << 63;
+        return (k & sign) ? ~k : (k | sign);
+    }
+};
+
+template <class T> struct __radix_identity
+{
+    typedef T result_type;
+    const T& operator () (const T& t) const { return t; }
+};
+
+template <class KeyExtractor> struct __radix_key_less
+{
+    typedef radix_key<typename KeyExtractor::result_type> key_traits;
+    KeyExtractor m_extract;
+
+    __radix_key_less(const KeyExtractor& extract) : m_extract(extract) {}
+
+    template <class T> bool operator () (const T& lhs, const T& rhs) const
+    {
+        return key_traits::get(m_extract(lhs)) < key_traits::get(m_extract(rhs));
+    }
+};
+
+enum
+{
+    __radix_insertion_threshold = 64,       // Ranges smaller than this are insertion sorted
+    __radix_buckets = 256,                  // One byte per pass
+};
+
+// Moves each value of [first, last) to its bucket in result for the byte at shift
+template <class InputIterator, class OutputIterator, class KeyExtractor>
+void __radix_scatter(InputIterator first, InputIterator last, OutputIterator result, KeyExtractor extract, thor_size_type* offsets, int shift)
+{
+    typedef radix_key<typename KeyExtractor::result_type> key_traits;
+    for (; first != last; ++first)
+    {
+        const thor_size_type digit = thor_size_type((key_traits::get(extract(*first)) >> shift) & 0xff);
+        *(result + offsets[digit]++) = *first;
+    }
+}
+
+template <class T, class RandomAccessIterator, class KeyExtractor>
+void __radix_sort_lsd(RandomAccessIterator first, RandomAccessIterator last, KeyExtractor extract, T*)
+{
+    typedef radix_key<typename KeyExtractor::result_type> key_traits;
+    typedef typename key_traits::key_type key_type;
+    enum { digits = sizeof(key_type) };
+
+    const thor_size_type n = thor_size_type(last - first);
+    if (n < thor_size_type(__radix_insertion_threshold))
+    {
+        __insertion_sort(first, last, __radix_key_less<KeyExtractor>(extract));
+        return;
+    }
+
+    // Histogram every byte in a single pass
+    thor_size_type counts[digits][__radix_buckets];
+    memset(counts, 0, sizeof(counts));
+    for (RandomAccessIterator iter = first; iter != last; ++iter)
+    {
+        const key_type k = key_traits::get(extract(*iter));
+        for (int d = 0; d != digits; ++d)
+        {
+            ++counts[d][(k >> (d * 8)) & 0xff];
+        }
+    }
+
+    __TemporaryBuffer<RandomAccessIterator, T> buf(first, last);
+    bool in_buffer = false;
+    for (int d = 0; d != digits; ++d)
+    {
+        // Skip bytes that are the same for every key
+        thor_size_type* count = counts[d];
+        thor_size_type offset = 0;
+        bool trivial = false;
+        for (int b = 0; b != __radix_buckets; ++b)
+        {
+            const thor_size_type c = count[b];
+            trivial = trivial || (c == n);
+            count[b] = offset;
+            offset += c;
+        }
+        if (trivial)
+        {
+            continue;
+        }
+
+        if (in_buffer)
+        {
+            __radix_scatter(buf.begin(), buf.end(), first, extract, count, d * 8);
+        }
+        else
+        {
+            __radix_scatter(first, last, buf.begin(), extract, count, d * 8);
+        }
+        in_buffer = !in_buffer;
+    }
+
+    if (in_buffer)
+    {
+        thor::copy(buf.begin(), buf.end(), first);
+    }
+}
+
+template <class T, class RandomAccessIterator, class KeyExtractor>
+void __radix_sort_msd(RandomAccessIterator first, RandomAccessIterator last, KeyExtractor extract, int shift, T*)
+{
+    typedef radix_key<typename KeyExtractor::result_type> key_traits;
+
+    for (;;)
+    {
+        const thor_size_type n = thor_size_type(last - first);
+        if (n < thor_size_type(__radix_insertion_threshold))
+        {
+            __insertion_sort(first, last, __radix_key_less<KeyExtractor>(extract));
+            return;
+        }
+
+        thor_size_type counts[__radix_buckets];
+        memset(counts, 0, sizeof(counts));
+        for (RandomAccessIterator iter = first; iter != last; ++iter)
+        {
+            ++counts[(key_traits::get(extract(*iter)) >> shift) & 0xff];
+        }
+
+        // All keys share this byte; move on to the next without permuting
+        thor_size_type largest = 0;
+        for (int b = 0; b != __radix_buckets; ++b)
+        {
+            largest = counts[b] > largest ? counts[b] : largest;
+        }
+        if (largest == n)
+        {
+            if (shift == 0)
+            {
+                return;
+            }
+            shift -= 8;
+            continue;
+        }
+
+        // Permute in place: each value is swapped directly into the next free slot of its bucket
+        thor_size_type heads[__radix_buckets];
+        thor_size_type tails[__radix_buckets];
+        thor_size_type offset = 0;
+        for (int b = 0; b != __radix_buckets; ++b)
+        {
+            heads[b] = offset;
+            offset += counts[b];
+            tails[b] = offset;
+        }
+        for (int b = 0; b != __radix_buckets; ++b)
+        {
+            while (heads[b] != tails[b])
+            {
+                T value(*(first + heads[b]));
+                thor_size_type digit = thor_size_type((key_traits::get(extract(value)) >> shift) & 0xff);
+                while (digit != thor_size_type(b))
+                {
+                    thor::swap(value, *(first + heads[digit]++));
+                    digit = thor_size_type((key_traits::get(extract(value)) >> shift) & 0xff);
+                }
+                *(first + heads[b]++) = value;
+            }
+        }
+
+        if (shift == 0)
+        {
+            return;
+        }
+        offset = 0;
+        for (int b = 0; b != __radix_buckets; ++b)
+        {
+            if (counts[b] > 1)
+            {
+                __radix_sort_msd(first + offset, first + (offset + counts[b]), extract, shift - 8, (T*)0);
+            }
+            offset += counts[b];
+        }
+        return;
+    }
+}
+
+template <class T, class RandomAccessIterator, class KeyExtractor>
+inline void __radix_sort_msd_start(RandomAccessIterator first, RandomAccessIterator last, KeyExtractor extract, T*)
+{
+    typedef typename radix_key<typename KeyExtractor::result_type>::key_type key_type;
+    __radix_sort_msd(first, last, extract, int(sizeof(key_type) - 1) * 8, (T*)0);
+}
+
+template <class T> __radix_identity<T> __radix_identity_factory(T*)
+{
+    return __radix_identity<T>();
+}
+
+template <class RandomAccessIterator>
+void radix_sort(RandomAccessIterator first, RandomAccessIterator last)
+{
+    if (first != last)
+    {
+        __radix_sort_lsd(first, last, __radix_identity_factory(THOR_GET_VALUE_TYPE(first, RandomAccessIterator)), THOR_GET_VALUE_TYPE(first, RandomAccessIterator));
+    }
+}
+
+template <class RandomAccessIterator, class KeyExtractor>
+void radix_sort(RandomAccessIterator first, RandomAccessIterator last, KeyExtractor key)
+{
+    if (first != last)
+    {
+        __radix_sort_lsd(first, last, key, THOR_GET_VALUE_TYPE(first, RandomAccessIterator));
+    }
+}
+
+template <class RandomAccessIterator>
+void radix_sort_msd(RandomAccessIterator first, RandomAccessIterator last)
+{
+    if (first != last)
+    {
+        __radix_sort_msd_start(first, last, __radix_identity_factory(THOR_GET_VALUE_TYPE(first, RandomAccessIterator)), THOR_GET_VALUE_TYPE(first, RandomAccessIterator));
+    }
+}
+
+template <class RandomAccessIterator, class KeyExtractor>
+void radix_sort_msd(RandomAccessIterator first, RandomAccessIterator last, KeyExtractor key)
+{
+    if (first != last)
+    {
+        __radix_sort_msd_start(first, last, key, THOR_GET_VALUE_TYPE(first, RandomAccessIterator));
+    }
+}
+
+}; // namespace thor
+
+#endif
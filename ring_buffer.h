@@ -0,0 +1,532 @@
+/* THOR - THOR Template Library
+ * Joshua M. Kriegshauser
+ *
+ * ring_buffer.h
+ *
+ * This file defines a fixed-capacity circular buffer (ring buffer) container.
+ *
+ * Elements are kept in a single contiguous array whose size is a power of two, so indexing is an add
+ * and a mask. Pushing or popping at either end never allocates or moves other elements.
+ *
+ * Extensions/Changes:
+ * - The capacity is fixed when the ring_buffer is constructed:
+ *   * ring_buffer<T, N> has a compile-time capacity of N, which must be a power of two.
+ *   * ring_buffer<T> takes the capacity as a constructor parameter and rounds it up to a power of
+ *     two (at least 1). capacity() returns the rounded value.
+ * - Storage is allocated once by the constructor with memory::align_alloc. Elements are only
+ *   constructed as they are pushed, so T need not be default-constructible.
+ * - Pushing to a full ring_buffer is normally an error. If overwrite mode is enabled (by the
+ *   constructor or set_overwrite()), push_back() instead destroys the front element to make room,
+ *   and push_front() destroys the back element. This makes a bounded sliding window.
+ * - get_spans() returns the elements as at most two contiguous arrays, for bulk copy-out. Pair with
+ *   pop_front(n) to consume the elements that were copied.
+ * - push_back() and push_front() are like deque:
+ *   * They return a reference to the added item
+ *   * With zero parameters they will default-construct an element
+ *   * Variations exist with 1-4 parameters that will in-place construct an element without
+ *     necessarily needing a copy constructor.
+ *   * push_back_placement() and push_front_placement() can be used with placement new to construct
+ *     elements with more than 4 parameters.
+ * - There is no insert() or erase(); elements are only added and removed at the ends.
+ * - Any push or pop invalidates all iterators.
+ *
+ * ring_buffer
+ *   Time:
+ *     push_back/push_front, pop_back/pop_front, operator[] - constant
+ *     pop_front(n)/pop_back(n), clear - constant for POD types; linear in n otherwise
+ *   Memory: capacity() elements, allocated by the constructor.
+ *   Usage suggestions:
+ *     Prefer over deque for queues and sliding windows with a known maximum size. deque allocates
+ *     blocks as it grows and finds an element through its block.
+ */
+
+#ifndef THOR_RING_BUFFER_H
+#define THOR_RING_BUFFER_H
+#pragma once
+
+#ifndef THOR_BASETYPES_H
+#include "basetypes.h"
+#endif
+
+#ifndef THOR_ITERATOR_H
+#include "iterator.h"
+#endif
+
+#ifndef THOR_TYPETRAITS_H
+#include "typetraits.h"
+#endif
+
+#ifndef THOR_MEMORY_H
+#include "memory.h"
+#endif
+
+#ifndef THOR_ALGORITHM_H
+#include "algorithm.h"
+#endif
+
+namespace thor
+{
+
+// The capacity of a ring_buffer, as a compile-time constant or (for T_CAPACITY == 0) a member
+template <size_type T_CAPACITY> class __ring_buffer_capacity
+{
+    THOR_COMPILETIME_ASSERT((T_CAPACITY & (T_CAPACITY - 1)) == 0, RingBufferCapacityMustBePowerOfTwo);
+public:
+    explicit __ring_buffer_capacity(size_type capacity) { THOR_UNUSED(capacity); THOR_DEBUG_ASSERT(capacity == T_CAPACITY); }
+    size_type capacity() const { return T_CAPACITY; }
+    void swap(__ring_buffer_capacity&) {}
+};
+
+template <> class __ring_buffer_capacity<0>
+{
+public:
+    explicit __ring_buffer_capacity(size_type capacity) : m_capacity(1)
+    {
+        while (m_capacity < capacity)
+        {
+            m_capacity <<= 1;
+        }
+    }
+    size_type capacity() const { return m_capacity; }
+    void swap(__ring_buffer_capacity& rhs) { thor::swap(m_capacity, rhs.m_capacity); }
+private:
+    size_type m_capacity;
+};
+
+template <class T, size_type T_CAPACITY = 0> class ring_buffer : private __ring_buffer_capacity<T_CAPACITY>
+{
+    typedef __ring_buffer_capacity<T_CAPACITY> capacity_base;
+public:
+    typedef T           value_type;
+    typedef T*          pointer;
+    typedef T&          reference;
+    typedef const T*    const_pointer;
+    typedef const T&    const_reference;
+    typedef thor_size_type size_type;
+    typedef thor_diff_type difference_type;
+
+    // iterator definitions
+    // An iterator is a position in the storage that is not wrapped to the capacity. Positions are
+    // compared and subtracted as signed differences, so they remain ordered across the wrap point.
+    struct iterator_base : public iterator_type<random_access_iterator_tag, T>
+    {
+        T*          m_elements;
+        size_type   m_mask;
+        size_type   m_pos;
+#ifdef THOR_DEBUG
+        const ring_buffer* m_owner;
+        iterator_base(T* e, size_type m, size_type p, const ring_buffer* o) : m_elements(e), m_mask(m), m_pos(p), m_owner(o) {}
+        void verify_iterator() const    { m_owner->verify_iterator(*this); }
+#else
+        iterator_base(T* e, size_type m, size_type p, const ring_buffer*) : m_elements(e), m_mask(m), m_pos(p) {}
+        void verify_iterator() const    {}
+#endif
+        T* value() const                { verify_iterator(); return m_elements + (m_pos & m_mask); }
+        difference_type diff(const iterator_base& rhs) const
+        {
+            THOR_DEBUG_ASSERT(m_owner == rhs.m_owner);
+            return difference_type(m_pos - rhs.m_pos);
+        }
+
+        bool operator == (const iterator_base& i) const { return diff(i) == 0; }
+        bool operator != (const iterator_base& i) const { return diff(i) != 0; }
+    };
+
+    template<class Traits> class fwd_iterator : public iterator_base
+    {
+    public:
+        typedef typename Traits::pointer pointer;
+        typedef typename Traits::reference reference;
+        typedef fwd_iterator<nonconst_traits<T> > nonconst_iterator;
+        typedef fwd_iterator<Traits> selftype;
+
+        fwd_iterator(T* e = 0, size_type m = 0, size_type p = 0, const ring_buffer* o = 0) : iterator_base(e, m, p, o) {}
+        fwd_iterator(const nonconst_iterator& i) : iterator_base(i) {}
+        selftype&  operator = (const nonconst_iterator& i)  { iterator_base::operator = (i); return *this; }
+        reference  operator * ()  const                     { return *this->value(); }
+        pointer    operator -> () const                     { return this->value(); }
+        reference  operator [] (difference_type i) const    { return *(*this + i); }
+        selftype   operator - (difference_type i) const     { selftype n(*this); n.m_pos -= i; return n; }
+        selftype&  operator -= (difference_type i)          {                    this->m_pos -= i; return *this; }
+        selftype&  operator -- ()     /* --iterator */      {                    --this->m_pos; return *this; }
+        selftype   operator -- (int)  /* iterator-- */      { selftype n(*this); --this->m_pos; return n; }
+        selftype   operator + (difference_type i) const     { selftype n(*this); n.m_pos += i; return n; }
+        selftype&  operator += (difference_type i)          {                    this->m_pos += i; return *this; }
+        selftype&  operator ++ ()     /* ++iterator */      {                    ++this->m_pos; return *this; }
+        selftype   operator ++ (int)  /* iterator++ */      { selftype n(*this); ++this->m_pos; return n; }
+
+        difference_type operator - (const selftype& i) const { return this->diff(i); }
+        bool operator <  (const selftype& i) const          { return this->diff(i) < 0; }
+        bool operator >  (const selftype& i) const          { return this->diff(i) > 0; }
+        bool operator <= (const selftype& i) const          { return this->diff(i) <= 0; }
+        bool operator >= (const selftype& i) const          { return this->diff(i) >= 0; }
+    };
+
+    template<class Traits> class rev_iterator : public iterator_base
+    {
+    public:
+        typedef typename Traits::pointer pointer;
+        typedef typename Traits::reference reference;
+        typedef rev_iterator<nonconst_traits<T> > nonconst_iterator;
+        typedef rev_iterator<Traits> selftype;
+
+        rev_iterator(T* e = 0, size_type m = 0, size_type p = 0, const ring_buffer* o = 0) : iterator_base(e, m, p, o) {}
+        rev_iterator(const nonconst_iterator& i) : iterator_base(i) {}
+        selftype&  operator = (const nonconst_iterator& i)  { iterator_base::operator = (i); return *this; }
+        reference  operator * ()  const                     { return *this->value(); }
+        pointer    operator -> () const                     { return this->value(); }
+        reference  operator [] (difference_type i) const    { return *(*this + i); }
+        selftype   operator - (difference_type i) const     { selftype n(*this); n.m_pos += i; return n; }
+        selftype&  operator -= (difference_type i)          {                    this->m_pos += i; return *this; }
+        selftype&  operator -- ()     /* --iterator */      {                    ++this->m_pos; return *this; }
+        selftype   operator -- (int)  /* iterator-- */      { selftype n(*this); ++this->m_pos; return n; }
+        selftype   operator + (difference_type i) const     { selftype n(*this); n.m_pos -= i; return n; }
+        selftype&  operator += (difference_type i)          {                    this->m_pos -= i; return *this; }
+        selftype&  operator ++ ()     /* ++iterator */      {                    --this->m_pos; return *this; }
+        selftype   operator ++ (int)  /* iterator++ */      { selftype n(*this); --this->m_pos; return n; }
+
+        difference_type operator - (const selftype& i) const { return i.diff(*this); }
+        bool operator <  (const selftype& i) const          { return i.diff(*this) < 0; }
+        bool operator >  (const selftype& i) const          { return i.diff(*this) > 0; }
+        bool operator <= (const selftype& i) const          { return i.diff(*this) <= 0; }
+        bool operator >= (const selftype& i) const          { return i.diff(*this) >= 0; }
+    };
+
+    typedef fwd_iterator<nonconst_traits<T> > iterator;
+    typedef fwd_iterator<const_traits<T>    > const_iterator;
+
+    typedef rev_iterator<nonconst_traits<T> > reverse_iterator;
+    typedef rev_iterator<const_traits<T>    > const_reverse_iterator;
+
+    // constructors
+    explicit ring_buffer(size_type capacity = T_CAPACITY, bool overwrite = false) :
+        capacity_base(capacity),
+        m_elements(memory::align_alloc<T>::alloc(capacity_base::capacity())),
+        m_head(0),
+        m_size(0),
+        m_overwrite(overwrite)
+    {}
+
+    ring_buffer(const ring_buffer& rhs) :
+        capacity_base(rhs),
+        m_elements(memory::align_alloc<T>::alloc(capacity_base::capacity())),
+        m_head(0),
+        m_size(0),
+        m_overwrite(rhs.m_overwrite)
+    {
+        copy_elements(rhs);
+    }
+
+    ~ring_buffer()
+    {
+        clear();
+        memory::align_alloc<T>::free(m_elements);
+    }
+
+    // The capacity and overwrite mode are copied along with the elements
+    ring_buffer& operator = (const ring_buffer& rhs)
+    {
+        if (&rhs != this)
+        {
+            if (rhs.capacity() == capacity())
+            {
+                clear();
+                copy_elements(rhs);
+                m_overwrite = rhs.m_overwrite;
+            }
+            else
+            {
+                ring_buffer(rhs).swap(*this);
+            }
+        }
+        return *this;
+    }
+
+    // iteration
+    iterator begin()                                { return iterator(m_elements, mask(), m_head, this); }
+    const_iterator begin() const                    { return const_iterator(m_elements, mask(), m_head, this); }
+    iterator end()                                  { return iterator(m_elements, mask(), m_head + m_size, this); }
+    const_iterator end() const                      { return const_iterator(m_elements, mask(), m_head + m_size, this); }
+    reverse_iterator rbegin()                       { return reverse_iterator(m_elements, mask(), m_head + m_size - 1, this); }
+    const_reverse_iterator rbegin() const           { return const_reverse_iterator(m_elements, mask(), m_head + m_size - 1, this); }
+    reverse_iterator rend()                         { return reverse_iterator(m_elements, mask(), m_head - 1, this); }
+    const_reverse_iterator rend() const             { return const_reverse_iterator(m_elements, mask(), m_head - 1, this); }
+
+    // size
+    size_type size() const                          { return m_size; }
+    size_type max_size() const                      { return capacity(); }
+    size_type capacity() const                      { return capacity_base::capacity(); }
+    bool empty() const                              { return m_size == 0; }
+    bool full() const                               { return m_size == capacity(); }
+
+    // extension: overwrite mode
+    bool overwrite() const                          { return m_overwrite; }
+    void set_overwrite(bool overwrite)              { m_overwrite = overwrite; }
+
+    // element access
+    T& operator [] (size_type n)                    { return *element(n); }
+    const T& operator [] (size_type n) const        { return *element(n); }
+    T& at(size_type n)                              { return *element(n); }
+    const T& at(size_type n) const                  { return *element(n); }
+    T& front()                                      { return *element(0); }
+    const T& front() const                          { return *element(0); }
+    T& back()                                       { return *element(m_size - 1); }
+    const T& back() const                           { return *element(m_size - 1); }
+
+    // extension: returns the elements in order as [first, first + first_count) followed by
+    // [second, second + second_count). second_count is zero unless the elements wrap around the end
+    // of the storage.
+    void get_spans(T*& first, size_type& first_count, T*& second, size_type& second_count)
+    {
+        first_count = min(m_size, capacity() - m_head);
+        second_count = m_size - first_count;
+        first = m_elements + m_head;
+        second = m_elements;
+    }
+
+    void get_spans(const T*& first, size_type& first_count, const T*& second, size_type& second_count) const
+    {
+        first_count = min(m_size, capacity() - m_head);
+        second_count = m_size - first_count;
+        first = m_elements + m_head;
+        second = m_elements;
+    }
+
+    // element insertion
+    T& push_back()
+    {
+        T* p = internal_push_back();
+        typetraits<T>::construct(p);
+        return *p;
+    }
+    template <class T1> T& push_back(const T1& t1)
+    {
+        T* p = internal_push_back();
+        typetraits<T>::construct(p, t1);
+        return *p;
+    }
+    template <class T1, class T2> T& push_back(const T1& t1, const T2& t2)
+    {
+        T* p = internal_push_back();
+        typetraits<T>::construct(p, t1, t2);
+        return *p;
+    }
+    template <class T1, class T2, class T3> T& push_back(const T1& t1, const T2& t2, const T3& t3)
+    {
+        T* p = internal_push_back();
+        typetraits<T>::construct(p, t1, t2, t3);
+        return *p;
+    }
+    template <class T1, class T2, class T3, class T4> T& push_back(const T1& t1, const T2& t2, const T3& t3, const T4& t4)
+    {
+        T* p = internal_push_back();
+        typetraits<T>::construct(p, t1, t2, t3, t4);
+        return *p;
+    }
+    // Requires use of placement new to construct the item
+    // Example: new (r.push_back_placement()) Value;
+    void* push_back_placement()
+    {
+        return internal_push_back();
+    }
+
+    T& push_front()
+    {
+        T* p = internal_push_front();
+        typetraits<T>::construct(p);
+        return *p;
+    }
+    template <class T1> T& push_front(const T1& t1)
+    {
+        T* p = internal_push_front();
+        typetraits<T>::construct(p, t1);
+        return *p;
+    }
+    template <class T1, class T2> T& push_front(const T1& t1, const T2& t2)
+    {
+        T* p = internal_push_front();
+        typetraits<T>::construct(p, t1, t2);
+        return *p;
+    }
+    template <class T1, class T2, class T3> T& push_front(const T1& t1, const T2& t2, const T3& t3)
+    {
+        T* p = internal_push_front();
+        typetraits<T>::construct(p, t1, t2, t3);
+        return *p;
+    }
+    template <class T1, class T2, class T3, class T4> T& push_front(const T1& t1, const T2& t2, const T3& t3, const T4& t4)
+    {
+        T* p = internal_push_front();
+        typetraits<T>::construct(p, t1, t2, t3, t4);
+        return *p;
+    }
+    // Requires use of placement new to construct the item
+    // Example: new (r.push_front_placement()) Value;
+    void* push_front_placement()
+    {
+        return internal_push_front();
+    }
+
+    // element removal
+    void pop_front()
+    {
+        THOR_DEBUG_ASSERT(!empty());
+        typetraits<T>::destruct(m_elements + m_head);
+        m_head = (m_head + 1) & mask();
+        --m_size;
+    }
+
+    void pop_back()
+    {
+        THOR_DEBUG_ASSERT(!empty());
+        typetraits<T>::destruct(element(m_size - 1));
+        --m_size;
+    }
+
+    // extension: removes the first n elements
+    void pop_front(size_type n)
+    {
+        THOR_DEBUG_ASSERT(n <= m_size);
+        destroy(0, n);
+        m_head = (m_head + n) & mask();
+        m_size -= n;
+    }
+
+    // extension: removes the last n elements
+    void pop_back(size_type n)
+    {
+        THOR_DEBUG_ASSERT(n <= m_size);
+        destroy(m_size - n, n);
+        m_size -= n;
+    }
+
+    void clear()
+    {
+        destroy(0, m_size);
+        m_head = 0;
+        m_size = 0;
+    }
+
+    // The storage is exchanged, so this is constant time
+    void swap(ring_buffer& rhs)
+    {
+        capacity_base::swap(rhs);
+        thor::swap(m_elements, rhs.m_elements);
+        thor::swap(m_head, rhs.m_head);
+        thor::swap(m_size, rhs.m_size);
+        thor::swap(m_overwrite, rhs.m_overwrite);
+    }
+
+private:
+    size_type mask() const                          { return capacity() - 1; }
+
+    T* element(size_type n) const
+    {
+        THOR_DEBUG_ASSERT(n < m_size);
+        return m_elements + ((m_head + n) & mask());
+    }
+
+    void verify_iterator(const iterator_base& b) const
+    {
+        THOR_UNUSED(b);
+        THOR_DEBUG_ASSERT(b.m_owner == this);   // Owner must match
+        THOR_DEBUG_ASSERT(b.m_elements == m_elements);
+        THOR_DEBUG_ASSERT(size_type(b.m_pos - m_head) < m_size); // Must reference an element
+    }
+
+    // Destroys n elements starting at logical index i, which may wrap around the end of the storage
+    void destroy(size_type i, size_type n)
+    {
+        const size_type start = (m_head + i) & mask();
+        const size_type first_count = min(n, capacity() - start);
+        typetraits<T>::range_destruct(m_elements + start, m_elements + start + first_count);
+        typetraits<T>::range_destruct(m_elements, m_elements + (n - first_count));
+    }
+
+    void copy_elements(const ring_buffer& rhs)
+    {
+        THOR_DEBUG_ASSERT(empty() && capacity() == rhs.capacity());
+        // The source is not modified; the pointer typetraits take non-const sources
+        const size_type first_count = min(rhs.m_size, rhs.capacity() - rhs.m_head);
+        typetraits<T>::range_construct(m_elements, m_elements + first_count, rhs.m_elements + rhs.m_head);
+        typetraits<T>::range_construct(m_elements + first_count, m_elements + rhs.m_size, rhs.m_elements);
+        m_head = 0;
+        m_size = rhs.m_size;
+    }
+
+    // When full, the overwritten element is destroyed and its slot is reused
+    T* internal_push_back()
+    {
+        if (full())
+        {
+            THOR_ASSERT(m_overwrite);   // ring_buffer is full
+            T* p = m_elements + m_head;
+            typetraits<T>::destruct(p);
+            m_head = (m_head + 1) & mask();
+            return p;
+        }
+        return m_elements + ((m_head + m_size++) & mask());
+    }
+
+    T* internal_push_front()
+    {
+        m_head = (m_head - 1) & mask();
+        T* p = m_elements + m_head;
+        if (full())
+        {
+            THOR_ASSERT(m_overwrite);   // ring_buffer is full
+            typetraits<T>::destruct(p);
+        }
+        else
+        {
+            ++m_size;
+        }
+        return p;
+    }
+
+    T*          m_elements;
+    size_type   m_head;
+    size_type   m_size;
+    bool        m_overwrite;
+};
+
+// Swap specialization
+template <class T, size_type T_CAPACITY> void swap(ring_buffer<T, T_CAPACITY>& lhs, ring_buffer<T, T_CAPACITY>& rhs)
+{
+    lhs.swap(rhs);
+}
+
+} // namespace thor
+
+// Global operators
+template <class T, thor::size_type T_CAPACITY> bool operator == (const thor::ring_buffer<T, T_CAPACITY>& lhs, const thor::ring_buffer<T, T_CAPACITY>& rhs)
+{
+    return lhs.size() == rhs.size() && thor::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+template <class T, thor::size_type T_CAPACITY> bool operator != (const thor::ring_buffer<T, T_CAPACITY>& lhs, const thor::ring_buffer<T, T_CAPACITY>& rhs)
+{
+    return !(lhs == rhs);
+}
+
+template <class T, thor::size_type T_CAPACITY> bool operator < (const thor::ring_buffer<T, T_CAPACITY>& lhs, const thor::ring_buffer<T, T_CAPACITY>& rhs)
+{
+    return thor::lexicographical_compare(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+}
+
+template <class T, thor::size_type T_CAPACITY> bool operator > (const thor::ring_buffer<T, T_CAPACITY>& lhs, const thor::ring_buffer<T, T_CAPACITY>& rhs)
+{
+    return rhs < lhs;
+}
+
+template <class T, thor::size_type T_CAPACITY> bool operator >= (const thor::ring_buffer<T, T_CAPACITY>& lhs, const thor::ring_buffer<T, T_CAPACITY>& rhs)
+{
+    return !(lhs < rhs);
+}
+
+template <class T, thor::size_type T_CAPACITY> bool operator <= (const thor::ring_buffer<T, T_CAPACITY>& lhs, const thor::ring_buffer<T, T_CAPACITY>& rhs)
+{
+    return !(rhs < lhs);
+}
+
+#endif
@@ -0,0 +1,237 @@
+/* THOR - THOR Template Library
+ * Joshua M. Kriegshauser
+ *
+ * select.h
+ *
+ * ** THOR INTERNAL FILE - NOT FOR APPLICATION USE **
+ *
+ * This file contains STL-compatible selection algorithms. It is included by algorithm.h.
+ *
+ * nth_element(first,nth,last[,comp]) - places the element that would be at nth if [first,last) were sorted at nth, with
+ *                                      no element before it greater and no element after it less.  Linear time: O(n)
+ *                                      average, O(n*log(n)) worst case
+ * partial_sort(first,middle,last[,comp]) - sorts the smallest (middle-first) elements of [first,last) into [first,middle).
+ *                                      The rest are left in [middle,last) in an unspecified order.  O(n + k*log(k)) average
+ * partial_sort_copy(first,last,result_first,result_last[,comp]) - copies the smallest (result_last-result_first)
+ *                                      elements of the input range to the result range, sorted. Only one pass is made
+ *                                      over the input.  O(n*log(k))
+ *
+ * nth_element() is an introselect using the same partitioning as sort(): after log2(n) unbalanced partitions it falls
+ * back to a heap select. partial_sort() uses a heap select when k is tiny compared to n (one comparison rejects most elements)
+ * and nth_element() followed by sort() otherwise.
+ * See top_k.h for an accumulator that keeps the smallest k values of a stream.
+ */
+
+#ifndef THOR_SELECT_H
+#define THOR_SELECT_H
+#pragma once
+
+#ifndef THOR_SORT_H
+#include "sort.h"
+#endif
+
+#ifndef THOR_HEAP_H
+#include "heap.h"
+#endif
+
+namespace thor
+{
+
+enum
+{
+    __partial_sort_heap_divisor = 256,      // partial_sort() heap selects when k < n / this
+};
+
+// Leaves the smallest (middle - first) elements in [first, middle) as a max-heap; *first is the largest of them
+template <class RandomAccessIterator, class T, class Compare>
+void __heap_select(RandomAccessIterator first, RandomAccessIterator middle, RandomAccessIterator last, Compare comp, T*)
+{
+    __make_heap_internal(first, middle, comp, (T*)0);
+    const thor_diff_type len = middle - first;
+    for (RandomAccessIterator iter = middle; iter != last; ++iter)
+    {
+        // Most elements are rejected by this one comparison once the heap holds small values
+        if (comp(*iter, *first))
+        {
+            T val(*iter);
+            *iter = *first;
+            __adjust_heap_internal(first, 0, len, val, comp);
+        }
+    }
+}
+
+template <class RandomAccessIterator, class T, class Compare, class PodType>
+void __introselect_loop(RandomAccessIterator begin, RandomAccessIterator nth, RandomAccessIterator end, Compare comp, int bad_allowed, bool leftmost, T*, const PodType& podtype)
+{
+    for (;;)
+    {
+        const thor_diff_type size = end - begin;
+
+        if (size < __sort_insertion_threshold)
+        {
+            if (leftmost)
+            {
+                __insertion_sort(begin, end, comp);
+            }
+            else
+            {
+                __unguarded_insertion_sort(begin, end, comp);
+            }
+            return;
+        }
+
+        __choose_pivot(begin, end, comp);
+
+        // As in sort(): if the pivot equals the element before this partition, every element in the
+        // left partition equals the pivot, so nth is done if it landed there.
+        if (!leftmost && !comp(*(begin - 1), *begin))
+        {
+            RandomAccessIterator pivot_pos = __partition_left(begin, end, comp, (T*)0);
+            if ((nth - pivot_pos) <= 0)
+            {
+                return;
+            }
+            begin = pivot_pos + 1;
+            continue;
+        }
+
+        bool already_partitioned = false;
+        RandomAccessIterator pivot_pos = __partition_right(begin, end, comp, already_partitioned, (T*)0, podtype);
+        if (pivot_pos == nth)
+        {
+            return;
+        }
+
+        const thor_diff_type l_size = pivot_pos - begin;
+        const thor_diff_type r_size = end - (pivot_pos + 1);
+        if (l_size < size / 8 || r_size < size / 8)
+        {
+            // Too many bad partitions; fall back to heap select
+            if (--bad_allowed == 0)
+            {
+                __heap_select(begin, nth + 1, end, comp, (T*)0);
+                thor::swap(*begin, *nth);
+                return;
+            }
+            __break_patterns(begin, pivot_pos, end);
+        }
+
+        // Only the partition containing nth needs to be examined further
+        if ((nth - pivot_pos) < 0)
+        {
+            end = pivot_pos;
+        }
+        else
+        {
+            begin = pivot_pos + 1;
+            leftmost = false;
+        }
+    }
+}
+
+template <class RandomAccessIterator, class T, class Compare>
+void __nth_element_internal(RandomAccessIterator first, RandomAccessIterator nth, RandomAccessIterator last, Compare comp, T*)
+{
+    int bad_allowed = 0;
+    for (thor_diff_type n = last - first; n > 1; n >>= 1)
+    {
+        ++bad_allowed;
+    }
+    __introselect_loop(first, nth, last, comp, bad_allowed, true, (T*)0, typename is_pod_type<T>::Type());
+}
+
+template <class RandomAccessIterator>
+void nth_element(RandomAccessIterator first, RandomAccessIterator nth, RandomAccessIterator last)
+{
+    if (first != last && nth != last)
+    {
+        __nth_element_internal(first, nth, last, __less_factory(THOR_GET_VALUE_TYPE(first, RandomAccessIterator)), THOR_GET_VALUE_TYPE(first, RandomAccessIterator));
+    }
+}
+
+template <class RandomAccessIterator, class Compare>
+void nth_element(RandomAccessIterator first, RandomAccessIterator nth, RandomAccessIterator last, Compare comp)
+{
+    if (first != last && nth != last)
+    {
+        __nth_element_internal(first, nth, last, comp, THOR_GET_VALUE_TYPE(first, RandomAccessIterator));
+    }
+}
+
+template <class RandomAccessIterator, class T, class Compare>
+void __partial_sort_internal(RandomAccessIterator first, RandomAccessIterator middle, RandomAccessIterator last, Compare comp, T*)
+{
+    const thor_diff_type k = middle - first;
+    if (k <= 0)
+    {
+        return;
+    }
+
+    if (k < (last - first) / __partial_sort_heap_divisor)
+    {
+        __heap_select(first, middle, last, comp, (T*)0);
+        sort_heap(first, middle, comp);
+    }
+    else
+    {
+        // Selecting first is cheaper than a heap when k is a large fraction of n
+        __nth_element_internal(first, middle - 1, last, comp, (T*)0);
+        __sort_internal(first, middle - 1, comp, (T*)0);
+    }
+}
+
+template <class RandomAccessIterator>
+void partial_sort(RandomAccessIterator first, RandomAccessIterator middle, RandomAccessIterator last)
+{
+    __partial_sort_internal(first, middle, last, __less_factory(THOR_GET_VALUE_TYPE(first, RandomAccessIterator)), THOR_GET_VALUE_TYPE(first, RandomAccessIterator));
+}
+
+template <class RandomAccessIterator, class Compare>
+void partial_sort(RandomAccessIterator first, RandomAccessIterator middle, RandomAccessIterator last, Compare comp)
+{
+    __partial_sort_internal(first, middle, last, comp, THOR_GET_VALUE_TYPE(first, RandomAccessIterator));
+}
+
+template <class InputIterator, class RandomAccessIterator, class T, class Compare>
+RandomAccessIterator __partial_sort_copy_internal(InputIterator first, InputIterator last,
+                                                  RandomAccessIterator result_first, RandomAccessIterator result_last,
+                                                  Compare comp, T*)
+{
+    RandomAccessIterator result_real_last = result_first;
+    for (; first != last && result_real_last != result_last; ++first, ++result_real_last)
+    {
+        *result_real_last = *first;
+    }
+    if (result_real_last == result_first)
+    {
+        return result_real_last;
+    }
+
+    __make_heap_internal(result_first, result_real_last, comp, (T*)0);
+    const thor_diff_type len = result_real_last - result_first;
+    for (; first != last; ++first)
+    {
+        if (comp(*first, *result_first))
+        {
+            __adjust_heap_internal(result_first, 0, len, T(*first), comp);
+        }
+    }
+    sort_heap(result_first, result_real_last, comp);
+    return result_real_last;
+}
+
+template <class InputIterator, class RandomAccessIterator>
+RandomAccessIterator partial_sort_copy(InputIterator first, InputIterator last, RandomAccessIterator result_first, RandomAccessIterator result_last)
+{
+    return __partial_sort_copy_internal(first, last, result_first, result_last, __less_factory(THOR_GET_VALUE_TYPE(result_first, RandomAccessIterator)), THOR_GET_VALUE_TYPE(result_first, RandomAccessIterator));
+}
+
+template <class InputIterator, class RandomAccessIterator, class Compare>
+RandomAccessIterator partial_sort_copy(InputIterator first, InputIterator last, RandomAccessIterator result_first, RandomAccessIterator result_last, Compare comp)
+{
+    return __partial_sort_copy_internal(first, last, result_first, result_last, comp, THOR_GET_VALUE_TYPE(result_first, RandomAccessIterator));
+}
+
+}; // namespace thor
+
+#endif
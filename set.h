@@ -8,6 +8,22 @@
  * Extensions/Changes to set and multiset:
  * - The insert(pos, value_type) functions that support an insert hint are not implemented.
  * - The value_comp() functions are not implemented.
+ * - insert_sorted(InputIterator, InputIterator) inserts a range that is already sorted in linear
+ *   time (size() plus the length of the range) by merging it with the existing entries and
+ *   rebuilding a balanced tree. Use it to build a set from sorted input or to merge in large
+ *   sorted batches; for a few entries insert(InputIterator, InputIterator) is faster.
+ * - The template allows a preallocated number of entries. These entries are included as part
+ *   of the class and are not allocated from the heap.
+ *   * Example: set<int, less<int>, 8> reserves space for 8 entries.
+ *   * Growth above the preallocated amount will continue using the preallocated
+ *     amount augmented with heap memory.
+ *   * swap() between preallocated containers is O(n) and converts preallocated storage to heap storage.
+ * - The template optionally supports order statistics. Each entry tracks the size of its subtree
+ *   which costs one size_type per entry.
+ *   * Example: set<int, less<int>, 0, true>
+ *   * nth(n) returns the n-th entry in order (or end()), rank(key) returns the number of entries
+ *     less than key, index_of(iterator) returns the index of an entry and distance() returns the
+ *     distance between two iterators. These are all logarithmic.
  */
 
 #ifndef THOR_SET_H
@@ -30,9 +46,9 @@ namespace thor
 {
 
 // thor::set
-template <class Key, class Compare = less<Key> > class set
+template <class Key, class Compare = less<Key>, thor_size_type T_PREALLOC = 0, bool T_ORDER_STATS = false> class set
 {
-    typedef red_black_tree<Key, Key, identity<Key>, Compare> tree_type;
+    typedef red_black_tree<Key, Key, identity<Key>, Compare, T_PREALLOC, T_ORDER_STATS> tree_type;
     typedef typename tree_type::iterator mutable_iterator;
     mutable_iterator make_mutable(typename tree_type::const_iterator pos) const { return *(mutable_iterator*)&pos; }
     tree_type m_tree;
@@ -105,6 +121,7 @@ public:
     // insertion
     pair<iterator, bool> insert(const value_type& v)    { return m_tree.insert_unique(v); }
     template <class InputIterator> void insert(InputIterator first, InputIterator last) { m_tree.insert_unique(first, last); }
+    template <class InputIterator> void insert_sorted(InputIterator first, InputIterator last) { m_tree.insert_sorted_unique(first, last); }
 
     // erasing
     void erase(iterator pos)                            { m_tree.erase(make_mutable(pos)); }
@@ -130,12 +147,18 @@ public:
     iterator lower_bound(const key_type& k) const       { return m_tree.lower_bound(k); }
     iterator upper_bound(const key_type& k) const       { return m_tree.upper_bound(k); }
     pair<iterator,iterator> equal_range(const key_type& k) const { return m_tree.equal_range(k); }
+
+    // Order statistics; require T_ORDER_STATS
+    iterator nth(size_type n) const                     { return m_tree.nth(n); }
+    size_type rank(const key_type& k) const             { return m_tree.rank(k); }
+    size_type index_of(iterator pos) const              { return m_tree.index_of(pos); }
+    difference_type distance(iterator first, iterator last) const { return m_tree.distance(first, last); }
 };
 
 // thor::multiset
-template <class Key, class Compare = less<Key> > class multiset
+template <class Key, class Compare = less<Key>, thor_size_type T_PREALLOC = 0, bool T_ORDER_STATS = false> class multiset
 {
-    typedef red_black_tree<Key, Key, identity<Key>, Compare> tree_type;
+    typedef red_black_tree<Key, Key, identity<Key>, Compare, T_PREALLOC, T_ORDER_STATS> tree_type;
     typedef typename tree_type::iterator mutable_iterator;
     mutable_iterator make_mutable(typename tree_type::const_iterator pos) const { return *(mutable_iterator*)&pos; }
     tree_type m_tree;
@@ -208,6 +231,7 @@ public:
     // insertion
     iterator insert(const value_type& v)                { return m_tree.insert_equal(v); }
     template <class InputIterator> void insert(InputIterator f, InputIterator l) { m_tree.insert_equal(f, l); }
+    template <class InputIterator> void insert_sorted(InputIterator f, InputIterator l) { m_tree.insert_sorted_equal(f, l); }
 
     // erasing
     void erase(iterator pos)                            { m_tree.erase(make_mutable(pos)); }
@@ -224,15 +248,21 @@ public:
     iterator lower_bound(const key_type& k) const       { return m_tree.lower_bound(k); }
     iterator upper_bound(const key_type& k) const       { return m_tree.upper_bound(k); }
     pair<iterator,iterator> equal_range(const key_type& k) const { return m_tree.equal_range(k); }
+
+    // Order statistics; require T_ORDER_STATS
+    iterator nth(size_type n) const                     { return m_tree.nth(n); }
+    size_type rank(const key_type& k) const             { return m_tree.rank(k); }
+    size_type index_of(iterator pos) const              { return m_tree.index_of(pos); }
+    difference_type distance(iterator first, iterator last) const { return m_tree.distance(first, last); }
 };
 
 // Swap specialization
-template <class Key, class Compare> void swap(set<Key, Compare>& lhs, set<Key, Compare>& rhs)
+template <class Key, class Compare, thor_size_type T_PREALLOC, bool T_ORDER_STATS> void swap(set<Key, Compare, T_PREALLOC, T_ORDER_STATS>& lhs, set<Key, Compare, T_PREALLOC, T_ORDER_STATS>& rhs)
 {
     lhs.swap(rhs);
 }
 
-template <class Key, class Compare> void swap(multiset<Key, Compare>& lhs, multiset<Key, Compare>& rhs)
+template <class Key, class Compare, thor_size_type T_PREALLOC, bool T_ORDER_STATS> void swap(multiset<Key, Compare, T_PREALLOC, T_ORDER_STATS>& lhs, multiset<Key, Compare, T_PREALLOC, T_ORDER_STATS>& rhs)
 {
     lhs.swap(rhs);
 }
@@ -0,0 +1,786 @@
+/* THOR - THOR Template Library
+ * Joshua M. Kriegshauser
+ *
+ * simd.h
+ *
+ * ** THOR INTERNAL FILE - NOT FOR APPLICATION USE **
+ *
+ * This file contains vectorized searches and reductions over arrays of 32- and 64-bit integers,
+ * float and double. It is included by algorithm.h, whose find(), count(), min_element(),
+ * max_element(), accumulate(), equal() and set_intersection() use these functions automatically for
+ * contiguous ranges (pointers and vector iterators) of those types. set_intersection() is only
+ * vectorized for integers. The bitwise operators of dynamic_bitset use __simd_bitwise() to combine
+ * whole arrays of words.
+ *
+ * SSE2 is used on all x86 and x64 targets. AVX2 is used when the processor and operating system
+ * support it, detected at runtime with cpuid (with GCC, only if the code is compiled with -mavx2).
+ *
+ * Results match the element-wise algorithms exactly:
+ * - Comparisons use the same semantics as operator == and operator <: -0.0 equals 0.0, and NaN
+ *   never compares equal, so it is never found or counted, and it is skipped by min_element()
+ *   and max_element() (unless it is the first element, as with the element-wise loop).
+ * - Integer sums wrap identically in any order. Floating-point sums are only vectorized by
+ *   accumulate_unordered(), since changing the order of additions changes the rounding.
+ */
+
+#ifndef THOR_SIMD_H
+#define THOR_SIMD_H
+#pragma once
+
+#ifndef THOR_BASETYPES_H
+#include "basetypes.h"
+#endif
+
+#ifndef THOR_ITERATOR_H
+#include "iterator.h"
+#endif
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define THOR_SIMD_SSE2
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(THOR_SIMD_SSE2) && ((defined(_MSC_VER) && _MSC_VER >= 1700) || defined(__AVX2__))
+#include <immintrin.h>
+#define THOR_SIMD_AVX2
+#endif
+
+namespace thor
+{
+
+// Selects the vector operations for a type. Type is true_type if the type is supported.
+template <class T> struct __simd_ops
+{
+    typedef false_type Type;
+    typedef false_type Exact;   // Whether a vectorized sum equals the sequential sum
+};
+
+// Whether a search of an array of U for a value of type T may search for static_cast<U>(value)
+// instead: T must be U or an integer type, since converting floating point values out of range
+// is undefined.
+template <class U, class T, class ExactT> struct __simd_value_tag_helper    { typedef false_type Type; };
+template <class U, class T> struct __simd_value_tag_helper<U, T, true_type> { typedef typename __simd_ops<U>::Type Type; };
+template <class U, class T> struct __simd_value_tag     { typedef typename __simd_value_tag_helper<U, T, typename __simd_ops<T>::Exact>::Type Type; };
+template <class U> struct __simd_value_tag<U, U>        { typedef typename __simd_ops<U>::Type Type; };
+
+#ifdef THOR_SIMD_SSE2
+
+enum
+{
+    __simd_block_size = 1024,   // Elements per block for min_element() and max_element()
+};
+
+// Index of the lowest set bit; bits must be non-zero
+inline size_type __simd_lowest_bit(unsigned bits)
+{
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward(&i, bits);
+    return size_type(i);
+#else
+    return size_type(__builtin_ctz(bits));
+#endif
+}
+
+//-----------------------------------------------------------------------------
+// Operations. Each provides, for its vector type:
+//   load/store/set1 - unaligned load and store, and broadcast
+//   zero/izero      - a zero vector, and a zero counter
+//   eq_bits         - one bit per lane that compares equal
+//   eq_mask         - all bits set in each lane that compares equal, as an integer vector
+//   count_add       - adds one to each lane of a counter where the mask is set
+//   count_total     - sum of the lanes of a counter
+//   vmin/vmax       - lane-wise minimum/maximum of x and acc; acc is kept when x is NaN
+//   add             - lane-wise sum
+//   rotate          - moves each lane down one, and the lowest lane to the top (integers only)
+
+// SSE2 has no 32-bit min/max or 64-bit compare, so integers are selected with a signed compare.
+// The bias flips the sign bit of unsigned types so that the signed compare orders them.
+template <class T, bool is_signed, size_type size = sizeof(T)> struct __simd_sse2_int;
+
+template <class T, bool is_signed> struct __simd_sse2_int<T, is_signed, 4>
+{
+    typedef T value_type;
+    typedef __m128i vec;
+    typedef __m128i ivec;
+    enum { lanes = 4 };
+
+    static vec load(const T* p)                     { return _mm_loadu_si128((const __m128i*)p); }
+    static void store(T* p, vec v)                  { _mm_storeu_si128((__m128i*)p, v); }
+    static vec set1(T t)                            { return _mm_set1_epi32((int)t); }
+    static vec zero()                               { return _mm_setzero_si128(); }
+    static ivec izero()                             { return _mm_setzero_si128(); }
+    static unsigned eq_bits(vec a, vec b)           { return (unsigned)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(a, b))); }
+    static ivec eq_mask(vec a, vec b)               { return _mm_cmpeq_epi32(a, b); }
+    static ivec count_add(ivec acc, ivec mask)      { return _mm_sub_epi32(acc, mask); }
+    static size_type count_total(ivec acc)
+    {
+        uint32 c[lanes];
+        _mm_storeu_si128((__m128i*)c, acc);
+        return size_type(c[0]) + c[1] + c[2] + c[3];
+    }
+    static vec vmin(vec x, vec acc)                 { return select(_mm_cmpgt_epi32(bias(acc), bias(x)), x, acc); }
+    static vec vmax(vec x, vec acc)                 { return select(_mm_cmpgt_epi32(bias(x), bias(acc)), x, acc); }
+    static vec add(vec a, vec b)                    { return _mm_add_epi32(a, b); }
+    static vec rotate(vec v)                        { return _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 3, 2, 1)); }
+    static vec vand(vec a, vec b)                   { return _mm_and_si128(a, b); }
+    static vec vor(vec a, vec b)                    { return _mm_or_si128(a, b); }
+    static vec vxor(vec a, vec b)                   { return _mm_xor_si128(a, b); }
+
+private:
+    static vec bias(vec v)                          { return _mm_xor_si128(v, _mm_set1_epi32(is_signed ? 0 : int(0x80000000))); }
+    static vec select(vec mask, vec a, vec b)       { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+};
+
+template <class T, bool is_signed> struct __simd_sse2_int<T, is_signed, 8>
+{
+    typedef T value_type;
+    typedef __m128i vec;
+    typedef __m128i ivec;
+    enum { lanes = 2 };
+
+    static vec load(const T* p)                     { return _mm_loadu_si128((const __m128i*)p); }
+    static void store(T* p, vec v)                  { _mm_storeu_si128((__m128i*)p, v); }
+    static vec set1(T t)
+    {
+        const __m128i v = _mm_loadl_epi64((const __m128i*)&t);
+        return _mm_unpacklo_epi64(v, v);
+    }
+    static vec zero()                               { return _mm_setzero_si128(); }
+    static ivec izero()                             { return _mm_setzero_si128(); }
+    static unsigned eq_bits(vec a, vec b)           { return (unsigned)_mm_movemask_pd(_mm_castsi128_pd(eq_mask(a, b))); }
+    static ivec eq_mask(vec a, vec b)
+    {
+        // Both 32-bit halves must be equal
+        const __m128i eq = _mm_cmpeq_epi32(a, b);
+        return _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+    }
+    static ivec count_add(ivec acc, ivec mask)      { return _mm_sub_epi64(acc, mask); }
+    static size_type count_total(ivec acc)
+    {
+        uint64 c[lanes];
+        _mm_storeu_si128((__m128i*)c, acc);
+        return size_type(c[0] + c[1]);
+    }
+    static vec vmin(vec x, vec acc)                 { return select(greater(bias(acc), bias(x)), x, acc); }
+    static vec vmax(vec x, vec acc)                 { return select(greater(bias(x), bias(acc)), x, acc); }
+    static vec add(vec a, vec b)                    { return _mm_add_epi64(a, b); }
+    static vec rotate(vec v)                        { return _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)); }
+    static vec vand(vec a, vec b)                   { return _mm_and_si128(a, b); }
+    static vec vor(vec a, vec b)                    { return _mm_or_si128(a, b); }
+    static vec vxor(vec a, vec b)                   { return _mm_xor_si128(a, b); }
+
+private:
+    static vec bias(vec v)                          { return _mm_xor_si128(v, _mm_set_epi32(is_signed ? 0 : int(0x80000000), 0, is_signed ? 0 : int(0x80000000), 0)); }
+    static vec select(vec mask, vec a, vec b)       { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+
+    // Signed 64-bit a > b: compare the high halves, or if they are equal, borrow from the low halves
+    static vec greater(vec a, vec b)
+    {
+        __m128i r = _mm_and_si128(_mm_cmpeq_epi32(a, b), _mm_sub_epi64(b, a));
+        r = _mm_or_si128(r, _mm_cmpgt_epi32(a, b));
+        return _mm_shuffle_epi32(r, _MM_SHUFFLE(3, 3, 1, 1));
+    }
+};
+
+struct __simd_sse2_float
+{
+    typedef float value_type;
+    typedef __m128 vec;
+    typedef __m128i ivec;
+    enum { lanes = 4 };
+
+    static vec load(const float* p)                 { return _mm_loadu_ps(p); }
+    static void store(float* p, vec v)              { _mm_storeu_ps(p, v); }
+    static vec set1(float f)                        { return _mm_set1_ps(f); }
+    static vec zero()                               { return _mm_setzero_ps(); }
+    static ivec izero()                             { return _mm_setzero_si128(); }
+    static unsigned eq_bits(vec a, vec b)           { return (unsigned)_mm_movemask_ps(_mm_cmpeq_ps(a, b)); }
+    static ivec eq_mask(vec a, vec b)               { return _mm_castps_si128(_mm_cmpeq_ps(a, b)); }
+    static ivec count_add(ivec acc, ivec mask)      { return _mm_sub_epi32(acc, mask); }
+    static size_type count_total(ivec acc)          { return __simd_sse2_int<uint32, false>::count_total(acc); }
+    static vec vmin(vec x, vec acc)                 { return _mm_min_ps(x, acc); }
+    static vec vmax(vec x, vec acc)                 { return _mm_max_ps(x, acc); }
+    static vec add(vec a, vec b)                    { return _mm_add_ps(a, b); }
+};
+
+struct __simd_sse2_double
+{
+    typedef double value_type;
+    typedef __m128d vec;
+    typedef __m128i ivec;
+    enum { lanes = 2 };
+
+    static vec load(const double* p)                { return _mm_loadu_pd(p); }
+    static void store(double* p, vec v)             { _mm_storeu_pd(p, v); }
+    static vec set1(double d)                       { return _mm_set1_pd(d); }
+    static vec zero()                               { return _mm_setzero_pd(); }
+    static ivec izero()                             { return _mm_setzero_si128(); }
+    static unsigned eq_bits(vec a, vec b)           { return (unsigned)_mm_movemask_pd(_mm_cmpeq_pd(a, b)); }
+    static ivec eq_mask(vec a, vec b)               { return _mm_castpd_si128(_mm_cmpeq_pd(a, b)); }
+    static ivec count_add(ivec acc, ivec mask)      { return _mm_sub_epi64(acc, mask); }
+    static size_type count_total(ivec acc)          { return __simd_sse2_int<uint64, false>::count_total(acc); }
+    static vec vmin(vec x, vec acc)                 { return _mm_min_pd(x, acc); }
+    static vec vmax(vec x, vec acc)                 { return _mm_max_pd(x, acc); }
+    static vec add(vec a, vec b)                    { return _mm_add_pd(a, b); }
+};
+
+#ifdef THOR_SIMD_AVX2
+template <class T, bool is_signed, size_type size = sizeof(T)> struct __simd_avx2_int;
+
+template <class T, bool is_signed> struct __simd_avx2_int<T, is_signed, 4>
+{
+    typedef T value_type;
+    typedef __m256i vec;
+    typedef __m256i ivec;
+    enum { lanes = 8 };
+
+    static vec load(const T* p)                     { return _mm256_loadu_si256((const __m256i*)p); }
+    static void store(T* p, vec v)                  { _mm256_storeu_si256((__m256i*)p, v); }
+    static vec set1(T t)                            { return _mm256_set1_epi32((int)t); }
+    static vec zero()                               { return _mm256_setzero_si256(); }
+    static ivec izero()                             { return _mm256_setzero_si256(); }
+    static unsigned eq_bits(vec a, vec b)           { return (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(a, b))); }
+    static ivec eq_mask(vec a, vec b)               { return _mm256_cmpeq_epi32(a, b); }
+    static ivec count_add(ivec acc, ivec mask)      { return _mm256_sub_epi32(acc, mask); }
+    static size_type count_total(ivec acc)
+    {
+        uint32 c[lanes];
+        _mm256_storeu_si256((__m256i*)c, acc);
+        size_type total = 0;
+        for (int i = 0; i != lanes; ++i)
+        {
+            total += c[i];
+        }
+        return total;
+    }
+    static vec vmin(vec x, vec acc)                 { return _mm256_blendv_epi8(acc, x, _mm256_cmpgt_epi32(bias(acc), bias(x))); }
+    static vec vmax(vec x, vec acc)                 { return _mm256_blendv_epi8(acc, x, _mm256_cmpgt_epi32(bias(x), bias(acc))); }
+    static vec add(vec a, vec b)                    { return _mm256_add_epi32(a, b); }
+    static vec rotate(vec v)                        { return _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(1, 2, 3, 4, 5, 6, 7, 0)); }
+    static vec vand(vec a, vec b)                   { return _mm256_and_si256(a, b); }
+    static vec vor(vec a, vec b)                    { return _mm256_or_si256(a, b); }
+    static vec vxor(vec a, vec b)                   { return _mm256_xor_si256(a, b); }
+
+private:
+    static vec bias(vec v)                          { return _mm256_xor_si256(v, _mm256_set1_epi32(is_signed ? 0 : int(0x80000000))); }
+};
+
+template <class T, bool is_signed> struct __simd_avx2_int<T, is_signed, 8>
+{
+    typedef T value_type;
+    typedef __m256i vec;
+    typedef __m256i ivec;
+    enum { lanes = 4 };
+
+    static vec load(const T* p)                     { return _mm256_loadu_si256((const __m256i*)p); }
+    static void store(T* p, vec v)                  { _mm256_storeu_si256((__m256i*)p, v); }
+    static vec set1(T t)                            { return _mm256_set1_epi64x((long long)t); }
+    static vec zero()                               { return _mm256_setzero_si256(); }
+    static ivec izero()                             { return _mm256_setzero_si256(); }
+    static unsigned eq_bits(vec a, vec b)           { return (unsigned)_mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(a, b))); }
+    static ivec eq_mask(vec a, vec b)               { return _mm256_cmpeq_epi64(a, b); }
+    static ivec count_add(ivec acc, ivec mask)      { return _mm256_sub_epi64(acc, mask); }
+    static size_type count_total(ivec acc)
+    {
+        uint64 c[lanes];
+        _mm256_storeu_si256((__m256i*)c, acc);
+        return size_type(c[0] + c[1] + c[2] + c[3]);
+    }
+    static vec vmin(vec x, vec acc)                 { return _mm256_blendv_epi8(acc, x, _mm256_cmpgt_epi64(bias(acc), bias(x))); }
+    static vec vmax(vec x, vec acc)                 { return _mm256_blendv_epi8(acc, x, _mm256_cmpgt_epi64(bias(x), bias(acc))); }
+    static vec add(vec a, vec b)                    { return _mm256_add_epi64(a, b); }
+    static vec rotate(vec v)                        { return _mm256_permute4x64_epi64(v, _MM_SHUFFLE(0, 3, 2, 1)); }
+    static vec vand(vec a, vec b)                   { return _mm256_and_si256(a, b); }
+    static vec vor(vec a, vec b)                    { return _mm256_or_si256(a, b); }
+    static vec vxor(vec a, vec b)                   { return _mm256_xor_si256(a, b); }
+
+private:
+    static vec bias(vec v)                          { return _mm256_xor_si256(v, _mm256_set1_epi64x(is_signed ? 0 : (long long)0x8000000000000000ULL)); }
+};
+
+struct __simd_avx2_float
+{
+    typedef float value_type;
+    typedef __m256 vec;
+    typedef __m256i ivec;
+    enum { lanes = 8 };
+
+    static vec load(const float* p)                 { return _mm256_loadu_ps(p); }
+    static void store(float* p, vec v)              { _mm256_storeu_ps(p, v); }
+    static vec set1(float f)                        { return _mm256_set1_ps(f); }
+    static vec zero()                               { return _mm256_setzero_ps(); }
+    static ivec izero()                             { return _mm256_setzero_si256(); }
+    static unsigned eq_bits(vec a, vec b)           { return (unsigned)_mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_EQ_OQ)); }
+    static ivec eq_mask(vec a, vec b)               { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_EQ_OQ)); }
+    static ivec count_add(ivec acc, ivec mask)      { return _mm256_sub_epi32(acc, mask); }
+    static size_type count_total(ivec acc)          { return __simd_avx2_int<uint32, false>::count_total(acc); }
+    static vec vmin(vec x, vec acc)                 { return _mm256_min_ps(x, acc); }
+    static vec vmax(vec x, vec acc)                 { return _mm256_max_ps(x, acc); }
+    static vec add(vec a, vec b)                    { return _mm256_add_ps(a, b); }
+};
+
+struct __simd_avx2_double
+{
+    typedef double value_type;
+    typedef __m256d vec;
+    typedef __m256i ivec;
+    enum { lanes = 4 };
+
+    static vec load(const double* p)                { return _mm256_loadu_pd(p); }
+    static void store(double* p, vec v)             { _mm256_storeu_pd(p, v); }
+    static vec set1(double d)                       { return _mm256_set1_pd(d); }
+    static vec zero()                               { return _mm256_setzero_pd(); }
+    static ivec izero()                             { return _mm256_setzero_si256(); }
+    static unsigned eq_bits(vec a, vec b)           { return (unsigned)_mm256_movemask_pd(_mm256_cmp_pd(a, b, _CMP_EQ_OQ)); }
+    static ivec eq_mask(vec a, vec b)               { return _mm256_castpd_si256(_mm256_cmp_pd(a, b, _CMP_EQ_OQ)); }
+    static ivec count_add(ivec acc, ivec mask)      { return _mm256_sub_epi64(acc, mask); }
+    static size_type count_total(ivec acc)          { return __simd_avx2_int<uint64, false>::count_total(acc); }
+    static vec vmin(vec x, vec acc)                 { return _mm256_min_pd(x, acc); }
+    static vec vmax(vec x, vec acc)                 { return _mm256_max_pd(x, acc); }
+    static vec add(vec a, vec b)                    { return _mm256_add_pd(a, b); }
+};
+
+// Whether the processor supports AVX2 and the operating system saves the AVX registers
+inline bool __simd_detect_avx2()
+{
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+    {
+        return false;
+    }
+    __cpuid(info, 1);
+    const int osxsave_avx = (1 << 27) | (1 << 28);
+    if ((info[2] & osxsave_avx) != osxsave_avx || (_xgetbv(0) & 6) != 6)
+    {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    // Compiled with -mavx2, so the program already requires it
+    return true;
+#endif
+}
+
+inline bool __simd_avx2_supported()
+{
+    // Racing threads compute the same value
+    static int supported = -1;
+    if (supported < 0)
+    {
+        supported = __simd_detect_avx2() ? 1 : 0;
+    }
+    return supported != 0;
+}
+#endif
+
+template <class T, bool is_signed> struct __simd_int_ops
+{
+    typedef true_type Type;
+    typedef true_type Exact;
+    typedef __simd_sse2_int<T, is_signed> sse2;
+#ifdef THOR_SIMD_AVX2
+    typedef __simd_avx2_int<T, is_signed> avx2;
+#endif
+};
+
+template <> struct __simd_ops<int>                  : public __simd_int_ops<int, true> {};
+template <> struct __simd_ops<unsigned int>         : public __simd_int_ops<unsigned int, false> {};
+template <> struct __simd_ops<long>                 : public __simd_int_ops<long, true> {};
+template <> struct __simd_ops<unsigned long>        : public __simd_int_ops<unsigned long, false> {};
+template <> struct __simd_ops<long long>            : public __simd_int_ops<long long, true> {};
+template <> struct __simd_ops<unsigned long long>   : public __simd_int_ops<unsigned long long, false> {};
+
+template <> struct __simd_ops<float>
+{
+    typedef true_type Type;
+    typedef false_type Exact;
+    typedef __simd_sse2_float sse2;
+#ifdef THOR_SIMD_AVX2
+    typedef __simd_avx2_float avx2;
+#endif
+};
+
+template <> struct __simd_ops<double>
+{
+    typedef true_type Type;
+    typedef false_type Exact;
+    typedef __simd_sse2_double sse2;
+#ifdef THOR_SIMD_AVX2
+    typedef __simd_avx2_double avx2;
+#endif
+};
+
+//-----------------------------------------------------------------------------
+// Kernels, written once in terms of the operations above
+
+template <class Ops, class T> size_type __simd_find_kernel(const T* p, size_type n, T t)
+{
+    const typename Ops::vec v = Ops::set1(t);
+    size_type i = 0;
+    for (; i + Ops::lanes * 2 <= n; i += Ops::lanes * 2)
+    {
+        const unsigned bits = Ops::eq_bits(Ops::load(p + i), v) | (Ops::eq_bits(Ops::load(p + i + Ops::lanes), v) << Ops::lanes);
+        if (bits != 0)
+        {
+            return i + __simd_lowest_bit(bits);
+        }
+    }
+    for (; i != n; ++i)
+    {
+        if (p[i] == t)
+        {
+            return i;
+        }
+    }
+    return n;
+}
+
+template <class Ops, class T> size_type __simd_count_kernel(const T* p, size_type n, T t)
+{
+    const typename Ops::vec v = Ops::set1(t);
+    typename Ops::ivec acc0 = Ops::izero(), acc1 = Ops::izero();
+    size_type i = 0;
+    for (; i + Ops::lanes * 2 <= n; i += Ops::lanes * 2)
+    {
+        acc0 = Ops::count_add(acc0, Ops::eq_mask(Ops::load(p + i), v));
+        acc1 = Ops::count_add(acc1, Ops::eq_mask(Ops::load(p + i + Ops::lanes), v));
+    }
+    size_type count = Ops::count_total(acc0) + Ops::count_total(acc1);
+    for (; i != n; ++i)
+    {
+        count += (p[i] == t);
+    }
+    return count;
+}
+
+// Smallest of init and [p, p + n); NaN values are ignored (init must not be NaN)
+template <class Ops, class T> T __simd_min_kernel(const T* p, size_type n, T init)
+{
+    typename Ops::vec acc = Ops::set1(init);
+    size_type i = 0;
+    for (; i + Ops::lanes <= n; i += Ops::lanes)
+    {
+        acc = Ops::vmin(Ops::load(p + i), acc);
+    }
+    T lanes[Ops::lanes];
+    Ops::store(lanes, acc);
+    T m = init;
+    for (int k = 0; k != Ops::lanes; ++k)
+    {
+        m = lanes[k] < m ? lanes[k] : m;
+    }
+    for (; i != n; ++i)
+    {
+        m = p[i] < m ? p[i] : m;
+    }
+    return m;
+}
+
+template <class Ops, class T> T __simd_max_kernel(const T* p, size_type n, T init)
+{
+    typename Ops::vec acc = Ops::set1(init);
+    size_type i = 0;
+    for (; i + Ops::lanes <= n; i += Ops::lanes)
+    {
+        acc = Ops::vmax(Ops::load(p + i), acc);
+    }
+    T lanes[Ops::lanes];
+    Ops::store(lanes, acc);
+    T m = init;
+    for (int k = 0; k != Ops::lanes; ++k)
+    {
+        m = m < lanes[k] ? lanes[k] : m;
+    }
+    for (; i != n; ++i)
+    {
+        m = m < p[i] ? p[i] : m;
+    }
+    return m;
+}
+
+// Index of the first minimum (greater == false) or maximum of [p, p + n); n must be non-zero.
+// The extreme value is found a block at a time, remembering the first block that improved on it,
+// and then that block alone is searched for the first element equal to it.
+template <class Ops, bool greater, class T> size_type __simd_extreme_element_kernel(const T* p, size_type n)
+{
+    // The element-wise loop never replaces a leading NaN, since nothing compares less or greater
+    if (!(p[0] == p[0]))
+    {
+        return 0;
+    }
+
+    T best = p[0];
+    size_type best_block = 0;
+    for (size_type b = 0; b < n; b += __simd_block_size)
+    {
+        const size_type len = (n - b) < size_type(__simd_block_size) ? (n - b) : size_type(__simd_block_size);
+        const T m = greater ? __simd_max_kernel<Ops>(p + b, len, best) : __simd_min_kernel<Ops>(p + b, len, best);
+        if (greater ? (best < m) : (m < best))
+        {
+            best = m;
+            best_block = b;
+        }
+    }
+    const size_type len = (n - best_block) < size_type(__simd_block_size) ? (n - best_block) : size_type(__simd_block_size);
+    return best_block + __simd_find_kernel<Ops>(p + best_block, len, best);
+}
+
+template <class Ops, class T> size_type __simd_min_element_kernel(const T* p, size_type n)
+{
+    return __simd_extreme_element_kernel<Ops, false>(p, n);
+}
+
+template <class Ops, class T> size_type __simd_max_element_kernel(const T* p, size_type n)
+{
+    return __simd_extreme_element_kernel<Ops, true>(p, n);
+}
+
+template <class Ops, class T, class U> U __simd_sum_kernel(const T* p, size_type n, U init)
+{
+    typename Ops::vec acc0 = Ops::zero(), acc1 = Ops::zero();
+    size_type i = 0;
+    for (; i + Ops::lanes * 2 <= n; i += Ops::lanes * 2)
+    {
+        acc0 = Ops::add(acc0, Ops::load(p + i));
+        acc1 = Ops::add(acc1, Ops::load(p + i + Ops::lanes));
+    }
+    T lanes[Ops::lanes];
+    Ops::store(lanes, Ops::add(acc0, acc1));
+    for (int k = 0; k != Ops::lanes; ++k)
+    {
+        init += lanes[k];
+    }
+    for (; i != n; ++i)
+    {
+        init += p[i];
+    }
+    return init;
+}
+
+template <class Ops, class T> bool __simd_equal_kernel(const T* a, size_type n, const T* b)
+{
+    const unsigned all = (1u << Ops::lanes) - 1;
+    size_type i = 0;
+    for (; i + Ops::lanes <= n; i += Ops::lanes)
+    {
+        if (Ops::eq_bits(Ops::load(a + i), Ops::load(b + i)) != all)
+        {
+            return false;
+        }
+    }
+    for (; i != n; ++i)
+    {
+        if (!(a[i] == b[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Combines src into dst element by element: dst[i] = op(dst[i], src[i]). Used for the bulk bitwise
+// operators of dynamic_bitset.
+struct __simd_bitwise_and
+{
+    template <class Ops> static typename Ops::vec vapply(typename Ops::vec a, typename Ops::vec b) { return Ops::vand(a, b); }
+    template <class T> static T apply(T a, T b) { return a & b; }
+};
+
+struct __simd_bitwise_or
+{
+    template <class Ops> static typename Ops::vec vapply(typename Ops::vec a, typename Ops::vec b) { return Ops::vor(a, b); }
+    template <class T> static T apply(T a, T b) { return a | b; }
+};
+
+struct __simd_bitwise_xor
+{
+    template <class Ops> static typename Ops::vec vapply(typename Ops::vec a, typename Ops::vec b) { return Ops::vxor(a, b); }
+    template <class T> static T apply(T a, T b) { return a ^ b; }
+};
+
+template <class Ops, class T, class Op> void __simd_bitwise_kernel(T* dst, const T* src, size_type n, Op)
+{
+    size_type i = 0;
+    for (; i + (2 * Ops::lanes) <= n; i += (2 * Ops::lanes))
+    {
+        const typename Ops::vec a = Op::template vapply<Ops>(Ops::load(dst + i), Ops::load(src + i));
+        const typename Ops::vec b = Op::template vapply<Ops>(Ops::load(dst + i + Ops::lanes), Ops::load(src + i + Ops::lanes));
+        Ops::store(dst + i, a);
+        Ops::store(dst + i + Ops::lanes, b);
+    }
+    for (; i + Ops::lanes <= n; i += Ops::lanes)
+    {
+        Ops::store(dst + i, Op::template vapply<Ops>(Ops::load(dst + i), Ops::load(src + i)));
+    }
+    for (; i != n; ++i)
+    {
+        dst[i] = Op::apply(dst[i], src[i]);
+    }
+}
+
+// Writes the elements of a that are also in b, as set_intersection() does; both are sorted ascending.
+// A block of each is compared all against all by rotating b's block through every lane. When there
+// is no match, the block with the smaller last element is skipped whole. Otherwise, the matches are
+// written and the elements of both blocks up to the smaller last element are skipped; that would
+// match a duplicated value too many times, so blocks with duplicates are merged element by element.
+template <class Ops, class T, class OutputIterator>
+OutputIterator __simd_set_intersection_kernel(const T* a, size_type na, const T* b, size_type nb, OutputIterator out)
+{
+    const T* const a_end = a + na;
+    const T* const b_end = b + nb;
+    while (size_type(a_end - a) >= size_type(Ops::lanes) && size_type(b_end - b) >= size_type(Ops::lanes))
+    {
+        const typename Ops::vec va = Ops::load(a);
+        const typename Ops::vec vb = Ops::load(b);
+        typename Ops::vec rb = vb;
+        unsigned bits = Ops::eq_bits(va, vb);
+        for (int k = 1; k != Ops::lanes; ++k)
+        {
+            rb = Ops::rotate(rb);
+            bits |= Ops::eq_bits(va, rb);
+        }
+
+        const T a_last = a[Ops::lanes - 1];
+        const T b_last = b[Ops::lanes - 1];
+        if (bits == 0)
+        {
+            // The last elements differ, or they would have matched
+            if (a_last < b_last)
+            {
+                a += Ops::lanes;
+            }
+            else
+            {
+                b += Ops::lanes;
+            }
+            continue;
+        }
+
+        // A sorted block has no duplicates if no lane equals the next (the top lane is compared
+        // with the bottom, which are only equal if all are)
+        const T m = a_last < b_last ? a_last : b_last;
+        if (Ops::eq_bits(va, Ops::rotate(va)) == 0 && Ops::eq_bits(vb, Ops::rotate(vb)) == 0 &&
+            (a + Ops::lanes == a_end || !(a[Ops::lanes] == m)) && (b + Ops::lanes == b_end || !(b[Ops::lanes] == m)))
+        {
+            do
+            {
+                *out = a[__simd_lowest_bit(bits)];
+                ++out;
+                bits &= bits - 1;
+            } while (bits != 0);
+
+            // The elements not greater than m are a prefix of each block
+            const typename Ops::vec vm = Ops::set1(m);
+            a += __simd_lowest_bit(~Ops::eq_bits(Ops::vmin(va, vm), va));
+            b += __simd_lowest_bit(~Ops::eq_bits(Ops::vmin(vb, vm), vb));
+            continue;
+        }
+
+        const T* const a_stop = a + Ops::lanes;
+        const T* const b_stop = b + Ops::lanes;
+        while (a != a_stop && b != b_stop)
+        {
+            if (*a < *b)
+            {
+                ++a;
+            }
+            else if (*b < *a)
+            {
+                ++b;
+            }
+            else
+            {
+                *out = *a;
+                ++out;
+                ++a;
+                ++b;
+            }
+        }
+    }
+
+    while (a != a_end && b != b_end)
+    {
+        if (*a < *b)
+        {
+            ++a;
+        }
+        else if (*b < *a)
+        {
+            ++b;
+        }
+        else
+        {
+            *out = *a;
+            ++out;
+            ++a;
+            ++b;
+        }
+    }
+    return out;
+}
+
+//-----------------------------------------------------------------------------
+// Entry points: choose AVX2 or SSE2 operations for the element type
+
+#ifdef THOR_SIMD_AVX2
+#define THOR_SIMD_DISPATCH(kernel, args) \
+    return __simd_avx2_supported() ? kernel<typename __simd_ops<T>::avx2> args : kernel<typename __simd_ops<T>::sse2> args
+#else
+#define THOR_SIMD_DISPATCH(kernel, args) \
+    return kernel<typename __simd_ops<T>::sse2> args
+#endif
+
+template <class T> size_type __simd_find(const T* p, size_type n, T t)
+{
+    THOR_SIMD_DISPATCH(__simd_find_kernel, (p, n, t));
+}
+
+template <class T> size_type __simd_count(const T* p, size_type n, T t)
+{
+    THOR_SIMD_DISPATCH(__simd_count_kernel, (p, n, t));
+}
+
+template <class T> size_type __simd_min_element(const T* p, size_type n)
+{
+    THOR_SIMD_DISPATCH(__simd_min_element_kernel, (p, n));
+}
+
+template <class T> size_type __simd_max_element(const T* p, size_type n)
+{
+    THOR_SIMD_DISPATCH(__simd_max_element_kernel, (p, n));
+}
+
+template <class T, class U> U __simd_sum(const T* p, size_type n, U init)
+{
+    THOR_SIMD_DISPATCH(__simd_sum_kernel, (p, n, init));
+}
+
+template <class T> bool __simd_equal(const T* a, size_type n, const T* b)
+{
+    THOR_SIMD_DISPATCH(__simd_equal_kernel, (a, n, b));
+}
+
+template <class T, class OutputIterator> OutputIterator __simd_set_intersection(const T* a, size_type na, const T* b, size_type nb, OutputIterator out)
+{
+    THOR_SIMD_DISPATCH(__simd_set_intersection_kernel, (a, na, b, nb, out));
+}
+
+template <class T, class Op> void __simd_bitwise(T* dst, const T* src, size_type n, Op op)
+{
+    THOR_SIMD_DISPATCH(__simd_bitwise_kernel, (dst, src, n, op));
+}
+
+#undef THOR_SIMD_DISPATCH
+
+#endif // THOR_SIMD_SSE2
+
+} // namespace thor
+
+#endif
@@ -23,15 +23,32 @@
 namespace thor
 {
 
-// sort() implementation (using heap sort). 
+// sort() implementation (pattern-defeating quicksort).
+//
+// An introsort variant based on Orson Peters' pdqsort: median-of-three (ninther for large ranges)
+// pivot selection, insertion sort for small partitions, partitioning that puts elements equal to
+// the pivot on one side so that many equal keys are handled in linear time, and detection of
+// already-partitioned ranges. Unbalanced partitions shuffle some elements to break up adversarial
+// patterns, and after log2(n) of them the range is heap sorted to keep the O(n log n) guarantee.
+// Plain-old-data values are partitioned with a branchless block partition (BlockQuicksort), which
+// avoids the branch mispredictions of comparing against the pivot.
 
 template <class T> less<T> __less_factory(T*)
 {
     return less<T>();
 }
 
+enum
+{
+    __sort_insertion_threshold = 24,        // Partitions smaller than this are insertion sorted
+    __sort_ninther_threshold = 128,         // Partitions larger than this use Tukey's ninther for the pivot
+    __sort_partial_insertion_limit = 8,     // Elements moved before giving up on partial_insertion_sort
+    __sort_block_size = 64,                 // Elements examined per block by the branchless partition
+};
+
+// Heap sort; the fallback that guarantees O(n log n).
 template<class T, class RandomAccessIterator, class Compare>
-void __sort_inner(RandomAccessIterator first, thor_diff_type i, thor_diff_type count, Compare comp, T*)
+void __heap_sort_inner(RandomAccessIterator first, thor_diff_type i, thor_diff_type count, Compare comp, T*)
 {
     thor_diff_type k = i * 2 + 1;
 
@@ -58,7 +75,7 @@ void __sort_inner(RandomAccessIterator first, thor_diff_type i, thor_diff_type c
 }
 
 template<class T, class RandomAccessIterator, class Compare>
-void __sort_internal(RandomAccessIterator first, RandomAccessIterator last, Compare comp, T*)
+void __heap_sort(RandomAccessIterator first, RandomAccessIterator last, Compare comp, T*)
 {
     //////////////////////////////////////////////////////////////////////////////////////////
     // well optimized heap sort - special thanks to eternallyconfuzzled.com (Julienne Walker)
@@ -70,35 +87,16 @@ void __sort_internal(RandomAccessIterator first, RandomAccessIterator last, Comp
     thor_diff_type i = sortCount / 2;
     while (i-- > 0)
     {
-        __sort_inner(first, i, sortCount, comp, (T*)0);
+        __heap_sort_inner(first, i, sortCount, comp, (T*)0);
     }
 
     while (--sortCount > 0)
     {
         thor::swap(*first, *(first + sortCount));
-        __sort_inner(first, 0, sortCount, comp, (T*)0);
+        __heap_sort_inner(first, 0, sortCount, comp, (T*)0);
     }    
 }
 
-template <class RandomAccessIterator>
-void sort(RandomAccessIterator first, RandomAccessIterator last)
-{
-    if (first != last)
-    {
-        __sort_internal(first, last, __less_factory(THOR_GET_VALUE_TYPE(first, RandomAccessIterator)), THOR_GET_VALUE_TYPE(first, RandomAccessIterator));
-    }
-}
-
-template <class RandomAccessIterator, class Compare>
-void sort(RandomAccessIterator first, RandomAccessIterator last, Compare comp)
-{
-    if (first != last)
-    {
-        __sort_internal(first, last, comp, THOR_GET_VALUE_TYPE(first, RandomAccessIterator));
-    }
-}
-
-// stable_sort() implementation (using merge sort). 
 template <class RandomAccessIterator, class T, class Compare>
 void __unguarded_linear_insert(RandomAccessIterator last, T val, Compare comp)
 {
@@ -140,6 +138,420 @@ void __insertion_sort(RandomAccessIterator first, RandomAccessIterator last, Com
     }
 }
 
+// Insertion sort that requires the element before first to be no greater than any in the range
+template <class RandomAccessIterator, class Compare>
+void __unguarded_insertion_sort(RandomAccessIterator first, RandomAccessIterator last, Compare comp)
+{
+    for (RandomAccessIterator iter = first; iter != last; ++iter)
+    {
+        __unguarded_linear_insert(iter, *iter, comp);
+    }
+}
+
+// Insertion sort that gives up and returns false once too many elements have been moved
+template <class RandomAccessIterator, class T, class Compare>
+bool __partial_insertion_sort(RandomAccessIterator first, RandomAccessIterator last, Compare comp, T*)
+{
+    if (first == last)
+    {
+        return true;
+    }
+
+    thor_diff_type moved = 0;
+    for (RandomAccessIterator cur = first + 1; cur != last; ++cur)
+    {
+        RandomAccessIterator sift = cur;
+        RandomAccessIterator sift_1 = cur - 1;
+        if (comp(*sift, *sift_1))
+        {
+            T tmp(*sift);
+            do
+            {
+                *sift = *sift_1;
+                --sift;
+            } while (sift != first && comp(tmp, *--sift_1));
+            *sift = tmp;
+
+            moved += (cur - sift);
+            if (moved > __sort_partial_insertion_limit)
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template <class RandomAccessIterator, class Compare>
+inline void __sort2(RandomAccessIterator a, RandomAccessIterator b, Compare comp)
+{
+    if (comp(*b, *a))
+    {
+        thor::swap(*a, *b);
+    }
+}
+
+template <class RandomAccessIterator, class Compare>
+inline void __sort3(RandomAccessIterator a, RandomAccessIterator b, RandomAccessIterator c, Compare comp)
+{
+    __sort2(a, b, comp);
+    __sort2(b, c, comp);
+    __sort2(a, b, comp);
+}
+
+// Partitions [begin, end) around the pivot *begin, with elements equal to the pivot going left.
+// Used when the pivot equals the element before the range, so every element in the left partition
+// equals the pivot and need not be sorted further. Returns the new position of the pivot.
+template <class RandomAccessIterator, class T, class Compare>
+RandomAccessIterator __partition_left(RandomAccessIterator begin, RandomAccessIterator end, Compare comp, T*)
+{
+    T pivot(*begin);
+    RandomAccessIterator first = begin;
+    RandomAccessIterator last = end;
+
+    while (comp(pivot, *--last)) {}
+
+    if (last + 1 == end)
+    {
+        while ((last - first) > 0 && !comp(pivot, *++first)) {}
+    }
+    else
+    {
+        while (!comp(pivot, *++first)) {}
+    }
+
+    while ((last - first) > 0)
+    {
+        thor::swap(*first, *last);
+        while (comp(pivot, *--last)) {}
+        while (!comp(pivot, *++first)) {}
+    }
+
+    RandomAccessIterator pivot_pos = last;
+    *begin = *pivot_pos;
+    *pivot_pos = pivot;
+    return pivot_pos;
+}
+
+// Partitions [begin, end) around the pivot *begin, with elements equal to the pivot going right.
+// The pivot must be a median of at least three elements of the range so that the scans are bounded.
+// Returns the new position of the pivot; already_partitioned is set if no elements were swapped.
+template <class RandomAccessIterator, class T, class Compare>
+RandomAccessIterator __partition_right(RandomAccessIterator begin, RandomAccessIterator end, Compare comp, bool& already_partitioned, T*, const false_type&)
+{
+    T pivot(*begin);
+    RandomAccessIterator first = begin;
+    RandomAccessIterator last = end;
+
+    // Find the first element not less than the pivot, then the last element less than the pivot
+    while (comp(*++first, pivot)) {}
+
+    if (first - 1 == begin)
+    {
+        while ((last - first) > 0 && !comp(*--last, pivot)) {}
+    }
+    else
+    {
+        while (!comp(*--last, pivot)) {}
+    }
+
+    already_partitioned = (last - first) <= 0;
+
+    while ((last - first) > 0)
+    {
+        thor::swap(*first, *last);
+        while (comp(*++first, pivot)) {}
+        while (!comp(*--last, pivot)) {}
+    }
+
+    RandomAccessIterator pivot_pos = first - 1;
+    *begin = *pivot_pos;
+    *pivot_pos = pivot;
+    return pivot_pos;
+}
+
+// Exchanges num pairs of misplaced elements found by the block partition. A cyclic permutation
+// needs fewer moves than swapping, but swaps are needed when both blocks are full of misplaced
+// elements (descending input) to keep the partition linear.
+template <class RandomAccessIterator, class T>
+inline void __swap_offsets(RandomAccessIterator first, RandomAccessIterator last,
+                           const unsigned char* offsets_l, const unsigned char* offsets_r,
+                           thor_size_type num, bool use_swaps, T*)
+{
+    if (use_swaps)
+    {
+        for (thor_size_type i = 0; i < num; ++i)
+        {
+            thor::swap(*(first + offsets_l[i]), *(last - offsets_r[i]));
+        }
+    }
+    else if (num > 0)
+    {
+        RandomAccessIterator l = first + offsets_l[0];
+        RandomAccessIterator r = last - offsets_r[0];
+        T tmp(*l);
+        *l = *r;
+        for (thor_size_type i = 1; i < num; ++i)
+        {
+            l = first + offsets_l[i];
+            *r = *l;
+            r = last - offsets_r[i];
+            *l = *r;
+        }
+        *r = tmp;
+    }
+}
+
+// Branchless version of __partition_right for plain-old-data types. Blocks from each end are
+// scanned with the comparison result used as an index increment instead of a branch, recording
+// the offsets of misplaced elements, which are then exchanged in bulk.
+template <class RandomAccessIterator, class T, class Compare>
+RandomAccessIterator __partition_right(RandomAccessIterator begin, RandomAccessIterator end, Compare comp, bool& already_partitioned, T*, const true_type&)
+{
+    T pivot(*begin);
+    RandomAccessIterator first = begin;
+    RandomAccessIterator last = end;
+
+    while (comp(*++first, pivot)) {}
+
+    if (first - 1 == begin)
+    {
+        while ((last - first) > 0 && !comp(*--last, pivot)) {}
+    }
+    else
+    {
+        while (!comp(*--last, pivot)) {}
+    }
+
+    already_partitioned = (last - first) <= 0;
+    if (!already_partitioned)
+    {
+        // The initial scans stopped on a pair of misplaced elements
+        thor::swap(*first, *last);
+        ++first;
+
+        unsigned char offsets_l_storage[__sort_block_size];
+        unsigned char offsets_r_storage[__sort_block_size];
+        unsigned char* offsets_l = offsets_l_storage;
+        unsigned char* offsets_r = offsets_r_storage;
+        RandomAccessIterator offsets_l_base = first;
+        RandomAccessIterator offsets_r_base = last;
+        thor_size_type num_l = 0, num_r = 0, start_l = 0, start_r = 0;
+
+        while ((last - first) > 0)
+        {
+            // Fill the offset blocks that are empty, splitting the remainder if both are empty
+            const thor_size_type num_unknown = thor_size_type(last - first);
+            const thor_size_type left_split = num_l == 0 ? (num_r == 0 ? num_unknown / 2 : num_unknown) : 0;
+            const thor_size_type right_split = num_r == 0 ? (num_unknown - left_split) : 0;
+
+            const thor_size_type left_count = left_split >= thor_size_type(__sort_block_size) ? thor_size_type(__sort_block_size) : left_split;
+            for (thor_size_type i = 0; i < left_count; ++i)
+            {
+                offsets_l[num_l] = (unsigned char)i;
+                num_l += !comp(*first, pivot);
+                ++first;
+            }
+
+            const thor_size_type right_count = right_split >= thor_size_type(__sort_block_size) ? thor_size_type(__sort_block_size) : right_split;
+            for (thor_size_type i = 1; i <= right_count; ++i)
+            {
+                offsets_r[num_r] = (unsigned char)i;
+                num_r += comp(*--last, pivot);
+            }
+
+            const thor_size_type num = num_l < num_r ? num_l : num_r;
+            __swap_offsets(offsets_l_base, offsets_r_base, offsets_l + start_l, offsets_r + start_r, num, num_l == num_r, (T*)0);
+            num_l -= num;
+            num_r -= num;
+            start_l += num;
+            start_r += num;
+
+            if (num_l == 0)
+            {
+                start_l = 0;
+                offsets_l_base = first;
+            }
+            if (num_r == 0)
+            {
+                start_r = 0;
+                offsets_r_base = last;
+            }
+        }
+
+        // At most one side has misplaced elements left; move them into place
+        if (num_l != 0)
+        {
+            offsets_l += start_l;
+            while (num_l-- != 0)
+            {
+                thor::swap(*(offsets_l_base + offsets_l[num_l]), *--last);
+            }
+            first = last;
+        }
+        if (num_r != 0)
+        {
+            offsets_r += start_r;
+            while (num_r-- != 0)
+            {
+                thor::swap(*(offsets_r_base - offsets_r[num_r]), *first);
+                ++first;
+            }
+            last = first;
+        }
+    }
+
+    RandomAccessIterator pivot_pos = first - 1;
+    *begin = *pivot_pos;
+    *pivot_pos = pivot;
+    return pivot_pos;
+}
+
+// Moves the median of three, or the pseudomedian of nine for large ranges, to begin
+template <class RandomAccessIterator, class Compare>
+void __choose_pivot(RandomAccessIterator begin, RandomAccessIterator end, Compare comp)
+{
+    const thor_diff_type size = end - begin;
+    const thor_diff_type s2 = size / 2;
+    if (size > __sort_ninther_threshold)
+    {
+        __sort3(begin, begin + s2, end - 1, comp);
+        __sort3(begin + 1, begin + (s2 - 1), end - 2, comp);
+        __sort3(begin + 2, begin + (s2 + 1), end - 3, comp);
+        __sort3(begin + (s2 - 1), begin + s2, begin + (s2 + 1), comp);
+        thor::swap(*begin, *(begin + s2));
+    }
+    else
+    {
+        __sort3(begin + s2, begin, end - 1, comp);
+    }
+}
+
+// After an unbalanced partition, swaps a few elements of each side to break up the pattern that caused it
+template <class RandomAccessIterator>
+void __break_patterns(RandomAccessIterator begin, RandomAccessIterator pivot_pos, RandomAccessIterator end)
+{
+    const thor_diff_type l_size = pivot_pos - begin;
+    const thor_diff_type r_size = end - (pivot_pos + 1);
+    if (l_size >= __sort_insertion_threshold)
+    {
+        thor::swap(*begin, *(begin + l_size / 4));
+        thor::swap(*(pivot_pos - 1), *(pivot_pos - l_size / 4));
+        if (l_size > __sort_ninther_threshold)
+        {
+            thor::swap(*(begin + 1), *(begin + (l_size / 4 + 1)));
+            thor::swap(*(begin + 2), *(begin + (l_size / 4 + 2)));
+            thor::swap(*(pivot_pos - 2), *(pivot_pos - (l_size / 4 + 1)));
+            thor::swap(*(pivot_pos - 3), *(pivot_pos - (l_size / 4 + 2)));
+        }
+    }
+    if (r_size >= __sort_insertion_threshold)
+    {
+        thor::swap(*(pivot_pos + 1), *(pivot_pos + (1 + r_size / 4)));
+        thor::swap(*(end - 1), *(end - r_size / 4));
+        if (r_size > __sort_ninther_threshold)
+        {
+            thor::swap(*(pivot_pos + 2), *(pivot_pos + (2 + r_size / 4)));
+            thor::swap(*(pivot_pos + 3), *(pivot_pos + (3 + r_size / 4)));
+            thor::swap(*(end - 2), *(end - (1 + r_size / 4)));
+            thor::swap(*(end - 3), *(end - (2 + r_size / 4)));
+        }
+    }
+}
+
+template <class RandomAccessIterator, class T, class Compare, class PodType>
+void __pdqsort_loop(RandomAccessIterator begin, RandomAccessIterator end, Compare comp, int bad_allowed, bool leftmost, T*, const PodType& podtype)
+{
+    for (;;)
+    {
+        const thor_diff_type size = end - begin;
+
+        if (size < __sort_insertion_threshold)
+        {
+            if (leftmost)
+            {
+                __insertion_sort(begin, end, comp);
+            }
+            else
+            {
+                __unguarded_insertion_sort(begin, end, comp);
+            }
+            return;
+        }
+
+        __choose_pivot(begin, end, comp);
+
+        // If the pivot equals the element before this partition (the pivot of a previous
+        // partition), all elements equal to it can be placed at once and skipped.
+        if (!leftmost && !comp(*(begin - 1), *begin))
+        {
+            begin = __partition_left(begin, end, comp, (T*)0) + 1;
+            continue;
+        }
+
+        bool already_partitioned = false;
+        RandomAccessIterator pivot_pos = __partition_right(begin, end, comp, already_partitioned, (T*)0, podtype);
+
+        const thor_diff_type l_size = pivot_pos - begin;
+        const thor_diff_type r_size = end - (pivot_pos + 1);
+        if (l_size < size / 8 || r_size < size / 8)
+        {
+            // Too many bad partitions; fall back to heap sort
+            if (--bad_allowed == 0)
+            {
+                __heap_sort(begin, end, comp, (T*)0);
+                return;
+            }
+
+            // Break up patterns that may have caused the bad partition
+            __break_patterns(begin, pivot_pos, end);
+        }
+        else if (already_partitioned &&
+                 __partial_insertion_sort(begin, pivot_pos, comp, (T*)0) &&
+                 __partial_insertion_sort(pivot_pos + 1, end, comp, (T*)0))
+        {
+            // Both partitions were (nearly) sorted already
+            return;
+        }
+
+        // Recurse into the left partition and loop on the right
+        __pdqsort_loop(begin, pivot_pos, comp, bad_allowed, leftmost, (T*)0, podtype);
+        begin = pivot_pos + 1;
+        leftmost = false;
+    }
+}
+
+template<class T, class RandomAccessIterator, class Compare>
+void __sort_internal(RandomAccessIterator first, RandomAccessIterator last, Compare comp, T*)
+{
+    // Number of bad partitions allowed before falling back to heap sort: log2(n)
+    int bad_allowed = 0;
+    for (thor_diff_type n = last - first; n > 1; n >>= 1)
+    {
+        ++bad_allowed;
+    }
+    __pdqsort_loop(first, last, comp, bad_allowed, true, (T*)0, typename is_pod_type<T>::Type());
+}
+
+template <class RandomAccessIterator>
+void sort(RandomAccessIterator first, RandomAccessIterator last)
+{
+    if (first != last)
+    {
+        __sort_internal(first, last, __less_factory(THOR_GET_VALUE_TYPE(first, RandomAccessIterator)), THOR_GET_VALUE_TYPE(first, RandomAccessIterator));
+    }
+}
+
+template <class RandomAccessIterator, class Compare>
+void sort(RandomAccessIterator first, RandomAccessIterator last, Compare comp)
+{
+    if (first != last)
+    {
+        __sort_internal(first, last, comp, THOR_GET_VALUE_TYPE(first, RandomAccessIterator));
+    }
+}
+
+// stable_sort() implementation (using merge sort). 
 template <class RandomAccessIterator1, class RandomAccessIterator2, class Compare>
 void __merge_sort_loop(RandomAccessIterator1 first, RandomAccessIterator1 last, RandomAccessIterator2 result, difference_type step_size, Compare comp)
 {
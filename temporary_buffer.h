@@ -6,6 +6,13 @@
  * ** THOR INTERNAL FILE - NOT FOR APPLICATION USE **
  *
  * This file defines an internally-used temporary buffer (a sort of simplified vector).
+ *
+ * Plain-old-data elements are not constructed, since the algorithms using the buffer overwrite them.
+ * Small buffers are kept within the __TemporaryBuffer object itself (on the stack). Larger buffers
+ * come from a per-thread pool that keeps the largest recently freed block, so repeated sorts on the
+ * same thread don't allocate. Blocks larger than __temporary_buffer_pool_bytes are never kept. The
+ * pooled block is freed when a thor::thread exits; other threads should call
+ * __temporary_buffer_pool<>::release() before exiting if they used a temporary buffer.
  */
 
 #ifndef THOR_TEMPORARY_BUFFER_H
@@ -31,20 +38,100 @@
 namespace thor
 {
 
+enum
+{
+    __temporary_buffer_stack_bytes = 1024,      // Buffers up to this size are kept in the __TemporaryBuffer
+    __temporary_buffer_pool_bytes = 1 << 20,    // Larger blocks are freed instead of pooled
+};
+
+// One free block per thread. The template parameter is unused; the class is a template so that the
+// thread-local members can be defined in this header.
+template <int Unused = 0> class __temporary_buffer_pool
+{
+public:
+    // On return, bytes is the size of the block, which is larger than requested if it came from the pool
+    static thor_byte* alloc(size_type& bytes)
+    {
+        if (s_block != 0 && s_bytes >= bytes)
+        {
+            thor_byte* p = s_block;
+            bytes = s_bytes;
+            s_block = 0;
+            s_bytes = 0;
+            return p;
+        }
+        return memory::align_alloc_raw<0>(bytes);
+    }
+
+    // bytes is the size of the block as returned by alloc(); the larger of it and the pooled block is kept
+    static void free(thor_byte* p, size_type bytes)
+    {
+        if (bytes > __temporary_buffer_pool_bytes || bytes <= s_bytes)
+        {
+            memory::align_free_raw<0>(p);
+            return;
+        }
+        memory::align_free_raw<0>(s_block);
+        s_block = p;
+        s_bytes = bytes;
+    }
+
+    // Frees the pooled block of the calling thread
+    static void release()
+    {
+        memory::align_free_raw<0>(s_block);
+        s_block = 0;
+        s_bytes = 0;
+    }
+
+private:
+    static THOR_THREAD_LOCAL thor_byte* s_block;
+    static THOR_THREAD_LOCAL size_type s_bytes;
+};
+
+template <int Unused> THOR_THREAD_LOCAL thor_byte* __temporary_buffer_pool<Unused>::s_block = 0;
+template <int Unused> THOR_THREAD_LOCAL size_type __temporary_buffer_pool<Unused>::s_bytes = 0;
+
+// Storage for types that need more than the guaranteed alignment is not pooled
+template <size_type T_ALIGN> struct __temporary_storage
+{
+    static thor_byte* alloc(size_type& bytes)               { return memory::align_alloc_raw<T_ALIGN>(bytes); }
+    static void free(thor_byte* p, size_type)               { memory::align_free_raw<T_ALIGN>(p); }
+};
+
+template <> struct __temporary_storage<0>
+{
+    static thor_byte* alloc(size_type& bytes)               { return __temporary_buffer_pool<>::alloc(bytes); }
+    static void free(thor_byte* p, size_type bytes)         { __temporary_buffer_pool<>::free(p, bytes); }
+};
+
 template <class ForwardIterator, class T> class __TemporaryBuffer
 {
+    const static size_type alignment = memory::align_selector<T>::alignment;
+    typedef __temporary_storage<alignment> storage;
 public:
     __TemporaryBuffer(ForwardIterator first, ForwardIterator last)
     {
         m_size = thor::distance(first, last);
         m_requested_size = m_size;
-        m_elements = memory::align_alloc<T>::alloc(m_size);
-        typetraits<T>::range_construct(m_elements, m_elements + m_size);
+        m_bytes = size_type(m_size) * sizeof(T);
+        if (m_bytes <= __temporary_buffer_stack_bytes)
+        {
+            m_elements = (T*)memory::align_forward<alignment>(m_stack);
+        }
+        else
+        {
+            m_elements = (T*)storage::alloc(m_bytes);
+        }
+        construct(typename is_pod_type<T>::Type());
     }
     ~__TemporaryBuffer()
     {
-        typetraits<T>::range_destruct(m_elements, m_elements + m_size);
-        memory::align_alloc<T>::free(m_elements);
+        destruct(typename is_pod_type<T>::Type());
+        if (!is_stack())
+        {
+            storage::free((thor_byte*)m_elements, m_bytes);
+        }
         m_elements = 0;
     }
 
@@ -69,9 +156,21 @@ public:
     }
 
 private:
+    void construct(const true_type&)    {}
+    void construct(const false_type&)   { typetraits<T>::range_construct(m_elements, m_elements + m_size); }
+    void destruct(const true_type&)     {}
+    void destruct(const false_type&)    { typetraits<T>::range_destruct(m_elements, m_elements + m_size); }
+
+    bool is_stack() const
+    {
+        return (const thor_byte*)m_elements >= m_stack && (const thor_byte*)m_elements < m_stack + sizeof(m_stack);
+    }
+
     T* m_elements;
+    size_type m_bytes;              // The size of the block, which may be larger than needed if it came from the pool
     difference_type m_size;
     difference_type m_requested_size;
+    thor_byte m_stack[__temporary_buffer_stack_bytes + alignment];
 
     // Prevent copy/assign
     __TemporaryBuffer(const __TemporaryBuffer&);
@@ -0,0 +1,139 @@
+/* THOR - THOR Template Library
+ * Joshua M. Kriegshauser
+ *
+ * top_k.h
+ *
+ * This file defines top_k: an accumulator that keeps the first k values of a stream in the order
+ * given by Compare (the k smallest with less<T>, the k largest with greater<T>).
+ *
+ * - push() accepts one value at a time, so the stream never needs to be stored or sorted. It
+ *   returns false if the value was rejected because it can not be among the first k.
+ * - Values are appended to a buffer of 2*k entries. When the buffer fills it is reduced to the
+ *   best k with nth_element(), and the kth value becomes the threshold that later values must beat.
+ *   Once the threshold is established most values are rejected with a single comparison.
+ * - Values that compare equal to the threshold are rejected. Reduction is not stable, so when
+ *   several values tie for the last places, which of them are kept is unspecified.
+ * - extract_sorted() sorts the kept values into a vector and resets the accumulator.
+ *
+ * top_k
+ *   Time:
+ *     push            - amortized constant; O(n + k log k) to accumulate n values and extract
+ *     extract_sorted  - O(k log k)
+ *   Memory: 2*k values, allocated by the constructor.
+ *   Usage suggestions:
+ *     Prefer over sort() or partial_sort() when only the first few of many candidates are needed,
+ *     especially when the candidates are generated rather than stored.
+ */
+
+#ifndef THOR_TOP_K_H
+#define THOR_TOP_K_H
+#pragma once
+
+#ifndef THOR_VECTOR_H
+#include "vector.h"
+#endif
+
+#ifndef THOR_ALGORITHM_H
+#include "algorithm.h"
+#endif
+
+#ifndef THOR_FUNCTION_H
+#include "function.h"
+#endif
+
+namespace thor
+{
+
+template <class T, class Compare = less<T> > class top_k
+{
+    THOR_DECLARE_NOCOPY(top_k);
+public:
+    typedef T               value_type;
+    typedef thor_size_type  size_type;
+    typedef Compare         compare_type;
+
+    explicit top_k(size_type k, const compare_type& comp = compare_type()) :
+        m_k(k),
+        m_comp(comp),
+        m_full(false)
+    {
+        m_values.reserve(k * 2);
+    }
+
+    size_type k() const         { return m_k; }
+    size_type size() const      { return m_values.size() < m_k ? m_values.size() : m_k; }
+    bool empty() const          { return m_values.empty(); }
+    compare_type comp() const   { return m_comp; }
+
+    bool push(const value_type& t)
+    {
+        if (m_k == 0 || (m_full && !m_comp(t, m_values[m_k - 1])))
+        {
+            return false;
+        }
+        m_values.push_back(t);
+        if (m_values.size() == m_k * 2)
+        {
+            reduce();
+        }
+        return true;
+    }
+
+    template <class InputIterator> void push(InputIterator first, InputIterator last)
+    {
+        for (; first != last; ++first)
+        {
+            push(*first);
+        }
+    }
+
+    // Replaces the contents of out with the kept values in sorted order and empties the accumulator
+    void extract_sorted(vector<value_type>& out)
+    {
+        if (m_values.size() > m_k)
+        {
+            reduce();
+        }
+        thor::sort(m_values.begin(), m_values.end(), m_comp);
+        out.swap(m_values);
+        clear();
+    }
+
+    void clear()
+    {
+        m_values.clear();
+        m_values.reserve(m_k * 2);
+        m_full = false;
+    }
+
+    void swap(top_k& rhs)
+    {
+        thor::swap(m_k, rhs.m_k);
+        thor::swap(m_comp, rhs.m_comp);
+        thor::swap(m_full, rhs.m_full);
+        m_values.swap(rhs.m_values);
+    }
+
+private:
+    // Keeps only the first k values; the kth is left at m_values[m_k - 1] as the threshold
+    void reduce()
+    {
+        thor::nth_element(m_values.begin(), m_values.begin() + (m_k - 1), m_values.end(), m_comp);
+        m_values.erase(m_values.begin() + m_k, m_values.end());
+        m_full = true;
+    }
+
+    size_type m_k;
+    compare_type m_comp;
+    bool m_full;
+    vector<value_type> m_values;
+};
+
+template <class T, class Compare> void swap(top_k<T, Compare>& lhs, top_k<T, Compare>& rhs)
+{
+    lhs.swap(rhs);
+}
+
+} // namespace thor
+
+#endif
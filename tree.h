@@ -7,6 +7,10 @@
  *
  * This file defines a red-black tree to be used as a base for tree-type containers (map, set, multimap, multiset).
  * This class is not intended to be used outside of internal THOR implementation.
+ *
+ * If T_ORDER_STATS is true, each node also tracks the size of its subtree. This allows finding
+ * the n-th element, the index of an element and the distance between two iterators in
+ * logarithmic time.
  */
 
 #ifndef THOR_TREE_H
@@ -29,10 +33,14 @@
 #include "memory.h"
 #endif
 
+#ifndef THOR_FREELIST_H
+#include "freelist.h"
+#endif
+
 namespace thor
 {
 
-template <class Key, class Value, class KeyFromValue, class Compare>
+template <class Key, class Value, class KeyFromValue, class Compare, thor_size_type T_PREALLOC = 0, bool T_ORDER_STATS = false>
 class red_black_tree
 {
     enum node_color
@@ -203,7 +211,7 @@ public:
             m_root.m_size = 0;
     
             // Copy the key comparator.
-            m_root = rhs.key_comp();
+            static_cast<empty_member_opt&>(m_root) = rhs.key_comp();
 
             if (rhs.m_root.parent == 0)
             {
@@ -314,9 +322,17 @@ public:
         return pair<const_iterator,const_iterator>(lower_bound(k),upper_bound(k));
     }
 
+    // O(1) swap with another tree, unless preallocated
     void swap(red_black_tree& rhs)
     {
-        thor::swap(m_root, rhs.m_root);
+        if (!m_root.is_always_shareable())
+        {
+            // Preallocated storage cannot change owners, so move everything to the heap first
+            make_shareable();
+            rhs.make_shareable();
+        }
+
+        thor::swap(static_cast<empty_member_opt&>(m_root), static_cast<empty_member_opt&>(rhs.m_root));
         // Fixup terminators if in use
         if (rhs.m_root.left == terminator())
         {
@@ -402,6 +418,18 @@ public:
         }
     }
 
+    // Inserts a range that is sorted by key in O(size() + n) time. The existing nodes are merged
+    // with the range and rebuilt into a balanced tree without any rebalancing rotations.
+    template <class InputIterator> void insert_sorted_unique(InputIterator first, InputIterator last)
+    {
+        internal_insert_sorted(first, last, true);
+    }
+
+    template <class InputIterator> void insert_sorted_equal(InputIterator first, InputIterator last)
+    {
+        internal_insert_sorted(first, last, false);
+    }
+
     iterator iterator_from_value_type(const value_type& v)
     {
         THOR_DEBUG_ASSERT(&v != 0);
@@ -471,16 +499,102 @@ public:
     size_type count(const key_type& k) const
     {
         pair<const_iterator,const_iterator> p(equal_range(k));
-        return (size_type)distance(p.first, p.second);
+        return (size_type)thor::distance(p.first, p.second);
     }
 
     template<class K> iterator find(const K& k) { return iterator(internal_find(k), this); }
     template<class K> const_iterator find(const K& k) const { return const_iterator(internal_find(k), this); }
 
+    // Order statistics; only available if T_ORDER_STATS is true.
+    // Returns end() if n >= size()
+    iterator nth(size_type n) { return iterator(nth_internal(n), this); }
+    const_iterator nth(size_type n) const { return const_iterator(nth_internal(n), this); }
+
+    // Returns the index of the element at pos; index_of(end()) is size()
+    size_type index_of(const iterator_base& pos) const
+    {
+        verify_iterator(pos);
+        return index_of_internal(pos.m_node);
+    }
+
+    // Returns the number of elements less than k (the index of lower_bound(k))
+    size_type rank(const key_type& k) const
+    {
+        THOR_COMPILETIME_ASSERT(T_ORDER_STATS, OrderStatisticsNotEnabled);
+        size_type index = 0;
+        tree_node* x = m_root.parent;
+        while (x != 0)
+        {
+            if (!key_comp()(KeyFromValue()(x->value), k))
+            {
+                x = x->left;
+            }
+            else
+            {
+                index += node_counter::get(x->left) + 1;
+                x = x->right;
+            }
+        }
+        return index;
+    }
+
+    difference_type distance(const iterator_base& first, const iterator_base& last) const
+    {
+        return difference_type(index_of(last)) - difference_type(index_of(first));
+    }
+
 private:
     struct tree_node;
 
-    struct tree_node_base
+    // Number of nodes in the subtree rooted at a node, used for order statistics. The
+    // specialization for false adds nothing to the size of a node and does no work.
+    template <bool T_ENABLED, class Unused = void> struct subtree_count
+    {
+        size_type m_count;
+
+        subtree_count() : m_count(1) {}
+
+        static size_type get(const tree_node* node)             { return node != 0 ? node->m_count : 0; }
+        static void copy(tree_node* dest, const tree_node* src) { dest->m_count = src->m_count; }
+        static void update(tree_node* node)                     { node->m_count = get(node->left) + get(node->right) + 1; }
+
+        // x has been rotated below y; y now roots the subtree that x did
+        static void rotated(tree_node* x, tree_node* y)
+        {
+            copy(y, x);
+            update(x);
+        }
+
+        // Adjusts the counts of node and its ancestors up to (not including) end
+        static void increment_path(tree_node* node, tree_node* end)
+        {
+            for (; node != end; node = node->parent)
+            {
+                ++node->m_count;
+            }
+        }
+        static void decrement_path(tree_node* node, tree_node* end)
+        {
+            for (; node != end; node = node->parent)
+            {
+                THOR_DEBUG_ASSERT(node->m_count > 1);
+                --node->m_count;
+            }
+        }
+    };
+
+    template <class Unused> struct subtree_count<false, Unused>
+    {
+        static void copy(tree_node*, const tree_node*)          {}
+        static void update(tree_node*)                          {}
+        static void rotated(tree_node*, tree_node*)             {}
+        static void increment_path(tree_node*, tree_node*)      {}
+        static void decrement_path(tree_node*, tree_node*)      {}
+    };
+
+    typedef subtree_count<T_ORDER_STATS> node_counter;
+
+    struct tree_node_base : public node_counter
     {
         node_color  color;
         tree_node*  parent;
@@ -521,7 +635,33 @@ private:
         }
     };
 
-    empty_member_opt m_root;
+    // Preallocated storage for T_COUNT nodes. The specialization for zero adds nothing to the
+    // size of the tree.
+    template <size_type T_COUNT, class Unused = void> struct root_storage : public empty_member_opt
+    {
+        freelist<tree_node, T_COUNT> m_freelist;
+
+        root_storage(tree_node* term) : empty_member_opt(term) {}
+        root_storage(tree_node* term, const key_compare& k) : empty_member_opt(term, k) {}
+
+        tree_node* alloc_node()                     { return m_freelist.alloc_node(); }
+        bool free_node(tree_node* node)             { return m_freelist.free_node(node); }
+        bool is_owned_node(tree_node* node) const   { return m_freelist.is_owned_node(node); }
+        static bool is_always_shareable()           { return false; }
+    };
+
+    template <class Unused> struct root_storage<0, Unused> : public empty_member_opt
+    {
+        root_storage(tree_node* term) : empty_member_opt(term) {}
+        root_storage(tree_node* term, const key_compare& k) : empty_member_opt(term, k) {}
+
+        static tree_node* alloc_node()              { return 0; }
+        static bool free_node(tree_node*)           { return false; }
+        static bool is_owned_node(tree_node*)       { return false; }
+        static bool is_always_shareable()           { return true; }
+    };
+
+    root_storage<T_PREALLOC> m_root;
 
     tree_node* terminator() const { return (tree_node*)&static_cast<const tree_node_base&>(m_root); }
     void verify_iterator(const iterator_base& i) const { THOR_UNUSED(i); THOR_ASSERT(i.m_owner == this); }
@@ -531,15 +671,70 @@ private:
         return static_cast<key_compare&>(m_root);
     }
 
-    // Only allocates memory for the node; does not construct anything
+    // Only allocates memory for the node; does not construct anything. Preallocated nodes are
+    // used first, if any are available.
     tree_node* alloc_node()
     {
-        return memory::align_alloc<tree_node>::alloc();
+        tree_node* node = m_root.alloc_node();
+        return node != 0 ? node : memory::align_alloc<tree_node>::alloc();
     }
     // Only frees memory for the node; does not destroy anything
     void free_node(tree_node* node)
     {
-        memory::align_alloc<tree_node>::free(node);
+        if (!m_root.free_node(node))
+        {
+            memory::align_alloc<tree_node>::free(node);
+        }
+    }
+
+    // Moves all nodes out of preallocated storage and onto the heap
+    void make_shareable()
+    {
+        iterator_base iter(m_root.left, this);
+        while (iter.m_node != terminator())
+        {
+            tree_node* node = iter.m_node;
+            iter.incr();
+            if (m_root.is_owned_node(node))
+            {
+                tree_node* newnode = memory::align_alloc<tree_node>::alloc();
+                new (newnode) tree_node_base(static_cast<const tree_node_base&>(*node));
+                typetraits<value_type>::construct(&newnode->value, node->value);
+
+                // Fix up the parent (the root's parent is the terminator)
+                if (node->parent == terminator())
+                {
+                    m_root.parent = newnode;
+                }
+                else if (node->parent->left == node)
+                {
+                    node->parent->left = newnode;
+                }
+                else
+                {
+                    node->parent->right = newnode;
+                }
+
+                // Fix up the children and the leftmost/rightmost nodes
+                if (node->left != 0)
+                {
+                    node->left->parent = newnode;
+                }
+                if (node->right != 0)
+                {
+                    node->right->parent = newnode;
+                }
+                if (m_root.left == node)
+                {
+                    m_root.left = newnode;
+                }
+                if (m_root.right == node)
+                {
+                    m_root.right = newnode;
+                }
+                dealloc_node(node);
+            }
+        }
     }
 
     tree_node* create_node()
@@ -579,6 +774,7 @@ private:
         tree_node* tmp = create_node();
         typetraits<value_type>::construct(&tmp->value, x->value);
         tmp->color = x->color;
+        node_counter::copy(tmp, x);
         return tmp;
     }
 
@@ -609,6 +805,122 @@ private:
         return top;
     }
 
+    // Removes all nodes from the tree and returns them in order as a list linked through the
+    // right pointers. Walking backwards only reads the left pointers, so the right pointers can be
+    // reused as the list is built.
+    tree_node* flatten()
+    {
+        tree_node* list = 0;
+        iterator_base iter(m_root.right, this);
+        for (size_type i = size(); i != 0; --i)
+        {
+            tree_node* node = iter.m_node;
+            if (i != 1)
+            {
+                iter.decr();
+            }
+            node->right = list;
+            list = node;
+        }
+        m_root.left = m_root.right = terminator();
+        m_root.parent = 0;
+        m_root.m_size = 0;
+        return list;
+    }
+
+    // Builds a perfectly balanced tree from the first n nodes of list. Nodes at red_depth (only
+    // present if the last level is not full) are red so that every path has the same number of
+    // black nodes.
+    tree_node* build_balanced(tree_node*& list, size_type n, size_type depth, size_type red_depth)
+    {
+        if (n == 0)
+        {
+            return 0;
+        }
+        const size_type nleft = (n - 1) / 2;
+        tree_node* left = build_balanced(list, nleft, depth + 1, red_depth);
+        tree_node* node = list;
+        list = list->right;
+        node->left = left;
+        if (left != 0)
+        {
+            left->parent = node;
+        }
+        node->right = build_balanced(list, n - nleft - 1, depth + 1, red_depth);
+        if (node->right != 0)
+        {
+            node->right->parent = node;
+        }
+        node->color = depth == red_depth ? red : black;
+        node_counter::update(node);
+        return node;
+    }
+
+    template <class InputIterator> void internal_insert_sorted(InputIterator first, InputIterator last, bool unique)
+    {
+        tree_node* existing = flatten();
+        tree_node* list = 0;
+        tree_node** tail = &list;
+        tree_node* prev = 0;
+        size_type n = 0;
+#ifdef THOR_DEBUG
+        tree_node* prev_new = 0;
+#endif
+        for (; first != last; ++first)
+        {
+            const value_type& v = *first;
+            const Key& key = KeyFromValue()(v);
+            THOR_DEBUG_ASSERT(prev_new == 0 || !key_comp()(key, KeyFromValue()(prev_new->value))); // Range must be sorted
+
+            // Existing nodes that order before the new value go first. For non-unique trees, new
+            // values follow existing equal values just as insert_equal() does.
+            while (existing != 0 &&
+                   (unique ? key_comp()(KeyFromValue()(existing->value), key) : !key_comp()(key, KeyFromValue()(existing->value))))
+            {
+                *tail = prev = existing;
+                tail = &existing->right;
+                existing = existing->right;
+                ++n;
+            }
+
+            if (unique &&
+                ((prev != 0 && !key_comp()(KeyFromValue()(prev->value), key)) ||
+                 (existing != 0 && !key_comp()(key, KeyFromValue()(existing->value)))))
+            {
+                // Duplicate key
+                continue;
+            }
+
+            tree_node* node = create_node();
+            typetraits<value_type>::construct(&node->value, v);
+            *tail = prev = node;
+            tail = &node->right;
+            ++n;
+#ifdef THOR_DEBUG
+            prev_new = node;
+#endif
+        }
+        *tail = existing;
+        for (; existing != 0; existing = existing->right)
+        {
+            ++n;
+        }
+
+        if (n != 0)
+        {
+            size_type red_depth = 0;
+            for (size_type full = n + 1; full > 1; full >>= 1)
+            {
+                ++red_depth;
+            }
+            m_root.parent = build_balanced(list, n, 0, red_depth);
+            m_root.parent->parent = terminator();
+            m_root.left = minimum(m_root.parent);
+            m_root.right = maximum(m_root.parent);
+            m_root.m_size = n;
+        }
+    }
+
     void internal_erase(tree_node* x)
     {
         // erase without re-balancing
@@ -699,6 +1011,7 @@ private:
         }
         z->parent = y;
         z->left = z->right = 0;
+        node_counter::increment_path(y, terminator());
         rebalance(z, m_root.parent);
         ++m_root.m_size;
         return z;
@@ -782,6 +1095,8 @@ private:
             }
             x = y->right;
         }
+        // y is the node that is removed from its position in the tree
+        node_counter::decrement_path(y->parent, terminator());
         if (y != z)          // relink y in place of z.  y is z's successor
         {
             z->left->parent = y; 
@@ -814,6 +1129,7 @@ private:
                 z->parent->right = y;
             }
             y->parent = z->parent;
+            node_counter::copy(y, z);
             thor::swap(y->color, z->color);
             y = z;
             // y now points to node to be actually deleted
@@ -981,6 +1297,7 @@ private:
         }
         y->left = x;
         x->parent = y;
+        node_counter::rotated(x, y);
     }
 
     void rotate_right(tree_node* x, tree_node*& root)
@@ -1007,6 +1324,7 @@ private:
         }
         y->right = x;
         x->parent = y;
+        node_counter::rotated(x, y);
     }
 
     template <class K> tree_node* internal_find(const K& k) const
@@ -1032,6 +1350,48 @@ private:
         return y;
     }
 
+    tree_node* nth_internal(size_type n) const
+    {
+        THOR_COMPILETIME_ASSERT(T_ORDER_STATS, OrderStatisticsNotEnabled);
+        tree_node* x = m_root.parent;
+        while (x != 0)
+        {
+            const size_type left = node_counter::get(x->left);
+            if (n < left)
+            {
+                x = x->left;
+            }
+            else if (n == left)
+            {
+                return x;
+            }
+            else
+            {
+                n -= left + 1;
+                x = x->right;
+            }
+        }
+        return terminator();
+    }
+
+    size_type index_of_internal(tree_node* x) const
+    {
+        THOR_COMPILETIME_ASSERT(T_ORDER_STATS, OrderStatisticsNotEnabled);
+        if (x == terminator())
+        {
+            return size();
+        }
+        size_type index = node_counter::get(x->left);
+        for (; x != m_root.parent; x = x->parent)
+        {
+            if (x == x->parent->right)
+            {
+                index += node_counter::get(x->parent->left) + 1;
+            }
+        }
+        return index;
+    }
+
     tree_node* lower_bound_internal(const key_type& k) const
     {
         tree_node* y = terminator();            // Last node which is not less than k.
@@ -1,5 +1,7 @@
 #include "gtest/gtest.h"
 
+#include <limits>
+
 #include "../vector.h"
 #include "../list.h"
 #include "../algorithm.h"
@@ -151,3 +153,612 @@ TEST(algorithms, test_remove)
     V2.erase(thor::remove_if(V2.begin(), V2.end(), evenpred()), V2.end());
     EXPECT_TRUE(V2.size() == 5);
 }
+
+// Non-POD value sorted by key only, to exercise the branching partition and check stability of data
+struct sort_record
+{
+    int key;
+    int id;
+    sort_record(int k = 0, int i = 0) : key(k), id(i) {}
+    bool operator < (const sort_record& rhs) const { return key < rhs.key; }
+};
+
+template <class T> static void fill_pattern(thor::vector<T>& V, int pattern, int count)
+{
+    V.clear();
+    for (int i = 0; i != count; ++i)
+    {
+        int value;
+        switch (pattern)
+        {
+        case 0:  value = rand(); break;                                 // random
+        case 1:  value = i; break;                                      // sorted
+        case 2:  value = count - i; break;                              // reversed
+        case 3:  value = rand() % 4; break;                             // many duplicates
+        case 4:  value = i < count / 2 ? i : count - i; break;          // organ pipe
+        case 5:  value = (i % 100) == 0 ? rand() : i; break;            // nearly sorted
+        case 6:  value = 7; break;                                      // all equal
+        default: value = (i & 1) ? i : count - i; break;                // interleaved
+        }
+        V.push_back(T(value));
+    }
+}
+
+TEST(algorithms, test_sort)
+{
+    const int sizes[] = { 0, 1, 2, 3, 10, 23, 24, 25, 100, 128, 129, 1000, 100000 };
+    for (size_t s = 0; s != sizeof(sizes)/sizeof(sizes[0]); ++s)
+    {
+        for (int pattern = 0; pattern != 8; ++pattern)
+        {
+            thor::vector<int> V;
+            fill_pattern(V, pattern, sizes[s]);
+            thor::vector<int> expected(V);
+            thor::stable_sort(expected.begin(), expected.end());
+
+            thor::sort(V.begin(), V.end());
+            EXPECT_TRUE(V == expected);
+
+            // Descending with a comparison functor
+            thor::sort(V.begin(), V.end(), thor::greater<int>());
+            thor::reverse(expected.begin(), expected.end());
+            EXPECT_TRUE(V == expected);
+
+            // Non-POD values
+            thor::vector<sort_record> R;
+            fill_pattern(R, pattern, sizes[s]);
+            for (size_t i = 0; i != R.size(); ++i)
+            {
+                R[i].id = R[i].key * 3;
+            }
+            thor::sort(R.begin(), R.end());
+            for (size_t i = 0; i != R.size(); ++i)
+            {
+                EXPECT_EQ(R[i].key * 3, R[i].id);
+                if (i != 0)
+                {
+                    EXPECT_LE(R[i - 1].key, R[i].key);
+                }
+            }
+        }
+    }
+
+    // Raw arrays
+    double D[] = { 3.5, -1.0, 2.25, 8.0, 0.0, -7.5, 2.25 };
+    thor::sort(D, D + 7);
+    for (int i = 1; i != 7; ++i)
+    {
+        EXPECT_LE(D[i - 1], D[i]);
+    }
+}
+
+TEST(algorithms, test_stable_sort)
+{
+    // Sizes within the buffer's stack storage, from the per-thread pool and too large to pool; each
+    // is sorted twice to reuse the pooled block
+    const int sizes[] = { 0, 1, 100, 128, 129, 5000, 1000, 200000, 5000 };
+    for (size_t s = 0; s != sizeof(sizes)/sizeof(sizes[0]); ++s)
+    {
+        for (int pass = 0; pass != 2; ++pass)
+        {
+            thor::vector<sort_record> R;
+            for (int i = 0; i != sizes[s]; ++i)
+            {
+                R.push_back(sort_record(rand() % 50, i));
+            }
+            thor::stable_sort(R.begin(), R.end());
+            for (size_t i = 1; i < R.size(); ++i)
+            {
+                EXPECT_TRUE(R[i - 1].key < R[i].key || (R[i - 1].key == R[i].key && R[i - 1].id < R[i].id));
+            }
+
+            thor::vector<int> V;
+            fill_pattern(V, pass, sizes[s]);
+            thor::stable_sort(V.begin(), V.end(), thor::greater<int>());
+            for (size_t i = 1; i < V.size(); ++i)
+            {
+                EXPECT_GE(V[i - 1], V[i]);
+            }
+        }
+    }
+}
+
+struct sort_record_key
+{
+    typedef int result_type;
+    int operator () (const sort_record& r) const { return r.key; }
+};
+
+TEST(algorithms, test_radix_sort)
+{
+    const int sizes[] = { 0, 1, 2, 63, 64, 65, 1000, 100000 };
+    for (size_t s = 0; s != sizeof(sizes)/sizeof(sizes[0]); ++s)
+    {
+        for (int pattern = 0; pattern != 8; ++pattern)
+        {
+            // Signed values, including negatives
+            thor::vector<int> V;
+            fill_pattern(V, pattern, sizes[s]);
+            for (size_t i = 0; i < V.size(); i += 3)
+            {
+                V[i] = -V[i];
+            }
+            thor::vector<int> expected(V);
+            thor::sort(expected.begin(), expected.end());
+
+            thor::vector<int> V2(V);
+            thor::radix_sort(V.begin(), V.end());
+            EXPECT_TRUE(V == expected);
+            thor::radix_sort_msd(V2.begin(), V2.end());
+            EXPECT_TRUE(V2 == expected);
+
+            // Stable by extracted key
+            thor::vector<sort_record> R;
+            fill_pattern(R, pattern, sizes[s]);
+            for (size_t i = 0; i != R.size(); ++i)
+            {
+                R[i].key %= 1000;
+                R[i].id = int(i);
+            }
+            thor::vector<sort_record> R2(R);
+            thor::radix_sort(R.begin(), R.end(), sort_record_key());
+            thor::radix_sort_msd(R2.begin(), R2.end(), sort_record_key());
+            for (size_t i = 1; i < R.size(); ++i)
+            {
+                EXPECT_LE(R[i - 1].key, R[i].key);
+                if (R[i - 1].key == R[i].key)
+                {
+                    EXPECT_LT(R[i - 1].id, R[i].id);
+                }
+                EXPECT_EQ(R[i].key, R2[i].key);
+            }
+        }
+    }
+
+    // 64-bit and unsigned keys
+    thor::vector<uint64> U64;
+    thor::vector<long long> S64;
+    for (int i = 0; i != 5000; ++i)
+    {
+        const uint64 u = (uint64(rand()) << 40) ^ (uint64(rand()) << 20) ^ uint64(rand());
+        U64.push_back(u);
+        S64.push_back((long long)u * ((i & 1) ? -1 : 1));
+    }
+    thor::radix_sort(U64.begin(), U64.end());
+    thor::radix_sort_msd(S64.begin(), S64.end());
+    for (size_t i = 1; i != U64.size(); ++i)
+    {
+        EXPECT_LE(U64[i - 1], U64[i]);
+        EXPECT_LE(S64[i - 1], S64[i]);
+    }
+
+    // Floating point, including negative zero and infinities
+    float F[] = { 3.5f, -1.0f, 2.25f, -0.0f, 0.0f, 1e30f, -7.5f, -1e-30f, 2.25f, 1.0f / 0.0f, -1.0f / 0.0f };
+    const int NF = sizeof(F)/sizeof(F[0]);
+    double D[NF];
+    for (int i = 0; i != NF; ++i)
+    {
+        D[i] = F[i];
+    }
+    thor::radix_sort(F, F + NF);
+    thor::radix_sort_msd(D, D + NF);
+    for (int i = 1; i != NF; ++i)
+    {
+        EXPECT_LE(F[i - 1], F[i]);
+        EXPECT_LE(D[i - 1], D[i]);
+    }
+}
+
+TEST(algorithms, test_selection)
+{
+    const int sizes[] = { 1, 2, 3, 23, 24, 25, 100, 1000, 100000 };
+    for (size_t s = 0; s != sizeof(sizes)/sizeof(sizes[0]); ++s)
+    {
+        const int n = sizes[s];
+        const int positions[] = { 0, 1, n / 8, n / 2, n - 2, n - 1 };
+        for (int pattern = 0; pattern != 8; ++pattern)
+        {
+            thor::vector<int> V;
+            fill_pattern(V, pattern, n);
+            thor::vector<int> expected(V);
+            thor::sort(expected.begin(), expected.end());
+
+            for (size_t p = 0; p != sizeof(positions)/sizeof(positions[0]); ++p)
+            {
+                const int pos = positions[p];
+                if (pos < 0 || pos >= n)
+                {
+                    continue;
+                }
+
+                thor::vector<int> W(V);
+                thor::nth_element(W.begin(), W.begin() + pos, W.end());
+                EXPECT_EQ(expected[pos], W[pos]);
+                for (int i = 0; i != n; ++i)
+                {
+                    if (i < pos) EXPECT_LE(W[i], W[pos]);
+                    if (i > pos) EXPECT_GE(W[i], W[pos]);
+                }
+
+                // partial_sort with k = pos + 1
+                W = V;
+                thor::partial_sort(W.begin(), W.begin() + (pos + 1), W.end());
+                EXPECT_TRUE(thor::equal(W.begin(), W.begin() + (pos + 1), expected.begin()));
+                thor::sort(W.begin(), W.end());
+                EXPECT_TRUE(W == expected);
+
+                // partial_sort_copy from a list (input iterators), largest first
+                thor::list<int> L(V.begin(), V.end());
+                thor::vector<int> R;
+                R.resize(pos + 1);
+                thor::vector<int>::iterator end = thor::partial_sort_copy(L.begin(), L.end(), R.begin(), R.end(), thor::greater<int>());
+                EXPECT_TRUE(end == R.end());
+                for (int i = 0; i <= pos; ++i)
+                {
+                    EXPECT_EQ(expected[n - 1 - i], R[i]);
+                }
+            }
+
+            // Non-POD values
+            thor::vector<sort_record> SR;
+            for (int i = 0; i != n; ++i)
+            {
+                SR.push_back(sort_record(V[i], i));
+            }
+            thor::nth_element(SR.begin(), SR.begin() + n / 2, SR.end());
+            EXPECT_EQ(expected[n / 2], SR[n / 2].key);
+        }
+    }
+
+    // Result range larger than the input
+    const int in[] = { 5, 3, 9, 1 };
+    int out[6] = { 0 };
+    int* out_end = thor::partial_sort_copy(in, in + 4, out, out + 6);
+    EXPECT_EQ(4, out_end - out);
+    EXPECT_EQ(1, out[0]);
+    EXPECT_EQ(9, out[3]);
+    EXPECT_EQ(0, out[4]);
+
+    // Empty ranges
+    thor::nth_element(out, out, out);
+    thor::partial_sort(out, out, out + 6);
+    EXPECT_TRUE(thor::partial_sort_copy(in, in + 4, out, out) == out);
+}
+
+TEST(algorithms, test_pod_fast_paths)
+{
+    // Overlapping copies in both directions, through vector iterators
+    thor::vector<int> V;
+    for (int i = 0; i != 100; ++i)
+    {
+        V.push_back(i);
+    }
+    thor::vector<int>::iterator result = thor::copy(V.begin() + 10, V.end(), V.begin());
+    EXPECT_TRUE(result == V.begin() + 90);
+    EXPECT_EQ(10, V[0]);
+    EXPECT_EQ(99, V[89]);
+    EXPECT_EQ(90, V[90]);
+
+    result = thor::copy_backward(V.begin(), V.begin() + 90, V.end());
+    EXPECT_TRUE(result == V.begin() + 10);
+    EXPECT_EQ(10, V[10]);
+    EXPECT_EQ(99, V[99]);
+
+    // Mixed iterator types still use the element-wise copy
+    thor::list<int> L(V.begin(), V.end());
+    thor::vector<int> V2;
+    V2.resize(100);
+    thor::vector<int>::iterator end = thor::copy(L.begin(), L.end(), V2.begin());
+    EXPECT_TRUE(end == V2.end());
+    EXPECT_TRUE(V == V2);
+
+    const int* cp = &V[0];
+    int raw[100];
+    EXPECT_EQ(raw + 100, thor::copy(cp, cp + 100, raw));
+    EXPECT_TRUE(thor::equal(V.begin(), V.end(), raw));
+    EXPECT_TRUE(thor::equal(raw, raw + 100, V2.begin()));
+    raw[50] = -1;
+    EXPECT_FALSE(thor::equal(V.begin(), V.end(), raw));
+    EXPECT_TRUE(thor::equal(V.begin(), V.end(), L.begin()));
+
+    // fill and fill_n, with values that can and can not be memset
+    thor::fill(V.begin(), V.end(), 0);
+    EXPECT_EQ(0, V[0]);
+    EXPECT_EQ(0, V[99]);
+    thor::fill(V.begin(), V.end(), -1);
+    EXPECT_EQ(-1, V[0]);
+    EXPECT_EQ(-1, V[99]);
+    thor::fill(V.begin() + 1, V.end() - 1, 0x01020304);
+    EXPECT_EQ(-1, V[0]);
+    EXPECT_EQ(0x01020304, V[1]);
+    EXPECT_EQ(0x01020304, V[98]);
+    EXPECT_EQ(-1, V[99]);
+    EXPECT_TRUE(thor::fill_n(V.begin(), 5, 7) == V.begin() + 5);
+    EXPECT_EQ(7, V[4]);
+    EXPECT_EQ(0x01020304, V[5]);
+    EXPECT_TRUE(thor::fill_n(V.begin(), 0, 8) == V.begin());
+
+    double D[4];
+    thor::fill(D, D + 4, 0.0);
+    EXPECT_EQ(0.0, D[3]);
+    thor::fill_n(D, 4, 1.5);
+    EXPECT_EQ(1.5, D[0]);
+
+    char C[16];
+    thor::fill(C, C + 16, 'x');
+    EXPECT_EQ('x', C[15]);
+
+    // Floating point equality is not bitwise
+    const float F1[] = { 0.0f, 1.0f };
+    const float F2[] = { -0.0f, 1.0f };
+    EXPECT_TRUE(thor::equal(F1, F1 + 2, F2));
+
+    // Byte-wise lexicographical compare
+    const unsigned char B1[] = { 1, 2, 200 };
+    const unsigned char B2[] = { 1, 2, 3, 4 };
+    EXPECT_FALSE(thor::lexicographical_compare(B1, B1 + 3, B2, B2 + 4));
+    EXPECT_TRUE(thor::lexicographical_compare(B2, B2 + 4, B1, B1 + 3));
+    EXPECT_TRUE(thor::lexicographical_compare(B1, B1 + 2, B1, B1 + 3));
+    EXPECT_FALSE(thor::lexicographical_compare(B1, B1 + 3, B1, B1 + 3));
+    const char S1[] = { 'a', -5 };
+    const char S2[] = { 'a', 5 };
+    EXPECT_TRUE(thor::lexicographical_compare(S1, S1 + 2, S2, S2 + 2));
+}
+
+// Element-wise versions of the vectorized algorithms, for comparison
+template <class T> static size_t scalar_find(const T* p, size_t n, T t)
+{
+    size_t i = 0;
+    while (i != n && !(p[i] == t)) ++i;
+    return i;
+}
+
+template <class T> static size_t scalar_count(const T* p, size_t n, T t)
+{
+    size_t c = 0;
+    for (size_t i = 0; i != n; ++i) c += (p[i] == t);
+    return c;
+}
+
+template <class T> static size_t scalar_min_element(const T* p, size_t n)
+{
+    size_t found = 0;
+    for (size_t i = 0; i < n; ++i) if (p[i] < p[found]) found = i;
+    return found;
+}
+
+template <class T> static size_t scalar_max_element(const T* p, size_t n)
+{
+    size_t found = 0;
+    for (size_t i = 0; i < n; ++i) if (p[found] < p[i]) found = i;
+    return found;
+}
+
+struct is_five
+{
+    bool operator () (int i) const { return i == 5; }
+};
+
+template <class T> static void check_simd(const thor::vector<T>& V)
+{
+    const T* p = V.empty() ? 0 : &V[0];
+    const size_t n = V.size();
+    for (size_t i = 0; i < n; i += 1 + n / 50)
+    {
+        EXPECT_EQ(scalar_find(p, n, V[i]), size_t(thor::find(V.begin(), V.end(), V[i]) - V.begin()));
+        EXPECT_EQ(scalar_count(p, n, V[i]), size_t(thor::count(p, p + n, V[i])));
+    }
+    EXPECT_EQ(scalar_find(p, n, T(3)), size_t(thor::find(p, p + n, T(3)) - p));
+    EXPECT_EQ(n, size_t(thor::find(p, p + n, T(1000)) - p));
+    EXPECT_EQ(scalar_min_element(p, n), size_t(thor::min_element(V.begin(), V.end()) - V.begin()));
+    EXPECT_EQ(scalar_max_element(p, n), size_t(thor::max_element(p, p + n) - p));
+    EXPECT_TRUE(thor::equal(V.begin(), V.end(), p));
+}
+
+TEST(algorithms, test_simd)
+{
+    // Integers of each size and signedness, including the extremes
+    const int sizes[] = { 0, 1, 3, 7, 8, 15, 16, 17, 33, 100, 1023, 1024, 1025, 5000 };
+    for (size_t s = 0; s != sizeof(sizes)/sizeof(sizes[0]); ++s)
+    {
+        thor::vector<int> I;
+        thor::vector<unsigned int> U;
+        thor::vector<long long> L;
+        thor::vector<unsigned long long> UL;
+        thor::vector<float> F;
+        thor::vector<double> D;
+        for (int i = 0; i != sizes[s]; ++i)
+        {
+            const int r = (rand() % 64) - 32;
+            I.push_back(r);
+            U.push_back(r < -28 ? 0xffffffffu - unsigned(r + 32) : unsigned(r));
+            L.push_back(r < -28 ? (long long)0x8000000000000000ULL + r + 32 : (long long)r * (1ll << 33));
+            UL.push_back(r < -28 ? 0xffffffffffffffffULL - unsigned(r + 32) : (unsigned long long)r);
+            F.push_back(r == -32 ? -0.0f : float(r) * 0.5f);
+            D.push_back(r == -31 ? -0.0 : r * 0.25);
+        }
+        check_simd(I);
+        check_simd(U);
+        check_simd(L);
+        check_simd(UL);
+        check_simd(F);
+        check_simd(D);
+
+        // Integer sums wrap, so they match in any order; floating point sums are only approximately equal
+        EXPECT_EQ(thor::__internal_accumulate(I.begin(), I.end(), 7), thor::accumulate(I.begin(), I.end(), 7));
+        EXPECT_EQ(thor::__internal_accumulate(U.begin(), U.end(), 7u), thor::accumulate(U.begin(), U.end(), 7u));
+        EXPECT_EQ(thor::__internal_accumulate(UL.begin(), UL.end(), 7ull), thor::accumulate(UL.begin(), UL.end(), 7ull));
+        EXPECT_EQ(thor::__internal_accumulate(F.begin(), F.end(), 1.f), thor::accumulate(F.begin(), F.end(), 1.f));
+        EXPECT_FLOAT_EQ(thor::accumulate(F.begin(), F.end(), 1.f), thor::accumulate_unordered(F.begin(), F.end(), 1.f));
+        EXPECT_DOUBLE_EQ(thor::accumulate(D.begin(), D.end(), 1.0), thor::accumulate_unordered(D.begin(), D.end(), 1.0));
+        EXPECT_EQ(thor::accumulate(I.begin(), I.end(), 0LL), thor::accumulate_unordered(I.begin(), I.end(), 0LL));
+    }
+
+    // Values that can't be represented by the element type are never found
+    thor::vector<int> I;
+    I.resize(100, 5);
+    EXPECT_TRUE(thor::find(I.begin(), I.end(), 5ll + (1ll << 32)) == I.end());
+    EXPECT_EQ(0, thor::count(I.begin(), I.end(), 5ll + (1ll << 32)));
+    EXPECT_EQ(100, thor::count(I.begin(), I.end(), 5ll));
+    EXPECT_EQ(100, thor::count_if(I.begin(), I.end(), is_five()));
+    thor::vector<float> F;
+    F.resize(100, 1.5f);
+    EXPECT_TRUE(thor::find(F.begin(), F.end(), 1) == F.end());
+    EXPECT_TRUE(thor::find(F.begin(), F.end(), 1.5f) == F.begin());
+
+    // NaN never compares equal, and is skipped by min_element() and max_element() unless it comes first
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    F[40] = nan;
+    F[41] = -1.f;
+    F[70] = 2.f;
+    EXPECT_TRUE(thor::find(F.begin(), F.end(), nan) == F.end());
+    EXPECT_EQ(0, thor::count(F.begin(), F.end(), nan));
+    EXPECT_EQ(41, thor::min_element(F.begin(), F.end()) - F.begin());
+    EXPECT_EQ(70, thor::max_element(F.begin(), F.end()) - F.begin());
+    EXPECT_FALSE(thor::equal(F.begin(), F.end(), F.begin()));
+    F[0] = nan;
+    EXPECT_EQ(0, thor::min_element(F.begin(), F.end()) - F.begin());
+    EXPECT_EQ(0, thor::max_element(F.begin(), F.end()) - F.begin());
+
+    // -0.0 equals 0.0, and the first of equal extremes is returned
+    thor::vector<double> D;
+    D.resize(50, 1.0);
+    D[10] = 0.0;
+    D[20] = -0.0;
+    thor::vector<double> D2(D);
+    D2[10] = -0.0;
+    EXPECT_TRUE(thor::equal(D.begin(), D.end(), D2.begin()));
+    EXPECT_EQ(10, thor::find(D.begin(), D.end(), -0.0) - D.begin());
+    EXPECT_EQ(2, thor::count(D.begin(), D.end(), 0.0));
+    EXPECT_EQ(10, thor::min_element(D.begin(), D.end()) - D.begin());
+    EXPECT_EQ(0, thor::max_element(D.begin(), D.end()) - D.begin());
+}
+
+TEST(algorithms, test_binary_search)
+{
+    // The random access (branchless) searches must agree with the forward iterator searches
+    thor::vector<int> V;
+    for (int i = 0; i != 2000; ++i)
+    {
+        V.push_back(rand() % 500);
+    }
+    thor::sort(V.begin(), V.end());
+    thor::list<int> L(V.begin(), V.end());
+
+    for (int v = -1; v <= 501; ++v)
+    {
+        const thor::vector<int>::iterator lb = thor::lower_bound(V.begin(), V.end(), v);
+        const thor::vector<int>::iterator ub = thor::upper_bound(V.begin(), V.end(), v);
+        EXPECT_TRUE(lb == V.end() || !(*lb < v));
+        EXPECT_TRUE(lb == V.begin() || *(lb - 1) < v);
+        EXPECT_TRUE(ub == V.end() || v < *ub);
+        EXPECT_TRUE(ub == V.begin() || !(v < *(ub - 1)));
+
+        const thor::pair<thor::vector<int>::iterator, thor::vector<int>::iterator> range = thor::equal_range(V.begin(), V.end(), v);
+        EXPECT_TRUE(range.first == lb);
+        EXPECT_TRUE(range.second == ub);
+
+        const thor::pair<thor::list<int>::iterator, thor::list<int>::iterator> lrange = thor::equal_range(L.begin(), L.end(), v, thor::less<int>());
+        EXPECT_EQ(lb - V.begin(), thor::distance(L.begin(), lrange.first));
+        EXPECT_EQ(ub - V.begin(), thor::distance(L.begin(), lrange.second));
+        EXPECT_TRUE(thor::lower_bound(L.begin(), L.end(), v) == lrange.first);
+        EXPECT_TRUE(thor::upper_bound(L.begin(), L.end(), v) == lrange.second);
+
+        const int* p = &V[0];
+        EXPECT_EQ(lb - V.begin(), thor::lower_bound(p, p + V.size(), v, thor::less<int>()) - p);
+        EXPECT_EQ(ub - V.begin(), thor::upper_bound(p, p + V.size(), v) - p);
+    }
+
+    // Empty and single-element ranges
+    const int one = 5;
+    EXPECT_EQ(&one, thor::lower_bound(&one, &one, 5));
+    EXPECT_EQ(&one, thor::lower_bound(&one, &one + 1, 5));
+    EXPECT_EQ(&one + 1, thor::upper_bound(&one, &one + 1, 5));
+    EXPECT_EQ(&one + 1, thor::lower_bound(&one, &one + 1, 6));
+}
+
+template <class T> void check_set_operations(const thor::vector<T>& A, const thor::vector<T>& B)
+{
+    // The list versions take the element-wise path; the vector versions may gallop or use SIMD
+    const thor::list<T> LA(A.begin(), A.end());
+    const thor::list<T> LB(B.begin(), B.end());
+    thor::vector<T> out, expect;
+    out.resize(A.size() + B.size());
+    expect.resize(A.size() + B.size());
+
+    thor_diff_type n = thor::set_intersection(A.begin(), A.end(), B.begin(), B.end(), out.begin()) - out.begin();
+    thor_diff_type m = thor::set_intersection(LA.begin(), LA.end(), LB.begin(), LB.end(), expect.begin()) - expect.begin();
+    EXPECT_EQ(m, n);
+    EXPECT_TRUE(thor::equal(expect.begin(), expect.begin() + m, out.begin()));
+    n = thor::set_intersection(A.begin(), A.end(), B.begin(), B.end(), out.begin(), thor::less<T>()) - out.begin();
+    EXPECT_EQ(m, n);
+    EXPECT_TRUE(thor::equal(expect.begin(), expect.begin() + m, out.begin()));
+
+    n = thor::set_union(A.begin(), A.end(), B.begin(), B.end(), out.begin()) - out.begin();
+    m = thor::set_union(LA.begin(), LA.end(), LB.begin(), LB.end(), expect.begin()) - expect.begin();
+    EXPECT_EQ(m, n);
+    EXPECT_TRUE(thor::equal(expect.begin(), expect.begin() + m, out.begin()));
+
+    n = thor::set_difference(A.begin(), A.end(), B.begin(), B.end(), out.begin()) - out.begin();
+    m = thor::set_difference(LA.begin(), LA.end(), LB.begin(), LB.end(), expect.begin()) - expect.begin();
+    EXPECT_EQ(m, n);
+    EXPECT_TRUE(thor::equal(expect.begin(), expect.begin() + m, out.begin()));
+
+    n = thor::set_symmetric_difference(A.begin(), A.end(), B.begin(), B.end(), out.begin()) - out.begin();
+    m = thor::set_symmetric_difference(LA.begin(), LA.end(), LB.begin(), LB.end(), expect.begin()) - expect.begin();
+    EXPECT_EQ(m, n);
+    EXPECT_TRUE(thor::equal(expect.begin(), expect.begin() + m, out.begin()));
+}
+
+template <class T> void check_random_set_operations(size_t size1, size_t size2, int range)
+{
+    thor::vector<T> A, B;
+    for (size_t i = 0; i != size1; ++i)
+    {
+        A.push_back(T(rand() % range));
+    }
+    for (size_t i = 0; i != size2; ++i)
+    {
+        B.push_back(T(rand() % range));
+    }
+    thor::sort(A.begin(), A.end());
+    thor::sort(B.begin(), B.end());
+    check_set_operations(A, B);
+    check_set_operations(B, A);
+}
+
+TEST(algorithms, test_set_operations)
+{
+    const int a[] = { 1, 2, 2, 2, 3, 5, 7, 7 };
+    const int b[] = { 2, 2, 4, 5, 7, 7, 7, 9 };
+    int out[16];
+
+    const int intersection[] = { 2, 2, 5, 7, 7 };
+    EXPECT_EQ(5, thor::set_intersection(a, a + 8, b, b + 8, out) - out);
+    EXPECT_TRUE(thor::equal(intersection, intersection + 5, out));
+
+    const int set_union[] = { 1, 2, 2, 2, 3, 4, 5, 7, 7, 7, 9 };
+    EXPECT_EQ(11, thor::set_union(a, a + 8, b, b + 8, out) - out);
+    EXPECT_TRUE(thor::equal(set_union, set_union + 11, out));
+
+    const int difference[] = { 1, 2, 3 };
+    EXPECT_EQ(3, thor::set_difference(a, a + 8, b, b + 8, out) - out);
+    EXPECT_TRUE(thor::equal(difference, difference + 3, out));
+
+    const int symmetric_difference[] = { 1, 2, 3, 4, 7, 9 };
+    EXPECT_EQ(6, thor::set_symmetric_difference(a, a + 8, b, b + 8, out) - out);
+    EXPECT_TRUE(thor::equal(symmetric_difference, symmetric_difference + 6, out));
+
+    // Similar sizes (merged, or SIMD for integers) and skewed sizes (galloping), with many duplicates, some and few
+    const size_t sizes[][2] = { { 0, 0 }, { 0, 10 }, { 1, 1 }, { 7, 9 }, { 1000, 1000 }, { 1000, 3000 }, { 50, 5000 }, { 3, 100000 } };
+    for (size_t i = 0; i != sizeof(sizes) / sizeof(sizes[0]); ++i)
+    {
+        check_random_set_operations<int>(sizes[i][0], sizes[i][1], 50);
+        check_random_set_operations<int>(sizes[i][0], sizes[i][1], 3000);
+        check_random_set_operations<int>(sizes[i][0], sizes[i][1], 200000);
+        check_random_set_operations<unsigned long long>(sizes[i][0], sizes[i][1], 50);
+        check_random_set_operations<unsigned long long>(sizes[i][0], sizes[i][1], 3000);
+        check_random_set_operations<unsigned long long>(sizes[i][0], sizes[i][1], 200000);
+        check_random_set_operations<double>(sizes[i][0], sizes[i][1], 50);
+    }
+}
@@ -139,6 +139,32 @@ template<unsigned N> void test_bitset()
         EXPECT_TRUE(test2.test(0));
         EXPECT_TRUE(test2.test(1));
     }
+
+    {
+        bitset test(0);
+        EXPECT_EQ(test.size(), test.find_first());
+        test.set(count - 1);
+        EXPECT_EQ(count - 1, test.find_first());
+        EXPECT_EQ(test.size(), test.find_next(count - 1));
+        if (THOR_SUPPRESS_WARNING(count > 1))
+        {
+            test.set(count / 2);
+            test.set(0);
+            EXPECT_EQ(0, test.find_first());
+            EXPECT_EQ(count / 2, test.find_next(0));
+            EXPECT_EQ(count - 1, test.find_next(count / 2));
+        }
+
+        // Visiting the set bits finds count() of them
+        bitset all(0);
+        all.set();
+        bitset::size_type found = 0;
+        for (bitset::size_type i = all.find_first(); i != all.size(); i = all.find_next(i))
+        {
+            EXPECT_EQ(found++, i);
+        }
+        EXPECT_EQ(all.count(), found);
+    }
 }
 
 TEST(bitset, initial)
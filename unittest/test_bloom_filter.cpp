@@ -0,0 +1,124 @@
+#include "test_common.h"
+#include "../bloom_filter.h"
+#include "../cuckoo_filter.h"
+
+using namespace thor;
+
+TEST(bloom_filter, blocked_bloom_filter)
+{
+    blocked_bloom_filter<int> f(10000);
+    EXPECT_TRUE(f.empty());
+    EXPECT_EQ(f.hash_count(), 7);
+    EXPECT_TRUE(f.bit_count() >= 10000 * 10);
+    EXPECT_FALSE(f.contains(1));
+
+    for (int i = 0; i < 10000; ++i)
+    {
+        f.insert(i * 2);
+    }
+    EXPECT_EQ(f.count(), 10000);
+
+    // No false negatives
+    for (int i = 0; i < 10000; ++i)
+    {
+        EXPECT_TRUE(f.contains(i * 2));
+    }
+
+    // False positive rate should be near 1%
+    int falsepositives = 0;
+    for (int i = 0; i < 10000; ++i)
+    {
+        if (f.contains(i * 2 + 1))
+        {
+            ++falsepositives;
+        }
+    }
+    EXPECT_LT(falsepositives, 300);
+
+    // Merging
+    blocked_bloom_filter<int> g(10000);
+    g.insert(-5);
+    EXPECT_FALSE(f.contains(-5) && !g.contains(-5));
+    EXPECT_TRUE(f.merge(g));
+    EXPECT_TRUE(f.contains(-5));
+    blocked_bloom_filter<int> h(100);
+    EXPECT_FALSE(f.merge(h));
+
+    f.clear();
+    EXPECT_TRUE(f.empty());
+    EXPECT_FALSE(f.contains(2));
+}
+
+TEST(bloom_filter, cuckoo_filter)
+{
+    cuckoo_filter<int> f(10000);
+    EXPECT_TRUE(f.empty());
+    EXPECT_TRUE(f.capacity() >= 10000);
+    EXPECT_FALSE(f.contains(1));
+
+    for (int i = 0; i < 10000; ++i)
+    {
+        EXPECT_TRUE(f.insert(i * 2));
+    }
+    EXPECT_EQ(f.size(), 10000);
+    EXPECT_FALSE(f.full());
+
+    for (int i = 0; i < 10000; ++i)
+    {
+        EXPECT_TRUE(f.contains(i * 2));
+    }
+
+    int falsepositives = 0;
+    for (int i = 0; i < 10000; ++i)
+    {
+        if (f.contains(i * 2 + 1))
+        {
+            ++falsepositives;
+        }
+    }
+    EXPECT_LT(falsepositives, 20);
+
+    // Remove half
+    for (int i = 0; i < 10000; i += 2)
+    {
+        EXPECT_TRUE(f.remove(i * 2));
+    }
+    EXPECT_EQ(f.size(), 5000);
+    for (int i = 1; i < 10000; i += 2)
+    {
+        EXPECT_TRUE(f.contains(i * 2));
+    }
+    int remaining = 0;
+    for (int i = 0; i < 10000; i += 2)
+    {
+        if (f.contains(i * 2))
+        {
+            ++remaining;
+        }
+    }
+    EXPECT_LT(remaining, 20);
+
+    // Fill until full; everything inserted must still be found
+    cuckoo_filter<int> small(64);
+    int inserted = 0;
+    while (small.insert(inserted))
+    {
+        ++inserted;
+    }
+    EXPECT_TRUE(small.full());
+    EXPECT_TRUE(inserted >= int(small.capacity() * 9 / 10));
+    for (int i = 0; i < inserted; ++i)
+    {
+        EXPECT_TRUE(small.contains(i));
+    }
+    EXPECT_TRUE(small.remove(0));
+    EXPECT_FALSE(small.full());
+    for (int i = 1; i < inserted; ++i)
+    {
+        EXPECT_TRUE(small.contains(i));
+    }
+
+    f.clear();
+    EXPECT_TRUE(f.empty());
+    EXPECT_FALSE(f.contains(2));
+}
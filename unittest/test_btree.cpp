@@ -0,0 +1,275 @@
+#include "../btree_map.h"
+#include "../btree_set.h"
+#include "../map.h"
+#include "test_common.h"
+
+namespace
+{
+
+// Deterministic pseudo-random sequence
+struct lcg
+{
+    unsigned int state;
+    lcg(unsigned int seed = 1) : state(seed) {}
+    unsigned int operator () () { state = state * 1103515245 + 12345; return state >> 8; }
+};
+
+// Non-arithmetic key uses the generic binary search
+struct point
+{
+    int x, y;
+    point(int x_ = 0, int y_ = 0) : x(x_), y(y_) {}
+    bool operator < (const point& p) const { return x < p.x || (x == p.x && y < p.y); }
+    bool operator == (const point& p) const { return x == p.x && y == p.y; }
+};
+
+template <class Key> void test_btree_against_map(unsigned int count)
+{
+    typedef thor::btree_map<Key, unsigned int> btree_map;
+    typedef thor::map<Key, unsigned int> ref_map;
+
+    btree_map bm;
+    ref_map rm;
+    lcg rng;
+
+    for (unsigned int i = 0; i != count; ++i)
+    {
+        Key k = Key(rng() % (count * 2));
+        thor::pair<typename btree_map::iterator, bool> b = bm.insert(typename btree_map::value_type(k, i));
+        thor::pair<typename ref_map::iterator, bool> r = rm.insert(typename ref_map::value_type(k, i));
+        ASSERT_EQ(b.second, r.second);
+        ASSERT_TRUE(b.first->first == k);
+        ASSERT_EQ(b.first->second, r.first->second);
+    }
+    ASSERT_EQ(bm.size(), rm.size());
+
+    // Forward and reverse iteration match
+    typename ref_map::iterator ri(rm.begin());
+    for (typename btree_map::iterator bi(bm.begin()); bi != bm.end(); ++bi, ++ri)
+    {
+        ASSERT_TRUE(bi->first == ri->first);
+        ASSERT_EQ(bi->second, ri->second);
+    }
+    EXPECT_TRUE(ri == rm.end());
+
+    typename ref_map::reverse_iterator rri(rm.rbegin());
+    for (typename btree_map::reverse_iterator bri(bm.rbegin()); bri != bm.rend(); ++bri, ++rri)
+    {
+        ASSERT_TRUE(bri->first == rri->first);
+    }
+    EXPECT_TRUE(rri == rm.rend());
+
+    // Lookups
+    for (unsigned int i = 0; i != count * 2; ++i)
+    {
+        Key k = Key(i);
+        typename btree_map::iterator bi(bm.find(k));
+        typename ref_map::iterator fi(rm.find(k));
+        ASSERT_EQ(bi == bm.end(), fi == rm.end());
+        ASSERT_EQ(bm.count(k), rm.count(k));
+        typename btree_map::iterator lb(bm.lower_bound(k));
+        typename ref_map::iterator rlb(rm.lower_bound(k));
+        ASSERT_EQ(lb == bm.end(), rlb == rm.end());
+        if (lb != bm.end())
+        {
+            ASSERT_TRUE(lb->first == rlb->first);
+        }
+        typename btree_map::iterator ub(bm.upper_bound(k));
+        typename ref_map::iterator rub(rm.upper_bound(k));
+        ASSERT_EQ(ub == bm.end(), rub == rm.end());
+        if (ub != bm.end())
+        {
+            ASSERT_TRUE(ub->first == rub->first);
+        }
+    }
+
+    // Erase half by key
+    for (unsigned int i = 0; i != count; ++i)
+    {
+        Key k = Key(rng() % (count * 2));
+        ASSERT_EQ(bm.erase(k), rm.erase(k));
+    }
+    ASSERT_EQ(bm.size(), rm.size());
+
+    // Erase by iterator, checking the returned iterator
+    typename btree_map::iterator bi(bm.begin());
+    while (bi != bm.end())
+    {
+        if ((rng() & 1) == 0)
+        {
+            ++bi;
+            continue;
+        }
+        Key k = bi->first;
+        typename ref_map::iterator next(rm.find(k));
+        ++next;
+        rm.erase(k);
+        bi = bm.erase(bi);
+        ASSERT_EQ(bi == bm.end(), next == rm.end());
+        if (bi != bm.end())
+        {
+            ASSERT_TRUE(bi->first == next->first);
+        }
+    }
+    ASSERT_EQ(bm.size(), rm.size());
+    ri = rm.begin();
+    for (bi = bm.begin(); bi != bm.end(); ++bi, ++ri)
+    {
+        ASSERT_TRUE(bi->first == ri->first);
+    }
+
+    bm.clear();
+    EXPECT_TRUE(bm.empty());
+    EXPECT_TRUE(bm.begin() == bm.end());
+}
+
+}
+
+TEST(test_btree, empty)
+{
+    thor::btree_map<int, int> m;
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.size(), 0);
+    EXPECT_TRUE(m.begin() == m.end());
+    EXPECT_TRUE(m.rbegin() == m.rend());
+    EXPECT_TRUE(m.find(0) == m.end());
+    EXPECT_TRUE(m.lower_bound(0) == m.end());
+    EXPECT_EQ(m.erase(0), 0);
+
+    thor::btree_set<int> s;
+    EXPECT_TRUE(s.begin() == s.end());
+}
+
+TEST(test_btree, map_int)
+{
+    test_btree_against_map<int>(100000);
+}
+
+TEST(test_btree, map_unsigned)
+{
+    test_btree_against_map<unsigned int>(20000);
+}
+
+TEST(test_btree, map_other_keys)
+{
+    test_btree_against_map<unsigned short>(10000);
+    test_btree_against_map<long long>(20000);
+    test_btree_against_map<double>(20000);
+}
+
+TEST(test_btree, unsigned_order)
+{
+    // Values with the high bit set must sort after the rest
+    thor::btree_set<unsigned int> s;
+    for (unsigned int i = 0; i != 1000; ++i)
+    {
+        s.insert(i);
+        s.insert(0xFFFFFFFF - i);
+    }
+    EXPECT_EQ(s.size(), 2000);
+    EXPECT_EQ(*s.begin(), 0);
+    EXPECT_EQ(*s.rbegin(), 0xFFFFFFFF);
+    EXPECT_EQ(*s.lower_bound(1000), 0xFFFFFFFF - 999);
+    EXPECT_EQ(*s.upper_bound(0x80000000), 0xFFFFFFFF - 999);
+}
+
+TEST(test_btree, map_operator_index)
+{
+    thor::btree_map<point, int> m;
+    for (int i = 0; i != 5000; ++i)
+    {
+        m[point(i % 50, i / 50)] = i;
+    }
+    EXPECT_EQ(m.size(), 5000);
+    for (int i = 0; i != 5000; ++i)
+    {
+        EXPECT_EQ(m[point(i % 50, i / 50)], i);
+    }
+    int last = -1;
+    for (thor::btree_map<point, int>::const_iterator iter(m.begin()); iter != m.end(); ++iter)
+    {
+        int cur = iter->first.x * 100 + iter->first.y;
+        EXPECT_LT(last, cur);
+        last = cur;
+    }
+}
+
+TEST(test_btree, multimap)
+{
+    thor::btree_multimap<int, int> m;
+    for (int i = 0; i != 3000; ++i)
+    {
+        m.insert(thor::btree_multimap<int, int>::value_type(i % 100, i));
+    }
+    EXPECT_EQ(m.size(), 3000);
+    for (int k = 0; k != 100; ++k)
+    {
+        EXPECT_EQ(m.count(k), 30);
+        thor::pair<thor::btree_multimap<int, int>::iterator, thor::btree_multimap<int, int>::iterator> r(m.equal_range(k));
+        int n = 0;
+        int prev = -1;
+        for (; r.first != r.second; ++r.first, ++n)
+        {
+            EXPECT_EQ(r.first->first, k);
+            // Equal keys keep insertion order
+            EXPECT_LT(prev, r.first->second);
+            prev = r.first->second;
+        }
+        EXPECT_EQ(n, 30);
+    }
+    EXPECT_EQ(m.erase(50), 30);
+    EXPECT_EQ(m.count(50), 0);
+    EXPECT_EQ(m.size(), 2970);
+
+    m.erase(m.lower_bound(10), m.upper_bound(19));
+    EXPECT_EQ(m.size(), 2670);
+    EXPECT_TRUE(m.find(15) == m.end());
+    EXPECT_EQ(m.lower_bound(10)->first, 20);
+}
+
+TEST(test_btree, multiset)
+{
+    thor::btree_multiset<int> s;
+    for (int i = 0; i != 10000; ++i)
+    {
+        s.insert(i % 7);
+    }
+    EXPECT_EQ(s.size(), 10000);
+    int total = 0;
+    for (int k = 0; k != 7; ++k)
+    {
+        total += (int)s.count(k);
+    }
+    EXPECT_EQ(total, 10000);
+    EXPECT_EQ(s.erase(3), 1429);
+    EXPECT_EQ(s.size(), 8571);
+}
+
+TEST(test_btree, copy_swap)
+{
+    thor::btree_set<int> a;
+    for (int i = 0; i != 10000; ++i)
+    {
+        a.insert(i * 3);
+    }
+    thor::btree_set<int> b(a);
+    EXPECT_TRUE(a == b);
+    b.erase(3);
+    EXPECT_TRUE(a != b);
+    EXPECT_TRUE(b < a == false);
+    EXPECT_TRUE(a < b);
+
+    thor::btree_set<int> c;
+    c.insert(1);
+    c = a;
+    EXPECT_TRUE(c == a);
+
+    thor::swap(b, c);
+    EXPECT_TRUE(b == a);
+    EXPECT_EQ(c.size(), 9999);
+    EXPECT_TRUE(c.find(3) == c.end());
+    EXPECT_TRUE(b.find(3) != b.end());
+
+    thor::btree_set<int> d(a.begin(), a.end());
+    EXPECT_TRUE(d == a);
+}
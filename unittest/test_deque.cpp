@@ -105,7 +105,7 @@ template <class T> bool test_deque()
         EXPECT_TRUE(*iter == T());
         deque::size_type count;
         EXPECT_TRUE(D4.get_contiguous(iter, count) == &(*iter));
-        EXPECT_TRUE(count > 0 && count <= 256 /*deque::BlockCount*/);
+        EXPECT_TRUE(count > 0 && count <= deque::block_count);
         *iter = T();
         ++s;
     }
@@ -127,7 +127,7 @@ template <class T> bool test_deque()
         // *iter = T(); // will fail to compile
         deque::size_type count;
         EXPECT_TRUE(D3.get_contiguous(iter, count) == &(*iter));
-        EXPECT_TRUE(count > 0 && count <= 256 /*deque::BlockCount*/);
+        EXPECT_TRUE(count > 0 && count <= deque::block_count);
         ++s;
     }
     EXPECT_TRUE(s == D3.size());
@@ -167,4 +167,76 @@ TEST(test_deque, test_deque)
     EXPECT_TRUE(b);
     b = test_insert<thor::deque<s>, NoValidate<thor::deque<s> > >(0, 1.f, 2.0, 3, '4');
     EXPECT_TRUE(b);
-}
\ No newline at end of file
+}
+
+struct big_record
+{
+    char data[1000];
+    int value;
+    big_record(int v = 0) : value(v) {}
+};
+
+template <class Deque> void test_fifo(int count)
+{
+    // Cycling through blocks as a queue reuses spare blocks
+    Deque D;
+    int front = 0, back = 0;
+    for (int i = 0; i != count; ++i)
+    {
+        D.push_back(back++);
+        D.push_back(back++);
+        EXPECT_EQ(front++, D.front().value);
+        D.pop_front();
+        if (D.size() > 100)
+        {
+            while (!D.empty())
+            {
+                EXPECT_EQ(front++, D.front().value);
+                D.pop_front();
+            }
+        }
+    }
+    EXPECT_EQ(size_t(back - front), D.size());
+    for (size_t i = 0; i != D.size(); ++i)
+    {
+        EXPECT_EQ(front + int(i), D[i].value);
+    }
+
+    Deque().swap(D);
+    EXPECT_TRUE(D.empty());
+}
+
+struct small_record
+{
+    int value;
+    small_record(int v = 0) : value(v) {}
+};
+
+TEST(test_deque, block_size)
+{
+    // Blocks hold the largest power of two elements that fit in the byte budget, but at least 4
+    EXPECT_EQ(4096, (int)thor::deque<char>::block_count);
+    EXPECT_EQ(1024, (int)thor::deque<int>::block_count);
+    EXPECT_EQ(4, (int)thor::deque<big_record>::block_count);
+    EXPECT_EQ(16, (int)(thor::deque<int, 64>::block_count));
+    EXPECT_EQ(4, (int)(thor::deque<int, 1>::block_count));
+    EXPECT_EQ(8, (int)(thor::deque<double, 100>::block_count));
+
+    test_fifo<thor::deque<small_record> >(5000);
+    test_fifo<thor::deque<small_record, 32> >(5000);
+    test_fifo<thor::deque<big_record> >(500);
+
+    // Random access across many small blocks
+    thor::deque<int, 16> D;
+    for (int i = 0; i != 1000; ++i)
+    {
+        D.push_front(-i - 1);
+        D.push_back(i);
+    }
+    for (int i = 0; i != 2000; ++i)
+    {
+        EXPECT_EQ(i - 1000, D[i]);
+    }
+    EXPECT_EQ(2000, D.end() - D.begin());
+    EXPECT_EQ(1999, D.end() - (D.begin() + 1));
+}
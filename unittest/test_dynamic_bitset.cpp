@@ -0,0 +1,190 @@
+#include "dynamic_bitset.h"
+#include "vector.h"
+#include "test_common.h"
+
+#include <stdlib.h>
+
+namespace
+{
+
+typedef thor::vector<bool> bool_vector;
+
+void expect_contents(const thor::dynamic_bitset& b, const bool_vector& expected)
+{
+    ASSERT_EQ(expected.size(), b.size());
+    thor::size_type count = 0;
+    for (thor::size_type i = 0; i != expected.size(); ++i)
+    {
+        EXPECT_EQ(expected[i], b.test(i)) << i;
+        if (expected[i])
+        {
+            ++count;
+        }
+    }
+    EXPECT_EQ(count, b.count());
+    EXPECT_EQ(count != 0, b.any());
+    EXPECT_EQ(count == 0, b.none());
+    EXPECT_EQ(count == b.size(), b.all());
+
+    // Unused bits of the last word stay clear
+    if (b.size() % thor::dynamic_bitset::bits_per_word)
+    {
+        EXPECT_EQ(0U, b.words()[b.num_words() - 1] >> (b.size() % thor::dynamic_bitset::bits_per_word));
+    }
+
+    // Scanning forward and backward visits exactly the set bits
+    thor::size_type expected_next = 0;
+    for (thor::size_type i = b.find_first(); i != thor::dynamic_bitset::npos; i = b.find_next(i))
+    {
+        while (!expected[expected_next])
+        {
+            ++expected_next;
+        }
+        EXPECT_EQ(expected_next++, i);
+        --count;
+    }
+    EXPECT_EQ(0U, count);
+    thor::size_type expected_prev = b.size();
+    for (thor::size_type i = b.find_last(); i != thor::dynamic_bitset::npos; i = b.find_prev(i))
+    {
+        while (!expected[--expected_prev]) {}
+        EXPECT_EQ(expected_prev, i);
+        ++count;
+    }
+    EXPECT_EQ(b.count(), count);
+}
+
+bool_vector random_bits(thor::size_type n, int density)
+{
+    bool_vector v;
+    for (thor::size_type i = 0; i != n; ++i)
+    {
+        v.push_back(rand() % 100 < density);
+    }
+    return v;
+}
+
+thor::dynamic_bitset make_bitset(const bool_vector& v)
+{
+    thor::dynamic_bitset b(v.size());
+    for (thor::size_type i = 0; i != v.size(); ++i)
+    {
+        b[i] = v[i];
+    }
+    return b;
+}
+
+}
+
+TEST(test_dynamic_bitset, basic)
+{
+    thor::dynamic_bitset b;
+    EXPECT_TRUE(b.empty());
+    EXPECT_EQ(0U, b.num_words());
+    EXPECT_TRUE(b.none());
+    EXPECT_TRUE(b.all());
+    EXPECT_TRUE(b.find_first() == thor::dynamic_bitset::npos);
+    EXPECT_TRUE(b.find_last() == thor::dynamic_bitset::npos);
+
+    thor::dynamic_bitset ones(130, true);
+    EXPECT_EQ(130U, ones.size());
+    EXPECT_EQ(3U, ones.num_words());
+    EXPECT_EQ(130U, ones.count());
+    EXPECT_TRUE(ones.all());
+    EXPECT_EQ(129U, ones.find_last());
+
+    ones.reset(64);
+    ones[65] = false;
+    ones.flip(66);
+    EXPECT_FALSE(ones.all());
+    EXPECT_EQ(127U, ones.count());
+    EXPECT_EQ(67U, ones.find_next(63));
+    EXPECT_EQ(63U, ones.find_prev(67));
+    EXPECT_TRUE(~ones[64]);
+    ones[64].flip();
+    EXPECT_TRUE(ones[64]);
+    ones[65] = ones[64];
+    EXPECT_TRUE(ones.test(65));
+
+    // push_back() and resize() keep the unused bits clear
+    bool_vector expected;
+    for (int i = 0; i != 200; ++i)
+    {
+        b.push_back(i % 3 == 0);
+        expected.push_back(i % 3 == 0);
+    }
+    expect_contents(b, expected);
+    b.resize(70, true);
+    expected.resize(70);
+    expect_contents(b, expected);
+    b.resize(150, true);
+    expected.resize(150, true);
+    expect_contents(b, expected);
+    b.resize(10);
+    expected.resize(10);
+    expect_contents(b, expected);
+
+    b.set();
+    EXPECT_TRUE(b.all());
+    b.flip();
+    EXPECT_TRUE(b.none());
+
+    thor::dynamic_bitset copy(ones);
+    EXPECT_TRUE(copy == ones);
+    copy.flip(0);
+    EXPECT_TRUE(copy != ones);
+    copy = ones;
+    EXPECT_TRUE(copy == ones);
+    thor::swap(copy, b);
+    EXPECT_EQ(10U, copy.size());
+    EXPECT_TRUE(b == ones);
+    b.clear();
+    EXPECT_TRUE(b.empty());
+}
+
+TEST(test_dynamic_bitset, operations)
+{
+    srand(54321);
+    const thor::size_type sizes[] = { 1, 63, 64, 65, 127, 128, 129, 500, 1000, 1024 };
+    for (thor::size_type s = 0; s != sizeof(sizes) / sizeof(sizes[0]); ++s)
+    {
+        const thor::size_type n = sizes[s];
+        const int density = (s % 3) == 0 ? 3 : 50;
+        const bool_vector va(random_bits(n, density)), vb(random_bits(n, density));
+        const thor::dynamic_bitset a(make_bitset(va)), b(make_bitset(vb));
+        expect_contents(a, va);
+        expect_contents(b, vb);
+
+        bool_vector vand(n), vor(n), vxor(n), vnot(n);
+        for (thor::size_type i = 0; i != n; ++i)
+        {
+            vand[i] = va[i] && vb[i];
+            vor[i] = va[i] || vb[i];
+            vxor[i] = va[i] != vb[i];
+            vnot[i] = !va[i];
+        }
+        expect_contents(a & b, vand);
+        expect_contents(a | b, vor);
+        expect_contents(a ^ b, vxor);
+        expect_contents(~a, vnot);
+
+        thor::dynamic_bitset self(a);
+        self ^= self;
+        EXPECT_TRUE(self.none());
+
+        // Shifts across and within word boundaries
+        const thor::size_type shifts[] = { 0, 1, 7, 63, 64, 65, 130, n - 1, n, n + 5 };
+        for (thor::size_type t = 0; t != sizeof(shifts) / sizeof(shifts[0]); ++t)
+        {
+            const thor::size_type shift = shifts[t];
+            bool_vector left(n), right(n);
+            for (thor::size_type i = 0; i != n; ++i)
+            {
+                left[i] = i >= shift && va[i - shift];
+                right[i] = shift < n - i && va[i + shift];
+            }
+            expect_contents(a << shift, left);
+            expect_contents(a >> shift, right);
+        }
+    }
+}
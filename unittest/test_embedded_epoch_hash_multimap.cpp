@@ -0,0 +1,198 @@
+#include "test_common.h"
+#include "../embedded_epoch_hash_multimap.h"
+
+using namespace thor;
+
+namespace
+{
+
+struct EpochMultimapTest
+{
+    static int live;
+    int value;
+    embedded_epoch_hash_multimap_link<int, EpochMultimapTest> link;
+
+    EpochMultimapTest(int v = 0) : value(v) { ++live; }
+    ~EpochMultimapTest() { --live; }
+};
+int EpochMultimapTest::live = 0;
+
+struct sum_values
+{
+    int& total;
+    sum_values(int& t) : total(t) {}
+    void operator () (EpochMultimapTest* p) const { total += p->value; }
+};
+
+}
+
+template <class T_PARTITION_POLICY> void test_eehmmap()
+{
+    typedef embedded_epoch_hash_multimap<int, EpochMultimapTest, &EpochMultimapTest::link, thor::hash<int>, T_PARTITION_POLICY> map;
+
+    epoch_domain domain;
+    epoch_domain::reader reader(domain);
+    {
+        map m(domain);
+        EXPECT_TRUE(m.empty());
+        EXPECT_TRUE(m.size() == 0);
+        EXPECT_TRUE(m.bucket_count() == 0);
+        {
+            epoch_domain::guard g(reader);
+            EXPECT_TRUE(m.find(1) == 0);
+            EXPECT_EQ(m.count(1), 0);
+        }
+
+        // Enough elements to force several resizes
+        for (int i = 0; i < 1000; ++i)
+        {
+            m.insert(i, new EpochMultimapTest(i));
+        }
+        EXPECT_EQ(m.size(), 1000);
+        EXPECT_TRUE(m.bucket_count() >= 1000);
+        {
+            epoch_domain::guard g(reader);
+            for (int i = 0; i < 1000; ++i)
+            {
+                EpochMultimapTest* p = m.find(i);
+                ASSERT_TRUE(p != 0);
+                EXPECT_EQ(p->value, i);
+                EXPECT_TRUE(p->link.is_contained());
+                EXPECT_EQ(p->link.key(), i);
+            }
+            EXPECT_TRUE(m.find(1000) == 0);
+        }
+
+        // Duplicate keys
+        m.insert(5, new EpochMultimapTest(10005));
+        m.insert(5, new EpochMultimapTest(20005));
+        {
+            epoch_domain::guard g(reader);
+            EXPECT_EQ(m.count(5), 3);
+            int total = 0;
+            EXPECT_EQ(m.find_all(5, sum_values(total)), 3);
+            EXPECT_EQ(total, 5 + 10005 + 20005);
+            EXPECT_EQ(m.find(5)->value, 5); // first inserted is found first
+        }
+
+        // Remove a single element; it stays valid until reclaimed
+        EpochMultimapTest* p;
+        {
+            epoch_domain::guard g(reader);
+            p = m.find(7);
+        }
+        EXPECT_TRUE(m.remove(p) == p);
+        EXPECT_FALSE(p->link.is_contained());
+        EXPECT_EQ(m.size(), 1001);
+        {
+            epoch_domain::guard g(reader);
+            EXPECT_TRUE(m.find(7) == 0);
+        }
+        domain.synchronize();
+        m.insert(7, p); // safe to re-insert after a grace period
+
+        // Retired elements are not deleted while a reader is active
+        const int live = EpochMultimapTest::live;
+        reader.enter();
+        EXPECT_EQ(m.remove_retire(5), 3);
+        EXPECT_EQ(EpochMultimapTest::live, live);
+        domain.reclaim();
+        domain.reclaim();
+        EXPECT_EQ(EpochMultimapTest::live, live);
+        reader.leave();
+        domain.synchronize();
+        EXPECT_EQ(EpochMultimapTest::live, live - 3);
+        EXPECT_EQ(domain.pending(), 0);
+        EXPECT_EQ(m.size(), 999);
+
+        {
+            epoch_domain::guard g(reader);
+            int total = 0;
+            m.for_each(sum_values(total));
+            EXPECT_EQ(total, (999 * 1000 / 2) - 5);
+        }
+
+        m.delete_all();
+        EXPECT_TRUE(m.empty());
+        EXPECT_EQ(EpochMultimapTest::live, 0);
+
+        // Usable again after delete_all
+        m.insert(1, new EpochMultimapTest(1));
+        EXPECT_EQ(m.size(), 1);
+        m.remove_retire(1);
+        EXPECT_TRUE(m.empty());
+    }
+    domain.synchronize();
+    EXPECT_EQ(EpochMultimapTest::live, 0);
+}
+
+TEST(test_eehmmap, test_eehmmap)
+{
+    test_eehmmap<thor::policy::base2_partition>();
+    test_eehmmap<thor::policy::prime_number_partition>();
+}
+
+TEST(test_eehmmap, epoch_domain)
+{
+    epoch_domain domain;
+    epoch_domain::reader r1(domain), r2(domain);
+
+    // Inactive readers never hold up the epoch
+    const size_type e = domain.current_epoch();
+    EXPECT_TRUE(domain.try_advance());
+    EXPECT_TRUE(domain.try_advance());
+    EXPECT_EQ(domain.current_epoch(), e + 2);
+
+    // An active reader allows one advance, then blocks until it leaves
+    r1.enter();
+    r1.enter(); // nested
+    EXPECT_TRUE(domain.try_advance());
+    EXPECT_FALSE(domain.try_advance());
+    r1.leave();
+    EXPECT_FALSE(domain.try_advance());
+    r1.leave();
+    EXPECT_TRUE(domain.try_advance());
+}
+
+TEST(test_eehmmap, insert_in_read_section)
+{
+    typedef embedded_epoch_hash_multimap<int, EpochMultimapTest, &EpochMultimapTest::link> map;
+
+    epoch_domain domain;
+    epoch_domain::reader reader(domain);
+    {
+        map m(domain);
+        size_type bucket_count;
+        {
+            // Growing twice would reuse the chains of the first generation, which this reader may
+            // still see; the second growth is deferred instead of waiting for the reader.
+            epoch_domain::guard g(reader);
+            for (int i = 0; i < 1000; ++i)
+            {
+                m.insert(i, new EpochMultimapTest(i));
+            }
+            bucket_count = m.bucket_count();
+            EXPECT_TRUE(bucket_count < 1000);
+            for (int i = 0; i < 1000; ++i)
+            {
+                ASSERT_TRUE(m.find(i) != 0);
+                EXPECT_EQ(m.find(i)->value, i);
+            }
+        }
+
+        // Grows once the reader has left
+        m.insert(1000, new EpochMultimapTest(1000));
+        EXPECT_TRUE(m.bucket_count() > bucket_count);
+        EXPECT_TRUE(m.bucket_count() >= 1001);
+        {
+            epoch_domain::guard g(reader);
+            for (int i = 0; i <= 1000; ++i)
+            {
+                ASSERT_TRUE(m.find(i) != 0);
+                EXPECT_EQ(m.find(i)->value, i);
+            }
+        }
+        m.delete_all();
+    }
+    EXPECT_EQ(EpochMultimapTest::live, 0);
+}
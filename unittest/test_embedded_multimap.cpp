@@ -1,6 +1,7 @@
 #include "test_common.h"
 #include "../embedded_multimap.h"
 #include "../basic_string.h"
+#include "../vector.h"
 
 using namespace thor;
 
@@ -158,4 +159,101 @@ public:
 TEST(test_emmap, initial)
 {
     test_emmap<string, MyEmbeddedMultimapTest, &MyEmbeddedMultimapTest::link>();
-}
\ No newline at end of file
+}
+
+struct MyTimer
+{
+    int id;
+    embedded_multimap_link<int, MyTimer> link;
+};
+
+typedef embedded_multimap<int, MyTimer, &MyTimer::link> timer_map;
+
+template <class T> static void verify_timers(const timer_map& m, T expected)
+{
+    int count = 0;
+    int prev = 0;
+    for (timer_map::const_iterator i = m.begin(); i != m.end(); ++i, ++count)
+    {
+        if (count != 0)
+        {
+            EXPECT_LE(prev, i.key());
+        }
+        prev = i.key();
+    }
+    EXPECT_EQ((int)expected, count);
+    EXPECT_EQ((int)expected, (int)m.size());
+}
+
+TEST(test_emmap, insert_hint)
+{
+    const int num = 1000;
+    MyTimer* timers = new MyTimer[num];
+    timer_map m;
+
+    // Increasing keys with end() as the hint
+    for (int i = 0; i < num / 2; ++i)
+    {
+        timers[i].id = i;
+        timer_map::iterator iter = m.insert(m.end(), i / 2, &timers[i]);
+        EXPECT_TRUE(&*iter == &timers[i]);
+    }
+    verify_timers(m, num / 2);
+    EXPECT_EQ(2, m.count(10));
+    EXPECT_EQ(20, m.find(20)->id / 2);
+
+    // Correct hints before existing keys, incorrect hints, and hints at begin()
+    for (int i = num / 2; i < num; ++i)
+    {
+        timers[i].id = i;
+        const int key = (i * 7) % (num / 4) - 10;
+        switch (i % 3)
+        {
+        case 0: m.insert(m.lower_bound(key), key, &timers[i]); break;
+        case 1: m.insert(m.begin(), key, &timers[i]); break;
+        default: m.insert(m.upper_bound(key + 5), key, &timers[i]); break;
+        }
+        EXPECT_EQ(key, timers[i].link.key());
+    }
+    verify_timers(m, num);
+
+    m.remove_all();
+    delete[] timers;
+}
+
+TEST(test_emmap, insert_sorted)
+{
+    const int num = 1000;
+    MyTimer* timers = new MyTimer[num];
+    timer_map m;
+
+    vector<pair<int, MyTimer*> > run;
+    for (int i = 0; i < num / 2; ++i)
+    {
+        timers[i].id = i;
+        run.push_back(pair<int, MyTimer*>(i / 4 * 2, &timers[i]));
+    }
+    m.insert_sorted(run.begin(), run.end());
+    verify_timers(m, num / 2);
+
+    // Equal keys keep their order from the run
+    int id = 0;
+    for (timer_map::iterator i = m.begin(); i != m.end(); ++i)
+    {
+        EXPECT_EQ(id++, i->id);
+    }
+
+    // A second run interleaves with the existing keys
+    run.clear();
+    for (int i = num / 2; i < num; ++i)
+    {
+        timers[i].id = i;
+        run.push_back(pair<int, MyTimer*>((i - num / 2) / 2 - 7, &timers[i]));
+    }
+    m.insert_sorted(run.begin(), run.end());
+    verify_timers(m, num);
+    EXPECT_EQ(6, m.count(10));
+
+    m.remove_all();
+    delete[] timers;
+}
@@ -0,0 +1,107 @@
+#include "test_common.h"
+#include "../eytzinger_array.h"
+
+using namespace thor;
+
+namespace
+{
+
+struct keyed
+{
+    int key;
+    int id;
+    keyed(int k = 0, int i = 0) : key(k), id(i) {}
+};
+
+struct keyed_less
+{
+    bool operator () (const keyed& lhs, const keyed& rhs) const { return lhs.key < rhs.key; }
+};
+
+}
+
+TEST(eytzinger_array, basic)
+{
+    eytzinger_array<int> e;
+    EXPECT_TRUE(e.empty());
+    EXPECT_TRUE(e.lower_bound(5) == e.end());
+    EXPECT_TRUE(e.find(5) == e.end());
+
+    // Every size up to a few levels, searched for every value in and around the range
+    for (int n = 1; n != 70; ++n)
+    {
+        vector<int> sorted;
+        for (int i = 0; i != n; ++i)
+        {
+            sorted.push_back(i * 2);
+        }
+        vector<int> shuffled(sorted);
+        thor::random_shuffle(shuffled.begin(), shuffled.end());
+
+        e.build(shuffled.begin(), shuffled.end());
+        ASSERT_EQ(size_type(n), e.size());
+        for (int v = -2; v <= n * 2; ++v)
+        {
+            const size_type lb = thor::lower_bound(sorted.begin(), sorted.end(), v) - sorted.begin();
+            const size_type ub = thor::upper_bound(sorted.begin(), sorted.end(), v) - sorted.begin();
+            eytzinger_array<int>::const_iterator i = e.lower_bound(v);
+            if (lb == sorted.size())
+            {
+                EXPECT_TRUE(i == e.end());
+            }
+            else
+            {
+                ASSERT_TRUE(i != e.end());
+                EXPECT_EQ(sorted[lb], *i);
+            }
+            i = e.upper_bound(v);
+            if (ub == sorted.size())
+            {
+                EXPECT_TRUE(i == e.end());
+            }
+            else
+            {
+                ASSERT_TRUE(i != e.end());
+                EXPECT_EQ(sorted[ub], *i);
+            }
+            EXPECT_EQ((v & 1) == 0 && v >= 0 && v < n * 2, e.find(v) != e.end());
+        }
+    }
+
+    e.clear();
+    EXPECT_TRUE(e.empty());
+}
+
+TEST(eytzinger_array, duplicates)
+{
+    // Equivalent values: the first one given is found
+    vector<keyed> values;
+    for (int i = 0; i != 10000; ++i)
+    {
+        values.push_back(keyed(rand() % 1000, i));
+    }
+    eytzinger_array<keyed, keyed_less> e(values.begin(), values.end());
+    EXPECT_EQ(values.size(), e.size());
+
+    vector<keyed> sorted(values);
+    thor::stable_sort(sorted.begin(), sorted.end(), keyed_less());
+    for (int k = -1; k <= 1000; ++k)
+    {
+        vector<keyed>::iterator lb = thor::lower_bound(sorted.begin(), sorted.end(), keyed(k), keyed_less());
+        eytzinger_array<keyed, keyed_less>::const_iterator i = e.find(keyed(k));
+        if (lb == sorted.end() || lb->key != k)
+        {
+            EXPECT_TRUE(i == e.end());
+        }
+        else
+        {
+            ASSERT_TRUE(i != e.end());
+            EXPECT_EQ(lb->id, i->id);
+        }
+    }
+
+    eytzinger_array<keyed, keyed_less> e2;
+    e2.swap(e);
+    EXPECT_TRUE(e.empty());
+    EXPECT_EQ(values.size(), e2.size());
+}
@@ -0,0 +1,239 @@
+#include "../flat_map.h"
+#include "../flat_set.h"
+#include "../map.h"
+#include "test_common.h"
+
+TEST(test_flat_map, basic)
+{
+    typedef thor::flat_map<int, int> map;
+    map m;
+    EXPECT_TRUE(m.empty());
+    EXPECT_TRUE(m.begin() == m.end());
+    EXPECT_TRUE(m.find(0) == m.end());
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        const int k = (i * 7919) % 1000;
+        thor::pair<map::iterator, bool> p = m.insert(map::value_type(k, i));
+        EXPECT_TRUE(p.second);
+        EXPECT_EQ(p.first->first, k);
+    }
+    EXPECT_EQ(m.size(), 1000);
+    EXPECT_FALSE(m.insert(map::value_type(5, -1)).second);
+
+    // Contiguous and sorted
+    const map::value_type* first = &*m.begin();
+    int expected = 0;
+    for (map::const_iterator iter(m.begin()); iter != m.end(); ++iter, ++expected)
+    {
+        EXPECT_EQ(iter->first, expected);
+        EXPECT_EQ(&*iter, first + expected);
+    }
+    EXPECT_EQ(m.rbegin()->first, 999);
+
+    EXPECT_EQ(m.count(500), 1);
+    EXPECT_EQ(m.lower_bound(500)->first, 500);
+    EXPECT_EQ(m.upper_bound(500)->first, 501);
+    EXPECT_TRUE(m.upper_bound(999) == m.end());
+
+    m[2000] = 5;
+    EXPECT_EQ(m.size(), 1001);
+    EXPECT_EQ(m[2000], 5);
+
+    EXPECT_EQ(m.erase(500), 1);
+    EXPECT_EQ(m.erase(500), 0);
+    map::iterator next = m.erase(m.find(499));
+    EXPECT_EQ(next->first, 501);
+    m.erase(m.begin(), m.lower_bound(100));
+    EXPECT_EQ(m.size(), 899);
+    EXPECT_EQ(m.begin()->first, 100);
+
+    map m2(m);
+    EXPECT_TRUE(m == m2);
+    m2.clear();
+    EXPECT_TRUE(m2.empty());
+    thor::swap(m, m2);
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m2.size(), 899);
+}
+
+TEST(test_flat_map, deferred)
+{
+    typedef thor::flat_map<int, int> map;
+    thor::map<int, int> ref;
+    map m;
+
+    unsigned int seed = 1;
+    for (int i = 0; i < 20000; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        const int k = int((seed >> 8) % 10000);
+        m.insert_deferred(map::value_type(k, i));
+        ref.insert(thor::map<int, int>::value_type(k, i));
+
+        if ((i % 997) == 0)
+        {
+            // A read merges everything that is pending
+            EXPECT_EQ(m.size(), ref.size());
+        }
+    }
+
+    // The first value inserted for a key is kept, as with map::insert()
+    const map& cm = m;
+    EXPECT_EQ(cm.size(), ref.size());
+    thor::map<int, int>::iterator r(ref.begin());
+    for (map::const_iterator iter(cm.begin()); iter != cm.end(); ++iter, ++r)
+    {
+        EXPECT_EQ(iter->first, (*r).first);
+        EXPECT_EQ(iter->second, (*r).second);
+    }
+
+    // Range insert merges as one batch
+    map::value_type input[4] = { map::value_type(-1, 0), map::value_type(20000, 0), map::value_type(-1, 1), map::value_type(0, -5) };
+    const map::size_type before = m.size();
+    const bool had_zero = m.find(0) != m.end();
+    m.insert_range(input, input + 4);
+    EXPECT_EQ(m.size(), before + (had_zero ? 2 : 3));
+    EXPECT_EQ(m.find(0)->second == -5, !had_zero);
+    EXPECT_EQ(m.begin()->first, -1);
+    EXPECT_EQ(m.begin()->second, 0);
+    EXPECT_EQ(m.rbegin()->first, 20000);
+}
+
+TEST(test_flat_map, multimap)
+{
+    typedef thor::flat_multimap<int, int> map;
+    map m;
+    for (int i = 0; i < 300; ++i)
+    {
+        if (i & 1)
+        {
+            m.insert(map::value_type(i % 10, i));
+        }
+        else
+        {
+            m.insert_deferred(map::value_type(i % 10, i));
+        }
+    }
+    EXPECT_EQ(m.size(), 300);
+    EXPECT_EQ(m.count(3), 30);
+
+    // Equal keys keep insertion order
+    thor::pair<map::iterator, map::iterator> range(m.equal_range(4));
+    int prev = -1;
+    for (; range.first != range.second; ++range.first)
+    {
+        EXPECT_EQ(range.first->first, 4);
+        EXPECT_LT(prev, range.first->second);
+        prev = range.first->second;
+    }
+
+    EXPECT_EQ(m.erase(4), 30);
+    EXPECT_EQ(m.size(), 270);
+    EXPECT_TRUE(m.find(4) == m.end());
+}
+
+TEST(test_flat_map, set)
+{
+    thor::flat_set<int> s;
+    for (int i = 0; i < 100; ++i)
+    {
+        s.insert_deferred(i % 50);
+    }
+    EXPECT_EQ(s.size(), 50);
+    EXPECT_FALSE(s.insert(10).second);
+    EXPECT_TRUE(s.insert(100).second);
+    EXPECT_EQ(*s.rbegin(), 100);
+    thor::flat_set<int>::iterator iter(s.erase(s.find(10)));
+    EXPECT_EQ(*iter, 11);
+    EXPECT_EQ(s.count(10), 0);
+    EXPECT_EQ(s.end() - s.begin(), 50);
+
+    thor::flat_multiset<int> ms(s.begin(), s.end());
+    ms.insert(s.begin(), s.end());
+    EXPECT_EQ(ms.size(), 100);
+    EXPECT_EQ(ms.count(11), 2);
+    ms.erase(ms.lower_bound(20), ms.upper_bound(29));
+    EXPECT_EQ(ms.size(), 80);
+}
+
+TEST(test_flat_map, find_batch)
+{
+    typedef thor::flat_map<int, int> map;
+    map m;
+
+    int keys[100];
+    map::iterator out[100];
+    for (int i = 0; i < 100; ++i)
+    {
+        keys[i] = i * 3;
+    }
+
+    // Empty map
+    m.find_batch(keys, 100, out);
+    for (int i = 0; i < 100; ++i)
+    {
+        EXPECT_TRUE(out[i] == m.end());
+    }
+
+    // Every size up to a few hundred, with the last entries still deferred
+    for (int i = 0; i < 600; i += 2)
+    {
+        m.insert_deferred(map::value_type(i, -i));
+        if ((i % 34) == 0)
+        {
+            m.find_batch(keys, 100, out);
+            for (int j = 0; j < 100; ++j)
+            {
+                EXPECT_TRUE(out[j] == m.find(keys[j]));
+                if (keys[j] <= i && (keys[j] % 2) == 0)
+                {
+                    EXPECT_EQ((*out[j]).second, -keys[j]);
+                }
+                else
+                {
+                    EXPECT_TRUE(out[j] == m.end());
+                }
+            }
+        }
+    }
+
+    const map& cm = m;
+    map::const_iterator cout[7];
+    cm.find_batch(keys + 3, 7, cout);
+    for (int i = 0; i < 7; ++i)
+    {
+        EXPECT_TRUE(cout[i] == cm.find(keys[i + 3]));
+    }
+
+    typedef thor::flat_multimap<int, int> multimap;
+    multimap mm;
+    mm.insert(multimap::value_type(5, 1));
+    mm.insert(multimap::value_type(5, 2));
+    mm.insert(multimap::value_type(6, 3));
+    int mkeys[] = { 6, 5, 7, 4 };
+    multimap::iterator mout[4];
+    mm.find_batch(mkeys, 4, mout);
+    EXPECT_EQ((*mout[0]).second, 3);
+    EXPECT_TRUE(mout[1] == mm.find(5));
+    EXPECT_EQ((*mout[1]).second, 1);
+    EXPECT_TRUE(mout[2] == mm.end());
+    EXPECT_TRUE(mout[3] == mm.end());
+
+    thor::flat_set<int> s;
+    for (int i = 0; i < 1000; i += 2)
+    {
+        s.insert_deferred(i);
+    }
+    thor::flat_set<int>::iterator sout[50];
+    for (int i = 0; i < 50; ++i)
+    {
+        keys[i] = i * 23 - 10;
+    }
+    s.find_batch(keys, 50, sout);
+    for (int i = 0; i < 50; ++i)
+    {
+        EXPECT_TRUE(sout[i] == s.find(keys[i]));
+        EXPECT_EQ(sout[i] != s.end(), keys[i] >= 0 && keys[i] < 1000 && (keys[i] % 2) == 0);
+    }
+}
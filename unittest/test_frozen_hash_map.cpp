@@ -0,0 +1,150 @@
+#include "test_common.h"
+#include "../frozen_hash_map.h"
+
+#include "../basic_string.h"
+
+using namespace thor;
+
+namespace
+{
+
+typedef frozen_hash_map<int, int> int_map;
+
+}
+
+TEST(frozen_hash_map, empty)
+{
+    int_map m;
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.size(), 0);
+    EXPECT_TRUE(m.begin() == m.end());
+    EXPECT_TRUE(m.find(0) == m.end());
+    EXPECT_EQ(m.count(0), 0);
+    EXPECT_TRUE(m.data() == 0);
+
+    vector<int_map::value_type> none;
+    EXPECT_TRUE(m.build(none.begin(), none.end()));
+    EXPECT_TRUE(m.empty());
+    EXPECT_TRUE(m.find(0) == m.end());
+}
+
+TEST(frozen_hash_map, build)
+{
+    vector<int_map::value_type> v;
+    for (int i = 0; i < 10000; ++i)
+    {
+        v.push_back(int_map::value_type(i * 7, i));
+    }
+
+    int_map m(v.begin(), v.end());
+    EXPECT_EQ(m.size(), 10000);
+    EXPECT_TRUE(m.bucket_count() <= 10000 / int_map::keys_per_bucket);
+    for (int i = 0; i < 10000; ++i)
+    {
+        int_map::const_iterator iter = m.find(i * 7);
+        ASSERT_TRUE(iter != m.end());
+        EXPECT_EQ(iter->first, i * 7);
+        EXPECT_EQ(iter->second, i);
+        EXPECT_EQ(m.count(i * 7), 1);
+        EXPECT_EQ(*m.lookup(i * 7), i);
+
+        // Non-members
+        EXPECT_TRUE(m.find(i * 7 + 1) == m.end());
+        EXPECT_TRUE(m.lookup(i * 7 + 3) == 0);
+    }
+
+    // Every element is visited exactly once
+    long long sum = 0;
+    for (int_map::const_iterator iter(m.begin()); iter != m.end(); ++iter)
+    {
+        sum += iter->second;
+    }
+    EXPECT_EQ(sum, (9999LL * 10000) / 2);
+
+    // Duplicate keys are rejected
+    v.push_back(int_map::value_type(14, 0));
+    int_map dup;
+    EXPECT_FALSE(dup.build(v.begin(), v.end()));
+    EXPECT_TRUE(dup.empty());
+}
+
+TEST(frozen_hash_map, strings)
+{
+    vector<pair<string, int> > v;
+    for (int i = 0; i < 1000; ++i)
+    {
+        v.push_back(pair<string, int>(string(string::fmt, "key%d", i), i));
+    }
+
+    frozen_hash_map<string, int> m(v.begin(), v.end());
+    EXPECT_EQ(m.size(), 1000);
+    for (int i = 0; i < 1000; ++i)
+    {
+        const int* p = m.lookup(string(string::fmt, "key%d", i));
+        ASSERT_TRUE(p != 0);
+        EXPECT_EQ(*p, i);
+    }
+    EXPECT_TRUE(m.find("key1000") == m.end());
+}
+
+TEST(frozen_hash_map, attach)
+{
+    vector<int_map::value_type> v;
+    for (int i = 0; i < 500; ++i)
+    {
+        v.push_back(int_map::value_type(i, -i));
+    }
+    int_map m(v.begin(), v.end());
+
+    // Copy the block as if it were written to a file and mapped back in
+    vector<uint32> storage((m.data_size() + sizeof(uint32) - 1) / sizeof(uint32));
+    memcpy(&storage[0], m.data(), m.data_size());
+
+    int_map attached;
+    EXPECT_FALSE(attached.attach(&storage[0], m.data_size() - 1));
+    EXPECT_TRUE(attached.attach(&storage[0], m.data_size()));
+    EXPECT_EQ(attached.size(), 500);
+    for (int i = 0; i < 500; ++i)
+    {
+        ASSERT_TRUE(attached.lookup(i) != 0);
+        EXPECT_EQ(*attached.lookup(i), -i);
+    }
+    EXPECT_TRUE(attached.find(500) == attached.end());
+
+    // Different value type is rejected
+    frozen_hash_map<int, double> other;
+    EXPECT_FALSE(other.attach(&storage[0], m.data_size()));
+
+    attached.swap(m);
+    EXPECT_EQ(*m.lookup(10), -10);
+    EXPECT_EQ(*attached.lookup(10), -10);
+    attached.clear();
+    m.clear();
+}
+
+TEST(frozen_hash_map, find_batch)
+{
+    vector<int_map::value_type> v;
+    for (int i = 0; i < 1000; ++i)
+    {
+        v.push_back(int_map::value_type(i * 2, i));
+    }
+    int_map m(v.begin(), v.end());
+
+    int keys[40];
+    int_map::const_iterator out[40];
+    for (int i = 0; i < 40; ++i)
+    {
+        keys[i] = i * 5;
+    }
+    m.find_batch(keys, 40, out);
+    for (int i = 0; i < 40; ++i)
+    {
+        EXPECT_TRUE(out[i] == m.find(keys[i]));
+        EXPECT_EQ(out[i] != m.end(), (keys[i] % 2) == 0);
+    }
+
+    int_map empty;
+    empty.find_batch(keys, 40, out);
+    EXPECT_TRUE(out[39] == empty.end());
+}
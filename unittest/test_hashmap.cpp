@@ -458,4 +458,117 @@ TEST(test_hashmap, test_hashmap)
         EXPECT_TRUE(m.end() == m.find(0x800000001));
         EXPECT_TRUE(m.empty());
     }
-}
\ No newline at end of file
+}
+
+TEST(test_hashmap, find_batch)
+{
+    typedef thor::hash_map<int, int> map;
+    map m;
+
+    int keys[100];
+    map::iterator out[100];
+    for (int i = 0; i < 100; ++i)
+    {
+        keys[i] = i * 3;
+    }
+
+    // Empty map
+    m.find_batch(keys, 100, out);
+    for (int i = 0; i < 100; ++i)
+    {
+        EXPECT_TRUE(out[i] == m.end());
+    }
+
+    for (int i = 0; i < 1000; i += 2)
+    {
+        m.insert(map::value_type(i, -i));
+    }
+
+    m.find_batch(keys, 100, out);
+    for (int i = 0; i < 100; ++i)
+    {
+        EXPECT_TRUE(out[i] == m.find(keys[i]));
+        if ((keys[i] % 2) == 0)
+        {
+            EXPECT_EQ((*out[i]).second, -keys[i]);
+        }
+        else
+        {
+            EXPECT_TRUE(out[i] == m.end());
+        }
+    }
+
+    const map& cm = m;
+    map::const_iterator cout[7];
+    cm.find_batch(keys + 3, 7, cout);
+    for (int i = 0; i < 7; ++i)
+    {
+        EXPECT_TRUE(cout[i] == cm.find(keys[i + 3]));
+    }
+
+    typedef thor::hash_multimap<int, int> multimap;
+    multimap mm;
+    mm.insert(multimap::value_type(5, 1));
+    mm.insert(multimap::value_type(5, 2));
+    mm.insert(multimap::value_type(6, 3));
+    int mkeys[] = { 6, 5, 7 };
+    multimap::iterator mout[3];
+    mm.find_batch(mkeys, 3, mout);
+    EXPECT_EQ((*mout[0]).second, 3);
+    EXPECT_TRUE(mout[1] == mm.find(5));
+    EXPECT_TRUE(mout[2] == mm.end());
+}
+
+TEST(test_hashmap, prealloc)
+{
+    typedef thor::hash_map<int, int, thor::hash<int>, thor::policy::base2_partition, 8> map;
+    map m1, m2;
+
+    for (int i = 0; i < 20; ++i)
+    {
+        m1.insert(i, i * 10);
+        if (i < 5)
+        {
+            m2.insert(i + 100, i);
+        }
+    }
+    EXPECT_EQ(m1.size(), 20);
+    for (int i = 0; i < 20; i += 2)
+    {
+        m1.erase(i);
+    }
+    EXPECT_EQ(m1.size(), 10);
+
+    map m3(m1);
+    EXPECT_TRUE(m3.size() == 10);
+
+    m1.swap(m2);
+    EXPECT_EQ(m1.size(), 5);
+    EXPECT_EQ(m2.size(), 10);
+    for (int i = 0; i < 5; ++i)
+    {
+        EXPECT_EQ((*m1.find(i + 100)).second, i);
+    }
+    for (int i = 1; i < 20; i += 2)
+    {
+        EXPECT_EQ((*m2.find(i)).second, i * 10);
+        EXPECT_EQ((*m3.find(i)).second, i * 10);
+    }
+
+    // Uses the preallocated nodes and buckets again after clear()
+    m1.clear();
+    for (int i = 0; i < 8; ++i)
+    {
+        m1.insert(i, i);
+    }
+    EXPECT_EQ(m1.size(), 8);
+    EXPECT_EQ(m1.bucket_count(), 8);
+
+    thor::hash_multimap<int, int, thor::hash<int>, thor::policy::prime_number_partition, 4> mm;
+    for (int i = 0; i < 10; ++i)
+    {
+        mm.insert(i % 3, i);
+    }
+    EXPECT_EQ(mm.count(0), 4);
+    EXPECT_EQ(mm.count(2), 3);
+}
@@ -313,4 +313,54 @@ TEST(test_hashset, test_hashset)
         EXPECT_TRUE(m.end() == m.find(0x800000001));
         EXPECT_TRUE(m.empty());
     }
-}
\ No newline at end of file
+}
+
+TEST(test_hashset, find_batch)
+{
+    typedef thor::hash_set<int> set;
+    set s;
+    for (int i = 0; i < 1000; i += 2)
+    {
+        s.insert(i);
+    }
+
+    int keys[50];
+    set::iterator out[50];
+    for (int i = 0; i < 50; ++i)
+    {
+        keys[i] = i * 7;
+    }
+    s.find_batch(keys, 50, out);
+    for (int i = 0; i < 50; ++i)
+    {
+        EXPECT_TRUE(out[i] == s.find(keys[i]));
+        EXPECT_EQ(out[i] != s.end(), (keys[i] % 2) == 0);
+    }
+}
+
+TEST(test_hashset, prealloc)
+{
+    typedef thor::hash_set<int, thor::hash<int>, thor::policy::base2_partition, 4> set;
+    set s1, s2;
+    for (int i = 0; i < 10; ++i)
+    {
+        s1.insert(i);
+    }
+    s2.insert(100);
+    s1.swap(s2);
+    EXPECT_EQ(s1.size(), 1);
+    EXPECT_EQ(s2.size(), 10);
+    EXPECT_TRUE(s1.find(100) != s1.end());
+    for (int i = 0; i < 10; ++i)
+    {
+        EXPECT_TRUE(s2.find(i) != s2.end());
+    }
+
+    thor::hash_multiset<int, thor::hash<int>, thor::policy::prime_number_partition, 4> ms;
+    for (int i = 0; i < 10; ++i)
+    {
+        ms.insert(i % 3);
+    }
+    EXPECT_EQ(ms.count(0), 4);
+    EXPECT_EQ(ms.count(2), 3);
+}
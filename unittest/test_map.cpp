@@ -448,4 +448,194 @@ TEST(test_map, test_map)
         EXPECT_TRUE(p->params == 5);
         EXPECT_TRUE(m.size() == 12);
     }
-}
\ No newline at end of file
+}
+
+TEST(test_map, prealloc)
+{
+    typedef thor::map<int, int, thor::less<int>, 8> map;
+    map m1, m2;
+
+    // Stays within the preallocated nodes, then grows onto the heap
+    for (int i = 0; i < 20; ++i)
+    {
+        m1.insert(i, i * 10);
+        if (i < 5)
+        {
+            m2.insert(i + 100, i);
+        }
+    }
+    EXPECT_EQ(m1.size(), 20);
+    for (int i = 0; i < 20; i += 2)
+    {
+        m1.erase(i);
+    }
+    for (int i = 20; i < 25; ++i)
+    {
+        m1.insert(i, i * 10);
+    }
+    EXPECT_EQ(m1.size(), 15);
+
+    map m3(m1);
+    EXPECT_TRUE(thor::equal(m1.begin(), m1.end(), m3.begin()));
+
+    m1.swap(m2);
+    EXPECT_EQ(m1.size(), 5);
+    EXPECT_EQ(m2.size(), 15);
+    EXPECT_TRUE(thor::equal(m2.begin(), m2.end(), m3.begin()));
+    for (int i = 0; i < 5; ++i)
+    {
+        EXPECT_EQ((*m1.find(i + 100)).second, i);
+    }
+
+    // Preallocated nodes are reused after the swap
+    m1.clear();
+    for (int i = 0; i < 8; ++i)
+    {
+        m1.insert(i, i);
+    }
+    m2.erase(m2.begin(), m2.end());
+    EXPECT_TRUE(m2.empty());
+    EXPECT_EQ(m1.size(), 8);
+
+    thor::multimap<int, int, thor::less<int>, 4> mm;
+    for (int i = 0; i < 10; ++i)
+    {
+        mm.insert(i % 3, i);
+    }
+    EXPECT_EQ(mm.count(0), 4);
+    EXPECT_EQ(mm.count(2), 3);
+}
+
+TEST(test_map, order_stats)
+{
+    typedef thor::map<int, int, thor::less<int>, 0, true> map;
+    map m;
+    EXPECT_TRUE(m.nth(0) == m.end());
+    EXPECT_EQ(m.rank(5), 0);
+    EXPECT_EQ(m.index_of(m.end()), 0);
+
+    // Pseudo-random inserts and erases exercise all of the rebalancing cases
+    unsigned int seed = 1;
+    for (int i = 0; i < 4000; ++i)
+    {
+        seed = seed * 1103515245 + 12345;
+        const int k = int((seed >> 8) % 2000);
+        if ((seed >> 4) & 3)
+        {
+            m.insert(k, k * 2);
+        }
+        else
+        {
+            m.erase(k);
+        }
+    }
+
+    map::size_type index = 0;
+    for (map::iterator iter(m.begin()); iter != m.end(); ++iter, ++index)
+    {
+        EXPECT_TRUE(m.nth(index) == iter);
+        EXPECT_EQ(m.index_of(iter), index);
+        EXPECT_EQ(m.rank((*iter).first), index);
+        EXPECT_EQ(m.rank((*iter).first + 1), index + 1);
+        EXPECT_EQ(m.distance(m.begin(), iter), (map::difference_type)index);
+        EXPECT_EQ(m.distance(iter, m.begin()), -(map::difference_type)index);
+    }
+    EXPECT_EQ(index, m.size());
+    EXPECT_TRUE(m.nth(m.size()) == m.end());
+    EXPECT_EQ(m.index_of(m.end()), m.size());
+    EXPECT_EQ(m.rank(-1), 0);
+    EXPECT_EQ(m.rank(2000), m.size());
+
+    // Copies and swaps keep the counts
+    map m2(m);
+    map m3;
+    m3.swap(m2);
+    EXPECT_TRUE(m3.nth(m.size() / 2) != m3.end());
+    EXPECT_EQ((*m3.nth(m.size() / 2)).first, (*m.nth(m.size() / 2)).first);
+    m3.erase(m3.begin(), m3.nth(10));
+    EXPECT_EQ((*m3.nth(0)).first, (*m.nth(10)).first);
+
+    thor::multimap<int, int, thor::less<int>, 0, true> mm;
+    for (int i = 0; i < 100; ++i)
+    {
+        mm.insert(i % 10, i);
+    }
+    EXPECT_EQ(mm.rank(3), 30);
+    EXPECT_EQ(mm.distance(mm.lower_bound(3), mm.upper_bound(5)), 30);
+    EXPECT_EQ((*mm.nth(55)).first, 5);
+}
+
+TEST(test_map, insert_sorted)
+{
+    typedef thor::map<int, int, thor::less<int>, 0, true> map;
+    thor::pair<int, int> input[1000];
+    for (int i = 0; i < 1000; ++i)
+    {
+        input[i] = thor::pair<int, int>(i * 2, i);
+    }
+
+    // Build from sorted input
+    map m;
+    m.insert_sorted(input, input + 1000);
+    EXPECT_EQ(m.size(), 1000);
+    int expected = 0;
+    for (map::iterator iter(m.begin()); iter != m.end(); ++iter, expected += 2)
+    {
+        EXPECT_EQ((*iter).first, expected);
+    }
+    EXPECT_EQ((*m.nth(500)).first, 1000);
+    EXPECT_EQ(m.rank(1001), 501);
+
+    // Merge with existing entries; existing keys are kept
+    for (int i = 0; i < 1000; ++i)
+    {
+        input[i] = thor::pair<int, int>(i + 500, -1);
+    }
+    m.insert_sorted(input, input + 1000);
+    EXPECT_EQ(m.size(), 1500);
+    EXPECT_EQ((*m.find(502)).second, 251);
+    EXPECT_EQ((*m.find(503)).second, -1);
+    EXPECT_TRUE(m.find(1501) == m.end());
+    for (map::size_type i = 0; i != m.size(); ++i)
+    {
+        EXPECT_EQ(m.index_of(m.nth(i)), i);
+    }
+
+    // The tree is still usable for regular inserts and erases
+    for (int i = 0; i < 3000; i += 3)
+    {
+        m.erase(i);
+        m.insert(i + 1, i);
+    }
+    map::const_iterator prev(m.begin());
+    map::size_type count = 1;
+    for (map::const_iterator iter(++m.begin()); iter != m.end(); ++iter, ++prev, ++count)
+    {
+        EXPECT_LT((*prev).first, (*iter).first);
+    }
+    EXPECT_EQ(count, m.size());
+
+    // Duplicates within the input are skipped by map and kept by multimap
+    thor::pair<int, int> dups[6] = { thor::pair<int, int>(1, 1), thor::pair<int, int>(1, 2), thor::pair<int, int>(2, 3),
+                                     thor::pair<int, int>(2, 4), thor::pair<int, int>(2, 5), thor::pair<int, int>(3, 6) };
+    thor::map<int, int> m2;
+    m2.insert_sorted(dups, dups + 6);
+    EXPECT_EQ(m2.size(), 3);
+    EXPECT_EQ((*m2.find(2)).second, 3);
+
+    thor::multimap<int, int> mm;
+    mm.insert_sorted(dups, dups + 6);
+    mm.insert_sorted(dups, dups + 6);
+    EXPECT_EQ(mm.size(), 12);
+    EXPECT_EQ(mm.count(2), 6);
+    thor::multimap<int, int>::iterator iter(mm.lower_bound(2));
+    int order[6] = { 3, 4, 5, 3, 4, 5 };
+    for (int i = 0; i < 6; ++i, ++iter)
+    {
+        EXPECT_EQ((*iter).second, order[i]);
+    }
+
+    // Empty input leaves the map unchanged
+    mm.insert_sorted(dups, dups);
+    EXPECT_EQ(mm.size(), 12);
+}
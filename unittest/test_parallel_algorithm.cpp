@@ -0,0 +1,232 @@
+#include "test_common.h"
+#include "../parallel_algorithm.h"
+
+#include "../vector.h"
+
+using namespace thor;
+
+namespace
+{
+
+struct record
+{
+    int key;
+    int id;
+    record(int k = 0, int i = 0) : key(k), id(i) {}
+};
+
+struct record_less
+{
+    bool operator () (const record& lhs, const record& rhs) const { return lhs.key < rhs.key; }
+};
+
+}
+
+TEST(parallel_algorithm, sort)
+{
+    job_queue<> queue;
+
+    // No threads: sorted on the calling thread
+    vector<int> V;
+    for (int i = 0; i != 1000; ++i)
+    {
+        V.push_back(rand());
+    }
+    parallel_sort(queue, V.begin(), V.end());
+    for (size_type i = 1; i < V.size(); ++i)
+    {
+        EXPECT_LE(V[i - 1], V[i]);
+    }
+
+    queue.start_threads(6, "sort");
+    const int sizes[] = { 0, 1, 50000, 100000, 1000003 };
+    for (size_t s = 0; s != sizeof(sizes)/sizeof(sizes[0]); ++s)
+    {
+        V.clear();
+        for (int i = 0; i != sizes[s]; ++i)
+        {
+            V.push_back(rand() ^ (rand() << 15));
+        }
+        vector<int> expected(V);
+        thor::sort(expected.begin(), expected.end());
+
+        parallel_sort(queue, V.begin(), V.end());
+        EXPECT_TRUE(V == expected);
+
+        parallel_sort(queue, V.begin(), V.end(), greater<int>());
+        thor::reverse(expected.begin(), expected.end());
+        EXPECT_TRUE(V == expected);
+    }
+    queue.stop_threads();
+}
+
+TEST(parallel_algorithm, stable_sort)
+{
+    job_queue<> queue;
+    queue.start_threads(5, "stable_sort");
+
+    vector<record> R;
+    for (int i = 0; i != 300000; ++i)
+    {
+        R.push_back(record(rand() % 1000, i));
+    }
+    parallel_stable_sort(queue, R.begin(), R.end(), record_less());
+    for (size_type i = 1; i < R.size(); ++i)
+    {
+        EXPECT_LE(R[i - 1].key, R[i].key);
+        if (R[i - 1].key == R[i].key)
+        {
+            EXPECT_LT(R[i - 1].id, R[i].id);
+        }
+    }
+
+    // Raw pointers
+    vector<int> V;
+    for (int i = 0; i != 200000; ++i)
+    {
+        V.push_back(200000 - i);
+    }
+    parallel_stable_sort(queue, &V[0], &V[0] + V.size());
+    for (size_type i = 0; i < V.size(); ++i)
+    {
+        EXPECT_EQ(int(i + 1), V[i]);
+    }
+    queue.stop_threads();
+}
+
+namespace
+{
+
+struct square
+{
+    long long operator () (int i) const { return (long long)i * i; }
+};
+
+struct increment
+{
+    void operator () (int& i) const { ++i; }
+};
+
+struct is_odd
+{
+    bool operator () (int i) const { return (i & 1) != 0; }
+};
+
+struct max_op
+{
+    int operator () (int a, int b) const { return a < b ? b : a; }
+};
+
+// Composition of the maps x -> x * a + b is associative but not commutative
+struct affine
+{
+    unsigned a, b;
+    affine(unsigned a_ = 1, unsigned b_ = 0) : a(a_), b(b_) {}
+    bool operator == (const affine& rhs) const { return a == rhs.a && b == rhs.b; }
+};
+
+struct compose
+{
+    affine operator () (const affine& f, const affine& g) const { return affine(f.a * g.a, f.b * g.a + g.b); }
+};
+
+}
+
+TEST(parallel_algorithm, chunked)
+{
+    job_queue<> empty_queue;
+    job_queue<> queue;
+    queue.start_threads(4, "chunked");
+
+    const int sizes[] = { 0, 1, 5000, 8192, 8193, 100000, 1000003 };
+    for (size_t s = 0; s != sizeof(sizes)/sizeof(sizes[0]); ++s)
+    {
+        for (int q = 0; q != 2; ++q)
+        {
+            job_queue<>& jq = q == 0 ? empty_queue : queue;
+            const int n = sizes[s];
+
+            vector<int> V;
+            for (int i = 0; i != n; ++i)
+            {
+                V.push_back(rand() % 1000);
+            }
+
+            // for_each
+            vector<int> W(V);
+            parallel_for_each(jq, W.begin(), W.end(), increment());
+            for (int i = 0; i != n; ++i)
+            {
+                ASSERT_EQ(V[i] + 1, W[i]);
+            }
+
+            // transform
+            vector<long long> T;
+            T.resize(n, -1);
+            EXPECT_TRUE(parallel_transform(jq, V.begin(), V.end(), T.begin(), square()) == T.end());
+            for (int i = 0; i != n; ++i)
+            {
+                ASSERT_EQ((long long)V[i] * V[i], T[i]);
+            }
+            EXPECT_TRUE(parallel_transform(jq, V.begin(), V.end(), W.begin(), W.begin(), max_op()) == W.end());
+            for (int i = 0; i != n; ++i)
+            {
+                ASSERT_EQ(V[i] + 1, W[i]);
+            }
+
+            // reduce, with an operation that is associative but not commutative
+            EXPECT_EQ(thor::accumulate(V.begin(), V.end(), 7ll), parallel_reduce(jq, V.begin(), V.end(), 7ll));
+            const int* p = n == 0 ? 0 : &V[0];
+            EXPECT_EQ(thor::accumulate(V.begin(), V.end(), 0), parallel_reduce(jq, p, p + n, 0));
+            int m = -1;
+            for (int i = 0; i != n; ++i)
+            {
+                m = max_op()(m, V[i]);
+            }
+            EXPECT_EQ(m, parallel_reduce(jq, V.begin(), V.end(), -1, max_op()));
+
+            // scans, including in place
+            vector<int> expected;
+            int total = 0;
+            for (int i = 0; i != n; ++i)
+            {
+                total += V[i];
+                expected.push_back(total);
+            }
+            vector<int> S;
+            S.resize(n, 0);
+            EXPECT_TRUE(parallel_inclusive_scan(jq, V.begin(), V.end(), S.begin()) == S.end());
+            EXPECT_TRUE(S == expected);
+
+            vector<affine> A;
+            vector<affine> aexpected;
+            affine atotal(3, 5);
+            for (int i = 0; i != n; ++i)
+            {
+                A.push_back(affine(V[i] * 2 + 1, V[i]));
+                aexpected.push_back(atotal);
+                atotal = compose()(atotal, A[i]);
+            }
+            EXPECT_TRUE(parallel_exclusive_scan(jq, A.begin(), A.end(), A.begin(), affine(3, 5), compose()) == A.end());
+            EXPECT_TRUE(A == aexpected);
+
+            // copy_if and counts
+            vector<int> odd;
+            for (int i = 0; i != n; ++i)
+            {
+                if (is_odd()(V[i]))
+                {
+                    odd.push_back(V[i]);
+                }
+            }
+            vector<int> C;
+            C.resize(n, -1);
+            vector<int>::iterator end = parallel_copy_if(jq, V.begin(), V.end(), C.begin(), is_odd());
+            ASSERT_EQ(thor_diff_type(odd.size()), end - C.begin());
+            EXPECT_TRUE(thor::equal(odd.begin(), odd.end(), C.begin()));
+            EXPECT_EQ(thor_diff_type(odd.size()), parallel_count_if(jq, V.begin(), V.end(), is_odd()));
+            EXPECT_EQ(thor::count(V.begin(), V.end(), 500), parallel_count(jq, V.begin(), V.end(), 500));
+        }
+    }
+    queue.stop_threads();
+}
@@ -0,0 +1,199 @@
+#include "test_common.h"
+#include "../persistent_map.h"
+
+#include "../map.h"
+#include "../vector.h"
+
+using namespace thor;
+
+namespace
+{
+
+typedef persistent_map<int, int> int_map;
+
+// Tracks the number of live values so that leaked nodes can be detected
+struct counted
+{
+    static int live;
+    int value;
+
+    counted(int v = 0) : value(v)           { ++live; }
+    counted(const counted& c) : value(c.value) { ++live; }
+    ~counted()                              { --live; }
+    counted& operator = (const counted& c)  { value = c.value; return *this; }
+};
+int counted::live = 0;
+
+template <class T_MAP> void verify_same(const T_MAP& p, const map<int, int>& m)
+{
+    ASSERT_EQ(p.size(), m.size());
+    typename T_MAP::const_iterator piter(p.begin());
+    for (map<int, int>::const_iterator iter(m.begin()); iter != m.end(); ++iter, ++piter)
+    {
+        ASSERT_TRUE(piter != p.end());
+        EXPECT_EQ(piter->first, iter->first);
+        EXPECT_EQ(piter->second, iter->second);
+    }
+    EXPECT_TRUE(piter == p.end());
+}
+
+}
+
+TEST(persistent_map, empty)
+{
+    int_map m;
+    EXPECT_TRUE(m.empty());
+    EXPECT_EQ(m.size(), 0);
+    EXPECT_TRUE(m.begin() == m.end());
+    EXPECT_TRUE(m.find(0) == m.end());
+    EXPECT_TRUE(m.lookup(0) == 0);
+    EXPECT_TRUE(m.lower_bound(0) == m.end());
+
+    int_map m2(m.erase(0));
+    EXPECT_TRUE(m2.empty());
+    EXPECT_TRUE(m2.shares_root(m));
+}
+
+TEST(persistent_map, versions)
+{
+    int_map v0;
+    int_map v1(v0.set(1, 10));
+    int_map v2(v1.set(2, 20));
+    int_map v3(v2.set(1, 11));
+    int_map v4(v3.erase(2));
+    int_map v5(v4.insert(int_map::value_type(1, 12)));
+
+    EXPECT_EQ(v0.size(), 0);
+    EXPECT_EQ(v1.size(), 1);
+    EXPECT_EQ(v2.size(), 2);
+    EXPECT_EQ(v3.size(), 2);
+    EXPECT_EQ(v4.size(), 1);
+
+    // Older versions are unchanged
+    EXPECT_EQ(*v1.lookup(1), 10);
+    EXPECT_TRUE(v1.lookup(2) == 0);
+    EXPECT_EQ(*v2.lookup(1), 10);
+    EXPECT_EQ(*v2.lookup(2), 20);
+    EXPECT_EQ(*v3.lookup(1), 11);
+    EXPECT_EQ(*v3.lookup(2), 20);
+    EXPECT_EQ(*v4.lookup(1), 11);
+    EXPECT_TRUE(v4.lookup(2) == 0);
+
+    // insert() does not replace, and nothing is copied when nothing changes
+    EXPECT_EQ(*v5.lookup(1), 11);
+    EXPECT_TRUE(v5.shares_root(v4));
+    EXPECT_TRUE(v4.erase(5).shares_root(v4));
+
+    // Assignment and swap are just handle operations
+    int_map a(v2);
+    EXPECT_TRUE(a.shares_root(v2));
+    a = v4;
+    EXPECT_TRUE(a.shares_root(v4));
+    a.swap(v2);
+    EXPECT_EQ(a.size(), 2);
+    EXPECT_EQ(v2.size(), 1);
+    a.clear();
+    EXPECT_TRUE(a.empty());
+    EXPECT_EQ(*v3.lookup(2), 20);
+}
+
+TEST(persistent_map, random)
+{
+    map<int, int> reference;
+    int_map p;
+    vector<int_map> history;
+    vector<map<int, int> > reference_history;
+
+    srand(12345);
+    for (int i = 0; i < 20000; ++i)
+    {
+        const int key = rand() % 2000;
+        switch (rand() % 3)
+        {
+        case 0:
+            p = p.erase(key);
+            reference.erase(key);
+            break;
+
+        default:
+            p = p.set(key, i);
+            reference[key] = i;
+            break;
+        }
+
+        if ((i % 1000) == 0)
+        {
+            history.push_back(p);
+            reference_history.push_back(reference);
+        }
+    }
+    verify_same(p, reference);
+
+    // Every saved version still matches
+    for (size_type i = 0; i != history.size(); ++i)
+    {
+        verify_same(history[i], reference_history[i]);
+    }
+
+    for (int key = -1; key <= 2001; ++key)
+    {
+        map<int, int>::const_iterator iter(reference.find(key));
+        int_map::const_iterator piter(p.find(key));
+        EXPECT_EQ(iter == reference.end(), piter == p.end());
+        EXPECT_EQ(reference.count(key), p.count(key));
+        if (iter != reference.end())
+        {
+            EXPECT_EQ(piter->second, iter->second);
+            EXPECT_EQ(*p.lookup(key), iter->second);
+        }
+
+        map<int, int>::const_iterator lower(reference.lower_bound(key));
+        int_map::const_iterator plower(p.lower_bound(key));
+        EXPECT_EQ(lower == reference.end(), plower == p.end());
+        if (lower != reference.end())
+        {
+            EXPECT_EQ(plower->first, lower->first);
+        }
+
+        map<int, int>::const_iterator upper(reference.upper_bound(key));
+        int_map::const_iterator pupper(p.upper_bound(key));
+        EXPECT_EQ(upper == reference.end(), pupper == p.end());
+        if (upper != reference.end())
+        {
+            EXPECT_EQ(pupper->first, upper->first);
+        }
+    }
+}
+
+TEST(persistent_map, no_leaks)
+{
+    {
+        persistent_map<int, counted> m;
+        for (int i = 0; i < 1000; ++i)
+        {
+            m = m.set(i, counted(i));
+        }
+        EXPECT_EQ(counted::live, 1000);
+
+        persistent_map<int, counted> old(m);
+        for (int i = 0; i < 1000; i += 2)
+        {
+            m = m.erase(i);
+        }
+        EXPECT_EQ(m.size(), 500);
+        EXPECT_EQ(old.size(), 1000);
+        EXPECT_EQ(old.lookup(2)->value, 2);
+        EXPECT_TRUE(m.lookup(2) == 0);
+
+        // Sorted insertion from a range, with the single-threaded reference count policy
+        vector<pair<int, counted> > v;
+        for (int i = 0; i < 100; ++i)
+        {
+            v.push_back(pair<int, counted>(i, counted(i)));
+        }
+        persistent_map<int, counted, less<int>, policy::unsafe_ref_count> r(v.begin(), v.end());
+        EXPECT_EQ(r.size(), 100);
+        EXPECT_EQ(r.begin()->second.value, 0);
+    }
+    EXPECT_EQ(counted::live, 0);
+}
@@ -0,0 +1,236 @@
+#include "ring_buffer.h"
+#include "vector.h"
+#include "test_common.h"
+
+namespace
+{
+
+template <class Ring> void expect_contents(const Ring& r, const thor::vector<int>& expected)
+{
+    ASSERT_EQ(expected.size(), r.size());
+    for (size_t i = 0; i != expected.size(); ++i)
+    {
+        EXPECT_EQ(expected[i], r[i]);
+    }
+
+    // Iteration in both directions agrees with indexing
+    size_t i = 0;
+    for (typename Ring::const_iterator iter(r.begin()); iter != r.end(); ++iter, ++i)
+    {
+        EXPECT_EQ(expected[i], *iter);
+        EXPECT_EQ(typename Ring::difference_type(i), iter - r.begin());
+    }
+    EXPECT_EQ(r.size(), i);
+    for (typename Ring::const_reverse_iterator iter(r.rbegin()); iter != r.rend(); ++iter)
+    {
+        EXPECT_EQ(expected[--i], *iter);
+    }
+    EXPECT_EQ(typename Ring::difference_type(r.size()), r.end() - r.begin());
+    EXPECT_EQ(typename Ring::difference_type(r.size()), r.rend() - r.rbegin());
+
+    // The two spans hold the elements in order
+    const int *first, *second;
+    typename Ring::size_type first_count, second_count;
+    r.get_spans(first, first_count, second, second_count);
+    ASSERT_EQ(r.size(), first_count + second_count);
+    for (i = 0; i != first_count; ++i)
+    {
+        EXPECT_EQ(expected[i], first[i]);
+    }
+    for (i = 0; i != second_count; ++i)
+    {
+        EXPECT_EQ(expected[first_count + i], second[i]);
+    }
+}
+
+}
+
+TEST(test_ring_buffer, basic)
+{
+    thor::ring_buffer<int, 8> r;
+    EXPECT_TRUE(r.empty());
+    EXPECT_FALSE(r.full());
+    EXPECT_EQ(8U, r.capacity());
+    EXPECT_TRUE(r.begin() == r.end());
+    EXPECT_TRUE(r.rbegin() == r.rend());
+
+    // Runtime capacities are rounded up to a power of two
+    thor::ring_buffer<int> r2(100);
+    EXPECT_EQ(128U, r2.capacity());
+    thor::ring_buffer<int> r3(0);
+    EXPECT_EQ(1U, r3.capacity());
+
+    // Wrap around the end of the storage from both ends
+    thor::vector<int> expected;
+    for (int i = 0; i != 1000; ++i)
+    {
+        if (r.full())
+        {
+            if (i % 3 == 0)
+            {
+                r.pop_back();
+                expected.pop_back();
+            }
+            else
+            {
+                r.pop_front();
+                expected.erase(expected.begin());
+            }
+        }
+        if (i % 5 == 0)
+        {
+            EXPECT_EQ(i, r.push_front(i));
+            expected.insert(expected.begin(), i);
+        }
+        else
+        {
+            EXPECT_EQ(i, r.push_back(i));
+            expected.push_back(i);
+        }
+        EXPECT_EQ(expected.front(), r.front());
+        EXPECT_EQ(expected.back(), r.back());
+        expect_contents(r, expected);
+    }
+
+    thor::ring_buffer<int, 8> copy(r);
+    expect_contents(copy, expected);
+    EXPECT_TRUE(copy == r);
+    copy.pop_front();
+    EXPECT_TRUE(copy != r);
+    copy = r;
+    EXPECT_TRUE(copy == r);
+
+    // Comparison is lexicographical from the front
+    thor::ring_buffer<int, 8> less(r);
+    less.back() -= 1;
+    EXPECT_TRUE(less < r);
+    EXPECT_TRUE(r > less);
+    EXPECT_TRUE(less <= r);
+    EXPECT_TRUE(r >= less);
+    EXPECT_FALSE(r < less);
+    EXPECT_FALSE(less > r);
+    EXPECT_FALSE(r <= less);
+    EXPECT_FALSE(less >= r);
+    EXPECT_TRUE(copy <= r);
+    EXPECT_TRUE(copy >= r);
+    EXPECT_FALSE(copy < r);
+    EXPECT_FALSE(copy > r);
+    copy.pop_back();
+    EXPECT_TRUE(copy < r); // a prefix compares less
+    EXPECT_TRUE(r > copy);
+    copy = r;
+
+    // Assignment adopts the capacity of the source
+    r2.push_back(1);
+    r3 = r2;
+    EXPECT_EQ(128U, r3.capacity());
+    EXPECT_EQ(1U, r3.size());
+    EXPECT_EQ(1, r3.front());
+
+    r.clear();
+    EXPECT_TRUE(r.empty());
+    thor::swap(r, copy);
+    expect_contents(r, expected);
+    EXPECT_TRUE(copy.empty());
+}
+
+TEST(test_ring_buffer, overwrite)
+{
+    // A sliding window of the last 16 values
+    thor::ring_buffer<int> r(16, true);
+    EXPECT_TRUE(r.overwrite());
+    thor::vector<int> expected;
+    for (int i = 0; i != 100; ++i)
+    {
+        r.push_back(i);
+        expected.push_back(i);
+        if (expected.size() > 16)
+        {
+            expected.erase(expected.begin());
+        }
+        expect_contents(r, expected);
+    }
+    EXPECT_TRUE(r.full());
+
+    // push_front() overwrites the back
+    r.push_front(-1);
+    expected.pop_back();
+    expected.insert(expected.begin(), -1);
+    expect_contents(r, expected);
+
+    r.set_overwrite(false);
+    EXPECT_FALSE(r.overwrite());
+}
+
+TEST(test_ring_buffer, bulk)
+{
+    thor::ring_buffer<int, 64> r;
+    thor::vector<int> expected;
+    int next = 0;
+    for (int round = 0; round != 100; ++round)
+    {
+        // Produce a variable amount, then consume part of it through the spans
+        const int produce = (round * 7) % 40;
+        for (int i = 0; i != produce && !r.full(); ++i)
+        {
+            r.push_back(next);
+            expected.push_back(next++);
+        }
+        expect_contents(r, expected);
+
+        int* first, *second;
+        thor::ring_buffer<int, 64>::size_type first_count, second_count;
+        r.get_spans(first, first_count, second, second_count);
+        const thor::ring_buffer<int, 64>::size_type consume = (first_count + second_count) / 2;
+        for (thor::ring_buffer<int, 64>::size_type i = 0; i != consume; ++i)
+        {
+            EXPECT_EQ(expected.front(), i < first_count ? first[i] : second[i - first_count]);
+            expected.erase(expected.begin());
+        }
+        r.pop_front(consume);
+        expect_contents(r, expected);
+    }
+
+    r.pop_back(r.size() / 2);
+    expected.erase(expected.end() - (expected.size() / 2), expected.end());
+    expect_contents(r, expected);
+}
+
+TEST(test_ring_buffer, objects)
+{
+    // Elements are constructed when pushed and destroyed when popped, overwritten or cleared
+    {
+        thor::ring_buffer<s> r(4, true);
+        for (int i = 0; i != 10; ++i)
+        {
+            r.push_back(i);
+            r.front().foo();
+        }
+        EXPECT_EQ(4U, r.size());
+        EXPECT_EQ(6, *r.front().test);
+        EXPECT_EQ(9, *r.back().test);
+
+        thor::ring_buffer<s> copy(r);
+        EXPECT_TRUE(copy == r);
+        r.pop_front(3);
+        r.push_front(5);
+        r.push_front(4);
+        EXPECT_EQ(4, *r[0].test);
+        EXPECT_EQ(9, *r[2].test);
+        r.clear();
+        copy.pop_back();
+        EXPECT_EQ(8, *copy.back().test);
+    }
+
+    bool b = test_push_back<thor::ring_buffer<s, 8>, NoValidate<thor::ring_buffer<s, 8> > >(0, 1.f, 2.0, 3, '4');
+    EXPECT_TRUE(b);
+    b = test_push_front<thor::ring_buffer<s, 8>, NoValidate<thor::ring_buffer<s, 8> > >(0, 1.f, 2.0, 3, '4');
+    EXPECT_TRUE(b);
+
+    thor::ring_buffer<s*, 4> pointers;
+    pointers.push_back((s*)0);
+    pointers.push_back(new s);
+    thor::ring_buffer<s*, 4> pointers_copy(pointers);
+    EXPECT_EQ(pointers[1], pointers_copy[1]);
+    delete pointers.back();
+}
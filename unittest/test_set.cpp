@@ -374,4 +374,97 @@ TEST(test_set, test_set)
     test_multiset<int>();
     test_multiset<s>();
     test_multiset<aligntest>();
-}
\ No newline at end of file
+}
+
+TEST(test_set, prealloc)
+{
+    typedef thor::set<int, thor::less<int>, 4> set;
+    set s1, s2;
+    for (int i = 0; i < 10; ++i)
+    {
+        s1.insert(i);
+    }
+    s2.insert(100);
+    s1.swap(s2);
+    EXPECT_EQ(s1.size(), 1);
+    EXPECT_EQ(s2.size(), 10);
+    EXPECT_TRUE(s1.find(100) != s1.end());
+    int expected = 0;
+    for (set::iterator iter(s2.begin()); iter != s2.end(); ++iter)
+    {
+        EXPECT_EQ(*iter, expected++);
+    }
+
+    thor::multiset<int, thor::less<int>, 4> ms;
+    for (int i = 0; i < 10; ++i)
+    {
+        ms.insert(i % 3);
+    }
+    EXPECT_EQ(ms.count(0), 4);
+    EXPECT_EQ(ms.count(2), 3);
+}
+
+TEST(test_set, order_stats)
+{
+    typedef thor::set<int, thor::less<int>, 0, true> set;
+    set s;
+    for (int i = 0; i < 1000; ++i)
+    {
+        s.insert((i * 7919) % 1000);
+    }
+    for (int i = 0; i < 1000; i += 3)
+    {
+        s.erase(i);
+    }
+
+    set::size_type index = 0;
+    for (set::iterator iter(s.begin()); iter != s.end(); ++iter, ++index)
+    {
+        EXPECT_TRUE(s.nth(index) == iter);
+        EXPECT_EQ(s.index_of(iter), index);
+        EXPECT_EQ(s.rank(*iter), index);
+    }
+    EXPECT_EQ(index, s.size());
+
+    // Percentiles
+    EXPECT_EQ(*s.nth(s.size() / 2), 500);
+    EXPECT_EQ(s.distance(s.lower_bound(100), s.lower_bound(200)), 67);
+
+    thor::multiset<int, thor::less<int>, 0, true> ms;
+    for (int i = 0; i < 50; ++i)
+    {
+        ms.insert(i % 5);
+    }
+    EXPECT_EQ(ms.rank(2), 20);
+    EXPECT_EQ(*ms.nth(49), 4);
+}
+
+TEST(test_set, insert_sorted)
+{
+    int v[500];
+    for (int i = 0; i < 500; ++i)
+    {
+        v[i] = i * 3;
+    }
+    thor::set<int> s;
+    s.insert_sorted(v, v + 500);
+    EXPECT_EQ(s.size(), 500);
+    EXPECT_TRUE(thor::equal(s.begin(), s.end(), v));
+
+    thor::set<int> s2;
+    s2.insert_sorted(s.begin(), s.end());
+    EXPECT_TRUE(s == s2);
+    s2.insert_sorted(v, v + 500);
+    EXPECT_EQ(s2.size(), 500);
+
+    thor::multiset<int> ms;
+    ms.insert_sorted(v, v + 500);
+    ms.insert_sorted(s.begin(), s.end());
+    EXPECT_EQ(ms.size(), 1000);
+    EXPECT_EQ(ms.count(3), 2);
+    for (int i = 0; i < 1000; ++i)
+    {
+        ms.erase(ms.begin());
+    }
+    EXPECT_TRUE(ms.empty());
+}
@@ -0,0 +1,81 @@
+#include "test_common.h"
+#include "../top_k.h"
+
+using namespace thor;
+
+namespace
+{
+
+struct candidate
+{
+    float score;
+    int id;
+    candidate(float s = 0.0f, int i = 0) : score(s), id(i) {}
+};
+
+struct candidate_greater
+{
+    bool operator () (const candidate& lhs, const candidate& rhs) const { return lhs.score > rhs.score; }
+};
+
+}
+
+TEST(top_k, basic)
+{
+    top_k<int> t(3);
+    EXPECT_EQ(t.k(), 3);
+    EXPECT_TRUE(t.empty());
+
+    const int values[] = { 9, 4, 7, 1, 8, 2, 6, 3, 5, 0 };
+    t.push(values, values + 10);
+    EXPECT_EQ(t.size(), 3);
+
+    // 0..2 are kept; anything larger than the threshold is rejected
+    EXPECT_FALSE(t.push(100));
+    EXPECT_TRUE(t.push(-1));
+
+    vector<int> out;
+    out.push_back(42);
+    t.extract_sorted(out);
+    ASSERT_EQ(out.size(), 3);
+    EXPECT_EQ(out[0], -1);
+    EXPECT_EQ(out[1], 0);
+    EXPECT_EQ(out[2], 1);
+    EXPECT_TRUE(t.empty());
+
+    // Fewer values than k
+    t.push(5);
+    t.push(4);
+    t.extract_sorted(out);
+    ASSERT_EQ(out.size(), 2);
+    EXPECT_EQ(out[0], 4);
+    EXPECT_EQ(out[1], 5);
+
+    top_k<int> none(0);
+    EXPECT_FALSE(none.push(1));
+    none.extract_sorted(out);
+    EXPECT_TRUE(out.empty());
+}
+
+TEST(top_k, stream)
+{
+    const size_type k = 100;
+    top_k<candidate, candidate_greater> best(k);
+    vector<candidate> all;
+    for (int i = 0; i != 1000000; ++i)
+    {
+        candidate c(float(rand() % 50000) / 7.0f, i);
+        best.push(c);
+        all.push_back(c);
+    }
+    EXPECT_EQ(best.size(), k);
+
+    vector<candidate> out;
+    best.extract_sorted(out);
+    stable_sort(all.begin(), all.end(), candidate_greater());
+    ASSERT_EQ(out.size(), k);
+    for (size_type i = 0; i != k; ++i)
+    {
+        EXPECT_EQ(all[i].score, out[i].score);
+    }
+}
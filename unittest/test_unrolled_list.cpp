@@ -0,0 +1,398 @@
+#include "unrolled_list.h"
+#include "list.h"
+#include "test_common.h"
+
+#include <stdlib.h>
+
+namespace
+{
+
+template <class T> class UnrolledListValidator
+{
+public:
+    bool operator () (T& t)
+    {
+        return t.validate();
+    }
+};
+
+template <class T, class U> bool same_contents(const T& t, const U& u)
+{
+    bool b = t.size() == u.size() && thor::equal(t.begin(), t.end(), u.begin());
+    typename U::const_reverse_iterator ru(u.rbegin());
+    for (typename T::const_reverse_iterator rt(t.rbegin()); b && rt != t.rend(); ++rt, ++ru)
+    {
+        b = (*rt == *ru);
+    }
+    EXPECT_TRUE(b);
+    return b;
+}
+
+template <class T, class Compare> bool ordered(const T& t, Compare comp)
+{
+    typename T::const_iterator prev(t.begin());
+    for (typename T::const_iterator iter(prev); iter != t.end(); prev = iter)
+    {
+        if (++iter != t.end() && comp(*iter, *prev))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Checks the node fill through get_contiguous(), which reports the rest of a node from its first element
+template <class T> bool nodes_filled(const T& t)
+{
+    thor::vector<typename T::size_type> counts;
+    for (typename T::const_iterator iter(t.begin()); iter != t.end(); )
+    {
+        typename T::size_type count;
+        t.get_contiguous(iter, count);
+        counts.push_back(count);
+        thor::advance(iter, count);
+    }
+    for (thor::size_type i = 1; i + 1 < counts.size(); ++i)
+    {
+        if (counts[i] < typename T::size_type(T::min_node_count))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct less_equal_int
+{
+    bool operator () (int lhs, int rhs) const { return lhs <= rhs; }
+};
+
+}
+
+template <class T, thor::size_type T_NODE_BYTES> bool test_unrolled_list()
+{
+    typedef thor::unrolled_list<T, T_NODE_BYTES> list;
+
+    {
+        list l;
+        EXPECT_TRUE(l.size() == 0);
+        EXPECT_TRUE(l.empty());
+        EXPECT_TRUE(l.begin() == l.end());
+        EXPECT_TRUE(l.rbegin() == l.rend());
+    }
+
+    {
+        const list l(25U, T());
+        EXPECT_TRUE(l.size() == 25);
+        typename list::size_type t = 0;
+        for (typename list::const_iterator iter(l.begin()); iter != l.end(); ++iter)
+        {
+            ++t;
+        }
+        EXPECT_TRUE(t == 25);
+        t = 0;
+        for (typename list::const_reverse_iterator iter(l.rbegin()); iter != l.rend(); ++iter)
+        {
+            ++t;
+        }
+        EXPECT_TRUE(t == 25);
+
+        list l2(l);
+        EXPECT_TRUE(l2.size() == l.size());
+        EXPECT_TRUE(l2.validate());
+
+        list l3(2); l3 = l; EXPECT_TRUE(l3.validate()); EXPECT_TRUE(l3.size() == 25);
+        list l4(70); l4 = l; EXPECT_TRUE(l4.validate()); EXPECT_TRUE(l4.size() == 25);
+
+        {
+            T& t = l3.front(); t = T();
+            const T& ct = l.front(); THOR_UNUSED(ct);
+        }
+        {
+            T& t = l3.back(); t = T();
+            const T& ct = l.back(); THOR_UNUSED(ct);
+        }
+    }
+
+    return true;
+}
+
+TEST(test_unrolled_list, test_unrolled_list)
+{
+    test_unrolled_list<int, 16>();
+    test_unrolled_list<int, 256>();
+    test_unrolled_list<s, 256>();
+    test_unrolled_list<aligntest, 256>();
+
+    // Extensions
+    test_pointer_types<thor::unrolled_list<s*>, UnrolledListValidator<thor::unrolled_list<s*> > >();
+    test_push_back<thor::unrolled_list<s>, UnrolledListValidator<thor::unrolled_list<s> > >(0, 1.f, 2.0, 3, '4');
+    test_push_front<thor::unrolled_list<s>, UnrolledListValidator<thor::unrolled_list<s> > >(0, 1.f, 2.0, 3, '4');
+    test_insert<thor::unrolled_list<s>, UnrolledListValidator<thor::unrolled_list<s> > >(0, 1.f, 2.0, 3, '4');
+    test_resize<thor::unrolled_list<int, 16>, UnrolledListValidator<thor::unrolled_list<int, 16> > >(100);
+
+    {
+        thor::unrolled_list<int, 16> list(10);
+        test_erase<UnrolledListValidator<thor::unrolled_list<int, 16> > >(list);
+    }
+    {
+        thor::unrolled_list<s> list(10);
+        test_erase<UnrolledListValidator<thor::unrolled_list<s> > >(list);
+    }
+}
+
+TEST(test_unrolled_list, swap_splice)
+{
+    typedef thor::unrolled_list<int, 16> list;
+    EXPECT_EQ(4, list::node_count);
+
+    list l1, l2;
+    for (int i = 0; i != 10; ++i)
+    {
+        l1.push_back(i);
+        l2.push_front(i);
+    }
+    l1.swap(l2);
+    thor::swap(l1, l2);
+    l1.swap(l2);
+    EXPECT_TRUE(l1.validate());
+    EXPECT_TRUE(l2.validate());
+    EXPECT_EQ(9, l1.front());
+    EXPECT_EQ(0, l1.back());
+    EXPECT_EQ(0, l2.front());
+    EXPECT_EQ(9, l2.back());
+
+    list empty;
+    empty.swap(l1);
+    EXPECT_TRUE(l1.empty());
+    EXPECT_EQ(10U, empty.size());
+    EXPECT_TRUE(l1.validate());
+    EXPECT_TRUE(empty.validate());
+
+    // Splicing into the middle of a node splits it
+    list l3(5U, -1);
+    list::iterator iter(l3.begin());
+    ++iter; ++iter; ++iter;
+    l3.splice(iter, l2);
+    EXPECT_TRUE(l2.empty());
+    EXPECT_TRUE(l2.validate());
+    EXPECT_TRUE(l3.validate());
+    EXPECT_EQ(15U, l3.size());
+    iter = l3.begin();
+    for (int i = 0; i != 3; ++i)
+    {
+        EXPECT_EQ(-1, *iter++);
+    }
+    for (int i = 0; i != 10; ++i)
+    {
+        EXPECT_EQ(i, *iter++);
+    }
+    EXPECT_EQ(-1, *iter++);
+    EXPECT_EQ(-1, *iter++);
+    EXPECT_TRUE(iter == l3.end());
+
+    // Single elements and ranges are copied
+    l2.splice(l2.end(), l3, l3.begin());
+    EXPECT_EQ(1U, l2.size());
+    EXPECT_EQ(14U, l3.size());
+    iter = l3.begin(); ++iter; ++iter;
+    list::iterator last(iter);
+    thor::advance(last, 5);
+    l2.splice(l2.begin(), l3, iter, last);
+    EXPECT_TRUE(l2.validate());
+    EXPECT_TRUE(l3.validate());
+    EXPECT_EQ(6U, l2.size());
+    EXPECT_EQ(9U, l3.size());
+    EXPECT_EQ(0, l2.front());
+    EXPECT_EQ(-1, l2.back());
+
+    // remove(), sort(), unique(), merge()
+    l3.push_back(3);
+    l3.remove(-1); // 5 6 7 8 9 3
+    EXPECT_TRUE(l3.validate());
+    EXPECT_EQ(6U, l3.size());
+    EXPECT_TRUE(thor::find(l3.begin(), l3.end(), -1) == l3.end());
+
+    l3.sort();
+    EXPECT_TRUE(l3.validate());
+    EXPECT_TRUE(ordered(l3, thor::less<int>()));
+    l2.sort();
+    l3.merge(l2);
+    EXPECT_TRUE(l2.empty());
+    EXPECT_TRUE(l3.validate());
+    EXPECT_EQ(12U, l3.size());
+    EXPECT_TRUE(ordered(l3, thor::less<int>()));
+    l3.unique();
+    EXPECT_TRUE(l3.validate());
+    EXPECT_EQ(11U, l3.size());
+    EXPECT_TRUE(ordered(l3, less_equal_int()));
+
+    l3.sort(thor::greater<int>());
+    EXPECT_TRUE(ordered(l3, thor::greater<int>()));
+}
+
+TEST(test_unrolled_list, random_operations)
+{
+    // Compare against list through many inserts and erases in the middle
+    typedef thor::unrolled_list<int, 32> unrolled;
+    unrolled u;
+    thor::list<int> l;
+    srand(12345);
+    for (int i = 0; i != 5000; ++i)
+    {
+        const int op = rand() % 8;
+        const thor::size_type pos = l.empty() ? 0 : thor::size_type(rand()) % (l.size() + 1);
+        unrolled::iterator uiter(u.begin());
+        thor::list<int>::iterator liter(l.begin());
+        thor::advance(uiter, pos);
+        thor::advance(liter, pos);
+
+        if (op < 4 || l.size() < 10)
+        {
+            unrolled::iterator inserted = u.insert(uiter, i);
+            EXPECT_EQ(i, *inserted);
+            l.insert(liter, i);
+        }
+        else if (op < 6 && liter != l.end())
+        {
+            unrolled::iterator next = u.erase(uiter);
+            thor::list<int>::iterator lnext = l.erase(liter);
+            EXPECT_TRUE((next == u.end()) == (lnext == l.end()));
+            if (lnext != l.end())
+            {
+                EXPECT_EQ(*lnext, *next);
+            }
+        }
+        else if (op == 6)
+        {
+            // Erase a range that may span several nodes
+            const thor::size_type count = thor::min(thor::size_type(rand() % 20), l.size() - pos);
+            unrolled::iterator ulast(uiter);
+            thor::list<int>::iterator llast(liter);
+            thor::advance(ulast, count);
+            thor::advance(llast, count);
+            unrolled::iterator next = u.erase(uiter, ulast);
+            thor::list<int>::iterator lnext = l.erase(liter, llast);
+            EXPECT_TRUE((next == u.end()) == (lnext == l.end()));
+            if (lnext != l.end())
+            {
+                EXPECT_EQ(*lnext, *next);
+            }
+        }
+        else
+        {
+            const int values[] = { i, i + 1, i + 2 };
+            u.insert(uiter, values, values + 3);
+            l.insert(liter, values, values + 3);
+        }
+
+        ASSERT_TRUE(u.validate());
+        ASSERT_TRUE(same_contents(u, l));
+    }
+
+    // Every element is reachable through get_contiguous()
+    thor::size_type total = 0;
+    for (unrolled::const_iterator iter(u.begin()); iter != u.end(); )
+    {
+        unrolled::size_type count;
+        const int* p = u.get_contiguous(iter, count);
+        EXPECT_TRUE(count > 0 && count <= unrolled::size_type(unrolled::node_count));
+        EXPECT_EQ(&*iter, p);
+        total += count;
+        thor::advance(iter, count);
+    }
+    EXPECT_EQ(u.size(), total);
+
+    while (!l.empty())
+    {
+        EXPECT_EQ(l.front(), u.front());
+        EXPECT_EQ(l.back(), u.back());
+        if (l.size() & 1)
+        {
+            u.pop_back();
+            l.pop_back();
+        }
+        else
+        {
+            u.pop_front();
+            l.pop_front();
+        }
+        ASSERT_TRUE(u.validate());
+    }
+    EXPECT_TRUE(u.empty());
+}
+
+TEST(test_unrolled_list, minimum_fill)
+{
+    typedef thor::unrolled_list<int, 64> unrolled;
+    EXPECT_EQ(16, unrolled::node_count);
+    EXPECT_EQ(4, unrolled::min_node_count);
+
+    srand(4321);
+    unrolled u;
+    thor::list<int> l;
+    for (int i = 0; i != 2000; ++i)
+    {
+        const int op = rand() % 4;
+        const thor::size_type pos = l.empty() ? 0 : thor::size_type(rand()) % (l.size() + 1);
+        unrolled::iterator uiter(u.begin());
+        thor::list<int>::iterator liter(l.begin());
+        thor::advance(uiter, pos);
+        thor::advance(liter, pos);
+
+        if (op == 0 || l.size() < 50)
+        {
+            // Splicing a short list at any index splits pos's node
+            const int values[] = { i, i + 1 };
+            const thor::size_type count = 1 + thor::size_type(rand() % 2);
+            u.insert(uiter, values, values + count);
+            l.insert(liter, values, values + count);
+        }
+        else if (op == 1)
+        {
+            unrolled other;
+            other.push_back(-i);
+            u.splice(uiter, other);
+            l.insert(liter, -i);
+        }
+        else if (liter != l.end())
+        {
+            // Erase a few elements, which can leave a node nearly empty
+            const thor::size_type count = thor::min(thor::size_type(1 + rand() % 12), l.size() - pos);
+            unrolled::iterator ulast(uiter);
+            thor::list<int>::iterator llast(liter);
+            thor::advance(ulast, count);
+            thor::advance(llast, count);
+            unrolled::iterator next = u.erase(uiter, ulast);
+            thor::list<int>::iterator lnext = l.erase(liter, llast);
+            EXPECT_TRUE((next == u.end()) == (lnext == l.end()));
+            if (lnext != l.end())
+            {
+                EXPECT_EQ(*lnext, *next);
+            }
+        }
+
+        ASSERT_TRUE(nodes_filled(u));
+        ASSERT_TRUE(u.validate());
+        ASSERT_TRUE(same_contents(u, l));
+    }
+
+    // Objects are constructed and destroyed correctly as they move between nodes
+    thor::unrolled_list<s, 64> objects;
+    for (int i = 0; i != 200; ++i)
+    {
+        thor::unrolled_list<s, 64>::iterator iter(objects.begin());
+        thor::advance(iter, objects.empty() ? 0 : rand() % objects.size());
+        if (i % 3 == 2)
+        {
+            objects.erase(iter);
+        }
+        else
+        {
+            const s values[3];
+            objects.insert(iter, values, values + 3);
+        }
+        ASSERT_TRUE(objects.validate());
+        ASSERT_TRUE(nodes_filled(objects));
+    }
+}
@@ -0,0 +1,1097 @@
+/* THOR - THOR Template Library
+ * Joshua M. Kriegshauser
+ *
+ * unrolled_list.h
+ *
+ * This file defines an unrolled linked list: a doubly-linked list of nodes that each hold a small
+ * array of elements.
+ *
+ * Scanning a list visits one heap node per element and waits on a cache miss for each of them. An
+ * unrolled_list visits one node per node_count elements, which are adjacent in memory, so sequential
+ * scans run at close to the speed of an array. Inserting or erasing in the middle only moves the
+ * elements of one node.
+ *
+ * Extensions/Changes:
+ * - The size of a node is given in bytes by the T_NODE_BYTES template parameter (256 by default).
+ *   Each node holds T_NODE_BYTES / sizeof(T) elements, but at least 4. The node_count enum is the
+ *   resulting number.
+ * - Inserting into a full node splits it into two half-full nodes. Inserting before the first
+ *   element of a node appends to the previous node if it has room, so push_back() and sequential
+ *   inserts fill nodes completely. Erasing merges a node with a neighbor when the two together are
+ *   at most half full.
+ * - Every node other than the first and last is kept at least a quarter full (min_node_count). A
+ *   node that falls below that after an erase or splice is merged into a neighbor, or takes elements
+ *   from its next node if neither neighbor has room.
+ * - Iterator invalidation is per node rather than per element:
+ *   * insert() invalidates iterators to elements in the node that was inserted into (and the node it
+ *     was split into, if any). Iterators to elements in other nodes remain valid.
+ *   * erase() invalidates iterators to elements in the node that was erased from, and in a neighbor
+ *     that it was merged with or took elements from.
+ *   * splice() and the range insert() invalidate iterators to elements in pos's node and in the
+ *     nodes on either side of the inserted nodes.
+ *   * As with list, iterators remain valid when other nodes are changed.
+ * - The API is that of list, with these differences:
+ *   * Elements are moved within and between nodes, so T must be copy-constructible and assignable.
+ *   * splice(pos, L) is O(node_count): the node at pos is split and L's nodes are linked in.
+ *     splice() of single elements or ranges copies the elements and erases them from L.
+ *   * merge() and sort() copy the elements. sort() is stable.
+ *   * There is no move() function.
+ *   * The parameters to the single-element insert() and push_front() must not refer to elements of
+ *     the list, since elements are moved to make room before the new element is constructed.
+ * - get_contiguous(pos, count):
+ *   * returns a pointer to the element at pos. count is an output parameter that receives the number
+ *     of elements that follow it in the same node (including itself).
+ * - push_back(), push_front() and insert() have the same extensions as list:
+ *   * They return a reference (or iterator) to the added item
+ *   * With zero parameters they will default-construct an element
+ *   * Variations exist with 1-4 parameters that will in-place construct an element without
+ *     necessarily needing a copy constructor.
+ *   * push_back_placement(), push_front_placement() and insert_placement() can be used with
+ *     placement new to construct elements with more than 4 parameters.
+ * - Assistance for raw pointer types:
+ *   * delete_all() will call delete on every element and clear() the list.
+ *   * erase_and_delete() can be used to delete an element and erase it from the list.
+ *   * pop_front_delete() will delete the first element and pop it from the list.
+ *   * pop_back_delete() will delete the last element and pop it from the list.
+ * - O(1) size() function
+ * - No initial heap allocation.
+ *
+ * unrolled_list
+ *   Time:
+ *     push_back, pop_back, pop_front - constant
+ *     push_front, insert, erase - O(node_count)
+ *     iteration - linear, with one node visited per node_count elements
+ *   Memory: nodes other than the first and last are kept at least a quarter full; they are full
+ *   when filled by push_back().
+ *   Usage suggestions:
+ *     Prefer over list when the list is mostly scanned and iterators to individual elements do not
+ *     need to survive changes nearby. Prefer over vector or deque when elements are frequently
+ *     inserted or erased in the middle of a long sequence.
+ */
+
+#ifndef THOR_UNROLLED_LIST_H
+#define THOR_UNROLLED_LIST_H
+#pragma once
+
+#ifndef THOR_BASETYPES_H
+#include "basetypes.h"
+#endif
+
+#ifndef THOR_TYPETRAITS_H
+#include "typetraits.h"
+#endif
+
+#ifndef THOR_ITERATOR_H
+#include "iterator.h"
+#endif
+
+#ifndef THOR_FUNCTION_H
+#include "function.h"
+#endif
+
+#ifndef THOR_ALGORITHM_H
+#include "algorithm.h"
+#endif
+
+#ifndef THOR_VECTOR_H
+#include "vector.h"
+#endif
+
+#ifndef THOR_MEMORY_H
+#include "memory.h"
+#endif
+
+namespace thor
+{
+
+template <class T, size_type T_NODE_BYTES = 256> class unrolled_list
+{
+    struct unrolled_node;
+public:
+    typedef T               value_type;
+    typedef T*              pointer;
+    typedef T&              reference;
+    typedef const T*        const_pointer;
+    typedef const T&        const_reference;
+    typedef thor_size_type  size_type;
+    typedef thor_diff_type  difference_type;
+
+    // extension: the number of elements held by each node
+    enum { node_count = (T_NODE_BYTES / sizeof(T)) < 4 ? 4 : (T_NODE_BYTES / sizeof(T)) };
+
+    // Every node other than the first and last holds at least this many elements
+    enum { min_node_count = node_count / 4 };
+
+    // iterator definitions
+    // An iterator is a node and the index of an element within it. The end() iterator is the
+    // terminator node with index zero.
+    struct iterator_base : public iterator_type<bidirectional_iterator_tag, T>
+    {
+        unrolled_node*  m_node;
+        size_type       m_index;
+#ifdef THOR_DEBUG
+        const unrolled_list* m_list;
+        iterator_base(unrolled_node* n, size_type i, const unrolled_list* o) : m_node(n), m_index(i), m_list(o) {}
+#else
+        iterator_base(unrolled_node* n, size_type i, const unrolled_list*) : m_node(n), m_index(i) {}
+#endif
+        void verify_not_end() const { THOR_DEBUG_ASSERT(m_list->terminator() != m_node && m_index < m_node->count); }
+        void incr()
+        {
+            verify_not_end();
+            if (++m_index == m_node->count)
+            {
+                m_node = m_node->next;
+                m_index = 0;
+            }
+        }
+        void decr()
+        {
+            if (m_index == 0)
+            {
+                // Decrementing from the first element reaches the terminator, which has no
+                // elements; (terminator, 0) is end()/rend()
+                m_node = m_node->prev;
+                m_index = m_node->count;
+                if (m_index == 0)
+                {
+                    return;
+                }
+            }
+            --m_index;
+        }
+        bool operator == (const iterator_base& i) const { THOR_DEBUG_ASSERT(m_list == i.m_list); return m_node == i.m_node && m_index == i.m_index; }
+        bool operator != (const iterator_base& i) const { return !operator == (i); }
+    };
+
+    template<class Traits> class fwd_iterator : public iterator_base
+    {
+    public:
+        typedef typename Traits::pointer pointer;
+        typedef typename Traits::reference reference;
+        typedef fwd_iterator<nonconst_traits<T> > nonconst_iterator;
+        typedef fwd_iterator<Traits> selftype;
+
+        fwd_iterator(unrolled_node* n = 0, size_type i = 0, const unrolled_list* l = 0) : iterator_base(n, i, l) {}
+        fwd_iterator(const nonconst_iterator& i) : iterator_base(i) {}
+        selftype&  operator = (const nonconst_iterator& i)  { iterator_base::operator = (i); return *this; }
+        reference  operator * ()  const                     { this->verify_not_end(); return this->m_node->values[this->m_index]; }
+        pointer    operator -> () const                     { return &(operator*()); }
+        selftype&  operator -- ()     /* --iterator */      {                    this->decr(); return *this; }
+        selftype   operator -- (int)  /* iterator-- */      { selftype n(*this); this->decr(); return n; }
+        selftype&  operator ++ ()     /* ++iterator */      {                    this->incr(); return *this; }
+        selftype   operator ++ (int)  /* iterator++ */      { selftype n(*this); this->incr(); return n; }
+    };
+
+    template<class Traits> class rev_iterator : public iterator_base
+    {
+    public:
+        typedef typename Traits::pointer pointer;
+        typedef typename Traits::reference reference;
+        typedef rev_iterator<nonconst_traits<T> > nonconst_iterator;
+        typedef rev_iterator<Traits> selftype;
+
+        rev_iterator(unrolled_node* n = 0, size_type i = 0, const unrolled_list* l = 0) : iterator_base(n, i, l) {}
+        rev_iterator(const nonconst_iterator& i) : iterator_base(i) {}
+        selftype&  operator = (const nonconst_iterator& i)  { iterator_base::operator = (i); return *this; }
+        reference  operator * ()  const                     { this->verify_not_end(); return this->m_node->values[this->m_index]; }
+        pointer    operator -> () const                     { return &(operator*()); }
+        selftype&  operator -- ()     /* --iterator */      {                    this->incr(); return *this; }
+        selftype   operator -- (int)  /* iterator-- */      { selftype n(*this); this->incr(); return n; }
+        selftype&  operator ++ ()     /* ++iterator */      {                    this->decr(); return *this; }
+        selftype   operator ++ (int)  /* iterator++ */      { selftype n(*this); this->decr(); return n; }
+    };
+
+    typedef fwd_iterator<nonconst_traits<T> > iterator;
+    typedef fwd_iterator<const_traits<T>    > const_iterator;
+
+    typedef rev_iterator<nonconst_traits<T> > reverse_iterator;
+    typedef rev_iterator<const_traits<T>    > const_reverse_iterator;
+
+    // Constructors
+    unrolled_list() :
+        m_head(terminator(), terminator()),
+        m_size(0)
+    {}
+
+    explicit unrolled_list(size_type n) :
+        m_head(terminator(), terminator()),
+        m_size(0)
+    {
+        while (n-- != 0)
+        {
+            push_back();
+        }
+    }
+
+    unrolled_list(size_type n, const T& t) :
+        m_head(terminator(), terminator()),
+        m_size(0)
+    {
+        insert(end(), n, t);
+    }
+
+    unrolled_list(const unrolled_list& L) :
+        m_head(terminator(), terminator()),
+        m_size(0)
+    {
+        insert(end(), L.begin(), L.end());
+    }
+
+    template <class InputIterator> unrolled_list(InputIterator first, InputIterator last) :
+        m_head(terminator(), terminator()),
+        m_size(0)
+    {
+        insert(end(), first, last);
+    }
+
+    ~unrolled_list()
+    {
+        clear();
+    }
+
+    // Forward iteration
+    iterator begin()                                { return iterator(m_head.next, 0, this); }
+    const_iterator begin() const                    { return const_iterator(m_head.next, 0, this); }
+    iterator end()                                  { return iterator(terminator(), 0, this); }
+    const_iterator end() const                      { return const_iterator(terminator(), 0, this); }
+
+    // Reverse iteration
+    reverse_iterator rbegin()                       { return reverse_iterator(m_head.prev, last_index(), this); }
+    const_reverse_iterator rbegin() const           { return const_reverse_iterator(m_head.prev, last_index(), this); }
+    reverse_iterator rend()                         { return reverse_iterator(terminator(), 0, this); }
+    const_reverse_iterator rend() const             { return const_reverse_iterator(terminator(), 0, this); }
+
+    // Size
+    size_type size() const                          { return m_size; }
+    size_type max_size() const                      { return size_type(-1); }
+    bool empty() const                              { return m_size == 0; }
+
+    unrolled_list& operator = (const unrolled_list& L)
+    {
+        if (this != &L)
+        {
+            // Assign over existing elements, then add or remove the difference
+            iterator write = begin();
+            iterator wend  = end();
+            const_iterator read = L.begin();
+            const_iterator rend = L.end();
+            while (write != wend && read != rend)
+            {
+                *write = *read;
+                ++write, ++read;
+            }
+
+            if (read != rend)
+            {
+                insert(wend, read, rend);
+            }
+            else
+            {
+                erase(write, wend);
+            }
+        }
+        return *this;
+    }
+
+    // Accessing elements
+    T& front()
+    {
+        THOR_ASSERT(!empty());
+        return m_head.next->values[0];
+    }
+
+    const T& front() const
+    {
+        THOR_ASSERT(!empty());
+        return m_head.next->values[0];
+    }
+
+    T& back()
+    {
+        THOR_ASSERT(!empty());
+        return m_head.prev->values[last_index()];
+    }
+
+    const T& back() const
+    {
+        THOR_ASSERT(!empty());
+        return m_head.prev->values[last_index()];
+    }
+
+    // extension: returns a pointer to the element at pos; count receives the number of elements
+    // from pos to the end of its node
+    T* get_contiguous(iterator pos, size_type& count)
+    {
+        verify_iterator(pos);
+        pos.verify_not_end();
+        count = pos.m_node->count - pos.m_index;
+        return &pos.m_node->values[pos.m_index];
+    }
+
+    const T* get_contiguous(const_iterator pos, size_type& count) const
+    {
+        verify_iterator(pos);
+        pos.verify_not_end();
+        count = pos.m_node->count - pos.m_index;
+        return &pos.m_node->values[pos.m_index];
+    }
+
+    // Adding elements to the front of the list
+    T& push_front()
+    {
+        T* p = alloc_front();
+        typetraits<T>::construct(p);
+        return *p;
+    }
+    template <class T1> T& push_front(const T1& t1)
+    {
+        T* p = alloc_front();
+        typetraits<T>::construct(p, t1);
+        return *p;
+    }
+    template <class T1, class T2> T& push_front(const T1& t1, const T2& t2)
+    {
+        T* p = alloc_front();
+        typetraits<T>::construct(p, t1, t2);
+        return *p;
+    }
+    template <class T1, class T2, class T3> T& push_front(const T1& t1, const T2& t2, const T3& t3)
+    {
+        T* p = alloc_front();
+        typetraits<T>::construct(p, t1, t2, t3);
+        return *p;
+    }
+    template <class T1, class T2, class T3, class T4> T& push_front(const T1& t1, const T2& t2, const T3& t3, const T4& t4)
+    {
+        T* p = alloc_front();
+        typetraits<T>::construct(p, t1, t2, t3, t4);
+        return *p;
+    }
+    // Requires the use of placement new to construct the element.
+    // Example: new (l.push_front_placement()) Element(arg1, arg2);
+    void* push_front_placement()
+    {
+        return alloc_front();
+    }
+
+    // Adding elements to the back of the list
+    T& push_back()
+    {
+        T* p = alloc_back();
+        typetraits<T>::construct(p);
+        return *p;
+    }
+    template <class T1> T& push_back(const T1& t1)
+    {
+        T* p = alloc_back();
+        typetraits<T>::construct(p, t1);
+        return *p;
+    }
+    template <class T1, class T2> T& push_back(const T1& t1, const T2& t2)
+    {
+        T* p = alloc_back();
+        typetraits<T>::construct(p, t1, t2);
+        return *p;
+    }
+    template <class T1, class T2, class T3> T& push_back(const T1& t1, const T2& t2, const T3& t3)
+    {
+        T* p = alloc_back();
+        typetraits<T>::construct(p, t1, t2, t3);
+        return *p;
+    }
+    template <class T1, class T2, class T3, class T4> T& push_back(const T1& t1, const T2& t2, const T3& t3, const T4& t4)
+    {
+        T* p = alloc_back();
+        typetraits<T>::construct(p, t1, t2, t3, t4);
+        return *p;
+    }
+    // Requires the use of placement new to construct the element.
+    // Example: new (l.push_back_placement()) Element(arg1, arg2);
+    void* push_back_placement()
+    {
+        return alloc_back();
+    }
+
+    void pop_front()
+    {
+        THOR_DEBUG_ASSERT(!empty());
+        if (!empty())
+        {
+            erase(begin());
+        }
+    }
+
+    // Like pop_front(), only deletes the front value as well. Only valid
+    // for pointer types.
+    void pop_front_delete()
+    {
+        if (!empty())
+        {
+            delete front();
+            erase(begin());
+        }
+    }
+
+    void pop_back()
+    {
+        THOR_DEBUG_ASSERT(!empty());
+        if (!empty())
+        {
+            erase(iterator(m_head.prev, last_index(), this));
+        }
+    }
+
+    // Like pop_back(), only deletes the back value as well. Only valid
+    // for pointer types.
+    void pop_back_delete()
+    {
+        if (!empty())
+        {
+            delete back();
+            erase(iterator(m_head.prev, last_index(), this));
+        }
+    }
+
+    void swap(unrolled_list& L)
+    {
+        THOR_ASSERT(this != &L);
+
+        // must fix up terminators first
+        // also note that pointers must be assigned simultaneously (i.e. m_head.prev->next = m_head.next->prev = terminator() doesn't work)
+        unrolled_node *&Rhead = m_head.next->prev,   *&Rtail = m_head.prev->next;
+        unrolled_node *&Lhead = L.m_head.next->prev, *&Ltail = L.m_head.prev->next;
+        Rhead = Rtail = L.terminator();
+        Lhead = Ltail = terminator();
+
+        thor::swap(m_head, L.m_head);
+        thor::swap(m_size, L.m_size);
+    }
+
+    template <class InputIterator> void assign(InputIterator first, InputIterator last)
+    {
+        clear();
+        insert(end(), first, last);
+    }
+
+    void assign(size_type n, const T& u)
+    {
+        clear();
+        insert(end(), n, u);
+    }
+
+    iterator insert(iterator pos)
+    {
+        T* p = alloc_insert(pos);
+        typetraits<T>::construct(p);
+        return pos;
+    }
+    template <class T1> iterator insert(iterator pos, const T1& t1)
+    {
+        T* p = alloc_insert(pos);
+        typetraits<T>::construct(p, t1);
+        return pos;
+    }
+    template <class T1, class T2> iterator insert(iterator pos, const T1& t1, const T2& t2)
+    {
+        T* p = alloc_insert(pos);
+        typetraits<T>::construct(p, t1, t2);
+        return pos;
+    }
+    template <class T1, class T2, class T3> iterator insert(iterator pos, const T1& t1, const T2& t2, const T3& t3)
+    {
+        T* p = alloc_insert(pos);
+        typetraits<T>::construct(p, t1, t2, t3);
+        return pos;
+    }
+    template <class T1, class T2, class T3, class T4> iterator insert(iterator pos, const T1& t1, const T2& t2, const T3& t3, const T4& t4)
+    {
+        T* p = alloc_insert(pos);
+        typetraits<T>::construct(p, t1, t2, t3, t4);
+        return pos;
+    }
+    // Requires the use of placement new to construct the element.
+    // Example: new (l.insert_placement(pos)) Element(arg1, arg2);
+    void* insert_placement(iterator pos)
+    {
+        return alloc_insert(pos);
+    }
+
+    // The elements are built in full nodes of their own that are spliced in before pos, so only
+    // pos's node is changed. This also allows [first, last) to be a range of this list.
+    template <class InputIterator> void insert(iterator pos, InputIterator first, InputIterator last)
+    {
+        verify_iterator(pos);
+        unrolled_list L;
+        for (; first != last; ++first)
+        {
+            L.push_back(*first);
+        }
+        splice(pos, L);
+    }
+
+    void insert(iterator pos, size_type n, const T& t)
+    {
+        verify_iterator(pos);
+        unrolled_list L;
+        while (n-- != 0)
+        {
+            L.push_back(t);
+        }
+        splice(pos, L);
+    }
+
+    iterator erase(iterator pos)
+    {
+        verify_iterator(pos);
+        pos.verify_not_end();
+        erase_elements(pos, 1);
+        return pos;
+    }
+
+    iterator erase(iterator first, iterator last)
+    {
+        verify_iterator(first);
+        verify_iterator(last);
+
+        // Erase a node's worth at a time. last may be invalidated by merging nodes, so only the
+        // number of elements is used.
+        size_type count = 0;
+        for (iterator i(first); i.m_node != last.m_node; i = iterator(i.m_node->next, 0, this))
+        {
+            count += i.m_node->count - i.m_index;
+        }
+        count += last.m_index;
+        count -= (first.m_node == last.m_node) ? first.m_index : 0;
+
+        while (count != 0)
+        {
+            const size_type n = min(count, first.m_node->count - first.m_index);
+            erase_elements(first, n);
+            count -= n;
+        }
+        return first;
+    }
+
+    // Similar to erase(pos), but also deletes the element. Only valid for pointer types.
+    iterator erase_and_delete(iterator pos)
+    {
+        verify_iterator(pos);
+        pos.verify_not_end();
+        delete *pos;
+        return erase(pos);
+    }
+
+    void clear()
+    {
+        unrolled_node* node = m_head.next;
+        m_size = 0;
+        m_head.prev = m_head.next = terminator();
+        while (node != terminator())
+        {
+            unrolled_node* next = node->next;
+            typetraits<T>::range_destruct(node->values, node->values + node->count);
+            free_node(node);
+            node = next;
+        }
+    }
+
+    void resize(size_type n, const T& t = T())
+    {
+        if (size() <= n)
+        {
+            // Grow
+            insert(end(), n - m_size, t);
+        }
+        else
+        {
+            // Shrink
+            iterator first(begin());
+            advance(first, n);
+            erase(first, end());
+        }
+    }
+
+    // Moves all of the elements of L before pos. The node at pos is split so that L's nodes can be
+    // linked in as they are.
+    void splice(iterator pos, unrolled_list& L)
+    {
+        THOR_ASSERT(this != &L);
+        verify_iterator(pos);
+        if (!L.empty() && this != &L)
+        {
+            unrolled_node* before = pos.m_node;
+            if (pos.m_index != 0)
+            {
+                before = split_node(pos.m_node, pos.m_index);
+            }
+
+            unrolled_node* first = L.m_head.next;
+            unrolled_node* last = L.m_head.prev;
+            unrolled_node* previous = before->prev;
+            previous->next = first;
+            first->prev = previous;
+            before->prev = last;
+            last->next = before;
+            m_size += L.m_size;
+
+            // Reset L
+            L.m_head.prev = L.m_head.next = L.terminator();
+            L.m_size = 0;
+
+            // Only the nodes at the two seams can be below the minimum. Each rebalance() can only
+            // free the node that it is given, so the later nodes remain valid.
+            iterator unused(end());
+            rebalance(previous, unused);
+            rebalance(first, unused);
+            if (last != first)
+            {
+                rebalance(last, unused);
+            }
+            rebalance(before, unused);
+        }
+    }
+
+    // Copies the element at i before pos and erases it from L
+    void splice(iterator pos, unrolled_list& L, iterator i)
+    {
+        THOR_ASSERT(this != &L);
+        L.verify_iterator(i);
+        i.verify_not_end();
+        insert(pos, *i);
+        L.erase(i);
+    }
+
+    // Copies [first, last) before pos and erases them from L
+    void splice(iterator pos, unrolled_list& L, iterator first, iterator last)
+    {
+        THOR_ASSERT(this != &L);
+        insert(pos, first, last);
+        L.erase(first, last);
+    }
+
+    void remove(const T& value)
+    {
+        erase(thor::remove(begin(), end(), value), end());
+    }
+
+    // list must be sorted in order to use this
+    void unique()
+    {
+        erase(thor::unique(begin(), end()), end());
+    }
+
+    // list must be sorted in order to use this
+    template <class BinaryPredicate> void unique(BinaryPredicate pred)
+    {
+        erase(thor::unique(begin(), end(), pred), end());
+    }
+
+    void merge(unrolled_list& L)
+    {
+        merge_internal(L, less<T>());
+    }
+
+    template <class StrictWeakOrdering> void merge(unrolled_list& L, StrictWeakOrdering comp)
+    {
+        merge_internal(L, comp);
+    }
+
+    void sort()
+    {
+        sort_internal(less<T>());
+    }
+
+    template <class Compare> void sort(Compare comp)
+    {
+        sort_internal(comp);
+    }
+
+    // extensions
+    bool validate() const
+    {
+#define THOR_ASSERT_RETURN(expr) THOR_ASSERT(expr); if (!(expr)) return false
+        THOR_ASSERT_RETURN(m_head.next->prev == terminator());
+        THOR_ASSERT_RETURN(m_head.prev->next == terminator());
+        THOR_ASSERT_RETURN(m_head.count == 0);
+        size_type localcount = 0;
+        unrolled_node* n = m_head.next;
+        while (n != terminator())
+        {
+            THOR_ASSERT_RETURN(n->next->prev == n);
+            THOR_ASSERT_RETURN(n->prev->next == n);
+            THOR_ASSERT_RETURN(n->count != 0 && n->count <= size_type(node_count));
+            THOR_ASSERT_RETURN(n->count >= size_type(min_node_count) || n->prev == terminator() || n->next == terminator());
+            localcount += n->count;
+            n = n->next;
+        }
+        THOR_ASSERT_RETURN(localcount == m_size);
+        return true;
+#undef THOR_ASSERT_RETURN
+    }
+
+    void delete_all()
+    {
+        for (iterator i(begin()); i != end(); ++i)
+        {
+            delete *i;
+        }
+        clear();
+    }
+
+private:
+    struct unrolled_node_base
+    {
+        unrolled_node*  next;
+        unrolled_node*  prev;
+        size_type       count;
+        unrolled_node_base(unrolled_node* n = 0, unrolled_node* p = 0) : next(n), prev(p), count(0) {}
+    };
+
+    // The unrolled_node class is never actually constructed. After memory is allocated, the
+    // unrolled_node_base is constructed and values [0, count) are constructed as they are needed.
+    struct unrolled_node : public unrolled_node_base
+    {
+        T values[node_count];
+    };
+
+    typedef memory::align_alloc<unrolled_node> align_alloc;
+
+    // (address of)m_head also happens to be the end() node (see terminator()). m_head.next is the
+    // first node and m_head.prev is the last node. The terminator has a count of zero.
+    unrolled_node_base  m_head;
+    size_type           m_size;
+
+    unrolled_node* terminator() const { return (unrolled_node*)&m_head; }
+
+    size_type last_index() const { return m_head.prev->count - (empty() ? 0 : 1); }
+
+    void verify_iterator(const iterator_base& i) const { THOR_UNUSED(i); THOR_ASSERT(i.m_list == this); }
+
+    // Allocates an empty node and links it in before 'before'
+    unrolled_node* insert_node(unrolled_node* before)
+    {
+        unrolled_node* node = align_alloc::alloc();
+        THOR_DEBUG_ASSERT(align_alloc::is_aligned(node));
+        new (node) unrolled_node_base(before, before->prev);
+        node->prev->next = node;
+        node->next->prev = node;
+        return node;
+    }
+
+    // The node's values must already be destructed
+    void free_node(unrolled_node* node)
+    {
+        THOR_ASSERT(node != terminator());
+        ((unrolled_node_base*)node)->~unrolled_node_base();
+        align_alloc::free(node);
+    }
+
+    // Unlinks and frees a node whose values are already destructed
+    void remove_node(unrolled_node* node)
+    {
+        node->prev->next = node->next;
+        node->next->prev = node->prev;
+        free_node(node);
+    }
+
+    // Moves the values [index, count) of node to a new node that follows it; returns the new node
+    unrolled_node* split_node(unrolled_node* node, size_type index)
+    {
+        unrolled_node* next = insert_node(node->next);
+        next->count = node->count - index;
+        typetraits<T>::range_move(next->values, next->values + next->count, node->values + index);
+        node->count = index;
+        return next;
+    }
+
+    // Moves all values of 'from' to the end of 'to' and frees 'from'
+    void merge_nodes(unrolled_node* to, unrolled_node* from)
+    {
+        THOR_DEBUG_ASSERT(to->count + from->count <= size_type(node_count));
+        typetraits<T>::range_move(to->values + to->count, to->values + to->count + from->count, from->values);
+        to->count += from->count;
+        remove_node(from);
+    }
+
+    // Makes room for an unconstructed element before pos and returns it; pos is updated to refer to
+    // the new element.
+    T* alloc_insert(iterator& pos)
+    {
+        verify_iterator(pos);
+        unrolled_node* node = pos.m_node;
+        size_type index = pos.m_index;
+
+        unrolled_node* prev = node->prev;
+        if (index == 0 && prev != terminator() && prev->count < size_type(node_count))
+        {
+            // Append to the previous node: no values need to move
+            node = prev;
+            index = prev->count;
+        }
+        else if (node == terminator() || (index == 0 && prev == terminator() && node->count == size_type(node_count)))
+        {
+            // A new first or last node, which may hold fewer than min_node_count
+            node = insert_node(node);
+        }
+        else if (node->count == size_type(node_count))
+        {
+            // Split the full node in half and insert into the half that pos is in
+            const size_type half = node_count / 2;
+            unrolled_node* next = split_node(node, half);
+            if (index > half)
+            {
+                node = next;
+                index -= half;
+            }
+        }
+
+        // Shift [index, count) up by one
+        T* values = node->values;
+        const size_type count = node->count;
+        if (index < count)
+        {
+            typetraits<T>::construct(values + count, values[count - 1]);
+            typetraits<T>::copy_backwards(values + index + 1, values + index, count - 1 - index);
+            typetraits<T>::destruct(values + index);
+        }
+        ++node->count;
+        ++m_size;
+
+        pos.m_node = node;
+        pos.m_index = index;
+        return values + index;
+    }
+
+    T* alloc_front()
+    {
+        iterator pos(begin());
+        return alloc_insert(pos);
+    }
+
+    T* alloc_back()
+    {
+        unrolled_node* node = m_head.prev;
+        if (node == terminator() || node->count == size_type(node_count))
+        {
+            node = insert_node(terminator());
+        }
+        ++m_size;
+        return node->values + node->count++;
+    }
+
+    // Erases n elements of pos's node starting at pos, then merges the node with a neighbor if the
+    // two together are at most half full, or rebalances it if it is below min_node_count. pos is
+    // updated to the element that followed the last one erased.
+    void erase_elements(iterator& pos, size_type n)
+    {
+        unrolled_node* node = pos.m_node;
+        size_type index = pos.m_index;
+        THOR_DEBUG_ASSERT(n != 0 && index + n <= node->count);
+
+        T* values = node->values;
+        typetraits<T>::copy_overlap(values + index, values + index + n, node->count - index - n);
+        typetraits<T>::range_destruct(values + node->count - n, values + node->count);
+        node->count -= n;
+        m_size -= n;
+
+        if (node->count == 0)
+        {
+            unrolled_node* next = node->next;
+            remove_node(node);
+            node = next;
+            index = 0;
+        }
+        else
+        {
+            unrolled_node* prev = node->prev;
+            unrolled_node* next = node->next;
+            if (prev != terminator() && (prev->count + node->count) <= size_type(node_count / 2))
+            {
+                index += prev->count;
+                merge_nodes(prev, node);
+                node = prev;
+            }
+            else if (next != terminator() && (node->count + next->count) <= size_type(node_count / 2))
+            {
+                merge_nodes(node, next);
+            }
+
+            pos.m_node = node;
+            pos.m_index = index;
+            rebalance(node, pos);
+            node = pos.m_node;
+            index = pos.m_index;
+
+            if (index == node->count)
+            {
+                node = node->next;
+                index = 0;
+            }
+        }
+
+        pos.m_node = node;
+        pos.m_index = index;
+    }
+
+    // If node is neither the first nor the last node and holds fewer than min_node_count elements,
+    // it is merged into a neighbor that has room (and freed), or else takes elements from the front
+    // of its next node until the two are balanced. No node other than 'node' is freed. pos may be
+    // one past the last element of a node, and is updated if the element it refers to moves.
+    void rebalance(unrolled_node* node, iterator& pos)
+    {
+        unrolled_node* prev = node->prev;
+        unrolled_node* next = node->next;
+        if (node == terminator() || prev == terminator() || next == terminator() ||
+            node->count >= size_type(min_node_count))
+        {
+            return;
+        }
+
+        const size_type count = node->count;
+        if (prev->count + count <= size_type(node_count))
+        {
+            if (pos.m_node == node)
+            {
+                pos.m_node = prev;
+                pos.m_index += prev->count;
+            }
+            merge_nodes(prev, node);
+        }
+        else if (count + next->count <= size_type(node_count))
+        {
+            // Move next's values up and node's values in front of them
+            shift_up(next, count);
+            typetraits<T>::range_move(next->values, next->values + count, node->values);
+            next->count += count;
+            if (pos.m_node == next)
+            {
+                pos.m_index += count;
+            }
+            else if (pos.m_node == node)
+            {
+                pos.m_node = next;
+            }
+            remove_node(node);
+        }
+        else
+        {
+            // Both neighbors are nearly full: take half of the difference from next
+            const size_type n = (next->count - count) / 2;
+            T* values = next->values;
+            typetraits<T>::range_construct(node->values + count, node->values + count + n, values);
+            typetraits<T>::copy_overlap(values, values + n, next->count - n);
+            typetraits<T>::range_destruct(values + next->count - n, values + next->count);
+            node->count += n;
+            next->count -= n;
+            if (pos.m_node == next)
+            {
+                if (pos.m_index < n)
+                {
+                    pos.m_node = node;
+                    pos.m_index += count;
+                }
+                else
+                {
+                    pos.m_index -= n;
+                }
+            }
+        }
+    }
+
+    // Moves the values of node up by n, leaving [0, n) unconstructed. node->count is not changed.
+    void shift_up(unrolled_node* node, size_type n)
+    {
+        T* values = node->values;
+        const size_type count = node->count;
+        if (n >= count)
+        {
+            typetraits<T>::range_move(values + n, values + n + count, values);
+        }
+        else
+        {
+            typetraits<T>::range_construct(values + count, values + count + n, values + count - n);
+            typetraits<T>::copy_backwards(values + n, values, count - n);
+            typetraits<T>::range_destruct(values, values + n);
+        }
+    }
+
+    template <class StrictWeakOrdering> void merge_internal(unrolled_list& L, StrictWeakOrdering comp)
+    {
+        THOR_ASSERT(this != &L);
+        if (this != &L && !L.empty())
+        {
+            unrolled_list merged;
+            const_iterator i1(begin()), e1(end()), i2(L.begin()), e2(L.end());
+            while (i1 != e1 && i2 != e2)
+            {
+                // Equivalent elements are taken from this list first
+                if (comp(*i2, *i1))
+                {
+                    merged.push_back(*i2++);
+                }
+                else
+                {
+                    merged.push_back(*i1++);
+                }
+            }
+            merged.insert(merged.end(), i1, e1);
+            merged.insert(merged.end(), i2, e2);
+            swap(merged);
+            L.clear();
+        }
+    }
+
+    template <class StrictWeakOrdering> void sort_internal(StrictWeakOrdering order)
+    {
+        if (size() < 2)
+        {
+            return;
+        }
+
+        vector<T> sorted(begin(), end());
+        thor::stable_sort(sorted.begin(), sorted.end(), order);
+        thor::copy(sorted.begin(), sorted.end(), begin());
+    }
+};
+
+// Swap specialization
+template <class T, size_type T_NODE_BYTES> void swap(unrolled_list<T, T_NODE_BYTES>& lhs, unrolled_list<T, T_NODE_BYTES>& rhs)
+{
+    lhs.swap(rhs);
+}
+
+} // namespace thor
+
+// Global operators
+template <class T, thor::size_type T_NODE_BYTES> bool operator == (const thor::unrolled_list<T, T_NODE_BYTES>& l1, const thor::unrolled_list<T, T_NODE_BYTES>& l2)
+{
+    return l1.size() == l2.size() && thor::equal(l1.begin(), l1.end(), l2.begin());
+}
+
+template <class T, thor::size_type T_NODE_BYTES> bool operator != (const thor::unrolled_list<T, T_NODE_BYTES>& l1, const thor::unrolled_list<T, T_NODE_BYTES>& l2)
+{
+    return !(l1 == l2);
+}
+
+template <class T, thor::size_type T_NODE_BYTES> bool operator < (const thor::unrolled_list<T, T_NODE_BYTES>& l1, const thor::unrolled_list<T, T_NODE_BYTES>& l2)
+{
+    return thor::lexicographical_compare(l1.begin(), l1.end(), l2.begin(), l2.end());
+}
+
+template <class T, thor::size_type T_NODE_BYTES> bool operator > (const thor::unrolled_list<T, T_NODE_BYTES>& l1, const thor::unrolled_list<T, T_NODE_BYTES>& l2)
+{
+    return thor::lexicographical_compare(l1.begin(), l1.end(), l2.begin(), l2.end(), thor::greater<T>());
+}
+
+template <class T, thor::size_type T_NODE_BYTES> bool operator <= (const thor::unrolled_list<T, T_NODE_BYTES>& l1, const thor::unrolled_list<T, T_NODE_BYTES>& l2)
+{
+    return !(l1 > l2);
+}
+
+template <class T, thor::size_type T_NODE_BYTES> bool operator >= (const thor::unrolled_list<T, T_NODE_BYTES>& l1, const thor::unrolled_list<T, T_NODE_BYTES>& l2)
+{
+    return !(l1 < l2);
+}
+
+#endif
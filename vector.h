@@ -132,6 +132,10 @@ public:
         selftype   operator ++ (int)  /* iterator++ */      { selftype n(*this); incr();           return n; }
 
         difference_type operator - (const selftype& t) const { THOR_DEBUG_ASSERT(m_vector == t.m_vector); return m_element - t.m_element; }
+
+        // Elements are contiguous, so algorithms may operate on pointers instead (see algorithm.h)
+        friend pointer  __unwrap_iter(const selftype& i)                { return i.m_element; }
+        friend selftype __rewrap_iter(const selftype& i, pointer p)     { return i + (p - i.m_element); }
     };
 
     // Reverse iterator template
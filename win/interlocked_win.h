@@ -33,6 +33,9 @@ __int64 _InterlockedCompareExchange64(__int64 volatile *, __int64, __int64);
 __int64 _InterlockedIncrement64(__int64 volatile *);
 __int64 _InterlockedDecrement64(__int64 volatile *);
 __int64 _InterlockedExchange64(__int64 volatile *, __int64);
+
+void _ReadWriteBarrier(void);
+void _mm_mfence(void);
 };
 
 // inc/dec for 8-bit doesn't exist, so do our own:
@@ -69,6 +72,10 @@ inline char _InterlockedDecrement8(char volatile *p)
 #pragma intrinsic(_InterlockedExchange)
 
 #pragma intrinsic(_InterlockedCompareExchange64)
+
+#pragma intrinsic(_ReadWriteBarrier)
+#pragma intrinsic(_mm_mfence)
+
 #if defined(_M_X64)
 #pragma intrinsic(_InterlockedIncrement64)
 #pragma intrinsic(_InterlockedDecrement64)
@@ -169,6 +176,13 @@ template<typename T> struct interlocked<T, 8>
     static T exchange(T volatile *a, T b) { return cvt::as_type(_InterlockedExchange64(cvt::as_pointer(a), cvt::as_value(b))); }
 };
 
+// Memory ordering. x86/x64 never reorders loads with older loads or stores with older stores, so
+// acquire/release ordering only has to keep the compiler from moving accesses. A full fence is only
+// needed when a store must become visible before a subsequent load.
+inline void acquire_barrier() { _ReadWriteBarrier(); }
+inline void release_barrier() { _ReadWriteBarrier(); }
+inline void memory_barrier()  { _mm_mfence(); }
+
 }
 
 }
@@ -12,6 +12,8 @@
 
 #include "../debug.h"
 
+#include "../temporary_buffer.h"
+
 #define WIN32_EXTRA_LEAN 1
 #include <Windows.h>
 
@@ -58,6 +60,9 @@ unsigned __stdcall thread_base::start_thread_proc(void* param)
 {
     thread_base* p = reinterpret_cast<thread_base*>(param);
     p->begin_run();
+
+    // Free any scratch memory kept for sorting by this thread
+    __temporary_buffer_pool<>::release();
     return 0;
 }
 